@@ -1,5 +1,18 @@
+// for syscall
+#if defined PURPL_LINUX && !defined _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "engine/engine.h"
 
+#ifdef PURPL_LINUX
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 static PVOID EcsMalloc(ecs_size_t Size)
 {
     return CmnAlloc(1, Size);
@@ -32,8 +45,7 @@ static PVOID EcsThreadJoin(ecs_os_thread_t Thread)
 
 static ecs_os_thread_id_t EcsThreadSelf(VOID)
 {
-    // Purpl threads don't have IDs
-    return 0;
+    return (ecs_os_thread_id_t)EngGetThreadId();
 }
 
 static ecs_os_mutex_t EcsMutexNew(VOID)
@@ -56,6 +68,102 @@ static VOID EcsMutexUnlock(ecs_os_mutex_t Mutex)
     AsUnlockMutex((PAS_MUTEX)Mutex);
 }
 
+#ifdef PURPL_LINUX
+// A condition variable is a sequence number. Waiters read it with the mutex held and sleep until it changes, and
+// signalling bumps it before waking them, so a signal between unlocking and sleeping makes the futex return right away
+// instead of being lost. Spurious wakeups are allowed, flecs checks its condition again after every wait.
+PURPL_MAKE_TAG(struct, ECS_CONDITION, { UINT32 Sequence; })
+
+static INT64 Futex(_In_ UINT32 *Address, _In_ INT32 Operation, _In_ UINT32 Value)
+{
+    return syscall(SYS_futex, Address, Operation, Value, NULL, NULL, 0);
+}
+
+static ecs_os_cond_t EcsCondNew(VOID)
+{
+    PECS_CONDITION Condition = CmnAllocType(1, ECS_CONDITION);
+    if (!Condition)
+    {
+        CmnError("Failed to allocate condition variable: %s", strerror(errno));
+    }
+
+    return (ecs_os_cond_t)Condition;
+}
+
+static VOID EcsCondFree(ecs_os_cond_t Condition)
+{
+    CmnFree((PVOID)Condition);
+}
+
+static VOID EcsCondSignal(ecs_os_cond_t Condition)
+{
+    PECS_CONDITION Real = (PECS_CONDITION)Condition;
+    __atomic_add_fetch(&Real->Sequence, 1, __ATOMIC_RELEASE);
+    Futex(&Real->Sequence, FUTEX_WAKE_PRIVATE, 1);
+}
+
+static VOID EcsCondBroadcast(ecs_os_cond_t Condition)
+{
+    PECS_CONDITION Real = (PECS_CONDITION)Condition;
+    __atomic_add_fetch(&Real->Sequence, 1, __ATOMIC_RELEASE);
+    Futex(&Real->Sequence, FUTEX_WAKE_PRIVATE, INT_MAX);
+}
+
+static VOID EcsCondWait(ecs_os_cond_t Condition, ecs_os_mutex_t Mutex)
+{
+    PECS_CONDITION Real = (PECS_CONDITION)Condition;
+    UINT32 Sequence = __atomic_load_n(&Real->Sequence, __ATOMIC_ACQUIRE);
+
+    AsUnlockMutex((PAS_MUTEX)Mutex);
+    Futex(&Real->Sequence, FUTEX_WAIT_PRIVATE, Sequence);
+    AsLockMutex((PAS_MUTEX)Mutex, TRUE);
+}
+
+static int32_t EcsAtomicIncrement(int32_t *Value)
+{
+    return __atomic_add_fetch(Value, 1, __ATOMIC_ACQ_REL);
+}
+
+static int32_t EcsAtomicDecrement(int32_t *Value)
+{
+    return __atomic_sub_fetch(Value, 1, __ATOMIC_ACQ_REL);
+}
+
+static int64_t EcsAtomicIncrement64(int64_t *Value)
+{
+    return __atomic_add_fetch(Value, 1, __ATOMIC_ACQ_REL);
+}
+
+static int64_t EcsAtomicDecrement64(int64_t *Value)
+{
+    return __atomic_sub_fetch(Value, 1, __ATOMIC_ACQ_REL);
+}
+
+static VOID EcsSleep(INT32 Seconds, INT32 Nanoseconds)
+{
+    struct timespec Remaining = {Seconds, Nanoseconds};
+
+    // Signals cut it short, so it goes back to sleep for whatever's left
+    while (nanosleep(&Remaining, &Remaining) < 0 && errno == EINTR)
+    {
+    }
+}
+
+static uint64_t EcsNow(VOID)
+{
+    struct timespec Now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    return (uint64_t)Now.tv_sec * 1000000000 + (uint64_t)Now.tv_nsec;
+}
+
+static VOID EcsGetTime(ecs_time_t *Time)
+{
+    struct timespec Now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+    Time->sec = (UINT32)Now.tv_sec;
+    Time->nanosec = (UINT32)Now.tv_nsec;
+}
+#else
 static VOID EcsSleep(INT32 Seconds, INT32 Nanoseconds)
 {
     PlatSleep(Seconds * 1000 + Nanoseconds / 1000000);
@@ -63,7 +171,8 @@ static VOID EcsSleep(INT32 Seconds, INT32 Nanoseconds)
 
 static uint64_t EcsNow(VOID)
 {
-    return PlatGetMilliseconds() / 1000;
+    // Flecs wants nanoseconds
+    return PlatGetMilliseconds() * 1000000;
 }
 
 static VOID EcsGetTime(ecs_time_t* Time)
@@ -72,6 +181,7 @@ static VOID EcsGetTime(ecs_time_t* Time)
     Time->sec = (UINT32)(Now / 1000);
     Time->nanosec = (UINT32)((Now - Time->sec * 1000) * 1000000);
 }
+#endif
 
 static VOID EcsLog(_In_ INT32 Level, _In_z_ PCSTR File, _In_ INT32 Line, _In_z_ PCSTR Message)
 {
@@ -120,6 +230,8 @@ VOID ecs_set_os_api_impl(VOID)
     ecs_os_api.thread_join_ = EcsThreadJoin;
     ecs_os_api.thread_self_ = EcsThreadSelf;
 
+    // Flecs task threads wait on each other at sync points, so they can't share the job system's workers without
+    // deadlocking when there are more tasks than workers
     ecs_os_api.task_new_ = EcsThreadNew;
     ecs_os_api.task_join_ = EcsThreadJoin;
 
@@ -128,6 +240,19 @@ VOID ecs_set_os_api_impl(VOID)
     ecs_os_api.mutex_lock_ = EcsMutexLock;
     ecs_os_api.mutex_unlock_ = EcsMutexUnlock;
 
+#ifdef PURPL_LINUX
+    ecs_os_api.cond_new_ = EcsCondNew;
+    ecs_os_api.cond_free_ = EcsCondFree;
+    ecs_os_api.cond_signal_ = EcsCondSignal;
+    ecs_os_api.cond_broadcast_ = EcsCondBroadcast;
+    ecs_os_api.cond_wait_ = EcsCondWait;
+
+    ecs_os_api.ainc_ = EcsAtomicIncrement;
+    ecs_os_api.adec_ = EcsAtomicDecrement;
+    ecs_os_api.lainc_ = EcsAtomicIncrement64;
+    ecs_os_api.ladec_ = EcsAtomicDecrement64;
+#endif
+
     ecs_os_api.sleep_ = EcsSleep;
     ecs_os_api.get_time_ = EcsGetTime;
     ecs_os_api.now_ = EcsNow;
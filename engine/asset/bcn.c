@@ -0,0 +1,328 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    bcn.c
+
+Abstract:
+
+    This file decodes BC1, BC3 and BC7 blocks on the CPU, for backends that
+    can't sample them. BC7 is only decoded for the single subset modes (4, 5
+    and 6), which is everything packtool writes. Blocks in the partitioned
+    modes decode to magenta so they stand out.
+
+--*/
+
+#include "bcn.h"
+
+/// @brief Interpolation weights of BC7 indices, out of 64
+static CONST UINT8 Bc7Weights2[] = {0, 21, 43, 64};
+static CONST UINT8 Bc7Weights3[] = {0, 9, 18, 27, 37, 46, 55, 64};
+static CONST UINT8 Bc7Weights4[] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+UINT64 AstGetTextureSize(_In_ PCTEXTURE Texture)
+{
+    if (AstIsBlockCompressed(Texture->Format))
+    {
+        return AstGetBlockCompressedSize(Texture->Format, Texture->Width, Texture->Height);
+    }
+
+    return GetTextureSize(*Texture);
+}
+
+static VOID Unpack565(_In_ UINT16 Colour, _Out_ UINT8 Rgb[3])
+{
+    UINT32 Red = (Colour >> 11) & 0x1F;
+    UINT32 Green = (Colour >> 5) & 0x3F;
+    UINT32 Blue = Colour & 0x1F;
+
+    Rgb[0] = (UINT8)((Red << 3) | (Red >> 2));
+    Rgb[1] = (UINT8)((Green << 2) | (Green >> 4));
+    Rgb[2] = (UINT8)((Blue << 3) | (Blue >> 2));
+}
+
+static VOID DecodeColour(_In_ CONST UINT8 *Block, _In_ BOOLEAN AlwaysOpaque, _Out_ UINT8 Pixels[16][4])
+{
+    UINT16 Colour0 = (UINT16)(Block[0] | (Block[1] << 8));
+    UINT16 Colour1 = (UINT16)(Block[2] | (Block[3] << 8));
+    UINT32 Indices = (UINT32)Block[4] | ((UINT32)Block[5] << 8) | ((UINT32)Block[6] << 16) | ((UINT32)Block[7] << 24);
+
+    UINT8 Palette[4][4] = {0};
+    Unpack565(Colour0, Palette[0]);
+    Unpack565(Colour1, Palette[1]);
+    Palette[0][3] = 255;
+    Palette[1][3] = 255;
+
+    // BC3 always uses four colours, BC1 uses three and transparent black when the endpoints are in the other order
+    if (AlwaysOpaque || Colour0 > Colour1)
+    {
+        for (UINT32 i = 0; i < 3; i++)
+        {
+            Palette[2][i] = (UINT8)((2 * Palette[0][i] + Palette[1][i] + 1) / 3);
+            Palette[3][i] = (UINT8)((Palette[0][i] + 2 * Palette[1][i] + 1) / 3);
+        }
+        Palette[2][3] = 255;
+        Palette[3][3] = 255;
+    }
+    else
+    {
+        for (UINT32 i = 0; i < 3; i++)
+        {
+            Palette[2][i] = (UINT8)((Palette[0][i] + Palette[1][i]) / 2);
+        }
+        Palette[2][3] = 255;
+    }
+
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        memcpy(Pixels[i], Palette[(Indices >> (i * 2)) & 3], 4);
+    }
+}
+
+static VOID DecodeAlpha(_In_ CONST UINT8 *Block, _Inout_ UINT8 Pixels[16][4])
+{
+    UINT8 Palette[8];
+    Palette[0] = Block[0];
+    Palette[1] = Block[1];
+    if (Palette[0] > Palette[1])
+    {
+        for (UINT32 i = 2; i < 8; i++)
+        {
+            Palette[i] = (UINT8)(((8 - i) * Palette[0] + (i - 1) * Palette[1] + 3) / 7);
+        }
+    }
+    else
+    {
+        for (UINT32 i = 2; i < 6; i++)
+        {
+            Palette[i] = (UINT8)(((6 - i) * Palette[0] + (i - 1) * Palette[1] + 2) / 5);
+        }
+        Palette[6] = 0;
+        Palette[7] = 255;
+    }
+
+    UINT64 Indices = 0;
+    for (UINT32 i = 0; i < 6; i++)
+    {
+        Indices |= (UINT64)Block[2 + i] << (i * 8);
+    }
+
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        Pixels[i][3] = Palette[(Indices >> (i * 3)) & 7];
+    }
+}
+
+/// @brief Reads a BC7 block from the least significant bit up
+PURPL_MAKE_TAG(struct, BC7_READER, {
+    CONST UINT8 *Data;
+    UINT32 Position;
+})
+
+static UINT32 ReadBits(_Inout_ PBC7_READER Reader, _In_ UINT32 Count)
+{
+    UINT32 Value = 0;
+    for (UINT32 i = 0; i < Count; i++, Reader->Position++)
+    {
+        Value |= ((Reader->Data[Reader->Position / 8] >> (Reader->Position % 8)) & 1u) << i;
+    }
+
+    return Value;
+}
+
+static UINT8 ExpandBits(_In_ UINT32 Value, _In_ UINT32 Bits)
+{
+    Value <<= 8 - Bits;
+    return (UINT8)(Value | (Value >> Bits));
+}
+
+static UINT8 Interpolate(_In_ UINT8 Start, _In_ UINT8 End, _In_ UINT32 Weight)
+{
+    return (UINT8)(((64 - Weight) * Start + Weight * End + 32) >> 6);
+}
+
+// Reads 16 indices of the given size, the first one has its top bit implied to be 0
+static VOID ReadIndices(_Inout_ PBC7_READER Reader, _In_ UINT32 Bits, _Out_ UINT8 Indices[16])
+{
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        Indices[i] = (UINT8)ReadBits(Reader, i == 0 ? Bits - 1 : Bits);
+    }
+}
+
+static CONST UINT8 *GetWeights(_In_ UINT32 Bits)
+{
+    return Bits == 2 ? Bc7Weights2 : Bits == 3 ? Bc7Weights3 : Bc7Weights4;
+}
+
+static VOID DecodeBc7(_In_ CONST UINT8 *Block, _Out_ UINT8 Pixels[16][4])
+{
+    BC7_READER Reader = {Block, 0};
+
+    UINT32 Mode = 0;
+    while (Mode < 8 && !ReadBits(&Reader, 1))
+    {
+        Mode++;
+    }
+
+    UINT8 Endpoints[2][4];
+    UINT8 ColourIndices[16];
+    UINT8 AlphaIndices[16];
+    UINT32 ColourBits;
+    UINT32 AlphaBits;
+    UINT32 Rotation = 0;
+    switch (Mode)
+    {
+    case 4:
+    case 5: {
+        Rotation = ReadBits(&Reader, 2);
+        BOOLEAN SwapIndices = Mode == 4 && ReadBits(&Reader, 1);
+        UINT32 ColourPrecision = Mode == 4 ? 5 : 7;
+        UINT32 AlphaPrecision = Mode == 4 ? 6 : 8;
+        for (UINT32 Channel = 0; Channel < 3; Channel++)
+        {
+            for (UINT32 i = 0; i < 2; i++)
+            {
+                Endpoints[i][Channel] = ExpandBits(ReadBits(&Reader, ColourPrecision), ColourPrecision);
+            }
+        }
+        for (UINT32 i = 0; i < 2; i++)
+        {
+            Endpoints[i][3] = ExpandBits(ReadBits(&Reader, AlphaPrecision), AlphaPrecision);
+        }
+
+        // Mode 4 has a 2-bit and a 3-bit index per pixel, and a bit to say which one is for colour
+        UINT32 FirstBits = 2;
+        UINT32 SecondBits = Mode == 4 ? 3 : 2;
+        UINT8 First[16];
+        UINT8 Second[16];
+        ReadIndices(&Reader, FirstBits, First);
+        ReadIndices(&Reader, SecondBits, Second);
+        memcpy(ColourIndices, SwapIndices ? Second : First, sizeof(ColourIndices));
+        memcpy(AlphaIndices, SwapIndices ? First : Second, sizeof(AlphaIndices));
+        ColourBits = SwapIndices ? SecondBits : FirstBits;
+        AlphaBits = SwapIndices ? FirstBits : SecondBits;
+        break;
+    }
+    case 6: {
+        UINT32 Values[2][4];
+        for (UINT32 Channel = 0; Channel < 4; Channel++)
+        {
+            for (UINT32 i = 0; i < 2; i++)
+            {
+                Values[i][Channel] = ReadBits(&Reader, 7);
+            }
+        }
+        for (UINT32 i = 0; i < 2; i++)
+        {
+            UINT32 Parity = ReadBits(&Reader, 1);
+            for (UINT32 Channel = 0; Channel < 4; Channel++)
+            {
+                Endpoints[i][Channel] = (UINT8)((Values[i][Channel] << 1) | Parity);
+            }
+        }
+
+        ReadIndices(&Reader, 4, ColourIndices);
+        memcpy(AlphaIndices, ColourIndices, sizeof(AlphaIndices));
+        ColourBits = 4;
+        AlphaBits = 4;
+        break;
+    }
+    case 8:
+        // Not a valid block, which decodes to transparent black
+        memset(Pixels, 0, 16 * 4);
+        return;
+    default:
+        for (UINT32 i = 0; i < 16; i++)
+        {
+            Pixels[i][0] = 255;
+            Pixels[i][1] = 0;
+            Pixels[i][2] = 255;
+            Pixels[i][3] = 255;
+        }
+        return;
+    }
+
+    CONST UINT8 *ColourWeights = GetWeights(ColourBits);
+    CONST UINT8 *AlphaWeights = GetWeights(AlphaBits);
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        for (UINT32 Channel = 0; Channel < 3; Channel++)
+        {
+            Pixels[i][Channel] =
+                Interpolate(Endpoints[0][Channel], Endpoints[1][Channel], ColourWeights[ColourIndices[i]]);
+        }
+        Pixels[i][3] = Interpolate(Endpoints[0][3], Endpoints[1][3], AlphaWeights[AlphaIndices[i]]);
+
+        // Rotation swaps alpha with one of the colour channels, so that channel gets the separate indices
+        if (Rotation)
+        {
+            UINT8 Swap = Pixels[i][3];
+            Pixels[i][3] = Pixels[i][Rotation - 1];
+            Pixels[i][Rotation - 1] = Swap;
+        }
+    }
+}
+
+VOID AstDecodeBlock(_In_ UINT32 Format, _In_ CONST VOID *Block, _Out_ UINT8 Pixels[16][4])
+{
+    CONST UINT8 *Data = Block;
+
+    switch (Format)
+    {
+    case AssetTextureFormatBc1:
+        DecodeColour(Data, FALSE, Pixels);
+        break;
+    case AssetTextureFormatBc3:
+        DecodeColour(Data + 8, TRUE, Pixels);
+        DecodeAlpha(Data, Pixels);
+        break;
+    case AssetTextureFormatBc7:
+        DecodeBc7(Data, Pixels);
+        break;
+    default:
+        memset(Pixels, 0, 16 * 4);
+        break;
+    }
+}
+
+PTEXTURE AstDecodeTexture(_In_ PCTEXTURE Texture)
+{
+    UINT64 PixelsSize = (UINT64)Texture->Width * Texture->Height * 4;
+    PTEXTURE Decoded = CmnAlloc(sizeof(TEXTURE) + PixelsSize, 1);
+    if (!Decoded)
+    {
+        CmnError("Failed to allocate %llu bytes to decode texture: %s", sizeof(TEXTURE) + PixelsSize,
+                 strerror(errno));
+    }
+
+    *Decoded = *Texture;
+    Decoded->Format = TextureFormatRgba8;
+    Decoded->Pixels = Decoded + 1;
+
+    UINT32 BlockSize = (UINT32)Texture->Format == AssetTextureFormatBc1 ? 8 : 16;
+    UINT32 BlocksWide = (Texture->Width + 3) / 4;
+    UINT32 BlocksHigh = (Texture->Height + 3) / 4;
+    CONST UINT8 *Block = Texture->Pixels;
+    PBYTE Pixels = Decoded->Pixels;
+    for (UINT32 BlockY = 0; BlockY < BlocksHigh; BlockY++)
+    {
+        for (UINT32 BlockX = 0; BlockX < BlocksWide; BlockX++, Block += BlockSize)
+        {
+            UINT8 BlockPixels[16][4];
+            AstDecodeBlock(Texture->Format, Block, BlockPixels);
+
+            // Partial blocks at the edges have padding that isn't copied out
+            for (UINT32 Y = 0; Y < 4 && BlockY * 4 + Y < Texture->Height; Y++)
+            {
+                UINT32 Width = PURPL_MIN(4, Texture->Width - BlockX * 4);
+                memcpy(Pixels + ((UINT64)(BlockY * 4 + Y) * Texture->Width + BlockX * 4) * 4, BlockPixels[Y * 4],
+                       Width * 4);
+            }
+        }
+    }
+
+    return Decoded;
+}
@@ -0,0 +1,38 @@
+/// @file bcn.h
+///
+/// @brief This file declares the block compressed texture decoder, for backends that can't sample BCn formats.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/log.h"
+
+#include "util/texture.h"
+
+#include "packformat.h"
+
+/// @brief Get the size of a texture's pixels, including block compressed ones
+///
+/// @param[in] Texture The texture
+///
+/// @return The size of the pixels in bytes
+extern UINT64 AstGetTextureSize(_In_ PCTEXTURE Texture);
+
+/// @brief Decode one 4x4 block
+///
+/// @param[in] Format The block compressed format
+/// @param[in] Block The block
+/// @param[out] Pixels Receives the pixels as RGBA8, in rows
+extern VOID AstDecodeBlock(_In_ UINT32 Format, _In_ CONST VOID *Block, _Out_ UINT8 Pixels[16][4]);
+
+/// @brief Decode a block compressed texture to RGBA8
+///
+/// @param[in] Texture The texture to decode
+///
+/// @return A texture with its pixels in the same allocation, free it with CmnFree
+extern PTEXTURE AstDecodeTexture(_In_ PCTEXTURE Texture);
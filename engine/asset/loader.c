@@ -0,0 +1,356 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    loader.c
+
+Abstract:
+
+    This file implements the asynchronous asset loader. Requests are kept in
+    one list guarded by a mutex, load jobs take the oldest queued request
+    with the highest priority, and finished requests wait in the same list
+    until AstPumpLoads hands them to their callbacks. A load job that finishes
+    queues another one instead of looping, so a long backlog doesn't hold on
+    to a worker, and the job gives up its slot when nothing's left.
+
+--*/
+
+#include "loader.h"
+
+#include "engine/profile.h"
+
+static PAS_MUTEX LoaderLock;
+static ENGINE_JOB_COUNTER LoaderJobs;
+static INT64 LoaderSlots; // how many more load jobs can be started
+static PASSET_LOAD_REQUEST *LoaderRequests;
+static UINT64 LoaderNextId = 1;
+static BOOLEAN LoaderStopping;
+
+VOID AstDefineVariables(VOID)
+{
+    CONFIGVAR_DEFINE_INT("ast_load_threads", 2, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_INT("ast_loads_per_frame", 8, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_INT("ast_watch_interval", 500, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_BOOLEAN("ast_prefetch", TRUE, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+}
+
+static BOOLEAN IsFinished(_In_ PCASSET_LOAD_REQUEST Request)
+{
+    return Request->Status != AssetLoadStatusQueued && Request->Status != AssetLoadStatusLoading;
+}
+
+static PASSET_LOAD_REQUEST FindRequest(_In_ UINT64 Id)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(LoaderRequests); i++)
+    {
+        if (LoaderRequests[i]->Id == Id)
+        {
+            return LoaderRequests[i];
+        }
+    }
+
+    return NULL;
+}
+
+// Gives the job's slot back if there's nothing to load, which has to happen under the same lock as queueing so a new
+// request can't be missed
+static PASSET_LOAD_REQUEST TakeRequest(VOID)
+{
+    PASSET_LOAD_REQUEST Best = NULL;
+
+    AsLockMutex(LoaderLock, TRUE);
+    if (!LoaderStopping)
+    {
+        // The list is in queue order, so the first one found at a given priority is the oldest
+        for (SIZE_T i = 0; i < stbds_arrlenu(LoaderRequests); i++)
+        {
+            PASSET_LOAD_REQUEST Request = LoaderRequests[i];
+            if (Request->Status == AssetLoadStatusQueued && (!Best || Request->Priority > Best->Priority))
+            {
+                Best = Request;
+            }
+        }
+    }
+
+    if (Best)
+    {
+        Best->Status = AssetLoadStatusLoading;
+    }
+    else
+    {
+        LoaderSlots++;
+    }
+    AsUnlockMutex(LoaderLock);
+
+    return Best;
+}
+
+static VOID LoadJob(_In_opt_ PVOID Unused)
+{
+    UNREFERENCED_PARAMETER(Unused);
+
+    PASSET_LOAD_REQUEST Request = TakeRequest();
+    if (!Request)
+    {
+        return;
+    }
+
+    // Nothing else touches the request while it's loading except to mark it cancelled
+    BOOLEAN Loaded = FALSE;
+    switch (Request->Type)
+    {
+    case AssetLoadTypeTexture:
+        if (Request->Levels)
+        {
+            // Part of a texture that's already loaded, so it isn't hashed
+            ENGINE_PROFILE_BEGIN("Load texture levels");
+            Loaded = AstLoadTextureLevels(&Request->Path, Request->FirstLevel, &Request->Texture, &Request->View);
+            ENGINE_PROFILE_END();
+            break;
+        }
+
+        ENGINE_PROFILE_BEGIN("Load texture");
+        Loaded = AstLoadTexture(&Request->Path, &Request->Texture, &Request->View);
+        ENGINE_PROFILE_END();
+        if (Loaded)
+        {
+            Request->ContentHash = AstHashTexture(&Request->Texture);
+        }
+        break;
+    case AssetLoadTypeMesh:
+        ENGINE_PROFILE_BEGIN("Load mesh");
+        Loaded = AstLoadMesh(&Request->Path, &Request->Mesh, &Request->View);
+        ENGINE_PROFILE_END();
+        if (Loaded)
+        {
+            Request->ContentHash = AstHashMesh(&Request->Mesh);
+        }
+        break;
+    default:
+        break;
+    }
+
+    AsLockMutex(LoaderLock, TRUE);
+    if (Request->Cancelled)
+    {
+        if (Loaded)
+        {
+            AstCloseView(&Request->View);
+        }
+        Request->Status = AssetLoadStatusCancelled;
+    }
+    else if (Loaded)
+    {
+        Request->Status = AssetLoadStatusSucceeded;
+    }
+    else
+    {
+        LogError("Failed to load %s", AstFormatPath(&Request->Path));
+        Request->Status = AssetLoadStatusFailed;
+    }
+    AsUnlockMutex(LoaderLock);
+
+    // The slot carries over to the next job
+    EngQueueBackgroundJob(LoadJob, NULL, &LoaderJobs);
+}
+
+VOID AstInitializeLoader(VOID)
+{
+    LoaderSlots = PURPL_MAX(CONFIGVAR_GET_INT("ast_load_threads"), 1);
+
+    LogInfo("Running up to %lld asset loads at once", LoaderSlots);
+
+    LoaderLock = AsCreateMutex();
+    if (!LoaderLock)
+    {
+        CmnError("Failed to create asset loader mutex");
+    }
+
+    LoaderStopping = FALSE;
+}
+
+static VOID CompleteRequest(_In_ PASSET_LOAD_REQUEST Request)
+{
+    if (Request->Callback)
+    {
+        Request->Callback(Request, Request->Context);
+    }
+
+    if (Request->Status == AssetLoadStatusSucceeded)
+    {
+        AstCloseView(&Request->View);
+    }
+    CmnFree((PVOID)Request->Path.Name);
+    CmnFree(Request);
+}
+
+VOID AstShutdownLoader(VOID)
+{
+    if (!LoaderLock)
+    {
+        return;
+    }
+
+    LogInfo("Stopping asset loader");
+
+    AsLockMutex(LoaderLock, TRUE);
+    LoaderStopping = TRUE;
+    AsUnlockMutex(LoaderLock);
+
+    // Loads that already started finish, and queued jobs see LoaderStopping and return
+    EngWaitForCounter(&LoaderJobs);
+
+    // The jobs are done, so everything left can be completed without the lock
+    for (SIZE_T i = 0; i < stbds_arrlenu(LoaderRequests); i++)
+    {
+        PASSET_LOAD_REQUEST Request = LoaderRequests[i];
+        if (Request->Status == AssetLoadStatusSucceeded)
+        {
+            AstCloseView(&Request->View);
+        }
+        Request->Status = AssetLoadStatusCancelled;
+        CompleteRequest(Request);
+    }
+    stbds_arrfree(LoaderRequests);
+
+    AsDestroyMutex(LoaderLock);
+    LoaderLock = NULL;
+}
+
+static UINT64 QueueRequest(_In_ ASSET_LOAD_TYPE Type, _In_ PCASSET_PATH Path, _In_ BOOLEAN Levels,
+                           _In_ UINT32 FirstLevel, _In_ ASSET_LOAD_PRIORITY Priority,
+                           _In_ PFN_ASSET_LOAD_CALLBACK Callback, _In_opt_ PVOID Context)
+{
+    PASSET_LOAD_REQUEST Request = CmnAllocType(1, ASSET_LOAD_REQUEST);
+    if (!Request)
+    {
+        CmnError("Failed to allocate load request for %s: %s", AstFormatPath(Path), strerror(errno));
+    }
+
+    Request->Type = Type;
+    Request->Priority = PURPL_MIN(Priority, AssetLoadPriorityCount - 1);
+    Request->Status = AssetLoadStatusQueued;
+    Request->Path = *Path;
+    Request->Path.Name = CmnDuplicateString(Path->Name, 0);
+    Request->Levels = Levels;
+    Request->FirstLevel = FirstLevel;
+    Request->Callback = Callback;
+    Request->Context = Context;
+
+    // A worker can finish the request and free it as soon as the lock is dropped
+    AsLockMutex(LoaderLock, TRUE);
+    UINT64 Id = LoaderNextId++;
+    Request->Id = Id;
+    stbds_arrpush(LoaderRequests, Request);
+    BOOLEAN StartJob = LoaderSlots > 0;
+    if (StartJob)
+    {
+        LoaderSlots--;
+    }
+    AsUnlockMutex(LoaderLock);
+
+    if (StartJob)
+    {
+        EngQueueBackgroundJob(LoadJob, NULL, &LoaderJobs);
+    }
+
+    LogTrace("Queued load %llu for %s", Id, AstFormatPath(Path));
+
+    return Id;
+}
+
+UINT64 AstQueueLoad(_In_ ASSET_LOAD_TYPE Type, _In_ PCASSET_PATH Path, _In_ ASSET_LOAD_PRIORITY Priority,
+                    _In_ PFN_ASSET_LOAD_CALLBACK Callback, _In_opt_ PVOID Context)
+{
+    return QueueRequest(Type, Path, FALSE, 0, Priority, Callback, Context);
+}
+
+UINT64 AstQueueTextureLevelLoad(_In_ PCASSET_PATH Path, _In_ UINT32 FirstLevel, _In_ ASSET_LOAD_PRIORITY Priority,
+                                _In_ PFN_ASSET_LOAD_CALLBACK Callback, _In_opt_ PVOID Context)
+{
+    return QueueRequest(AssetLoadTypeTexture, Path, TRUE, FirstLevel, Priority, Callback, Context);
+}
+
+BOOLEAN AstCancelLoad(_In_ UINT64 Id)
+{
+    BOOLEAN Cancelled = FALSE;
+
+    AsLockMutex(LoaderLock, TRUE);
+    PASSET_LOAD_REQUEST Request = FindRequest(Id);
+    if (Request && Request->Status != AssetLoadStatusCancelled && !Request->Cancelled)
+    {
+        if (Request->Status == AssetLoadStatusLoading)
+        {
+            // The job finishes it off when it's done
+            Request->Cancelled = TRUE;
+        }
+        else
+        {
+            if (Request->Status == AssetLoadStatusSucceeded)
+            {
+                AstCloseView(&Request->View);
+            }
+            Request->Status = AssetLoadStatusCancelled;
+        }
+        Cancelled = TRUE;
+    }
+    AsUnlockMutex(LoaderLock);
+
+    return Cancelled;
+}
+
+VOID AstSetLoadPriority(_In_ UINT64 Id, _In_ ASSET_LOAD_PRIORITY Priority)
+{
+    AsLockMutex(LoaderLock, TRUE);
+    PASSET_LOAD_REQUEST Request = FindRequest(Id);
+    if (Request)
+    {
+        Request->Priority = PURPL_MIN(Priority, AssetLoadPriorityCount - 1);
+    }
+    AsUnlockMutex(LoaderLock);
+}
+
+UINT32 AstPumpLoads(_In_ UINT32 MaxCount)
+{
+    PASSET_LOAD_REQUEST *Finished = NULL;
+
+    // Highest priority first, then queue order, and anything over the limit waits for the next call
+    AsLockMutex(LoaderLock, TRUE);
+    for (ASSET_LOAD_PRIORITY Priority = AssetLoadPriorityCount; Priority-- > 0;)
+    {
+        for (SIZE_T i = 0; i < stbds_arrlenu(LoaderRequests) && (!MaxCount || stbds_arrlenu(Finished) < MaxCount);)
+        {
+            PASSET_LOAD_REQUEST Request = LoaderRequests[i];
+            if (Request->Priority == Priority && IsFinished(Request))
+            {
+                stbds_arrpush(Finished, Request);
+                stbds_arrdel(LoaderRequests, i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+    AsUnlockMutex(LoaderLock);
+
+    UINT32 Count = (UINT32)stbds_arrlenu(Finished);
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        CompleteRequest(Finished[i]);
+    }
+    stbds_arrfree(Finished);
+
+    return Count;
+}
+
+UINT32 AstGetPendingLoadCount(VOID)
+{
+    AsLockMutex(LoaderLock, TRUE);
+    UINT32 Count = (UINT32)stbds_arrlenu(LoaderRequests);
+    AsUnlockMutex(LoaderLock);
+
+    return Count;
+}
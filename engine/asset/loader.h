@@ -0,0 +1,124 @@
+/// @file loader.h
+///
+/// @brief This file declares the asynchronous asset loader.
+///
+/// Loads are queued from any thread and run as background jobs, which do the file I/O, decompression and decoding.
+/// Only ast_load_threads loads run at once, so the rest of the workers stay free for jobs that have to finish within a
+/// frame. Finished loads are handed back through AstPumpLoads, which the render thread calls at the start of each
+/// frame to do the GPU side of the work.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/configvar.h"
+#include "common/log.h"
+
+#include "platform/async.h"
+#include "platform/platform.h"
+
+#include "util/mesh.h"
+#include "util/texture.h"
+
+#include "engine/job.h"
+
+#include "pack.h"
+
+/// @brief Load priority, higher priorities are loaded and completed first
+PURPL_MAKE_TAG(enum, ASSET_LOAD_PRIORITY,
+               {AssetLoadPriorityLow, AssetLoadPriorityNormal, AssetLoadPriorityHigh, AssetLoadPriorityCount})
+
+/// @brief What kind of asset a load is for
+PURPL_MAKE_TAG(enum, ASSET_LOAD_TYPE, {AssetLoadTypeTexture, AssetLoadTypeMesh, AssetLoadTypeCount})
+
+/// @brief State of a load
+PURPL_MAKE_TAG(enum, ASSET_LOAD_STATUS,
+               {AssetLoadStatusQueued, AssetLoadStatusLoading, AssetLoadStatusSucceeded, AssetLoadStatusFailed,
+                AssetLoadStatusCancelled})
+
+struct ASSET_LOAD_REQUEST;
+
+/// @brief Called on the thread that calls AstPumpLoads when a load finishes, fails or is cancelled
+typedef VOID (*PFN_ASSET_LOAD_CALLBACK)(_In_ struct ASSET_LOAD_REQUEST *Request, _In_opt_ PVOID Context);
+
+/// @brief A load request
+PURPL_MAKE_TAG(struct, ASSET_LOAD_REQUEST, {
+    UINT64 Id;
+    ASSET_LOAD_TYPE Type;
+    ASSET_LOAD_PRIORITY Priority;
+    ASSET_LOAD_STATUS Status;
+    BOOLEAN Cancelled; // cancelled while loading, the job sets Status when it's done
+    ASSET_PATH Path;   // the name is a copy, the directory has to be static
+    BOOLEAN Levels;    // for textures, only load FirstLevel and the mip levels after it, with AstLoadTextureLevels
+    UINT32 FirstLevel;
+
+    // Only valid in the completion callback, and only if Status is AssetLoadStatusSucceeded
+    TEXTURE Texture;
+    MESH Mesh;
+    ASSET_VIEW View;
+    UINT64 ContentHash; // from AstHashTexture or AstHashMesh, 0 for loads of texture levels
+
+    PFN_ASSET_LOAD_CALLBACK Callback;
+    PVOID Context;
+})
+
+/// @brief Define configuration variables
+extern VOID AstDefineVariables(VOID);
+
+/// @brief Start the loader, the job system has to be running first
+extern VOID AstInitializeLoader(VOID);
+
+/// @brief Wait for the loads that are running and cancel any that haven't been completed
+extern VOID AstShutdownLoader(VOID);
+
+/// @brief Queue a load
+///
+/// @param[in] Type The kind of asset to load
+/// @param[in] Path The path of the asset, its name is copied and its directory has to be static
+/// @param[in] Priority The priority of the load
+/// @param[in] Callback The function to call when the load is done
+/// @param[in] Context Passed to the callback
+///
+/// @return An ID that can be used to cancel the load or change its priority
+extern UINT64 AstQueueLoad(_In_ ASSET_LOAD_TYPE Type, _In_ PCASSET_PATH Path, _In_ ASSET_LOAD_PRIORITY Priority,
+                           _In_ PFN_ASSET_LOAD_CALLBACK Callback, _In_opt_ PVOID Context);
+
+/// @brief Queue a load of some of the mip levels of a cooked texture
+///
+/// @param[in] Path The path of the texture, its name is copied and its directory has to be static
+/// @param[in] FirstLevel The first level to load, every level after it is loaded too
+/// @param[in] Priority The priority of the load
+/// @param[in] Callback The function to call when the load is done
+/// @param[in] Context Passed to the callback
+///
+/// @return An ID that can be used to cancel the load or change its priority
+extern UINT64 AstQueueTextureLevelLoad(_In_ PCASSET_PATH Path, _In_ UINT32 FirstLevel,
+                                       _In_ ASSET_LOAD_PRIORITY Priority, _In_ PFN_ASSET_LOAD_CALLBACK Callback,
+                                       _In_opt_ PVOID Context);
+
+/// @brief Cancel a load
+///
+/// @param[in] Id The load to cancel
+///
+/// @return TRUE if the load hadn't been completed yet, in which case its callback will get AssetLoadStatusCancelled
+extern BOOLEAN AstCancelLoad(_In_ UINT64 Id);
+
+/// @brief Change the priority of a load that hasn't been completed yet
+///
+/// @param[in] Id The load to change
+/// @param[in] Priority The new priority
+extern VOID AstSetLoadPriority(_In_ UINT64 Id, _In_ ASSET_LOAD_PRIORITY Priority);
+
+/// @brief Call the callbacks of finished loads, highest priority first
+///
+/// @param[in] MaxCount The most loads to complete, 0 for all of them
+///
+/// @return The number of loads completed
+extern UINT32 AstPumpLoads(_In_ UINT32 MaxCount);
+
+/// @brief Get the number of loads that haven't been completed yet
+extern UINT32 AstGetPendingLoadCount(VOID);
@@ -0,0 +1,864 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    pack.c
+
+Abstract:
+
+    This file implements mapped asset packs. Packs are mapped read-only for
+    the lifetime of the engine, and lookups return views into the mapping
+    instead of heap copies.
+
+--*/
+
+#include "bcn.h"
+#include "pack.h"
+#include "trace.h"
+#include "watch.h"
+
+#include "engine/atomic.h"
+
+// zstd is linked statically, so the experimental API is fine (for ZSTD_createDDict_byReference)
+#define ZSTD_STATIC_LINKING_ONLY
+#include "zstd.h"
+
+#ifdef PURPL_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+PURPL_MAKE_TAG(struct, ASSET_PACK, {
+    PCHAR Path;
+    PBYTE Base;
+    UINT64 Size;
+    PASSET_PACK_HEADER Header;
+    PASSET_PACK_ENTRY Entries;
+    PUINT32 IndexSeeds;
+    PCHAR Names;
+    ZSTD_DDict *Dictionary;
+#ifdef PURPL_WIN32
+    HANDLE File;
+    HANDLE Mapping;
+#endif
+    BOOLEAN Mapped; // FALSE if the whole pack had to be read into memory
+})
+
+static PASSET_PACK AstPacks;
+
+// Each thread keeps the context it decompresses with, and they're all freed when the packs are unmounted
+static ENGINE_THREAD_LOCAL ZSTD_DCtx *DecompressionContext;
+static ZSTD_DCtx **DecompressionContexts;
+static PAS_MUTEX DecompressionContextLock;
+
+static BOOLEAN MapPack(_Inout_ PASSET_PACK Pack)
+{
+#if defined PURPL_UNIX
+    INT File = open(Pack->Path, O_RDONLY);
+    if (File < 0)
+    {
+        return FALSE;
+    }
+
+    struct stat Stat = {0};
+    if (fstat(File, &Stat) < 0 || Stat.st_size < (off_t)sizeof(ASSET_PACK_HEADER))
+    {
+        close(File);
+        return FALSE;
+    }
+
+    PVOID Base = mmap(NULL, (SIZE_T)Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+    close(File); // the mapping keeps the file referenced
+    if (Base == MAP_FAILED)
+    {
+        LogWarning("Failed to map pack %s: %s", Pack->Path, strerror(errno));
+        return FALSE;
+    }
+
+    Pack->Base = Base;
+    Pack->Size = (UINT64)Stat.st_size;
+    Pack->Mapped = TRUE;
+    return TRUE;
+#elif defined PURPL_WIN32
+    Pack->File = CreateFileA(Pack->Path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (Pack->File == INVALID_HANDLE_VALUE)
+    {
+        return FALSE;
+    }
+
+    LARGE_INTEGER Size = {0};
+    if (!GetFileSizeEx(Pack->File, &Size) || Size.QuadPart < (LONGLONG)sizeof(ASSET_PACK_HEADER))
+    {
+        CloseHandle(Pack->File);
+        return FALSE;
+    }
+
+    Pack->Mapping = CreateFileMappingA(Pack->File, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!Pack->Mapping)
+    {
+        LogWarning("Failed to create mapping for pack %s: error 0x%X", Pack->Path, GetLastError());
+        CloseHandle(Pack->File);
+        return FALSE;
+    }
+
+    Pack->Base = MapViewOfFile(Pack->Mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!Pack->Base)
+    {
+        LogWarning("Failed to map pack %s: error 0x%X", Pack->Path, GetLastError());
+        CloseHandle(Pack->Mapping);
+        CloseHandle(Pack->File);
+        return FALSE;
+    }
+
+    Pack->Size = (UINT64)Size.QuadPart;
+    Pack->Mapped = TRUE;
+    return TRUE;
+#else
+    // No mapping on this platform, read the whole thing so views still avoid per-asset allocations
+    FILE *File = fopen(Pack->Path, "rb");
+    if (!File)
+    {
+        return FALSE;
+    }
+
+    fseek(File, 0, SEEK_END);
+    Pack->Size = (UINT64)ftell(File);
+    fseek(File, 0, SEEK_SET);
+    if (Pack->Size < sizeof(ASSET_PACK_HEADER))
+    {
+        fclose(File);
+        return FALSE;
+    }
+
+    Pack->Base = CmnAlloc(Pack->Size, 1);
+    if (!Pack->Base)
+    {
+        CmnError("Failed to allocate %llu bytes for pack %s: %s", Pack->Size, Pack->Path, strerror(errno));
+    }
+
+    if (fread(Pack->Base, 1, (SIZE_T)Pack->Size, File) != Pack->Size)
+    {
+        LogWarning("Failed to read pack %s", Pack->Path);
+        fclose(File);
+        CmnFree(Pack->Base);
+        Pack->Base = NULL;
+        return FALSE;
+    }
+
+    fclose(File);
+    Pack->Mapped = FALSE;
+    return TRUE;
+#endif
+}
+
+static VOID UnmapPack(_Inout_ PASSET_PACK Pack)
+{
+    if (!Pack->Base)
+    {
+        return;
+    }
+
+    if (Pack->Mapped)
+    {
+#if defined PURPL_UNIX
+        munmap(Pack->Base, (SIZE_T)Pack->Size);
+#elif defined PURPL_WIN32
+        UnmapViewOfFile(Pack->Base);
+        CloseHandle(Pack->Mapping);
+        CloseHandle(Pack->File);
+#endif
+    }
+    else
+    {
+        CmnFree(Pack->Base);
+    }
+
+    Pack->Base = NULL;
+}
+
+static BOOLEAN ValidatePack(_In_ PCASSET_PACK Pack)
+{
+    PCASSET_PACK_HEADER Header = (PCASSET_PACK_HEADER)Pack->Base;
+
+    if (memcmp(Header->Signature, ASSET_PACK_SIGNATURE, sizeof(Header->Signature)) != 0)
+    {
+        LogError("Pack %s has an invalid signature", Pack->Path);
+        return FALSE;
+    }
+
+    if (Header->Version != ASSET_PACK_VERSION)
+    {
+        LogError("Pack %s is version %u, expected version %u", Pack->Path, Header->Version, ASSET_PACK_VERSION);
+        return FALSE;
+    }
+
+    if (Header->EntryTableOffset + (UINT64)Header->EntryCount * sizeof(ASSET_PACK_ENTRY) > Pack->Size ||
+        Header->NameTableOffset + Header->NameTableSize > Pack->Size)
+    {
+        LogError("Pack %s is truncated", Pack->Path);
+        return FALSE;
+    }
+
+    if (!Header->IndexBucketCount || Header->IndexOffset % sizeof(UINT32) != 0 ||
+        Header->IndexOffset + (UINT64)Header->IndexBucketCount * sizeof(UINT32) > Pack->Size)
+    {
+        LogError("Entry index of pack %s is invalid", Pack->Path);
+        return FALSE;
+    }
+
+    if (Header->DictionaryOffset + Header->DictionarySize > Pack->Size)
+    {
+        LogError("Dictionary of pack %s is out of bounds", Pack->Path);
+        return FALSE;
+    }
+
+    PCASSET_PACK_ENTRY Entries = (PCASSET_PACK_ENTRY)(Pack->Base + Header->EntryTableOffset);
+    for (UINT32 i = 0; i < Header->EntryCount; i++)
+    {
+        if (Entries[i].Offset + Entries[i].StoredSize > Pack->Size || Entries[i].NameOffset >= Header->NameTableSize)
+        {
+            LogError("Entry %u of pack %s is out of bounds", i, Pack->Path);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+BOOLEAN AstMountPack(_In_z_ PCSTR Path)
+{
+    ASSET_PACK Pack = {0};
+
+    if (!DecompressionContextLock)
+    {
+        DecompressionContextLock = AsCreateMutex();
+    }
+
+    Pack.Path = CmnFormatString("%s", Path);
+    if (!MapPack(&Pack))
+    {
+        CmnFree(Pack.Path);
+        return FALSE;
+    }
+
+    if (!ValidatePack(&Pack))
+    {
+        UnmapPack(&Pack);
+        CmnFree(Pack.Path);
+        return FALSE;
+    }
+
+    Pack.Header = (PASSET_PACK_HEADER)Pack.Base;
+    Pack.Entries = (PASSET_PACK_ENTRY)(Pack.Base + Pack.Header->EntryTableOffset);
+    Pack.IndexSeeds = (PUINT32)(Pack.Base + Pack.Header->IndexOffset);
+    Pack.Names = (PCHAR)(Pack.Base + Pack.Header->NameTableOffset);
+    if (Pack.Header->DictionarySize)
+    {
+        // The dictionary lives in the mapping, so it doesn't need to be copied either
+        Pack.Dictionary =
+            ZSTD_createDDict_byReference(Pack.Base + Pack.Header->DictionaryOffset, Pack.Header->DictionarySize);
+        if (!Pack.Dictionary)
+        {
+            LogError("Failed to load dictionary of pack %s", Path);
+            UnmapPack(&Pack);
+            CmnFree(Pack.Path);
+            return FALSE;
+        }
+    }
+
+    LogInfo("Mounted %s pack %s with %u entries (%llu bytes)", Pack.Mapped ? "mapped" : "in-memory", Path,
+            Pack.Header->EntryCount, Pack.Size);
+
+    stbds_arrpush(AstPacks, Pack);
+    return TRUE;
+}
+
+VOID AstUnmountPacks(VOID)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(AstPacks); i++)
+    {
+        LogDebug("Unmounting pack %s", AstPacks[i].Path);
+        if (AstPacks[i].Dictionary)
+        {
+            ZSTD_freeDDict(AstPacks[i].Dictionary);
+        }
+        UnmapPack(&AstPacks[i]);
+        CmnFree(AstPacks[i].Path);
+    }
+
+    stbds_arrfree(AstPacks);
+
+    // Nothing else can be reading by now, the job threads are gone
+    for (SIZE_T i = 0; i < stbds_arrlenu(DecompressionContexts); i++)
+    {
+        ZSTD_freeDCtx(DecompressionContexts[i]);
+    }
+    stbds_arrfree(DecompressionContexts);
+    DecompressionContext = NULL;
+
+    if (DecompressionContextLock)
+    {
+        AsDestroyMutex(DecompressionContextLock);
+        DecompressionContextLock = NULL;
+    }
+}
+
+VOID AstMakePath(_Out_ PASSET_PATH Path, _In_opt_z_ PCSTR Directory, _In_ UINT64 DirectoryHash, _In_z_ PCSTR Name)
+{
+    Path->Directory = Directory;
+    Path->Name = Name;
+    Path->Hash = Directory ? AstExtendPathHash(DirectoryHash, Name, TRUE) : AstHashPath(Name);
+}
+
+PCSTR AstFormatPath(_In_ PCASSET_PATH Path)
+{
+    static ENGINE_THREAD_LOCAL CHAR Buffer[512];
+
+    if (!Path->Directory)
+    {
+        return Path->Name;
+    }
+
+    snprintf(Buffer, PURPL_ARRAYSIZE(Buffer), "%s/%s", Path->Directory, Path->Name);
+    return Buffer;
+}
+
+static PCASSET_PACK_ENTRY FindEntry(_In_ UINT64 Hash, _Out_opt_ PCASSET_PACK *FoundPack)
+{
+    // Later packs override earlier ones
+    for (SIZE_T i = stbds_arrlenu(AstPacks); i > 0; i--)
+    {
+        PCASSET_PACK Pack = &AstPacks[i - 1];
+        if (!Pack->Header->EntryCount)
+        {
+            continue;
+        }
+
+        // The index only says where the entry would be, paths that aren't in the pack land on some other entry
+        UINT32 Bucket = AstGetPackBucket(Hash, Pack->Header->IndexBucketCount);
+        UINT32 Slot = AstGetPackSlot(Hash, Pack->IndexSeeds[Bucket], Pack->Header->EntryCount);
+        if (Pack->Entries[Slot].PathHash == Hash)
+        {
+            if (FoundPack)
+            {
+                *FoundPack = Pack;
+            }
+            return &Pack->Entries[Slot];
+        }
+    }
+
+    return NULL;
+}
+
+static ZSTD_DCtx *GetDecompressionContext(VOID)
+{
+    if (!DecompressionContext)
+    {
+        DecompressionContext = ZSTD_createDCtx();
+        if (!DecompressionContext)
+        {
+            CmnError("Failed to create zstd decompression context");
+        }
+
+        AsLockMutex(DecompressionContextLock, TRUE);
+        stbds_arrpush(DecompressionContexts, DecompressionContext);
+        AsUnlockMutex(DecompressionContextLock);
+    }
+
+    return DecompressionContext;
+}
+
+static BOOLEAN ReadEntryRange(_In_ PCASSET_PACK Pack, _In_ PCASSET_PACK_ENTRY Entry, _In_ UINT64 Offset,
+                              _In_ UINT64 Size, _Out_ PBYTE Destination)
+{
+    PBYTE Base = Pack->Base + Entry->Offset;
+
+    if (Offset > Entry->Size || Size > Entry->Size - Offset)
+    {
+        return FALSE;
+    }
+
+    if (!(Entry->Flags & AssetPackEntryCompressed))
+    {
+        memcpy(Destination, Base + Offset, Size);
+        return TRUE;
+    }
+
+    if (Entry->StoredSize < sizeof(ASSET_COMPRESSED_HEADER))
+    {
+        return FALSE;
+    }
+
+    // Every byte of the entry has to be in exactly one chunk, and the offsets have to fit in what's stored
+    PCASSET_COMPRESSED_HEADER Header = (PCASSET_COMPRESSED_HEADER)Base;
+    CONST UINT64 *ChunkOffsets = (CONST UINT64 *)(Header + 1);
+    if (!Header->ChunkSize ||
+        Header->ChunkCount != Entry->Size / Header->ChunkSize + (Entry->Size % Header->ChunkSize != 0) ||
+        sizeof(ASSET_COMPRESSED_HEADER) + ((UINT64)Header->ChunkCount + 1) * sizeof(UINT64) > Entry->StoredSize)
+    {
+        return FALSE;
+    }
+
+    if (!Size)
+    {
+        return TRUE;
+    }
+
+    if (Entry->Flags & AssetPackEntryDictionary && !Pack->Dictionary)
+    {
+        return FALSE;
+    }
+
+    UINT64 FirstChunk = Offset / Header->ChunkSize;
+    UINT64 LastChunk = (Offset + Size - 1) / Header->ChunkSize;
+    if (LastChunk >= Header->ChunkCount)
+    {
+        return FALSE;
+    }
+
+    ZSTD_DCtx *Context = GetDecompressionContext();
+    PBYTE Scratch = NULL;
+    BOOLEAN Success = TRUE;
+    for (UINT32 i = (UINT32)FirstChunk; i <= LastChunk; i++)
+    {
+        UINT64 ChunkStart = (UINT64)i * Header->ChunkSize;
+        UINT64 ChunkLength = PURPL_MIN(Header->ChunkSize, Entry->Size - ChunkStart);
+        UINT64 CopyStart = PURPL_MAX(Offset, ChunkStart);
+        UINT64 CopyEnd = PURPL_MIN(Offset + Size, ChunkStart + ChunkLength);
+        if (ChunkOffsets[i] > ChunkOffsets[i + 1] || ChunkOffsets[i + 1] > Entry->StoredSize)
+        {
+            Success = FALSE;
+            break;
+        }
+
+        // Whole chunks go straight to the destination, only partial ones at the ends of the range need scratch
+        PBYTE Target;
+        if (CopyStart == ChunkStart && CopyEnd == ChunkStart + ChunkLength)
+        {
+            Target = Destination + (ChunkStart - Offset);
+        }
+        else
+        {
+            if (!Scratch)
+            {
+                Scratch = CmnAlloc(Header->ChunkSize, 1);
+                if (!Scratch)
+                {
+                    CmnError("Failed to allocate decompression buffer: %s", strerror(errno));
+                }
+            }
+            Target = Scratch;
+        }
+
+        SIZE_T Result;
+        if (Entry->Flags & AssetPackEntryDictionary)
+        {
+            Result = ZSTD_decompress_usingDDict(Context, Target, (SIZE_T)ChunkLength, Base + ChunkOffsets[i],
+                                                (SIZE_T)(ChunkOffsets[i + 1] - ChunkOffsets[i]), Pack->Dictionary);
+        }
+        else
+        {
+            Result = ZSTD_decompressDCtx(Context, Target, (SIZE_T)ChunkLength, Base + ChunkOffsets[i],
+                                         (SIZE_T)(ChunkOffsets[i + 1] - ChunkOffsets[i]));
+        }
+
+        if (ZSTD_isError(Result) || Result != ChunkLength)
+        {
+            LogError("Failed to decompress chunk %u: %s", i,
+                     ZSTD_isError(Result) ? ZSTD_getErrorName(Result) : "size mismatch");
+            Success = FALSE;
+            break;
+        }
+
+        if (Target == Scratch)
+        {
+            memcpy(Destination + (CopyStart - Offset), Scratch + (CopyStart - ChunkStart), CopyEnd - CopyStart);
+        }
+    }
+
+    if (Scratch)
+    {
+        CmnFree(Scratch);
+    }
+
+    return Success;
+}
+
+static BOOLEAN GetEntryData(_In_ PCASSET_PATH Path, _In_ PCASSET_PACK Pack, _In_ PCASSET_PACK_ENTRY Entry,
+                            _Out_ PASSET_VIEW View)
+{
+    View->Size = Entry->Size;
+    View->Flags = Entry->Flags;
+
+    if (!(Entry->Flags & AssetPackEntryCompressed))
+    {
+        View->Data = Pack->Base + Entry->Offset;
+        return TRUE;
+    }
+
+    // The compressed data is in the mapping, so this is the only copy
+    View->Allocation = CmnAlloc(Entry->Size ? Entry->Size : 1, 1);
+    if (!View->Allocation)
+    {
+        CmnError("Failed to allocate %llu bytes for %s: %s", Entry->Size, AstFormatPath(Path), strerror(errno));
+    }
+
+    if (!ReadEntryRange(Pack, Entry, 0, Entry->Size, View->Allocation))
+    {
+        LogError("Failed to decompress %s", AstFormatPath(Path));
+        CmnFree(View->Allocation);
+        memset(View, 0, sizeof(ASSET_VIEW));
+        return FALSE;
+    }
+
+    View->Data = View->Allocation;
+    return TRUE;
+}
+
+BOOLEAN AstIsMapped(_In_z_ PCSTR Path)
+{
+    return FindEntry(AstHashPath(Path), NULL) != NULL;
+}
+
+UINT64 AstGetSize(_In_z_ PCSTR Path)
+{
+    PCASSET_PACK_ENTRY Entry = FindEntry(AstHashPath(Path), NULL);
+    return Entry ? Entry->Size : 0;
+}
+
+BOOLEAN AstReadRange(_In_z_ PCSTR Path, _In_ UINT64 Offset, _In_ UINT64 Size, _Out_ PVOID Destination)
+{
+    PCASSET_PACK Pack = NULL;
+    PCASSET_PACK_ENTRY Entry = FindEntry(AstHashPath(Path), &Pack);
+    if (!Entry)
+    {
+        return FALSE;
+    }
+
+    return ReadEntryRange(Pack, Entry, Offset, Size, Destination);
+}
+
+BOOLEAN AstPrefetch(_In_z_ PCSTR Path)
+{
+    PCASSET_PACK Pack = NULL;
+    PCASSET_PACK_ENTRY Entry = FindEntry(AstHashPath(Path), &Pack);
+    if (!Entry)
+    {
+        return FALSE;
+    }
+
+    // Packs that were read into memory are already there
+    if (!Pack->Mapped || !Entry->StoredSize)
+    {
+        return TRUE;
+    }
+
+    CONST BYTE *Start = Pack->Base + Entry->Offset;
+    UINT64 Size = Entry->StoredSize;
+
+#ifdef PURPL_UNIX
+    // Ask for the whole entry to be read ahead at once, touching it below then mostly just waits for that
+    UINT64 PageSize = (UINT64)sysconf(_SC_PAGESIZE);
+    UINT64 PageOffset = (UINT64)(uintptr_t)Start % PageSize;
+    madvise((PVOID)(Start - PageOffset), (SIZE_T)(Size + PageOffset), MADV_WILLNEED);
+#endif
+
+    volatile BYTE Touched = 0;
+    for (UINT64 i = 0; i < Size; i += 4096)
+    {
+        Touched ^= Start[i];
+    }
+    Touched ^= Start[Size - 1];
+
+    return TRUE;
+}
+
+BOOLEAN AstOpenView(_In_z_ PCSTR Path, _Out_ PASSET_VIEW View)
+{
+    PCASSET_PACK Pack = NULL;
+    PCASSET_PACK_ENTRY Entry;
+
+    memset(View, 0, sizeof(ASSET_VIEW));
+    AstRecordAccess(NULL, Path);
+
+    ASSET_PATH AssetPath;
+    AstMakePath(&AssetPath, NULL, 0, Path);
+    Entry = FindEntry(AssetPath.Hash, &Pack);
+    if (Entry)
+    {
+        return GetEntryData(&AssetPath, Pack, Entry, View);
+    }
+
+    UINT64 Size = 0;
+    View->Allocation = FsReadFile(FALSE, Path, 0, 0, &Size, 0);
+    if (!View->Allocation || !Size)
+    {
+        if (View->Allocation)
+        {
+            CmnFree(View->Allocation);
+        }
+        memset(View, 0, sizeof(ASSET_VIEW));
+        return FALSE;
+    }
+
+    View->Data = View->Allocation;
+    View->Size = Size;
+    AstWatchAsset(Path);
+    return TRUE;
+}
+
+VOID AstCloseView(_Inout_ PASSET_VIEW View)
+{
+    if (View->Allocation)
+    {
+        CmnFree(View->Allocation);
+    }
+
+    memset(View, 0, sizeof(ASSET_VIEW));
+}
+
+// Checks that the levels fit in an asset of the given size and are back to back, which is how they get uploaded
+static BOOLEAN CheckCookedTexture(_In_ PCASSET_COOKED_TEXTURE Cooked, _In_ UINT64 Size)
+{
+    if (!Cooked->MipCount || Cooked->MipCount > ASSET_MAX_TEXTURE_MIPS || Cooked->PixelsOffset > Size ||
+        Cooked->PixelsSize > Size - Cooked->PixelsOffset)
+    {
+        return FALSE;
+    }
+
+    UINT64 Offset = Cooked->PixelsOffset;
+    for (UINT32 i = 0; i < Cooked->MipCount; i++)
+    {
+        if (Cooked->MipOffsets[i] != Offset)
+        {
+            return FALSE;
+        }
+        Offset += AstGetTextureLevelSize(Cooked->Format, Cooked->Width, Cooked->Height, i);
+    }
+
+    return Offset - Cooked->PixelsOffset <= Cooked->PixelsSize;
+}
+
+BOOLEAN AstLoadTexture(_In_ PCASSET_PATH Path, _Out_ PTEXTURE Texture, _Out_ PASSET_VIEW View)
+{
+    memset(Texture, 0, sizeof(TEXTURE));
+    memset(View, 0, sizeof(ASSET_VIEW));
+    AstRecordAccess(Path->Directory, Path->Name);
+
+    PCASSET_PACK Pack = NULL;
+    PCASSET_PACK_ENTRY Entry = FindEntry(Path->Hash, &Pack);
+    if (Entry && Entry->Flags & AssetPackEntryCookedTexture)
+    {
+        if (!GetEntryData(Path, Pack, Entry, View))
+        {
+            return FALSE;
+        }
+
+        PBYTE Base = View->Data;
+        PCASSET_COOKED_TEXTURE Cooked = (PCASSET_COOKED_TEXTURE)Base;
+        if (View->Size < sizeof(ASSET_COOKED_TEXTURE) || !CheckCookedTexture(Cooked, View->Size))
+        {
+            LogError("Cooked texture %s is corrupt", AstFormatPath(Path));
+            AstCloseView(View);
+            return FALSE;
+        }
+
+        Texture->Format = Cooked->Format;
+        Texture->Width = Cooked->Width;
+        Texture->Height = Cooked->Height;
+        Texture->Pixels = Base + Cooked->PixelsOffset;
+
+        return TRUE;
+    }
+
+    // Not cooked, let the texture library parse it
+    PCSTR FullPath = AstFormatPath(Path);
+    PTEXTURE Loaded = LoadTexture(FullPath);
+    if (!Loaded)
+    {
+        return FALSE;
+    }
+
+    *Texture = *Loaded;
+    View->Data = Loaded;
+    View->Size = sizeof(TEXTURE) + AstGetTextureSize(Loaded);
+    View->Allocation = Loaded;
+    AstWatchAsset(FullPath);
+    return TRUE;
+}
+
+BOOLEAN AstLoadTextureLevels(_In_ PCASSET_PATH Path, _In_ UINT32 FirstLevel, _Out_ PTEXTURE Texture,
+                             _Out_ PASSET_VIEW View)
+{
+    memset(Texture, 0, sizeof(TEXTURE));
+    memset(View, 0, sizeof(ASSET_VIEW));
+
+    PCASSET_PACK Pack = NULL;
+    PCASSET_PACK_ENTRY Entry = FindEntry(Path->Hash, &Pack);
+    if (!Entry || !(Entry->Flags & AssetPackEntryCookedTexture))
+    {
+        LogError("Texture %s isn't cooked, so its levels can't be loaded on their own", AstFormatPath(Path));
+        return FALSE;
+    }
+
+    // Only the header and the chunks with the wanted levels get decompressed
+    ASSET_COOKED_TEXTURE Cooked;
+    if (!ReadEntryRange(Pack, Entry, 0, sizeof(ASSET_COOKED_TEXTURE), (PBYTE)&Cooked) ||
+        !CheckCookedTexture(&Cooked, Entry->Size))
+    {
+        LogError("Cooked texture %s is corrupt", AstFormatPath(Path));
+        return FALSE;
+    }
+    if (FirstLevel >= Cooked.MipCount)
+    {
+        LogError("Texture %s only has %u mip levels, can't load from level %u", AstFormatPath(Path), Cooked.MipCount,
+                 FirstLevel);
+        return FALSE;
+    }
+
+    UINT64 Start = Cooked.MipOffsets[FirstLevel];
+    UINT64 End = Cooked.MipOffsets[Cooked.MipCount - 1] +
+                 AstGetTextureLevelSize(Cooked.Format, Cooked.Width, Cooked.Height, Cooked.MipCount - 1);
+
+    // Laid out like a cooked texture whose full size is the first level, so it's used the same way
+    PASSET_COOKED_TEXTURE Levels = CmnAlloc(sizeof(ASSET_COOKED_TEXTURE) + End - Start, 1);
+    if (!Levels)
+    {
+        CmnError("Failed to allocate %llu bytes for levels of texture %s: %s",
+                 sizeof(ASSET_COOKED_TEXTURE) + End - Start, AstFormatPath(Path), strerror(errno));
+    }
+
+    if (!ReadEntryRange(Pack, Entry, Start, End - Start, (PBYTE)(Levels + 1)))
+    {
+        LogError("Failed to read levels %u-%u of texture %s", FirstLevel, Cooked.MipCount - 1,
+                 AstFormatPath(Path));
+        CmnFree(Levels);
+        return FALSE;
+    }
+
+    memset(Levels, 0, sizeof(ASSET_COOKED_TEXTURE));
+    Levels->Format = Cooked.Format;
+    Levels->Width = PURPL_MAX(Cooked.Width >> FirstLevel, 1);
+    Levels->Height = PURPL_MAX(Cooked.Height >> FirstLevel, 1);
+    Levels->MipCount = Cooked.MipCount - FirstLevel;
+    Levels->PixelsOffset = sizeof(ASSET_COOKED_TEXTURE);
+    Levels->PixelsSize = End - Start;
+    for (UINT32 i = 0; i < Levels->MipCount; i++)
+    {
+        Levels->MipOffsets[i] = Levels->PixelsOffset + Cooked.MipOffsets[FirstLevel + i] - Start;
+    }
+
+    Texture->Format = Levels->Format;
+    Texture->Width = Levels->Width;
+    Texture->Height = Levels->Height;
+    Texture->Pixels = Levels + 1;
+
+    View->Data = Levels;
+    View->Size = sizeof(ASSET_COOKED_TEXTURE) + End - Start;
+    View->Flags = Entry->Flags;
+    View->Allocation = Levels;
+    return TRUE;
+}
+
+BOOLEAN AstLoadMesh(_In_ PCASSET_PATH Path, _Out_ PMESH Mesh, _Out_ PASSET_VIEW View)
+{
+    memset(Mesh, 0, sizeof(MESH));
+    memset(View, 0, sizeof(ASSET_VIEW));
+    AstRecordAccess(Path->Directory, Path->Name);
+
+    PCASSET_PACK Pack = NULL;
+    PCASSET_PACK_ENTRY Entry = FindEntry(Path->Hash, &Pack);
+    if (Entry && Entry->Flags & AssetPackEntryCookedMesh)
+    {
+        if (!GetEntryData(Path, Pack, Entry, View))
+        {
+            return FALSE;
+        }
+
+        PBYTE Base = View->Data;
+        PCASSET_COOKED_MESH Cooked = (PCASSET_COOKED_MESH)Base;
+        BOOLEAN Corrupt = View->Size < sizeof(ASSET_COOKED_MESH) ||
+                          Cooked->VerticesOffset + Cooked->VertexCount * sizeof(MESH_VERTEX) > View->Size ||
+                          Cooked->IndicesOffset + Cooked->IndexCount * sizeof(ivec3) > View->Size ||
+                          !Cooked->LodCount || Cooked->LodCount > ASSET_MAX_MESH_LODS;
+        for (UINT32 i = 0; !Corrupt && i < Cooked->LodCount; i++)
+        {
+            PCASSET_MESH_LOD Lod = &Cooked->Lods[i];
+            Corrupt = Cooked->IndicesOffset + (Lod->IndexOffset + Lod->IndexCount) * sizeof(ivec3) > View->Size;
+        }
+        if (Corrupt)
+        {
+            LogError("Cooked mesh %s is corrupt", AstFormatPath(Path));
+            AstCloseView(View);
+            return FALSE;
+        }
+
+        Mesh->VertexCount = Cooked->VertexCount;
+        Mesh->IndexCount = Cooked->IndexCount;
+        Mesh->Vertices = (PMESH_VERTEX)(Base + Cooked->VerticesOffset);
+        Mesh->Indices = (ivec3 *)(Base + Cooked->IndicesOffset);
+        return TRUE;
+    }
+
+    PCSTR FullPath = AstFormatPath(Path);
+    PMESH Loaded = LoadMesh(FullPath);
+    if (!Loaded)
+    {
+        return FALSE;
+    }
+
+    *Mesh = *Loaded;
+    View->Data = Loaded;
+    View->Size = sizeof(MESH) + Loaded->VertexCount * sizeof(MESH_VERTEX) + Loaded->IndexCount * sizeof(ivec3);
+    View->Allocation = Loaded;
+    AstWatchAsset(FullPath);
+    return TRUE;
+}
+
+UINT32 AstGetMeshLods(_In_ PCMESH Mesh, _In_ PCASSET_VIEW View, _Out_ PASSET_MESH_LOD Lods)
+{
+    memset(Lods, 0, ASSET_MAX_MESH_LODS * sizeof(ASSET_MESH_LOD));
+
+    if (View->Flags & AssetPackEntryCookedMesh)
+    {
+        // AstLoadMesh already checked the ranges
+        PCASSET_COOKED_MESH Cooked = View->Data;
+        memcpy(Lods, Cooked->Lods, Cooked->LodCount * sizeof(ASSET_MESH_LOD));
+        return Cooked->LodCount;
+    }
+
+    Lods[0].IndexCount = Mesh->IndexCount;
+    return 1;
+}
+
+UINT32 AstGetTextureMipCount(_In_ PCASSET_VIEW View)
+{
+    if (View->Flags & AssetPackEntryCookedTexture)
+    {
+        // AstLoadTexture already checked the levels
+        PCASSET_COOKED_TEXTURE Cooked = View->Data;
+        return Cooked->MipCount;
+    }
+
+    return 1;
+}
+
+UINT64 AstHashTexture(_In_ PCTEXTURE Texture)
+{
+    UINT32 Header[] = {Texture->Format, Texture->Width, Texture->Height};
+    UINT64 Hash = AstHashData(Header, sizeof(Header), 0);
+    return AstHashData(Texture->Pixels, AstGetTextureSize(Texture), Hash);
+}
+
+UINT64 AstHashMesh(_In_ PCMESH Mesh)
+{
+    UINT64 Header[] = {Mesh->VertexCount, Mesh->IndexCount};
+    UINT64 Hash = AstHashData(Header, sizeof(Header), 0);
+    Hash = AstHashData(Mesh->Vertices, Mesh->VertexCount * sizeof(MESH_VERTEX), Hash);
+    return AstHashData(Mesh->Indices, Mesh->IndexCount * sizeof(ivec3), Hash);
+}
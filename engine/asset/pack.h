@@ -0,0 +1,175 @@
+/// @file pack.h
+///
+/// @brief This file declares the mapped asset pack API.
+///
+/// Mapped packs are memory mapped once and entries are handed out as views into the mapping, so uncompressed
+/// assets go from the page cache to the GPU without being copied into an intermediate heap buffer. Compressed
+/// entries are decompressed once, directly into the memory they're used from. Anything that isn't in a mapped pack
+/// falls back to the regular filesystem sources.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/filesystem.h"
+#include "common/log.h"
+
+#include "util/mesh.h"
+#include "util/texture.h"
+
+#include "packformat.h"
+
+/// @brief A view of an asset's data
+PURPL_MAKE_TAG(struct, ASSET_VIEW, {
+    PVOID Data; // read only, may point into a read only mapping
+    UINT64 Size;
+    UINT32 Flags;     // ASSET_PACK_ENTRY_FLAGS, 0 if not from a pack
+    PVOID Allocation; // owned memory backing the view, NULL if it points into a mapping
+})
+
+/// @brief Where an asset is, as a directory and a name, so packs can be searched without formatting the whole path
+PURPL_MAKE_TAG(struct, ASSET_PATH, {
+    PCSTR Directory; // NULL if Name is the whole path
+    PCSTR Name;      // relative to Directory
+    UINT64 Hash;     // of the whole path, from AstHashPath
+})
+
+/// @brief Fill out an asset path
+///
+/// @param[out] Path The path, which points to Directory and Name
+/// @param[in] Directory The directory, NULL if Name is the whole path
+/// @param[in] DirectoryHash The hash of the directory followed by a separator, from AstHashPath, so it only has to be
+/// hashed once
+/// @param[in] Name The rest of the path
+extern VOID AstMakePath(_Out_ PASSET_PATH Path, _In_opt_z_ PCSTR Directory, _In_ UINT64 DirectoryHash,
+                        _In_z_ PCSTR Name);
+
+/// @brief Put an asset path together, for the filesystem and messages
+///
+/// @param[in] Path The path
+///
+/// @return The whole path, in a buffer that's reused by the next call on the same thread
+extern PCSTR AstFormatPath(_In_ PCASSET_PATH Path);
+
+/// @brief Mount a mapped pack
+///
+/// @param[in] Path The path to the pack
+///
+/// @return Whether the pack could be mounted
+extern BOOLEAN AstMountPack(_In_z_ PCSTR Path);
+
+/// @brief Unmount all mapped packs, views into them become invalid
+extern VOID AstUnmountPacks(VOID);
+
+/// @brief Check whether an asset is in a mapped pack
+///
+/// @param[in] Path The path of the asset
+///
+/// @return Whether the asset can be viewed without reading it
+extern BOOLEAN AstIsMapped(_In_z_ PCSTR Path);
+
+/// @brief Get the size of an asset in a mapped pack
+///
+/// @param[in] Path The path of the asset
+///
+/// @return The uncompressed size of the asset, or 0 if it isn't in a mapped pack
+extern UINT64 AstGetSize(_In_z_ PCSTR Path);
+
+/// @brief Read part of an asset from a mapped pack into a buffer
+///
+/// Only the chunks overlapping the range are decompressed, and whole chunks are decompressed directly into the
+/// destination, so this can fill a staging buffer or mesh arrays without a full-size intermediate copy.
+///
+/// @param[in] Path The path of the asset
+/// @param[in] Offset The offset into the uncompressed asset
+/// @param[in] Size The number of bytes to read
+/// @param[out] Destination The buffer to read into
+///
+/// @return Whether the range could be read
+extern BOOLEAN AstReadRange(_In_z_ PCSTR Path, _In_ UINT64 Offset, _In_ UINT64 Size, _Out_ PVOID Destination);
+
+/// @brief Start reading an asset in a mapped pack into memory, so a later view of it doesn't have to wait on storage
+///
+/// @param[in] Path The path of the asset
+///
+/// @return Whether the asset is in a mapped pack, if not it has to be prefetched through the filesystem
+extern BOOLEAN AstPrefetch(_In_z_ PCSTR Path);
+
+/// @brief Get a view of an asset, either into a mapped pack or read through the filesystem
+///
+/// @param[in] Path The path of the asset
+/// @param[out] View The view to fill in
+///
+/// @return Whether the asset was found
+extern BOOLEAN AstOpenView(_In_z_ PCSTR Path, _Out_ PASSET_VIEW View);
+
+/// @brief Release a view
+///
+/// @param[in,out] View The view to release
+extern VOID AstCloseView(_Inout_ PASSET_VIEW View);
+
+/// @brief Load a texture, pointing into the pack when possible
+///
+/// @param[in] Path The path of the texture
+/// @param[out] Texture The texture, valid until the view is closed
+/// @param[out] View The view backing the texture
+///
+/// @return Whether the texture could be loaded
+extern BOOLEAN AstLoadTexture(_In_ PCASSET_PATH Path, _Out_ PTEXTURE Texture, _Out_ PASSET_VIEW View);
+
+/// @brief Load a cooked texture starting from one of its mip levels, reading only that level and the ones after it
+///
+/// @param[in] Path The path of the texture, which has to be cooked
+/// @param[in] FirstLevel The first level to load, which becomes the texture's full size
+/// @param[out] Texture The texture, valid until the view is closed
+/// @param[out] View The view backing the texture, AstGetTextureMipCount gives the number of levels that were loaded
+///
+/// @return Whether the levels could be loaded
+extern BOOLEAN AstLoadTextureLevels(_In_ PCASSET_PATH Path, _In_ UINT32 FirstLevel, _Out_ PTEXTURE Texture,
+                                    _Out_ PASSET_VIEW View);
+
+/// @brief Load a mesh, pointing into the pack when possible
+///
+/// @param[in] Path The path of the mesh
+/// @param[out] Mesh The mesh, valid until the view is closed
+/// @param[out] View The view backing the mesh
+///
+/// @return Whether the mesh could be loaded
+extern BOOLEAN AstLoadMesh(_In_ PCASSET_PATH Path, _Out_ PMESH Mesh, _Out_ PASSET_VIEW View);
+
+/// @brief Get the levels of detail of a mesh loaded with AstLoadMesh
+///
+/// @param[in] Mesh The mesh
+/// @param[in] View The view backing the mesh
+/// @param[out] Lods Receives ASSET_MAX_MESH_LODS levels of detail, the full mesh first
+///
+/// @return The number of levels of detail, 1 if the mesh doesn't have any others
+extern UINT32 AstGetMeshLods(_In_ PCMESH Mesh, _In_ PCASSET_VIEW View, _Out_ PASSET_MESH_LOD Lods);
+
+/// @brief Get the number of mip levels of a texture loaded with AstLoadTexture
+///
+/// The levels are one after the other in the texture's pixels, from the full texture down, each one
+/// AstGetTextureLevelSize bytes.
+///
+/// @param[in] View The view backing the texture
+///
+/// @return The number of mip levels, 1 if the texture only has the full size one
+extern UINT32 AstGetTextureMipCount(_In_ PCASSET_VIEW View);
+
+/// @brief Hash the contents of a texture, for finding identical textures with different names
+///
+/// @param[in] Texture The texture to hash
+///
+/// @return The hash of the texture's format, size and pixels
+extern UINT64 AstHashTexture(_In_ PCTEXTURE Texture);
+
+/// @brief Hash the contents of a mesh, for finding identical meshes with different names
+///
+/// @param[in] Mesh The mesh to hash
+///
+/// @return The hash of the mesh's vertices and indices
+extern UINT64 AstHashMesh(_In_ PCMESH Mesh);
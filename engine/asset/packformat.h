@@ -0,0 +1,300 @@
+/// @file packformat.h
+///
+/// @brief This file defines the on-disk layout of mapped asset packs, shared between the engine and packtool.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+/// @brief Mapped pack signature
+#define ASSET_PACK_SIGNATURE "PMPK"
+
+/// @brief Mapped pack version
+#define ASSET_PACK_VERSION 5
+
+/// @brief Default alignment of entry data, enough for SPIR-V and any vertex/index/pixel data to be used in place
+#define ASSET_PACK_DEFAULT_ALIGNMENT 16
+
+/// @brief Default name of the mapped pack
+#define ASSET_PACK_DEFAULT_NAME "assets_mapped.pak"
+
+/// @brief Default size of the independently decompressible chunks of compressed entries
+#define ASSET_PACK_DEFAULT_CHUNK_SIZE (256 * 1024)
+
+/// @brief Average number of entries per bucket of the entry index, more means a smaller index but a slower build
+#define ASSET_PACK_INDEX_BUCKET_SIZE 4
+
+/// @brief Entry flags
+typedef enum ASSET_PACK_ENTRY_FLAGS
+{
+    AssetPackEntryNone = 0,
+    AssetPackEntryCookedTexture = 1 << 0, // data starts with an ASSET_COOKED_TEXTURE
+    AssetPackEntryCookedMesh = 1 << 1,    // data starts with an ASSET_COOKED_MESH
+    AssetPackEntryCompressed = 1 << 2,    // stored as an ASSET_COMPRESSED_HEADER and zstd frames
+    AssetPackEntryDictionary = 1 << 3,    // the frames were compressed with the pack's dictionary
+} ASSET_PACK_ENTRY_FLAGS, *PASSET_PACK_ENTRY_FLAGS;
+
+/// @brief Pack header, at the start of the file
+PURPL_MAKE_TAG(struct, ASSET_PACK_HEADER, {
+    CHAR Signature[4];
+    UINT32 Version;
+    UINT32 EntryCount;
+    UINT32 Alignment;
+    UINT64 EntryTableOffset;
+    UINT64 NameTableOffset;
+    UINT64 NameTableSize;
+    UINT64 DictionaryOffset; // zstd dictionary shared by small entries, 0 if there isn't one
+    UINT64 DictionarySize;
+    UINT64 DataOffset;
+    UINT64 IndexOffset; // IndexBucketCount UINT32 seeds of the entry index
+    UINT32 IndexBucketCount;
+    UINT32 Reserved;
+})
+
+/// @brief Pack entry, the entry table is in the order of the entry index (see AstGetPackSlot)
+PURPL_MAKE_TAG(struct, ASSET_PACK_ENTRY, {
+    UINT64 PathHash;
+    UINT64 Offset; // absolute, aligned to the pack's alignment
+    UINT64 Size;   // size of the entry as the engine sees it
+    UINT64 StoredSize;
+    UINT32 NameOffset; // into the name table, NUL-terminated
+    UINT32 Flags;
+})
+
+/// @brief Header of a compressed entry
+///
+/// Followed by ChunkCount + 1 UINT64 offsets (relative to the start of the entry) delimiting the compressed chunks.
+/// Every chunk but the last decompresses to exactly ChunkSize bytes, and each one is a standalone zstd frame, so
+/// any range of the entry can be read by decompressing only the chunks that overlap it.
+PURPL_MAKE_TAG(struct, ASSET_COMPRESSED_HEADER, {
+    UINT32 ChunkSize;
+    UINT32 ChunkCount;
+})
+
+/// @brief Block compressed texture formats, which only come from cooked textures
+///
+/// These go in TEXTURE::Format like the formats in TEXTURE_FORMAT, and are numbered well past them so the two can't
+/// collide. Each 4x4 block of pixels is stored in 8 or 16 bytes, in rows of blocks, and partial blocks at the right
+/// and bottom edges are padded.
+typedef enum ASSET_TEXTURE_FORMAT
+{
+    AssetTextureFormatBc1 = 0x100, // RGB and 1-bit alpha, 8 bytes per block
+    AssetTextureFormatBc3 = 0x101, // BC1 colour with 8-bit interpolated alpha, 16 bytes per block
+    AssetTextureFormatBc7 = 0x102, // RGBA, 16 bytes per block
+} ASSET_TEXTURE_FORMAT, *PASSET_TEXTURE_FORMAT;
+
+/// @brief Check if a texture format is block compressed
+///
+/// @param[in] Format The format, from TEXTURE_FORMAT or ASSET_TEXTURE_FORMAT
+///
+/// @return Whether the format is block compressed
+static inline BOOLEAN AstIsBlockCompressed(_In_ UINT32 Format)
+{
+    return Format == AssetTextureFormatBc1 || Format == AssetTextureFormatBc3 || Format == AssetTextureFormatBc7;
+}
+
+/// @brief Get the size of the pixels of a block compressed image
+///
+/// @param[in] Format The block compressed format
+/// @param[in] Width The width in pixels
+/// @param[in] Height The height in pixels
+///
+/// @return The size in bytes
+static inline UINT64 AstGetBlockCompressedSize(_In_ UINT32 Format, _In_ UINT32 Width, _In_ UINT32 Height)
+{
+    return (UINT64)((Width + 3) / 4) * ((Height + 3) / 4) * (Format == AssetTextureFormatBc1 ? 8 : 16);
+}
+
+/// @brief Get the size of the pixels of a mip level of a texture
+///
+/// @param[in] Format The format, from TEXTURE_FORMAT or ASSET_TEXTURE_FORMAT
+/// @param[in] Width The width of the full texture in pixels
+/// @param[in] Height The height of the full texture in pixels
+/// @param[in] Level The mip level, 0 is the full texture and each one after it is half the size of the last
+///
+/// @return The size in bytes
+static inline UINT64 AstGetTextureLevelSize(_In_ UINT32 Format, _In_ UINT32 Width, _In_ UINT32 Height,
+                                            _In_ UINT32 Level)
+{
+    Width = PURPL_MAX(Width >> Level, 1);
+    Height = PURPL_MAX(Height >> Level, 1);
+    if (AstIsBlockCompressed(Format))
+    {
+        return AstGetBlockCompressedSize(Format, Width, Height);
+    }
+
+    // RGBA8 and 32-bit depth are both 4 bytes per pixel
+    return (UINT64)Width * Height * 4;
+}
+
+/// @brief Get the number of levels in a full mip chain, down to 1x1
+///
+/// @param[in] Width The width of the full texture in pixels
+/// @param[in] Height The height of the full texture in pixels
+///
+/// @return The number of levels, including the full texture
+static inline UINT32 AstGetFullMipCount(_In_ UINT32 Width, _In_ UINT32 Height)
+{
+    UINT32 MipCount = 1;
+    for (UINT32 Size = PURPL_MAX(Width, Height); Size > 1; Size >>= 1)
+    {
+        MipCount++;
+    }
+
+    return MipCount;
+}
+
+/// @brief Maximum number of mip levels in a cooked texture, enough for a full chain of a 32768x32768 texture
+#define ASSET_MAX_TEXTURE_MIPS 16
+
+/// @brief Header of a cooked texture entry, offsets are relative to the start of the entry
+///
+/// The mip levels come one after the other from the full texture down, with no padding, so the pixels of every level
+/// are PixelsSize bytes at PixelsOffset and any range of levels can be read in one go.
+PURPL_MAKE_TAG(struct, ASSET_COOKED_TEXTURE, {
+    UINT32 Format; // TEXTURE_FORMAT or ASSET_TEXTURE_FORMAT
+    UINT32 Width;
+    UINT32 Height;
+    UINT32 MipCount;
+    UINT64 PixelsOffset;
+    UINT64 PixelsSize; // of every level
+    UINT64 MipOffsets[ASSET_MAX_TEXTURE_MIPS];
+})
+
+/// @brief Maximum number of levels of detail in a cooked mesh, including the full mesh
+#define ASSET_MAX_MESH_LODS 4
+
+/// @brief A level of detail of a mesh, a range of triangles in its index buffer that use the same vertices
+PURPL_MAKE_TAG(struct, ASSET_MESH_LOD, {
+    UINT64 IndexOffset; // in triangles
+    UINT64 IndexCount;  // in triangles
+    FLOAT Error;        // furthest the surface moved from the full mesh, in model units
+    UINT32 Reserved;
+})
+
+/// @brief Header of a cooked mesh entry, offsets are relative to the start of the entry
+///
+/// The index buffer has every level of detail one after the other, IndexCount only covers the first (full) one.
+PURPL_MAKE_TAG(struct, ASSET_COOKED_MESH, {
+    UINT64 VertexCount;
+    UINT64 IndexCount; // in triangles, like MESH::IndexCount
+    UINT64 VerticesOffset;
+    UINT64 IndicesOffset;
+    UINT32 LodCount;
+    UINT32 Reserved;
+    ASSET_MESH_LOD Lods[ASSET_MAX_MESH_LODS];
+})
+
+/// @brief Continue hashing an asset path, so a path can be hashed in pieces without putting it together
+///
+/// @param[in] Hash The hash of the start of the path, from AstHashPath or this
+/// @param[in] Path The rest of the path
+/// @param[in] AfterSeparator Whether the start of the path ended with a separator
+///
+/// @return The hash of the whole path
+static inline UINT64 AstExtendPathHash(_In_ UINT64 Hash, _In_z_ PCSTR Path, _In_ BOOLEAN AfterSeparator)
+{
+    for (PCSTR Current = Path; *Current; Current++)
+    {
+        CHAR Character = *Current;
+        if (Character == '\\')
+        {
+            Character = '/';
+        }
+        else if (Character >= 'A' && Character <= 'Z')
+        {
+            Character = (CHAR)(Character - 'A' + 'a');
+        }
+
+        // collapse duplicate separators, EngGetAssetPath can produce them
+        if (Character == '/' && AfterSeparator)
+        {
+            continue;
+        }
+        AfterSeparator = Character == '/';
+
+        Hash ^= (UINT8)Character;
+        Hash *= 0x100000001B3ull;
+    }
+
+    return Hash;
+}
+
+/// @brief Hash an asset path, case-insensitively and treating \ and / the same (64-bit FNV-1a)
+///
+/// @param[in] Path The path to hash
+///
+/// @return The hash of the path
+static inline UINT64 AstHashPath(_In_z_ PCSTR Path)
+{
+    return AstExtendPathHash(0xCBF29CE484222325ull, Path, FALSE);
+}
+
+/// @brief Get the bucket of the entry index a path hash is in
+///
+/// The entry index is a minimal perfect hash over the path hashes of a pack's entries. Each bucket has a seed, picked
+/// by packtool so that every entry in the pack lands in a different slot of the entry table, and an entry can be found
+/// from its path hash by looking up its bucket's seed and checking the one entry in the slot it gives.
+///
+/// @param[in] PathHash The hash of the path, from AstHashPath
+/// @param[in] BucketCount The number of buckets in the index
+///
+/// @return The bucket
+static inline UINT32 AstGetPackBucket(_In_ UINT64 PathHash, _In_ UINT32 BucketCount)
+{
+    return (UINT32)((PathHash >> 32) % BucketCount);
+}
+
+/// @brief Get the slot of the entry table a path hash lands in with a seed
+///
+/// @param[in] PathHash The hash of the path, from AstHashPath
+/// @param[in] Seed The seed of the path's bucket
+/// @param[in] EntryCount The number of entries in the pack
+///
+/// @return The slot
+static inline UINT32 AstGetPackSlot(_In_ UINT64 PathHash, _In_ UINT32 Seed, _In_ UINT32 EntryCount)
+{
+    // MurmurHash3's finaliser, so every bit of the seed affects every bit of the slot
+    UINT64 Hash = PathHash ^ ((UINT64)Seed * 0x9E3779B97F4A7C15ull);
+    Hash ^= Hash >> 33;
+    Hash *= 0xFF51AFD7ED558CCDull;
+    Hash ^= Hash >> 33;
+    Hash *= 0xC4CEB9FE1A85EC53ull;
+    Hash ^= Hash >> 33;
+
+    return (UINT32)(Hash % EntryCount);
+}
+
+/// @brief Hash a block of data, eight bytes at a time (FNV-1a style with an extra mix per word)
+///
+/// @param[in] Data The data to hash
+/// @param[in] Size The size of the data
+/// @param[in] Hash The hash to continue from, 0 to start a new one
+///
+/// @return The hash of the data
+static inline UINT64 AstHashData(_In_ CONST VOID *Data, _In_ UINT64 Size, _In_ UINT64 Hash)
+{
+    CONST UINT8 *Bytes = Data;
+    UINT64 i;
+
+    if (!Hash)
+    {
+        Hash = 0xCBF29CE484222325ull;
+    }
+
+    for (i = 0; i + sizeof(UINT64) <= Size; i += sizeof(UINT64))
+    {
+        UINT64 Word;
+        memcpy(&Word, Bytes + i, sizeof(UINT64));
+        Hash = (Hash ^ Word) * 0x100000001B3ull;
+        Hash ^= Hash >> 29;
+    }
+    for (; i < Size; i++)
+    {
+        Hash = (Hash ^ Bytes[i]) * 0x100000001B3ull;
+    }
+
+    return Hash;
+}
@@ -0,0 +1,211 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    trace.c
+
+Abstract:
+
+    This file implements the load order trace. Accessed paths are kept in
+    one map in the order they were first seen, guarded by a mutex since the
+    loader threads open assets too. The previous trace is prefetched by one
+    thread, which goes through mapped packs where it can and reads through
+    the filesystem otherwise.
+
+--*/
+
+#include "pack.h"
+#include "trace.h"
+
+PURPL_MAKE_STRING_HASHMAP_ENTRY(ASSET_TRACE_MAP, UINT32);
+
+static PAS_MUTEX TraceLock;
+static PCHAR TracePath;
+static PASSET_TRACE_MAP TracedPaths; // stb_ds keeps these in the order they were added
+static BOOLEAN Recording;
+
+static PCHAR *PrefetchPaths;
+static PAS_THREAD PrefetchThread;
+static BOOLEAN PrefetchStopping;
+
+static INT Prefetch(_In_opt_ PVOID Context)
+{
+    UINT64 Start = PlatGetMilliseconds();
+    UINT32 Count = 0;
+
+    UNREFERENCED_PARAMETER(Context);
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(PrefetchPaths); i++)
+    {
+        AsLockMutex(TraceLock, TRUE);
+        BOOLEAN Stopping = PrefetchStopping;
+        AsUnlockMutex(TraceLock);
+        if (Stopping)
+        {
+            break;
+        }
+
+        if (!AstPrefetch(PrefetchPaths[i]))
+        {
+            // Not in a pack, reading it once still leaves it in the OS's cache for when it's really loaded
+            UINT64 Size = 0;
+            PVOID Data = FsReadFile(FALSE, PrefetchPaths[i], 0, 0, &Size, 0);
+            if (!Data)
+            {
+                continue;
+            }
+            CmnFree(Data);
+        }
+        Count++;
+    }
+
+    LogDebug("Prefetched %u of %zu assets in %llu ms", Count, stbds_arrlenu(PrefetchPaths),
+             PlatGetMilliseconds() - Start);
+    return 0;
+}
+
+static VOID ReadTrace(VOID)
+{
+    FILE *File = fopen(TracePath, "rb");
+    if (!File)
+    {
+        LogDebug("No load order trace at %s", TracePath);
+        return;
+    }
+
+    CHAR Line[1024];
+    while (fgets(Line, PURPL_ARRAYSIZE(Line), File))
+    {
+        Line[strcspn(Line, "\r\n")] = 0;
+        if (Line[0] && Line[0] != '#')
+        {
+            stbds_arrpush(PrefetchPaths, CmnDuplicateString(Line, 0));
+        }
+    }
+
+    fclose(File);
+}
+
+VOID AstInitializeTrace(_In_z_ PCSTR Path)
+{
+    TraceLock = AsCreateMutex();
+    if (!TraceLock)
+    {
+        CmnError("Failed to create load order trace mutex");
+    }
+
+    TracePath = CmnDuplicateString(Path, 0);
+    stbds_sh_new_strdup(TracedPaths);
+    Recording = TRUE;
+
+    if (!CONFIGVAR_GET_BOOLEAN("ast_prefetch"))
+    {
+        return;
+    }
+
+    ReadTrace();
+    if (!stbds_arrlenu(PrefetchPaths))
+    {
+        return;
+    }
+
+    LogInfo("Prefetching %zu assets from load order trace %s", stbds_arrlenu(PrefetchPaths), TracePath);
+    PrefetchStopping = FALSE;
+    PrefetchThread = AsCreateThread("Asset prefetch", PURPL_DEFAULT_THREAD_STACK_SIZE,
+                                    (PFN_THREAD_START)Prefetch, NULL);
+    if (!PrefetchThread)
+    {
+        LogWarning("Failed to create asset prefetch thread");
+    }
+}
+
+VOID AstRecordAccess(_In_opt_z_ PCSTR Directory, _In_z_ PCSTR Name)
+{
+    if (!TraceLock)
+    {
+        return;
+    }
+
+    CHAR Path[512];
+    if (Directory)
+    {
+        snprintf(Path, PURPL_ARRAYSIZE(Path), "%s/%s", Directory, Name);
+    }
+    else
+    {
+        snprintf(Path, PURPL_ARRAYSIZE(Path), "%s", Name);
+    }
+
+    AsLockMutex(TraceLock, TRUE);
+    if (Recording && stbds_shgeti(TracedPaths, Path) < 0)
+    {
+        stbds_shput(TracedPaths, Path, (UINT32)stbds_shlenu(TracedPaths));
+    }
+    AsUnlockMutex(TraceLock);
+}
+
+VOID AstFinishTrace(VOID)
+{
+    if (!TraceLock)
+    {
+        return;
+    }
+
+    AsLockMutex(TraceLock, TRUE);
+    if (!Recording)
+    {
+        AsUnlockMutex(TraceLock);
+        return;
+    }
+    Recording = FALSE;
+
+    LogInfo("Writing load order trace of %zu assets to %s", stbds_shlenu(TracedPaths), TracePath);
+    FILE *File = fopen(TracePath, "wb");
+    if (File)
+    {
+        fprintf(File, "# Assets loaded before the first frame, in order, for packtool -o\n");
+        for (SIZE_T i = 0; i < stbds_shlenu(TracedPaths); i++)
+        {
+            fprintf(File, "%s\n", TracedPaths[i].key);
+        }
+        fclose(File);
+    }
+    else
+    {
+        LogWarning("Failed to open %s: %s", TracePath, strerror(errno));
+    }
+
+    stbds_shfree(TracedPaths);
+    AsUnlockMutex(TraceLock);
+}
+
+VOID AstShutdownTrace(VOID)
+{
+    if (!TraceLock)
+    {
+        return;
+    }
+
+    if (PrefetchThread)
+    {
+        AsLockMutex(TraceLock, TRUE);
+        PrefetchStopping = TRUE;
+        AsUnlockMutex(TraceLock);
+
+        AsJoinThread(PrefetchThread);
+        PrefetchThread = NULL;
+    }
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(PrefetchPaths); i++)
+    {
+        CmnFree(PrefetchPaths[i]);
+    }
+    stbds_arrfree(PrefetchPaths);
+    stbds_shfree(TracedPaths);
+    CmnFree(TracePath);
+
+    AsDestroyMutex(TraceLock);
+    TraceLock = NULL;
+}
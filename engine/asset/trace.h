@@ -0,0 +1,44 @@
+/// @file trace.h
+///
+/// @brief This file declares the load order trace, which records the assets used during startup so the next run can
+/// read them in ahead of time.
+///
+/// Every asset opened between AstInitializeTrace and AstFinishTrace is recorded once, in the order it was first
+/// opened, and the list is written to the data directory, one path per line. packtool can lay packs out in the same
+/// order. On the next run, a thread reads the previous trace's assets into memory while the rest of the engine starts,
+/// so the reads overlap with creating the window, the renderer and the shaders instead of happening after them.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/configvar.h"
+#include "common/filesystem.h"
+#include "common/log.h"
+
+#include "platform/async.h"
+#include "platform/platform.h"
+
+/// @brief Name of the trace in the data directory
+#define ASSET_TRACE_NAME "load_order.txt"
+
+/// @brief Start recording, and prefetch the assets in the previous trace if there is one
+///
+/// @param[in] Path The trace to read and later write
+extern VOID AstInitializeTrace(_In_z_ PCSTR Path);
+
+/// @brief Record that an asset was opened, called by the asset functions
+///
+/// @param[in] Directory The directory of the asset, NULL if Name is the whole path
+/// @param[in] Name The path of the asset in the directory, only put together with it while recording
+extern VOID AstRecordAccess(_In_opt_z_ PCSTR Directory, _In_z_ PCSTR Name);
+
+/// @brief Stop recording and write the trace, called once the first frame is done
+extern VOID AstFinishTrace(VOID);
+
+/// @brief Stop prefetching and free the trace, must be called before the packs are unmounted
+extern VOID AstShutdownTrace(VOID);
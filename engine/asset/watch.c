@@ -0,0 +1,320 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    watch.c
+
+Abstract:
+
+    This file implements the asset watcher. Watched files are kept in one
+    map by their asset path. inotify marks them changed as soon as whatever
+    wrote them closes them, and files it can't cover are polled with stat,
+    which only reports a change once the file has stayed the same for a
+    whole interval so half written files aren't picked up.
+
+--*/
+
+#include "watch.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef PURPL_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/// @brief A watched asset
+PURPL_MAKE_TAG(struct, ASSET_WATCHED_FILE, {
+    INT64 ModifiedTime; // newest of the copies in the watched directories
+    INT64 Size;
+    BOOLEAN Polled;   // not covered by inotify
+    BOOLEAN Settling; // polled and seen to change, reported once it stops changing
+    BOOLEAN Changed;
+})
+
+PURPL_MAKE_STRING_HASHMAP_ENTRY(ASSET_WATCH_MAP, ASSET_WATCHED_FILE);
+
+static PAS_MUTEX WatchLock;
+static PASSET_WATCH_MAP WatchedFiles;
+static PCHAR *WatchRoots;
+static UINT64 LastPoll;
+
+static ENGINE_CONFIGVAR IntervalVar = ENGINE_CONFIGVAR_INT("ast_watch_interval");
+
+#ifdef PURPL_LINUX
+/// @brief The directory each inotify watch is for, relative to the watched directories like the asset paths
+PURPL_MAKE_TAG(struct, ASSET_WATCH_DIRECTORY_MAP, {
+    INT key;
+    PCHAR value;
+})
+
+static PASSET_WATCH_DIRECTORY_MAP WatchDirectories;
+static INT Notify = -1;
+#endif
+
+VOID AstInitializeWatcher(VOID)
+{
+    LogInfo("Watching assets for changes");
+
+    WatchLock = AsCreateMutex();
+    if (!WatchLock)
+    {
+        CmnError("Failed to create asset watcher mutex");
+    }
+
+    stbds_sh_new_strdup(WatchedFiles);
+    LastPoll = PlatGetMilliseconds();
+
+#ifdef PURPL_LINUX
+    Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (Notify < 0)
+    {
+        LogWarning("Failed to initialize inotify, polling for asset changes instead: %s", strerror(errno));
+    }
+#endif
+}
+
+VOID AstShutdownWatcher(VOID)
+{
+    if (!WatchLock)
+    {
+        return;
+    }
+
+    LogInfo("Stopping asset watcher");
+
+#ifdef PURPL_LINUX
+    if (Notify >= 0)
+    {
+        close(Notify);
+        Notify = -1;
+    }
+    for (SIZE_T i = 0; i < stbds_hmlenu(WatchDirectories); i++)
+    {
+        CmnFree(WatchDirectories[i].value);
+    }
+    stbds_hmfree(WatchDirectories);
+#endif
+
+    stbds_shfree(WatchedFiles);
+    for (SIZE_T i = 0; i < stbds_arrlenu(WatchRoots); i++)
+    {
+        CmnFree(WatchRoots[i]);
+    }
+    stbds_arrfree(WatchRoots);
+
+    AsDestroyMutex(WatchLock);
+    WatchLock = NULL;
+}
+
+VOID AstWatchDirectory(_In_z_ PCSTR Root)
+{
+    if (!WatchLock)
+    {
+        return;
+    }
+
+    LogDebug("Watching directory %s", Root);
+
+    AsLockMutex(WatchLock, TRUE);
+    stbds_arrpush(WatchRoots, CmnDuplicateString(Root, 0));
+    AsUnlockMutex(WatchLock);
+}
+
+// Gets the newest copy of an asset out of the watched directories, both are 0 if there are none
+static VOID StatFile(_In_z_ PCSTR Path, _Out_ INT64 *ModifiedTime, _Out_ INT64 *Size)
+{
+    *ModifiedTime = 0;
+    *Size = 0;
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(WatchRoots); i++)
+    {
+        CHAR FullPath[1024];
+        stbsp_snprintf(FullPath, PURPL_ARRAYSIZE(FullPath), "%s/%s", WatchRoots[i], Path);
+
+        struct stat Stat = {0};
+        if (stat(FullPath, &Stat) == 0 && (INT64)Stat.st_mtime >= *ModifiedTime)
+        {
+            *ModifiedTime = (INT64)Stat.st_mtime;
+            *Size = (INT64)Stat.st_size;
+        }
+    }
+}
+
+#ifdef PURPL_LINUX
+// Watches the directory the asset is in under every root, returns FALSE if none of them could be watched
+static BOOLEAN WatchParents(_In_z_ PCSTR Path)
+{
+    CHAR Directory[1024] = {0};
+    PCSTR Separator = strrchr(Path, '/');
+    if (Separator)
+    {
+        strncpy(Directory, Path, PURPL_MIN((SIZE_T)(Separator - Path), PURPL_ARRAYSIZE(Directory) - 1));
+    }
+
+    BOOLEAN Watched = FALSE;
+    for (SIZE_T i = 0; i < stbds_arrlenu(WatchRoots); i++)
+    {
+        CHAR FullPath[1024];
+        stbsp_snprintf(FullPath, PURPL_ARRAYSIZE(FullPath), "%s/%s", WatchRoots[i], Directory);
+
+        // Watching the same directory again gives back the same descriptor
+        INT Watch = inotify_add_watch(Notify, FullPath, IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (Watch < 0)
+        {
+            if (errno != ENOENT)
+            {
+                LogWarning("Failed to watch %s, polling it instead: %s", FullPath, strerror(errno));
+                return FALSE;
+            }
+            continue;
+        }
+
+        if (stbds_hmgeti(WatchDirectories, Watch) < 0)
+        {
+            stbds_hmput(WatchDirectories, Watch, CmnDuplicateString(Directory, 0));
+        }
+        Watched = TRUE;
+    }
+
+    return Watched;
+}
+
+static VOID ReadEvents(VOID)
+{
+    _Alignas(struct inotify_event) CHAR Buffer[4096];
+    INT64 Length;
+
+    while ((Length = (INT64)read(Notify, Buffer, sizeof(Buffer))) > 0)
+    {
+        PCHAR Current = Buffer;
+        while (Current < Buffer + Length)
+        {
+            CONST struct inotify_event *Event = (CONST struct inotify_event *)Current;
+            Current += sizeof(struct inotify_event) + Event->len;
+            if (Event->mask & IN_Q_OVERFLOW)
+            {
+                // Something was missed, so everything has to be assumed to have changed
+                LogWarning("Too many asset changes at once, reloading everything watched");
+                for (SIZE_T i = 0; i < stbds_shlenu(WatchedFiles); i++)
+                {
+                    WatchedFiles[i].value.Changed = TRUE;
+                }
+                continue;
+            }
+            else if (!Event->len)
+            {
+                continue;
+            }
+
+            PCSTR Directory = stbds_hmget(WatchDirectories, Event->wd);
+            if (!Directory)
+            {
+                continue;
+            }
+
+            CHAR Path[1024];
+            stbsp_snprintf(Path, PURPL_ARRAYSIZE(Path), Directory[0] ? "%s/%s" : "%s%s", Directory, Event->name);
+            PASSET_WATCH_MAP File = stbds_shgetp_null(WatchedFiles, Path);
+            if (File)
+            {
+                File->value.Changed = TRUE;
+            }
+        }
+    }
+}
+#endif
+
+VOID AstWatchAsset(_In_z_ PCSTR Path)
+{
+    if (!WatchLock)
+    {
+        return;
+    }
+
+    AsLockMutex(WatchLock, TRUE);
+    if (stbds_shgeti(WatchedFiles, Path) < 0)
+    {
+        ASSET_WATCHED_FILE File = {0};
+        StatFile(Path, &File.ModifiedTime, &File.Size);
+        File.Polled = TRUE;
+#ifdef PURPL_LINUX
+        File.Polled = Notify < 0 || !WatchParents(Path);
+#endif
+        LogTrace("Watching %s%s", Path, File.Polled ? " by polling" : "");
+        stbds_shput(WatchedFiles, Path, File);
+    }
+    AsUnlockMutex(WatchLock);
+}
+
+UINT32 AstPollWatcher(_In_ PFN_ASSET_CHANGED_CALLBACK Callback, _In_opt_ PVOID Context)
+{
+    if (!WatchLock)
+    {
+        return 0;
+    }
+
+    AsLockMutex(WatchLock, TRUE);
+
+#ifdef PURPL_LINUX
+    if (Notify >= 0)
+    {
+        ReadEvents();
+    }
+#endif
+
+    UINT64 Now = PlatGetMilliseconds();
+    if (Now - LastPoll >= (UINT64)PURPL_MAX(ENGINE_CONFIGVAR_GET_INT(IntervalVar), 0))
+    {
+        LastPoll = Now;
+        for (SIZE_T i = 0; i < stbds_shlenu(WatchedFiles); i++)
+        {
+            PASSET_WATCHED_FILE File = &WatchedFiles[i].value;
+            if (!File->Polled)
+            {
+                continue;
+            }
+
+            INT64 ModifiedTime;
+            INT64 Size;
+            StatFile(WatchedFiles[i].key, &ModifiedTime, &Size);
+            if (ModifiedTime != File->ModifiedTime || Size != File->Size)
+            {
+                File->ModifiedTime = ModifiedTime;
+                File->Size = Size;
+                File->Settling = TRUE;
+            }
+            else if (File->Settling)
+            {
+                File->Settling = FALSE;
+                File->Changed = TRUE;
+            }
+        }
+    }
+
+    // The callbacks can load things, which would watch them, so they're called without the lock
+    PCHAR *Changed = NULL;
+    for (SIZE_T i = 0; i < stbds_shlenu(WatchedFiles); i++)
+    {
+        if (WatchedFiles[i].value.Changed)
+        {
+            WatchedFiles[i].value.Changed = FALSE;
+            stbds_arrpush(Changed, CmnDuplicateString(WatchedFiles[i].key, 0));
+        }
+    }
+    AsUnlockMutex(WatchLock);
+
+    UINT32 Count = (UINT32)stbds_arrlenu(Changed);
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        LogInfo("Asset %s changed", Changed[i]);
+        Callback(Changed[i], Context);
+        CmnFree(Changed[i]);
+    }
+    stbds_arrfree(Changed);
+
+    return Count;
+}
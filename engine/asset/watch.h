@@ -0,0 +1,50 @@
+/// @file watch.h
+///
+/// @brief This file declares the asset watcher, which notices when loose asset files change so they can be reloaded.
+///
+/// Every asset read from a directory source instead of a mapped pack is watched once it's been loaded. On Linux, the
+/// directories they're in are watched with inotify, and everywhere else (or if inotify runs out of watches) the files
+/// are checked with stat every ast_watch_interval milliseconds.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/configvar.h"
+#include "common/log.h"
+
+#include "engine/confighandle.h"
+
+#include "platform/async.h"
+#include "platform/platform.h"
+
+/// @brief Called for each asset that changed, with the same path it was loaded with
+typedef VOID (*PFN_ASSET_CHANGED_CALLBACK)(_In_z_ PCSTR Path, _In_opt_ PVOID Context);
+
+/// @brief Start watching for changes, nothing is watched until this is called
+extern VOID AstInitializeWatcher(VOID);
+
+/// @brief Stop watching for changes
+extern VOID AstShutdownWatcher(VOID);
+
+/// @brief Add a directory that asset paths are relative to, like a directory source
+///
+/// @param[in] Root The directory
+extern VOID AstWatchDirectory(_In_z_ PCSTR Root);
+
+/// @brief Watch an asset, called by the asset functions when they read something that isn't in a pack
+///
+/// @param[in] Path The path of the asset, relative to the watched directories
+extern VOID AstWatchAsset(_In_z_ PCSTR Path);
+
+/// @brief Report the watched assets that changed since the last call
+///
+/// @param[in] Callback Called for each changed asset
+/// @param[in] Context Passed to the callback
+///
+/// @return The number of assets that changed
+extern UINT32 AstPollWatcher(_In_ PFN_ASSET_CHANGED_CALLBACK Callback, _In_opt_ PVOID Context);
@@ -0,0 +1,39 @@
+/// @file atomic.h
+///
+/// @brief This file defines thread local storage and atomic operations on 64-bit integers for the engine's own threading
+/// code, using compiler intrinsics so it works the same with MSVC and GCC-compatible compilers.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#ifdef _MSC_VER
+#define ENGINE_THREAD_LOCAL __declspec(thread)
+#define ENGINE_ATOMIC_ADD(Target, Value) (InterlockedExchangeAdd64((volatile LONG64 *)(Target), (Value)) + (Value))
+#define ENGINE_ATOMIC_CAS(Target, Expected, Desired)                                                                   \
+    (InterlockedCompareExchange64((volatile LONG64 *)(Target), (Desired), (Expected)) == (Expected))
+#define ENGINE_ATOMIC_LOAD(Target) InterlockedOr64((volatile LONG64 *)(Target), 0)
+#define ENGINE_ATOMIC_STORE(Target, Value) InterlockedExchange64((volatile LONG64 *)(Target), (Value))
+#define ENGINE_ATOMIC_FENCE() MemoryBarrier()
+#define ENGINE_CPU_PAUSE() YieldProcessor()
+#else
+#define ENGINE_THREAD_LOCAL _Thread_local
+#define ENGINE_ATOMIC_ADD(Target, Value) __atomic_add_fetch((Target), (Value), __ATOMIC_ACQ_REL)
+#define ENGINE_ATOMIC_CAS(Target, Expected, Desired)                                                                   \
+    __extension__({                                                                                                    \
+        INT64 Expected_ = (Expected);                                                                                  \
+        __atomic_compare_exchange_n((Target), &Expected_, (Desired), TRUE, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);        \
+    })
+#define ENGINE_ATOMIC_LOAD(Target) __atomic_load_n((Target), __ATOMIC_ACQUIRE)
+#define ENGINE_ATOMIC_STORE(Target, Value) __atomic_store_n((Target), (Value), __ATOMIC_RELEASE)
+#define ENGINE_ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#if defined __x86_64__ || defined __i386__
+#define ENGINE_CPU_PAUSE() __builtin_ia32_pause()
+#elif defined __aarch64__ || defined __arm__
+#define ENGINE_CPU_PAUSE() __asm__ __volatile__("yield")
+#else
+#define ENGINE_CPU_PAUSE()
+#endif
+#endif
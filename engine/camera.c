@@ -50,6 +50,8 @@ static CONST CAMERA_FUNCS CameraFuncs[RenderApiCount] = {
 };
 static PCCAMERA_FUNCS CurrentCameraFuncs;
 
+static ENGINE_CONFIGVAR FovVar = ENGINE_CONFIGVAR_FLOAT("cam_fov");
+
 VOID CamDefineVariables(VOID)
 {
     CONFIGVAR_DEFINE_FLOAT("cam_fov", 78.0, FALSE, ConfigVarSideClientOnly, FALSE, FALSE);
@@ -57,6 +59,23 @@ VOID CamDefineVariables(VOID)
 
 VOID CamGetVectors(_In_ ecs_entity_t Camera, _Out_opt_ vec3 Forward, _Out_opt_ vec3 Up)
 {
+    // Quaternions rotate the vectors directly, without building a matrix from angles
+    PCORIENTATION Orientation = ecs_get(EcsGetWorld(), Camera, ORIENTATION);
+    if (Orientation)
+    {
+        if (Forward)
+        {
+            glm_quat_rotatev((PFLOAT)Orientation->Value, (vec3){0.0, 0.0, 1.0}, Forward);
+        }
+
+        if (Up)
+        {
+            glm_quat_rotatev((PFLOAT)Orientation->Value, (vec3){0.0, CurrentCameraFuncs->UpSign, 0.0}, Up);
+        }
+
+        return;
+    }
+
     mat4 RotationMatrix = {0};
     PCROTATION Rotation = ecs_get(EcsGetWorld(), Camera, ROTATION);
     if (Rotation)
@@ -90,7 +109,7 @@ VOID CamUpdate(_In_ ecs_iter_t *Iterator)
     {
         if (!Camera[i].FixedFov)
         {
-            Camera[i].FieldOfView = glm_rad(CONFIGVAR_GET_FLOAT("cam_fov"));
+            Camera[i].FieldOfView = glm_rad((FLOAT)ENGINE_CONFIGVAR_GET_FLOAT(FovVar));
         }
 
         vec3 Forward = {0};
@@ -126,5 +145,8 @@ VOID CameraImport(_In_ ecs_world_t *World)
 
     ECS_COMPONENT_DEFINE(World, CAMERA);
 
-    ECS_SYSTEM_DEFINE(World, CamUpdate, EcsOnUpdate, CAMERA, POSITION);
+    // Cameras only write their own matrices, so they can be split across threads, as long as the handle is registered
+    // here first
+    EngResolveConfigVar(&FovVar);
+    ECS_SYSTEM_DEFINE_EX(World, CamUpdate, EcsOnUpdate, TRUE, 0, CAMERA, [in] POSITION);
 }
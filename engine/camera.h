@@ -42,7 +42,7 @@ extern VOID CamAddPerspective(_In_ ecs_entity_t Entity, _In_ DOUBLE FieldOfView,
 /// @param[out] Camera The camera to initialize.
 extern VOID CamAddOrthographic(_In_ ecs_entity_t Entity);
 
-/// @brief Get the up and forward vectors of a camera
+/// @brief Get the up and forward vectors of a camera, from its ORIENTATION if it has one or its ROTATION otherwise
 extern VOID CamGetVectors(_In_ ecs_entity_t Camera, _Out_opt_ vec3 Forward, _Out_opt_ vec3 Up);
 
 extern ECS_SYSTEM_DECLARE(CamUpdate);
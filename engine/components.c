@@ -1,8 +1,76 @@
 #include "components.h"
+#include "job.h"
+#include "profile.h"
+#include "math/transform.h"
 
 ecs_entity_t ecs_id(POSITION);
 ecs_entity_t ecs_id(ROTATION);
 ecs_entity_t ecs_id(SCALE);
+ecs_entity_t ecs_id(ORIENTATION);
+ecs_entity_t ecs_id(WORLD_TRANSFORM);
+
+// Cascade makes flecs return tables in order of depth, so parents are always done before their children
+static ecs_query_t *TransformQuery;
+
+// Tables up to this size are done in one go, bigger ones are split across the job system
+#define TRANSFORM_BATCH_SIZE 512
+
+/// @brief The columns of a table being updated
+PURPL_MAKE_TAG(struct, TRANSFORM_COLUMNS, {
+    PCPOSITION Position;
+    PCROTATION Rotation;
+    PCORIENTATION Orientation;
+    PCSCALE Scale;
+    PWORLD_TRANSFORM Transform;
+    PCWORLD_TRANSFORM Parent; // shared by the whole table
+})
+
+static VOID UpdateTransforms(_In_ PTRANSFORM_COLUMNS Columns, _In_ UINT64 Start, _In_ UINT64 End)
+{
+    // The components are just a vector or a matrix, so the columns can go to the kernel as they are
+    MthCreateTransformMatrices(End - Start, Columns->Position ? &Columns->Position[Start].Value : NULL,
+                               Columns->Rotation ? &Columns->Rotation[Start].Value : NULL,
+                               Columns->Orientation ? &Columns->Orientation[Start].Value : NULL,
+                               Columns->Scale ? &Columns->Scale[Start].Value : NULL,
+                               &Columns->Transform[Start].Value);
+    if (Columns->Parent)
+    {
+        for (UINT64 i = Start; i < End; i++)
+        {
+            glm_mat4_mul((vec4 *)Columns->Parent->Value, Columns->Transform[i].Value, Columns->Transform[i].Value);
+        }
+    }
+}
+
+VOID EcsUpdateTransforms(_In_ ecs_iter_t *Iterator)
+{
+    ENGINE_PROFILE_BEGIN("EcsUpdateTransforms");
+
+    ecs_iter_t It = ecs_query_iter(Iterator->world, TransformQuery);
+    while (ecs_query_next(&It))
+    {
+        // Only [in] terms are tracked, and writing WORLD_TRANSFORM marks it changed for any children
+        if (!ecs_query_changed(TransformQuery, &It))
+        {
+            ecs_query_skip(&It);
+            continue;
+        }
+
+        TRANSFORM_COLUMNS Columns = {0};
+        Columns.Position = ecs_field(&It, POSITION, 1);
+        Columns.Rotation = ecs_field(&It, ROTATION, 2);
+        Columns.Orientation = ecs_field(&It, ORIENTATION, 3);
+        Columns.Scale = ecs_field(&It, SCALE, 4);
+        Columns.Transform = ecs_field(&It, WORLD_TRANSFORM, 5);
+        Columns.Parent = ecs_field(&It, WORLD_TRANSFORM, 6);
+
+        // Rows of a table don't depend on each other, only on the parent's table, which was finished before this one
+        EngParallelFor(It.count, TRANSFORM_BATCH_SIZE, (PFN_ENGINE_PARALLEL_FOR)UpdateTransforms, &Columns);
+    }
+
+    ENGINE_PROFILE_END();
+}
+ecs_entity_t ecs_id(EcsUpdateTransforms);
 
 VOID CoreImport(_In_ ecs_world_t *World)
 {
@@ -11,4 +79,20 @@ VOID CoreImport(_In_ ecs_world_t *World)
     ECS_COMPONENT_DEFINE(World, POSITION);
     ECS_COMPONENT_DEFINE(World, ROTATION);
     ECS_COMPONENT_DEFINE(World, SCALE);
+    ECS_COMPONENT_DEFINE(World, ORIENTATION);
+    ECS_COMPONENT_DEFINE(World, WORLD_TRANSFORM);
+
+    ecs_add_pair(World, ecs_id(POSITION), EcsWith, ecs_id(WORLD_TRANSFORM));
+    ecs_add_pair(World, ecs_id(ROTATION), EcsWith, ecs_id(WORLD_TRANSFORM));
+    ecs_add_pair(World, ecs_id(SCALE), EcsWith, ecs_id(WORLD_TRANSFORM));
+    ecs_add_pair(World, ecs_id(ORIENTATION), EcsWith, ecs_id(WORLD_TRANSFORM));
+
+    TransformQuery =
+        ecs_query(World, {.filter.expr = "[in] ?POSITION, [in] ?ROTATION, [in] ?ORIENTATION, [in] ?SCALE, [out] "
+                                         "WORLD_TRANSFORM, [in] ?WORLD_TRANSFORM(parent|cascade)"});
+
+    // Game logic and cameras run in OnUpdate, and the renderer draws in PostUpdate. This can't be split across ECS
+    // threads, flecs would hand out tables without waiting for their parents, so it stays on the main thread and splits
+    // big tables across the job system instead.
+    ECS_SYSTEM_DEFINE_EX(World, EcsUpdateTransforms, EcsOnValidate, FALSE, 0, 0);
 }
@@ -9,3 +9,20 @@ PURPL_MAKE_COMPONENT(struct, POSITION, { vec3 Value; })
 PURPL_MAKE_COMPONENT(struct, ROTATION, { vec3 Value; })
 
 PURPL_MAKE_COMPONENT(struct, SCALE, { vec3 Value; })
+
+/// @brief Rotation as a normalized quaternion, used instead of ROTATION by anything that has both
+///
+/// Nothing has to be recomputed from angles when this is read, rotations combine with a multiplication, and it can be
+/// interpolated with glm_quat_slerp. MthEulerToQuaternion and MthQuaternionToEuler convert to and from ROTATION.
+PURPL_MAKE_COMPONENT(struct, ORIENTATION, { versor Value; })
+
+/// @brief World transform, from POSITION, ORIENTATION or ROTATION, SCALE, and the WORLD_TRANSFORM of the entity's parent
+///
+/// Added along with any of the others, and kept up to date by EcsUpdateTransforms. Only tables where one of them
+/// changed, or where the parent's transform changed, get recomputed, so anything that doesn't move costs nothing. Flecs
+/// notices changes made with ecs_set, ecs_modified, and by systems that have them as [inout] or [out], but not writes
+/// through ecs_get_mut on their own.
+PURPL_MAKE_COMPONENT(struct, WORLD_TRANSFORM, { mat4 Value; })
+
+/// @brief Recompute world transforms that changed, parents before children
+extern ECS_SYSTEM_DECLARE(EcsUpdateTransforms);
@@ -0,0 +1,93 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    confighandle.c
+
+Abstract:
+
+    This file implements config var handles. A handle's name is only looked
+    up when it's registered, after that it's refreshed through a pointer to
+    its config var's value.
+
+--*/
+
+#include "confighandle.h"
+
+static PENGINE_CONFIGVAR *ConfigVars;
+
+static VOID Refresh(_Inout_ PENGINE_CONFIGVAR Var)
+{
+    BOOLEAN Changed;
+
+    switch (Var->Type)
+    {
+    case EngConfigVarTypeInt: {
+        INT64 Value = *Var->Source.Int;
+        Changed = Value != Var->Value.Int;
+        Var->Value.Int = Value;
+        break;
+    }
+    case EngConfigVarTypeFloat: {
+        DOUBLE Value = *Var->Source.Float;
+        Changed = Value != Var->Value.Float;
+        Var->Value.Float = Value;
+        break;
+    }
+    case EngConfigVarTypeBoolean:
+    default: {
+        BOOLEAN Value = *Var->Source.Boolean;
+        Changed = Value != Var->Value.Boolean;
+        Var->Value.Boolean = Value;
+        break;
+    }
+    }
+
+    if (Changed)
+    {
+        Var->ChangeCount++;
+    }
+}
+
+VOID EngRegisterConfigVar(_Inout_ PENGINE_CONFIGVAR Var)
+{
+    LogTrace("Registering handle for config var %s", Var->Name);
+
+    switch (Var->Type)
+    {
+    case EngConfigVarTypeInt:
+        Var->Source.Int = &CONFIGVAR_GET_INT(Var->Name);
+        break;
+    case EngConfigVarTypeFloat:
+        Var->Source.Float = &CONFIGVAR_GET_FLOAT(Var->Name);
+        break;
+    case EngConfigVarTypeBoolean:
+    default:
+        Var->Source.Boolean = &CONFIGVAR_GET_BOOLEAN(Var->Name);
+        break;
+    }
+
+    Refresh(Var);
+    Var->ChangeCount = 0;
+    Var->Registered = TRUE;
+    stbds_arrpush(ConfigVars, Var);
+}
+
+VOID EngRefreshConfigVars(VOID)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(ConfigVars); i++)
+    {
+        Refresh(ConfigVars[i]);
+    }
+}
+
+VOID EngClearConfigVars(VOID)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(ConfigVars); i++)
+    {
+        ConfigVars[i]->Registered = FALSE;
+    }
+    stbds_arrfree(ConfigVars);
+}
@@ -0,0 +1,98 @@
+/// @file confighandle.h
+///
+/// @brief This file declares config var handles, for reading config vars on hot paths without looking them up by name.
+///
+/// A handle is a static variable that names a config var. The first time it's read, its config var is looked up by name
+/// to get a pointer to its value, and the handle is added to a list. EngRefreshConfigVars copies the value through that
+/// pointer into every handle in the list once per frame, without looking any names up. Reading a handle is just reading
+/// that copy, and ChangeCount goes up every time the value changes, so code that has to react to changes can remember
+/// the count it last saw instead of polling the config var.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/configvar.h"
+#include "common/log.h"
+
+/// @brief The type of a config var handle
+typedef enum ENGINE_CONFIGVAR_TYPE
+{
+    EngConfigVarTypeInt,
+    EngConfigVarTypeFloat,
+    EngConfigVarTypeBoolean,
+} ENGINE_CONFIGVAR_TYPE, *PENGINE_CONFIGVAR_TYPE;
+
+/// @brief A config var handle, define these with ENGINE_CONFIGVAR_INT/FLOAT/BOOLEAN
+PURPL_MAKE_TAG(struct, ENGINE_CONFIGVAR, {
+    PCSTR Name;
+    ENGINE_CONFIGVAR_TYPE Type;
+    BOOLEAN Registered;
+    union {
+        CONST INT64 *Int;
+        CONST DOUBLE *Float;
+        CONST BOOLEAN *Boolean;
+    } Source; // the config var's value, config vars don't move once they're all defined
+    union {
+        INT64 Int;
+        DOUBLE Float;
+        BOOLEAN Boolean;
+    } Value;
+    UINT64 ChangeCount; // goes up every time the value changes
+})
+
+/// @brief Initializer for an integer config var handle
+#define ENGINE_CONFIGVAR_INT(VarName) {.Name = (VarName), .Type = EngConfigVarTypeInt}
+
+/// @brief Initializer for a floating point config var handle
+#define ENGINE_CONFIGVAR_FLOAT(VarName) {.Name = (VarName), .Type = EngConfigVarTypeFloat}
+
+/// @brief Initializer for a boolean config var handle
+#define ENGINE_CONFIGVAR_BOOLEAN(VarName) {.Name = (VarName), .Type = EngConfigVarTypeBoolean}
+
+/// @brief Read an integer config var handle
+#define ENGINE_CONFIGVAR_GET_INT(Var) (EngResolveConfigVar(&(Var))->Value.Int)
+
+/// @brief Read a floating point config var handle
+#define ENGINE_CONFIGVAR_GET_FLOAT(Var) (EngResolveConfigVar(&(Var))->Value.Float)
+
+/// @brief Read a boolean config var handle
+#define ENGINE_CONFIGVAR_GET_BOOLEAN(Var) (EngResolveConfigVar(&(Var))->Value.Boolean)
+
+/// @brief Get the change count of a config var handle
+#define ENGINE_CONFIGVAR_CHANGE_COUNT(Var) (EngResolveConfigVar(&(Var))->ChangeCount)
+
+/// @brief Look up a handle's config var, which is the only time its name is used, and add it to the list of handles
+/// refreshed every frame
+///
+/// Handles should be registered on the main thread, which is where they're refreshed.
+///
+/// @param[in,out] Var The handle
+extern VOID EngRegisterConfigVar(_Inout_ PENGINE_CONFIGVAR Var);
+
+/// @brief Copy the current value of every registered config var into its handle
+///
+/// Called at the start of every frame, and after the engine changes a config var it reads through a handle.
+extern VOID EngRefreshConfigVars(VOID);
+
+/// @brief Forget every registered handle, they register themselves again when they're next read
+extern VOID EngClearConfigVars(VOID);
+
+/// @brief Register a handle if it isn't registered yet
+///
+/// @param[in,out] Var The handle
+///
+/// @return The handle
+static inline PENGINE_CONFIGVAR EngResolveConfigVar(_Inout_ PENGINE_CONFIGVAR Var)
+{
+    if (!Var->Registered)
+    {
+        EngRegisterConfigVar(Var);
+    }
+
+    return Var;
+}
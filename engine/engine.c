@@ -63,12 +63,23 @@ PCHAR EngGetAssetPath(_In_ ENGINE_ASSET_DIRECTORY Directory, _In_opt_z_ _Printf_
 
 #undef X
 
+// Hashes of each asset directory followed by a separator, so paths in them can be hashed from the name alone
+static UINT64 AssetDirectoryHashes[EngAssetDirectoryCount];
+
+VOID EngMakeAssetPath(_In_ ENGINE_ASSET_DIRECTORY Directory, _In_z_ PCSTR Name, _Out_ PASSET_PATH Path)
+{
+    AstMakePath(Path, EngAssetDirectories[Directory], AssetDirectoryHashes[Directory], Name);
+}
+
 ecs_entity_t EngMainCamera;
 
 VOID EngDefineVariables(VOID)
 {
+    AstDefineVariables();
     CamDefineVariables();
     EcsDefineVariables();
+    EngDefineJobVariables();
+    EngDefineProfileVariables();
     RdrDefineVariables();
 }
 
@@ -111,6 +122,25 @@ Return Value:
         }
     }
 
+    for (i = 0; i < EngAssetDirectoryCount; i++)
+    {
+        AssetDirectoryHashes[i] = AstHashPath(CmnFormatTempString("%s/", EngAssetDirectories[i]));
+    }
+
+    // Mapped packs are checked before the regular sources, anything not in them is read normally
+#ifdef PURPL_SWITCH
+    AstMountPack(PURPL_SWITCH_ROMFS_MOUNTPOINT ASSET_PACK_DEFAULT_NAME);
+#else
+    if (!AstMountPack(ASSET_PACK_DEFAULT_NAME)
+#ifdef PURPL_DEBUG
+        && !AstMountPack("assets/" ASSET_PACK_DEFAULT_NAME)
+#endif
+    )
+    {
+        LogDebug("No mapped asset pack found");
+    }
+#endif
+
 #ifdef PURPL_SWITCH
     if (!FsAddPackSource(PURPL_SWITCH_ROMFS_MOUNTPOINT "assets_dir.pak"))
     {
@@ -127,6 +157,11 @@ Return Value:
         FsAddDirectorySource("assets");
 #ifdef PURPL_DEBUG
         FsAddDirectorySource("assets/out");
+
+        // Loose assets can be reloaded when they change, anything in a mapped pack still comes from the pack
+        AstInitializeWatcher();
+        AstWatchDirectory("assets");
+        AstWatchDirectory("assets/out");
 #endif
     }
 #endif
@@ -141,17 +176,21 @@ Return Value:
                                Time.tm_mday, Time.tm_hour, Time.tm_min, Time.tm_sec);
 
     LogInfo("Opening log file %s", Path);
-    FILE *LogFile = fopen(Path, "ab");
-    if (!LogFile)
+    if (!EngOpenLogFile(Path))
     {
         CmnError("Failed to open log file %s: %s", Path, strerror(errno));
     }
-
-    LogAddFile(LogFile, LogGetLevel());
 #endif
 
     LogInfo(PURPL_BUILD_TYPE " engine running on %s", PlatGetDescription());
 
+    EngInitializeProfiler();
+    EngInitializeJobs();
+
+    // Everything up to the first frame is recorded, and what was recorded last time gets read in while the window and
+    // renderer are being set up
+    AstInitializeTrace(CmnFormatTempString("%s" ASSET_TRACE_NAME, EngDataDirectory));
+    AstInitializeLoader();
     VidInitialize(CONFIGVAR_GET_INT("rdr_api") == RenderApiOpenGL);
     InInitialize();
     EcsInitialize();
@@ -185,12 +224,36 @@ EngGetRuntime(VOID)
     return time(NULL) - Start;
 }
 
+static VOID ExportProfile(VOID)
+{
+    static ENGINE_CONFIGVAR ExportVar = ENGINE_CONFIGVAR_BOOLEAN("eng_profile_export");
+
+    if (!ENGINE_CONFIGVAR_GET_BOOLEAN(ExportVar))
+    {
+        return;
+    }
+
+    time_t RawTime;
+    struct tm Time;
+    RawTime = time(NULL);
+    Time = *localtime(&RawTime);
+    EngExportProfile(CmnFormatTempString("%s%spurpl_%04d-%02d-%02d_%02d-%02d-%02d.json", EngDataDirectory,
+                                         EngDataDirectories[EngDataDirectoryLogs], Time.tm_year + 1900,
+                                         Time.tm_mon + 1, Time.tm_mday, Time.tm_hour, Time.tm_min, Time.tm_sec));
+
+    CONFIGVAR_SET_BOOLEAN("eng_profile_export", FALSE);
+    EngRefreshConfigVars();
+}
+
 static VOID StartFrame(VOID)
 {
     UINT64 Hours;
     UINT64 Minutes;
     UINT64 Seconds;
 
+    EngRefreshConfigVars();
+    ExportProfile();
+
     Now = (DOUBLE)PlatGetMilliseconds();
     Delta = Now - Last;
     if (Last > 0)
@@ -226,8 +289,10 @@ static VOID EndFrame(VOID)
 VOID EngMainLoop(VOID)
 {
     BOOLEAN Running;
+    BOOLEAN FirstFrame;
 
     Running = TRUE;
+    FirstFrame = TRUE;
     while (Running)
     {
         Running = VidUpdate();
@@ -240,8 +305,16 @@ VOID EngMainLoop(VOID)
         }
 
         StartFrame();
+        ENGINE_PROFILE_BEGIN("ecs_progress");
         ecs_progress(EcsGetWorld(), 0);
+        ENGINE_PROFILE_END();
         EndFrame();
+
+        if (FirstFrame)
+        {
+            AstFinishTrace();
+            FirstFrame = FALSE;
+        }
     }
 
     RdrFinishRendering();
@@ -255,13 +328,22 @@ VOID EngShutdown(VOID)
     DiscordShutdown();
 #endif
     EcsShutdown();
+    AstShutdownLoader();
+    EngShutdownJobs();
+    AstShutdownWatcher();
+    AstShutdownTrace();
     RdrShutdown();
+    AstUnmountPacks();
     InShutdown();
     VidShutdown();
 
+    EngShutdownProfiler();
+
     CmnFree(EngDataDirectory);
+    EngClearConfigVars();
 
     LogInfo("Successfully shut down engine");
+    EngFlushLogFile();
 }
 
 ecs_entity_t EngGetMainCamera(VOID)
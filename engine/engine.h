@@ -17,11 +17,20 @@
 #include "platform/input.h"
 #include "platform/video.h"
 
+#include "asset/loader.h"
+#include "asset/pack.h"
+#include "asset/trace.h"
+#include "asset/watch.h"
+
 #include "render/render.h"
 
 #include "camera.h"
 #include "components.h"
+#include "confighandle.h"
 #include "entity.h"
+#include "job.h"
+#include "logfile.h"
+#include "profile.h"
 
 #ifdef PURPL_DISCORD
 #include "discord.h"
@@ -55,6 +64,13 @@ extern CONST PCSTR EngAssetDirectories[EngAssetDirectoryCount];
 /// @brief Get an asset path in a static buffer
 extern PCHAR EngGetAssetPath(_In_ ENGINE_ASSET_DIRECTORY Directory, _In_opt_z_ _Printf_format_string_ PCSTR Name, ...);
 
+/// @brief Get the path of an asset for the asset functions, only the name gets hashed
+///
+/// @param[in] Directory The directory the asset is in
+/// @param[in] Name The name of the asset, which has to stay valid as long as the path is used
+/// @param[out] Path The path
+extern VOID EngMakeAssetPath(_In_ ENGINE_ASSET_DIRECTORY Directory, _In_z_ PCSTR Name, _Out_ PASSET_PATH Path);
+
 /// @brief Define configuration variables (must be called before CmnInitialize)
 extern VOID EngDefineVariables(VOID);
 
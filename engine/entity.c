@@ -15,14 +15,41 @@ Abstract:
 #include "common/configvar.h"
 #include "flecs.h"
 
+#include "confighandle.h"
 #include "entity.h"
+#include "job.h"
 
 static ecs_world_t *EngineEcsWorld;
 
+static ENGINE_CONFIGVAR FpsTargetVar = ENGINE_CONFIGVAR_FLOAT("ecs_main_fps_target");
+static UINT64 FpsTargetChangeCount;
+
 VOID EcsDefineVariables(VOID)
 {
     CONFIGVAR_DEFINE_BOOLEAN("ecs_in_init", TRUE, FALSE, ConfigVarSideBoth, FALSE, TRUE);
     CONFIGVAR_DEFINE_FLOAT("ecs_main_fps_target", 60.0f, FALSE, ConfigVarSideBoth, FALSE, FALSE);
+    CONFIGVAR_DEFINE_INT("ecs_threads", 0, FALSE, ConfigVarSideBoth, FALSE, TRUE);
+}
+
+static VOID SetThreadCount(VOID)
+{
+    INT64 Requested = CONFIGVAR_GET_INT("ecs_threads");
+
+    // By default, the main thread and whatever processors the job system's workers left over, so the two pools don't
+    // fight over the same cores
+    UINT32 ProcessorCount = EngGetProcessorCount();
+    UINT32 Used = EngGetJobThreadCount() + 1;
+    INT32 Count = Requested > 0 ? (INT32)PURPL_MIN(Requested, ENGINE_JOB_MAX_THREADS + 1)
+                                : (INT32)(ProcessorCount > Used ? ProcessorCount - Used + 1 : 1);
+    if (Count > 1 && !ecs_os_has_threading())
+    {
+        LogWarning("The ECS has no threading support on this platform, running systems on the main thread");
+        Count = 1;
+    }
+
+    // Multi-threaded systems have their entities split between these, everything else runs on the main thread
+    LogInfo("Running ECS systems on %d threads", Count);
+    ecs_set_threads(EngineEcsWorld, Count);
 }
 
 VOID EcsInitialize(VOID)
@@ -31,18 +58,24 @@ VOID EcsInitialize(VOID)
 
     LogTrace("Creating ECS world");
     EcsSetWorld(ecs_init());
+
+    // The first frame runs the OnStart systems, which set up state like the render target size that multi-threaded
+    // systems read, so it's run before there are any other threads
     ecs_progress(EngineEcsWorld, 0.0f);
+    SetThreadCount();
     CONFIGVAR_SET_BOOLEAN("ecs_in_init", FALSE);
+    EngRefreshConfigVars();
 
-    ecs_set_target_fps(EngineEcsWorld, CONFIGVAR_GET_FLOAT("ecs_main_fps_target"));
+    ecs_set_target_fps(EngineEcsWorld, (FLOAT)ENGINE_CONFIGVAR_GET_FLOAT(FpsTargetVar));
+    FpsTargetChangeCount = ENGINE_CONFIGVAR_CHANGE_COUNT(FpsTargetVar);
 }
 
 VOID EcsBeginFrame(_In_ UINT64 Delta)
 {
-    if (CONFIGVAR_HAS_CHANGED("ecs_main_fps_target"))
+    if (ENGINE_CONFIGVAR_CHANGE_COUNT(FpsTargetVar) != FpsTargetChangeCount)
     {
-        ecs_set_target_fps(EngineEcsWorld, CONFIGVAR_GET_FLOAT("ecs_main_fps_target"));
-        CONFIGVAR_CLEAR_CHANGED("ecs_main_fps_target");
+        ecs_set_target_fps(EngineEcsWorld, (FLOAT)ENGINE_CONFIGVAR_GET_FLOAT(FpsTargetVar));
+        FpsTargetChangeCount = ENGINE_CONFIGVAR_CHANGE_COUNT(FpsTargetVar);
     }
     ecs_frame_begin(EngineEcsWorld, (FLOAT)Delta / 1000);
 }
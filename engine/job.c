@@ -0,0 +1,578 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    job.c
+
+Abstract:
+
+    This file implements the job system. Each deque is a ring with its own
+    lock, which is only contended when a thief and the owner want it at the
+    same time, and counters are updated with atomics. Jobs waiting for a
+    counter hang off it in a list guarded by one lock, which is only taken
+    when a continuation is added or a counter that might have some reaches
+    zero. Idle workers block on a condition variable, and queueing a job
+    only touches it if a worker has said it's about to block.
+
+--*/
+
+#include "atomic.h"
+#include "job.h"
+#include "profile.h"
+
+#if defined PURPL_UNIX
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/// @brief A queued job
+PURPL_MAKE_TAG(struct, ENGINE_JOB, {
+    PFN_ENGINE_JOB Function;
+    PVOID Context;
+    PENGINE_JOB_COUNTER Counter;
+})
+
+/// @brief A thread's deque, or the background queue
+PURPL_MAKE_TAG(struct, ENGINE_JOB_QUEUE, {
+    PAS_MUTEX Lock;
+    volatile INT64 Top;    // thieves take from here
+    volatile INT64 Bottom; // the owner pushes and pops here
+    ENGINE_JOB Jobs[ENGINE_JOB_QUEUE_SIZE];
+})
+
+/// @brief A job waiting for a counter to reach zero
+PURPL_MAKE_TAG(struct, ENGINE_JOB_CONTINUATION, {
+    ENGINE_JOB Job;
+    struct ENGINE_JOB_CONTINUATION *Next;
+})
+
+/// @brief The state shared by the jobs of a parallel for
+PURPL_MAKE_TAG(struct, ENGINE_PARALLEL_FOR, {
+    PFN_ENGINE_PARALLEL_FOR Function;
+    PVOID Context;
+    UINT64 Count;
+    UINT64 BatchSize;
+    volatile INT64 NextBatch;
+})
+
+static PENGINE_JOB_QUEUE Queues; // the main thread's, one for each worker, then the background queue
+static PAS_THREAD *Workers;
+static UINT32 WorkerCount;
+static PAS_MUTEX ContinuationLock;
+static volatile INT64 Stopping;
+
+// Workers that are about to block or are blocked, and how many times they've been woken
+static volatile INT64 Sleepers;
+static volatile INT64 WakeCount;
+#if defined PURPL_WIN32
+static SRWLOCK WakeLock = SRWLOCK_INIT;
+static CONDITION_VARIABLE WakeCondition = CONDITION_VARIABLE_INIT;
+#elif defined PURPL_UNIX
+static pthread_mutex_t WakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t WakeCondition = PTHREAD_COND_INITIALIZER;
+#endif
+
+static ENGINE_THREAD_LOCAL UINT32 ThreadIndex;
+static ENGINE_THREAD_LOCAL UINT32 RandomState;
+static ENGINE_THREAD_LOCAL CHAR ThreadTag; // its address is the thread ID
+
+#define BACKGROUND_QUEUE (&Queues[WorkerCount + 1])
+
+VOID EngDefineJobVariables(VOID)
+{
+    CONFIGVAR_DEFINE_INT("eng_job_threads", 0, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+}
+
+UINT32 EngGetProcessorCount(VOID)
+{
+#if defined PURPL_UNIX
+    INT64 Count = (INT64)sysconf(_SC_NPROCESSORS_ONLN);
+    return Count > 0 ? (UINT32)Count : 1;
+#elif defined PURPL_WIN32
+    SYSTEM_INFO Info = {0};
+    GetSystemInfo(&Info);
+    return PURPL_MAX(Info.dwNumberOfProcessors, 1);
+#else
+    return 1;
+#endif
+}
+
+static UINT32 NextRandom(VOID)
+{
+    if (!RandomState)
+    {
+        RandomState = (UINT32)EngGetThreadId() | 1;
+    }
+
+    // xorshift32, only used to pick a victim
+    RandomState ^= RandomState << 13;
+    RandomState ^= RandomState >> 17;
+    RandomState ^= RandomState << 5;
+    return RandomState;
+}
+
+static BOOLEAN PushJob(_In_ PENGINE_JOB_QUEUE Queue, _In_ PCENGINE_JOB Job)
+{
+    BOOLEAN Pushed = FALSE;
+
+    AsLockMutex(Queue->Lock, TRUE);
+    if (Queue->Bottom - Queue->Top < ENGINE_JOB_QUEUE_SIZE)
+    {
+        Queue->Jobs[Queue->Bottom & (ENGINE_JOB_QUEUE_SIZE - 1)] = *Job;
+        ENGINE_ATOMIC_STORE(&Queue->Bottom, Queue->Bottom + 1);
+        Pushed = TRUE;
+    }
+    AsUnlockMutex(Queue->Lock);
+
+    return Pushed;
+}
+
+static BOOLEAN TakeJob(_In_ PENGINE_JOB_QUEUE Queue, _Out_ PENGINE_JOB Job, _In_ BOOLEAN Steal)
+{
+    BOOLEAN Taken = FALSE;
+
+    // Looking without the lock first keeps idle threads from fighting over empty queues
+    if (ENGINE_ATOMIC_LOAD(&Queue->Bottom) == ENGINE_ATOMIC_LOAD(&Queue->Top))
+    {
+        return FALSE;
+    }
+
+    AsLockMutex(Queue->Lock, TRUE);
+    if (Queue->Bottom > Queue->Top)
+    {
+        if (Steal)
+        {
+            *Job = Queue->Jobs[Queue->Top & (ENGINE_JOB_QUEUE_SIZE - 1)];
+            ENGINE_ATOMIC_STORE(&Queue->Top, Queue->Top + 1);
+        }
+        else
+        {
+            ENGINE_ATOMIC_STORE(&Queue->Bottom, Queue->Bottom - 1);
+            *Job = Queue->Jobs[Queue->Bottom & (ENGINE_JOB_QUEUE_SIZE - 1)];
+        }
+        Taken = TRUE;
+    }
+    AsUnlockMutex(Queue->Lock);
+
+    return Taken;
+}
+
+static BOOLEAN FindJob(_Out_ PENGINE_JOB Job, _In_ BOOLEAN Background)
+{
+    UINT32 Self = ThreadIndex;
+    UINT32 Count = WorkerCount + 1;
+
+    if (TakeJob(&Queues[Self], Job, FALSE))
+    {
+        return TRUE;
+    }
+
+    // Starting somewhere random keeps thieves from all going after the same thread
+    UINT32 Start = NextRandom() % Count;
+    for (UINT32 i = 0; i < Count; i++)
+    {
+        UINT32 Victim = (Start + i) % Count;
+        if (Victim != Self && TakeJob(&Queues[Victim], Job, TRUE))
+        {
+            return TRUE;
+        }
+    }
+
+    return Background && TakeJob(BACKGROUND_QUEUE, Job, TRUE);
+}
+
+static VOID WakeWorkers(_In_ BOOLEAN All)
+{
+#if defined PURPL_WIN32
+    AcquireSRWLockExclusive(&WakeLock);
+    ENGINE_ATOMIC_ADD(&WakeCount, 1);
+    ReleaseSRWLockExclusive(&WakeLock);
+    if (All)
+    {
+        WakeAllConditionVariable(&WakeCondition);
+    }
+    else
+    {
+        WakeConditionVariable(&WakeCondition);
+    }
+#elif defined PURPL_UNIX
+    pthread_mutex_lock(&WakeLock);
+    ENGINE_ATOMIC_ADD(&WakeCount, 1);
+    pthread_mutex_unlock(&WakeLock);
+    if (All)
+    {
+        pthread_cond_broadcast(&WakeCondition);
+    }
+    else
+    {
+        pthread_cond_signal(&WakeCondition);
+    }
+#else
+    UNREFERENCED_PARAMETER(All);
+    ENGINE_ATOMIC_ADD(&WakeCount, 1);
+#endif
+}
+
+// Blocks until WakeWorkers is called after WakeCount was Epoch
+static VOID WaitForWork(_In_ INT64 Epoch)
+{
+#if defined PURPL_WIN32
+    AcquireSRWLockExclusive(&WakeLock);
+    while (ENGINE_ATOMIC_LOAD(&WakeCount) == Epoch)
+    {
+        SleepConditionVariableSRW(&WakeCondition, &WakeLock, INFINITE, 0);
+    }
+    ReleaseSRWLockExclusive(&WakeLock);
+#elif defined PURPL_UNIX
+    pthread_mutex_lock(&WakeLock);
+    while (ENGINE_ATOMIC_LOAD(&WakeCount) == Epoch)
+    {
+        pthread_cond_wait(&WakeCondition, &WakeLock);
+    }
+    pthread_mutex_unlock(&WakeLock);
+#else
+    UNREFERENCED_PARAMETER(Epoch);
+    PlatSleep(1);
+#endif
+}
+
+static VOID SubmitJob(_In_ PCENGINE_JOB Job, _In_ BOOLEAN Background);
+
+static VOID FinishJob(_Inout_ PENGINE_JOB_COUNTER Counter)
+{
+    // Not the last one, so nothing can be waiting on this
+    INT64 Value = ENGINE_ATOMIC_LOAD(&Counter->Value);
+    while (Value > 1)
+    {
+        if (ENGINE_ATOMIC_CAS(&Counter->Value, Value, Value - 1))
+        {
+            return;
+        }
+        Value = ENGINE_ATOMIC_LOAD(&Counter->Value);
+    }
+
+    // A waiter can return and free the counter as soon as it reaches zero, so the continuations are taken off it
+    // before that, and it isn't touched after
+    AsLockMutex(ContinuationLock, TRUE);
+    PENGINE_JOB_CONTINUATION Continuations = Counter->Continuations;
+    Counter->Continuations = NULL;
+    if (ENGINE_ATOMIC_ADD(&Counter->Value, -1) != 0)
+    {
+        // Something was queued on it in the meantime, so it's still alive
+        Counter->Continuations = Continuations;
+        Continuations = NULL;
+    }
+    AsUnlockMutex(ContinuationLock);
+
+    while (Continuations)
+    {
+        PENGINE_JOB_CONTINUATION Next = Continuations->Next;
+        SubmitJob(&Continuations->Job, FALSE);
+        CmnFree(Continuations);
+        Continuations = Next;
+    }
+}
+
+static VOID RunJob(_In_ PCENGINE_JOB Job)
+{
+    Job->Function(Job->Context);
+    if (Job->Counter)
+    {
+        FinishJob(Job->Counter);
+    }
+}
+
+static VOID SubmitJob(_In_ PCENGINE_JOB Job, _In_ BOOLEAN Background)
+{
+    // Before the workers start, after they stop, or when the deque is full, the job just runs here
+    if (!Queues || !PushJob(Background ? BACKGROUND_QUEUE : &Queues[ThreadIndex], Job))
+    {
+        RunJob(Job);
+        return;
+    }
+
+    // Pairs with the fence in WorkerThread, so either the worker sees the job or this sees the worker
+    ENGINE_ATOMIC_FENCE();
+    if (ENGINE_ATOMIC_LOAD(&Sleepers) > 0)
+    {
+        WakeWorkers(FALSE);
+    }
+}
+
+static INT WorkerThread(_In_opt_ PVOID Index)
+{
+    ThreadIndex = (UINT32)(SIZE_T)Index;
+    UINT64 LastWork = PlatGetMilliseconds();
+
+#ifdef PURPL_PROFILE
+    CHAR Name[32];
+    stbsp_snprintf(Name, PURPL_ARRAYSIZE(Name), "Job worker %u", ThreadIndex - 1);
+    ENGINE_PROFILE_THREAD_NAME(Name);
+#endif
+
+    while (!ENGINE_ATOMIC_LOAD(&Stopping))
+    {
+        ENGINE_JOB Job;
+        if (FindJob(&Job, TRUE))
+        {
+            RunJob(&Job);
+            LastWork = PlatGetMilliseconds();
+        }
+        else if (PlatGetMilliseconds() - LastWork < ENGINE_JOB_SPIN_TIME)
+        {
+            ENGINE_CPU_PAUSE();
+        }
+        else
+        {
+            // Look once more after saying this is going to block, anything queued after that wakes it
+            INT64 Epoch = ENGINE_ATOMIC_LOAD(&WakeCount);
+            ENGINE_ATOMIC_ADD(&Sleepers, 1);
+            ENGINE_ATOMIC_FENCE();
+            if (FindJob(&Job, TRUE))
+            {
+                ENGINE_ATOMIC_ADD(&Sleepers, -1);
+                RunJob(&Job);
+            }
+            else if (!ENGINE_ATOMIC_LOAD(&Stopping))
+            {
+                WaitForWork(Epoch);
+                ENGINE_ATOMIC_ADD(&Sleepers, -1);
+            }
+            else
+            {
+                ENGINE_ATOMIC_ADD(&Sleepers, -1);
+            }
+            LastWork = PlatGetMilliseconds();
+        }
+    }
+
+    return 0;
+}
+
+VOID EngInitializeJobs(VOID)
+{
+    INT64 Requested = CONFIGVAR_GET_INT("eng_job_threads");
+    UINT32 ProcessorCount = EngGetProcessorCount();
+
+    // By default, half of the processors the main thread isn't using, the ECS's threads get the rest
+    UINT32 Spare = ProcessorCount > 1 ? ProcessorCount - 1 : 1;
+    WorkerCount = Requested > 0 ? (UINT32)PURPL_MIN(Requested, ENGINE_JOB_MAX_THREADS)
+                                : PURPL_MIN(Spare - Spare / 2, ENGINE_JOB_MAX_THREADS);
+
+    LogInfo("Starting %u job threads on %u processors", WorkerCount, ProcessorCount);
+
+    Queues = CmnAllocType(WorkerCount + 2, ENGINE_JOB_QUEUE);
+    if (!Queues)
+    {
+        CmnError("Failed to allocate job queues: %s", strerror(errno));
+    }
+    for (UINT32 i = 0; i < WorkerCount + 2; i++)
+    {
+        Queues[i].Lock = AsCreateMutex();
+        if (!Queues[i].Lock)
+        {
+            CmnError("Failed to create job queue mutex");
+        }
+        Queues[i].Top = 0;
+        Queues[i].Bottom = 0;
+    }
+
+    ContinuationLock = AsCreateMutex();
+    if (!ContinuationLock)
+    {
+        CmnError("Failed to create job continuation mutex");
+    }
+
+    ThreadIndex = 0;
+    ENGINE_ATOMIC_STORE(&Stopping, FALSE);
+    for (UINT32 i = 0; i < WorkerCount; i++)
+    {
+        PAS_THREAD Thread = AsCreateThread(CmnFormatTempString("Job worker %u", i), PURPL_DEFAULT_THREAD_STACK_SIZE,
+                                           (PFN_THREAD_START)WorkerThread, (PVOID)(SIZE_T)(i + 1));
+        if (!Thread)
+        {
+            CmnError("Failed to create job worker thread %u", i);
+        }
+        stbds_arrpush(Workers, Thread);
+    }
+}
+
+VOID EngShutdownJobs(VOID)
+{
+    if (!Queues)
+    {
+        return;
+    }
+
+    LogInfo("Stopping job threads");
+
+    ENGINE_ATOMIC_STORE(&Stopping, TRUE);
+    WakeWorkers(TRUE);
+    for (SIZE_T i = 0; i < stbds_arrlenu(Workers); i++)
+    {
+        AsJoinThread(Workers[i]);
+    }
+    stbds_arrfree(Workers);
+
+    // The workers are gone, so anything left runs here, and anything it queues goes on the main thread's deque
+    ENGINE_JOB Job;
+    while (FindJob(&Job, TRUE))
+    {
+        RunJob(&Job);
+    }
+
+    for (UINT32 i = 0; i < WorkerCount + 2; i++)
+    {
+        AsDestroyMutex(Queues[i].Lock);
+    }
+    CmnFree(Queues);
+    Queues = NULL;
+    WorkerCount = 0;
+
+    AsDestroyMutex(ContinuationLock);
+    ContinuationLock = NULL;
+}
+
+VOID EngQueueJob(_In_ PFN_ENGINE_JOB Function, _In_opt_ PVOID Context, _Inout_opt_ PENGINE_JOB_COUNTER Counter)
+{
+    ENGINE_JOB Job = {Function, Context, Counter};
+
+    if (Counter)
+    {
+        ENGINE_ATOMIC_ADD(&Counter->Value, 1);
+    }
+    SubmitJob(&Job, FALSE);
+}
+
+VOID EngQueueBackgroundJob(_In_ PFN_ENGINE_JOB Function, _In_opt_ PVOID Context,
+                           _Inout_opt_ PENGINE_JOB_COUNTER Counter)
+{
+    ENGINE_JOB Job = {Function, Context, Counter};
+
+    if (Counter)
+    {
+        ENGINE_ATOMIC_ADD(&Counter->Value, 1);
+    }
+    SubmitJob(&Job, TRUE);
+}
+
+VOID EngQueueJobAfter(_Inout_ PENGINE_JOB_COUNTER Wait, _In_ PFN_ENGINE_JOB Function, _In_opt_ PVOID Context,
+                      _Inout_opt_ PENGINE_JOB_COUNTER Counter)
+{
+    ENGINE_JOB Job = {Function, Context, Counter};
+
+    if (Counter)
+    {
+        ENGINE_ATOMIC_ADD(&Counter->Value, 1);
+    }
+
+    if (!ContinuationLock)
+    {
+        SubmitJob(&Job, FALSE);
+        return;
+    }
+
+    // The last FinishJob on Wait takes this lock too, so the job either sees it at zero here or gets queued by it
+    AsLockMutex(ContinuationLock, TRUE);
+    BOOLEAN Ready = ENGINE_ATOMIC_LOAD(&Wait->Value) <= 0;
+    if (!Ready)
+    {
+        PENGINE_JOB_CONTINUATION Continuation = CmnAllocType(1, ENGINE_JOB_CONTINUATION);
+        if (!Continuation)
+        {
+            CmnError("Failed to allocate job continuation: %s", strerror(errno));
+        }
+        Continuation->Job = Job;
+        Continuation->Next = Wait->Continuations;
+        Wait->Continuations = Continuation;
+    }
+    AsUnlockMutex(ContinuationLock);
+
+    if (Ready)
+    {
+        SubmitJob(&Job, FALSE);
+    }
+}
+
+VOID EngWaitForCounter(_In_ PENGINE_JOB_COUNTER Counter)
+{
+    // Background jobs could block for a long time, so only regular jobs are run while waiting
+    while (ENGINE_ATOMIC_LOAD(&Counter->Value) > 0)
+    {
+        ENGINE_JOB Job;
+        if (Queues && FindJob(&Job, FALSE))
+        {
+            RunJob(&Job);
+        }
+        else
+        {
+            ENGINE_CPU_PAUSE();
+        }
+    }
+}
+
+static VOID RunBatches(_In_opt_ PVOID Context)
+{
+    PENGINE_PARALLEL_FOR State = Context;
+
+    while (TRUE)
+    {
+        UINT64 Start = (UINT64)(ENGINE_ATOMIC_ADD(&State->NextBatch, 1) - 1) * State->BatchSize;
+        if (Start >= State->Count)
+        {
+            break;
+        }
+
+        State->Function(State->Context, Start, PURPL_MIN(Start + State->BatchSize, State->Count));
+    }
+}
+
+VOID EngParallelFor(_In_ UINT64 Count, _In_ UINT64 BatchSize, _In_ PFN_ENGINE_PARALLEL_FOR Function,
+                    _In_opt_ PVOID Context)
+{
+    BatchSize = PURPL_MAX(BatchSize, 1);
+    if (Count <= BatchSize || !WorkerCount)
+    {
+        if (Count)
+        {
+            Function(Context, 0, Count);
+        }
+        return;
+    }
+
+    ENGINE_PARALLEL_FOR State = {0};
+    State.Function = Function;
+    State.Context = Context;
+    State.Count = Count;
+    State.BatchSize = BatchSize;
+
+    // Every job takes batches until they're gone, and this thread takes them too, so there's no point in having more
+    // jobs than workers or one for every batch
+    ENGINE_JOB_COUNTER Counter = {0};
+    UINT64 BatchCount = (Count + BatchSize - 1) / BatchSize;
+    UINT64 JobCount = PURPL_MIN(BatchCount - 1, WorkerCount);
+    for (UINT64 i = 0; i < JobCount; i++)
+    {
+        EngQueueJob(RunBatches, &State, &Counter);
+    }
+
+    RunBatches(&State);
+    EngWaitForCounter(&Counter);
+}
+
+UINT32 EngGetJobThreadCount(VOID)
+{
+    return WorkerCount;
+}
+
+UINT32 EngGetJobThreadIndex(VOID)
+{
+    return ThreadIndex;
+}
+
+UINT64 EngGetThreadId(VOID)
+{
+    return (UINT64)(SIZE_T)&ThreadTag;
+}
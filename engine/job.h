@@ -0,0 +1,117 @@
+/// @file job.h
+///
+/// @brief This file declares the job system, which runs short pieces of work on a pool of worker threads.
+///
+/// The main thread and every worker have their own deque of jobs. A thread pushes and pops jobs at the bottom of its
+/// own deque, and when that's empty it steals from the top of another thread's, so work spreads out without one queue
+/// everything fights over. Jobs can be counted with a counter. Waiting on a counter runs other jobs until it reaches
+/// zero instead of blocking, so a job can wait on jobs it queued itself. Jobs can also be queued to start when a counter
+/// reaches zero, which is how dependencies between jobs are expressed without anything waiting at all.
+///
+/// Background jobs, like asset loads, are for work that can block on I/O. They go in a separate queue that only idle
+/// workers take from, and never a thread that's waiting on a counter, so a frame never stalls behind a load.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/configvar.h"
+#include "common/log.h"
+
+#include "platform/async.h"
+#include "platform/platform.h"
+
+/// @brief Most worker threads the job system will start
+#define ENGINE_JOB_MAX_THREADS 64
+
+/// @brief Number of jobs each deque holds, must be a power of two. Jobs queued on a full deque run right away.
+#define ENGINE_JOB_QUEUE_SIZE 1024
+
+/// @brief How long in milliseconds an idle worker keeps looking for work before it blocks until a job is queued
+#define ENGINE_JOB_SPIN_TIME 2
+
+/// @brief A job
+typedef VOID (*PFN_ENGINE_JOB)(_In_opt_ PVOID Context);
+
+/// @brief A batch of a parallel for, from Start up to but not including End
+typedef VOID (*PFN_ENGINE_PARALLEL_FOR)(_In_opt_ PVOID Context, _In_ UINT64 Start, _In_ UINT64 End);
+
+/// @brief Counts unfinished jobs, zero initialize it before use
+PURPL_MAKE_TAG(struct, ENGINE_JOB_COUNTER, {
+    volatile INT64 Value;
+    PVOID Continuations; // jobs to queue when Value reaches zero, only touched by the job system
+})
+
+/// @brief Define the job system's config vars
+extern VOID EngDefineJobVariables(VOID);
+
+/// @brief Start the worker threads, the calling thread becomes the main thread of the job system
+extern VOID EngInitializeJobs(VOID);
+
+/// @brief Stop the worker threads, anything still queued runs on the calling thread first
+extern VOID EngShutdownJobs(VOID);
+
+/// @brief Queue a job
+///
+/// @param[in] Function The job
+/// @param[in] Context Passed to the job
+/// @param[in,out] Counter Incremented now and decremented once the job has run
+extern VOID EngQueueJob(_In_ PFN_ENGINE_JOB Function, _In_opt_ PVOID Context, _Inout_opt_ PENGINE_JOB_COUNTER Counter);
+
+/// @brief Queue a job that might block, only idle workers run these
+///
+/// @param[in] Function The job
+/// @param[in] Context Passed to the job
+/// @param[in,out] Counter Incremented now and decremented once the job has run
+extern VOID EngQueueBackgroundJob(_In_ PFN_ENGINE_JOB Function, _In_opt_ PVOID Context,
+                                  _Inout_opt_ PENGINE_JOB_COUNTER Counter);
+
+/// @brief Queue a job once a counter reaches zero
+///
+/// The job is queued the first time Wait reaches zero after this is called, or right away if it's already zero.
+///
+/// @param[in,out] Wait The counter to wait for
+/// @param[in] Function The job
+/// @param[in] Context Passed to the job
+/// @param[in,out] Counter Incremented now and decremented once the job has run
+extern VOID EngQueueJobAfter(_Inout_ PENGINE_JOB_COUNTER Wait, _In_ PFN_ENGINE_JOB Function, _In_opt_ PVOID Context,
+                             _Inout_opt_ PENGINE_JOB_COUNTER Counter);
+
+/// @brief Run other jobs until a counter reaches zero
+///
+/// @param[in] Counter The counter to wait for
+extern VOID EngWaitForCounter(_In_ PENGINE_JOB_COUNTER Counter);
+
+/// @brief Split a range into batches and run them across the workers and the calling thread, returns once every batch
+/// has run
+///
+/// @param[in] Count The number of items
+/// @param[in] BatchSize The most items a batch has, ranges no bigger than this run on the calling thread
+/// @param[in] Function Called for each batch
+/// @param[in] Context Passed to Function
+extern VOID EngParallelFor(_In_ UINT64 Count, _In_ UINT64 BatchSize, _In_ PFN_ENGINE_PARALLEL_FOR Function,
+                           _In_opt_ PVOID Context);
+
+/// @brief Get the number of worker threads, not counting the main thread
+///
+/// @return The number of worker threads
+extern UINT32 EngGetJobThreadCount(VOID);
+
+/// @brief Get the number of processors
+///
+/// @return The number of processors, at least 1
+extern UINT32 EngGetProcessorCount(VOID);
+
+/// @brief Get the index of the calling thread in the job system
+///
+/// @return 1 to EngGetJobThreadCount() for workers, 0 for the main thread and threads the job system didn't start
+extern UINT32 EngGetJobThreadIndex(VOID);
+
+/// @brief Get an ID for the calling thread that's unique among the threads that are running
+///
+/// @return The ID
+extern UINT64 EngGetThreadId(VOID);
@@ -0,0 +1,265 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    logfile.c
+
+Abstract:
+
+    This file implements the log file. The ring is a bounded queue where
+    every record has a sequence number, so producers claim a record with one
+    compare and swap on the head and publish it by bumping its sequence, and
+    the writer thread, the only consumer, takes records in order without
+    ever taking a lock. Messages come in through a log callback, so this
+    works the same on every platform.
+
+--*/
+
+#include "atomic.h"
+#include "logfile.h"
+
+/// @brief A record in the ring
+PURPL_MAKE_TAG(struct, ENGINE_LOG_RECORD, {
+    volatile INT64 Sequence; // its index when free, its index + 1 once it's been written
+    UINT32 Size;
+    CHAR Data[ENGINE_LOG_RECORD_SIZE];
+})
+
+static PENGINE_LOG_RECORD Records;
+static volatile INT64 Head;
+static UINT64 Tail; // only touched by the writer
+static volatile INT64 Dropped;
+static volatile INT64 TotalDropped;
+static volatile INT64 Stopping;
+static volatile INT64 Stopped;
+static volatile INT64 Pushing; // producers that saw Stopped unset and haven't finished pushing yet
+static PAS_THREAD WriterThread;
+static FILE *RealFile;
+
+static BOOLEAN PushRecord(_In_reads_(Size) CONST CHAR *Data, _In_ UINT32 Size)
+{
+    INT64 Position = ENGINE_ATOMIC_LOAD(&Head);
+    PENGINE_LOG_RECORD Record;
+
+    while (TRUE)
+    {
+        Record = &Records[Position & (ENGINE_LOG_RECORD_COUNT - 1)];
+        INT64 Difference = ENGINE_ATOMIC_LOAD(&Record->Sequence) - Position;
+        if (Difference == 0)
+        {
+            if (ENGINE_ATOMIC_CAS(&Head, Position, Position + 1))
+            {
+                break;
+            }
+        }
+        else if (Difference < 0)
+        {
+            // The writer hasn't caught up to this record from the last time around
+            ENGINE_ATOMIC_ADD(&Dropped, 1);
+            ENGINE_ATOMIC_ADD(&TotalDropped, 1);
+            return FALSE;
+        }
+
+        Position = ENGINE_ATOMIC_LOAD(&Head);
+    }
+
+    memcpy(Record->Data, Data, Size);
+    Record->Size = Size;
+    ENGINE_ATOMIC_STORE(&Record->Sequence, Position + 1);
+    return TRUE;
+}
+
+// Writes every record that's been published, returns how many there were
+static UINT32 WriteRecords(VOID)
+{
+    UINT32 Count = 0;
+
+    while (TRUE)
+    {
+        PENGINE_LOG_RECORD Record = &Records[Tail & (ENGINE_LOG_RECORD_COUNT - 1)];
+        if ((UINT64)ENGINE_ATOMIC_LOAD(&Record->Sequence) != Tail + 1)
+        {
+            break;
+        }
+
+        fwrite(Record->Data, 1, Record->Size, RealFile);
+        ENGINE_ATOMIC_STORE(&Record->Sequence, (INT64)(Tail + ENGINE_LOG_RECORD_COUNT));
+        Tail++;
+        Count++;
+    }
+
+    INT64 DroppedCount = ENGINE_ATOMIC_LOAD(&Dropped);
+    if (DroppedCount)
+    {
+        ENGINE_ATOMIC_ADD(&Dropped, -DroppedCount);
+        fprintf(RealFile, "[%lld log records dropped, the log was written faster than the disk could keep up]\n",
+                (long long)DroppedCount);
+    }
+
+    return Count;
+}
+
+static INT WriteLog(_In_opt_ PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    while (TRUE)
+    {
+        if (WriteRecords())
+        {
+            continue;
+        }
+
+        // Only stop once everything written before Stopping was set has been taken
+        if (ENGINE_ATOMIC_LOAD(&Stopping))
+        {
+            WriteRecords();
+            break;
+        }
+
+        fflush(RealFile);
+        PlatSleep(5);
+    }
+
+    fflush(RealFile);
+    return 0;
+}
+
+static VOID WriteEvent(_In_ PLOG_EVENT Event)
+{
+    CHAR Buffer[1024];
+    PCHAR Line = Buffer;
+
+    // Formatted the same way LogAddFile formats it
+    CHAR Time[32];
+    strftime(Time, PURPL_ARRAYSIZE(Time), "%Y-%m-%d %H:%M:%S", Event->Time);
+    INT PrefixSize = snprintf(Buffer, PURPL_ARRAYSIZE(Buffer), "%s %-5s %s:%llu: ", Time,
+                              LogGetLevelString(Event->Level), Event->File, (UINT64)Event->Line);
+    if (PrefixSize < 0)
+    {
+        return;
+    }
+    PrefixSize = PURPL_MIN(PrefixSize, (INT)PURPL_ARRAYSIZE(Buffer) - 1);
+
+    va_list Arguments;
+    va_copy(Arguments, Event->Arguments);
+    INT MessageSize = vsnprintf(Buffer + PrefixSize, PURPL_ARRAYSIZE(Buffer) - PrefixSize, Event->Format, Arguments);
+    va_end(Arguments);
+    if (MessageSize < 0)
+    {
+        return;
+    }
+
+    // Rare enough that it's fine to allocate
+    SIZE_T Size = (SIZE_T)PrefixSize + MessageSize + 1;
+    if (Size >= PURPL_ARRAYSIZE(Buffer))
+    {
+        Line = CmnAlloc(Size + 1, 1);
+        if (!Line)
+        {
+            return;
+        }
+        memcpy(Line, Buffer, PrefixSize);
+        va_copy(Arguments, Event->Arguments);
+        vsnprintf(Line + PrefixSize, Size - PrefixSize, Event->Format, Arguments);
+        va_end(Arguments);
+    }
+    Line[Size - 1] = '\n';
+
+    // Pairs with the fence in EngFlushLogFile, either this sees Stopped or the flush waits for this push
+    ENGINE_ATOMIC_ADD(&Pushing, 1);
+    ENGINE_ATOMIC_FENCE();
+    if (Records && !ENGINE_ATOMIC_LOAD(&Stopped))
+    {
+        for (SIZE_T Offset = 0; Offset < Size; Offset += ENGINE_LOG_RECORD_SIZE)
+        {
+            PushRecord(Line + Offset, (UINT32)PURPL_MIN(Size - Offset, ENGINE_LOG_RECORD_SIZE));
+        }
+        ENGINE_ATOMIC_ADD(&Pushing, -1);
+    }
+    else
+    {
+        ENGINE_ATOMIC_ADD(&Pushing, -1);
+        fwrite(Line, 1, Size, RealFile);
+    }
+
+    if (Line != Buffer)
+    {
+        CmnFree(Line);
+    }
+}
+
+BOOLEAN EngOpenLogFile(_In_z_ PCSTR Path)
+{
+    RealFile = fopen(Path, "ab");
+    if (!RealFile)
+    {
+        return FALSE;
+    }
+
+    Records = CmnAllocType(ENGINE_LOG_RECORD_COUNT, ENGINE_LOG_RECORD);
+    if (!Records)
+    {
+        CmnError("Failed to allocate log ring: %s", strerror(errno));
+    }
+    for (UINT64 i = 0; i < ENGINE_LOG_RECORD_COUNT; i++)
+    {
+        Records[i].Sequence = (INT64)i;
+    }
+    Head = 0;
+    Tail = 0;
+    Dropped = 0;
+    TotalDropped = 0;
+    Stopping = FALSE;
+    Stopped = FALSE;
+    Pushing = 0;
+
+    WriterThread = AsCreateThread("Log writer", PURPL_DEFAULT_THREAD_STACK_SIZE, (PFN_THREAD_START)WriteLog, NULL);
+    if (!WriterThread)
+    {
+        CmnError("Failed to create log writer thread");
+    }
+
+    LogAddCallback(WriteEvent, NULL, LogGetLevel());
+    return TRUE;
+}
+
+VOID EngFlushLogFile(VOID)
+{
+    if (!RealFile)
+    {
+        return;
+    }
+
+    if (WriterThread)
+    {
+        ENGINE_ATOMIC_STORE(&Stopping, TRUE);
+        AsJoinThread(WriterThread);
+        WriterThread = NULL;
+
+        // New messages go straight to the file from here, so once every push that started before this is done, the
+        // ring can't change under the final drain
+        ENGINE_ATOMIC_STORE(&Stopped, TRUE);
+        ENGINE_ATOMIC_FENCE();
+        while (ENGINE_ATOMIC_LOAD(&Pushing))
+        {
+            ENGINE_CPU_PAUSE();
+        }
+        WriteRecords();
+
+        INT64 DroppedCount = ENGINE_ATOMIC_LOAD(&TotalDropped);
+        if (DroppedCount)
+        {
+            LogWarning("%lld log records were dropped in total", (long long)DroppedCount);
+        }
+    }
+
+    fflush(RealFile);
+}
+
+UINT64 EngGetDroppedLogRecords(VOID)
+{
+    return (UINT64)ENGINE_ATOMIC_LOAD(&TotalDropped);
+}
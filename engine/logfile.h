@@ -0,0 +1,46 @@
+/// @file logfile.h
+///
+/// @brief This file declares the engine's log file, which is written on its own thread.
+///
+/// The log file is fed by a log callback that formats each message into a lock-free ring buffer of fixed-size records.
+/// Any thread that logs only copies its message into the ring, and a background thread writes the records to the
+/// real file, so nothing that logs ever waits on the disk. If the ring is full, records are dropped instead of
+/// blocking, and a note with the number dropped is written once there's space again.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/log.h"
+
+#include "platform/async.h"
+#include "platform/platform.h"
+
+/// @brief Size of the message in each record of the ring, longer writes take several records
+#define ENGINE_LOG_RECORD_SIZE 240
+
+/// @brief Number of records in the ring, must be a power of two
+#define ENGINE_LOG_RECORD_COUNT 4096
+
+/// @brief Open the log file, add it to the log, and start writing it in the background
+///
+/// @param[in] Path The path of the log file, appended to if it exists
+///
+/// @return Whether the file could be opened
+extern BOOLEAN EngOpenLogFile(_In_z_ PCSTR Path);
+
+/// @brief Write everything that's been logged and stop the background thread
+///
+/// Anything logged after this is written straight to the file by the thread that logs it, so by the time this is
+/// called, every other thread that logs should have stopped. It waits for messages that are still being put in the
+/// ring, but it doesn't order direct writes between threads.
+extern VOID EngFlushLogFile(VOID);
+
+/// @brief Get the number of log records that have been dropped because the ring was full
+///
+/// @return The number of dropped records
+extern UINT64 EngGetDroppedLogRecords(VOID);
@@ -0,0 +1,451 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    transform.c
+
+Abstract:
+
+    This file implements the batch transform kernel. Each vector lane is one
+    entity, so the inputs are transposed on the way in and the matrices are
+    transposed back on the way out, and everything in between is the same
+    code for every instruction set. The sines and cosines come from the same
+    minimax polynomials as Cephes' sinf and cosf, which are accurate to about
+    an ulp after reducing the angle to within pi/4 of a multiple of pi/2.
+
+--*/
+
+#include "transform.h"
+
+#if defined __AVX2__
+#include <immintrin.h>
+#define MTH_AVX2
+#define MTH_LANES 8
+#elif defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MTH_SSE2
+#define MTH_LANES 4
+#elif defined __aarch64__ || defined _M_ARM64
+#include <arm_neon.h>
+#define MTH_NEON
+#define MTH_LANES 4
+#else
+#define MTH_LANES 1
+#endif
+
+#if defined MTH_AVX2
+typedef __m256 MTH_VECTOR;
+typedef __m256i MTH_INT_VECTOR;
+typedef __m256 MTH_MASK;
+
+#define VecSet(Value) _mm256_set1_ps(Value)
+#define VecAdd(A, B) _mm256_add_ps(A, B)
+#define VecSub(A, B) _mm256_sub_ps(A, B)
+#define VecMul(A, B) _mm256_mul_ps(A, B)
+#define VecSelect(Mask, A, B) _mm256_blendv_ps(B, A, Mask)
+#define VecFlipSign(A, Bits) _mm256_xor_ps(A, _mm256_castsi256_ps(Bits))
+#define VecRound(A) _mm256_cvtps_epi32(A)
+#define VecConvert(A) _mm256_cvtepi32_ps(A)
+#define IntVecSet(Value) _mm256_set1_epi32(Value)
+#define IntVecAdd(A, B) _mm256_add_epi32(A, B)
+#define IntVecAnd(A, B) _mm256_and_si256(A, B)
+#define IntVecShift(A, Count) _mm256_slli_epi32(A, Count)
+#define IntVecEqual(A, B) _mm256_castsi256_ps(_mm256_cmpeq_epi32(A, B))
+
+static inline VOID LoadVec3(_In_reads_(MTH_LANES) CONST vec3 *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z)
+{
+    CONST __m256i Indices = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+    CONST FLOAT *Base = (CONST FLOAT *)Data;
+
+    *X = _mm256_i32gather_ps(Base, Indices, 4);
+    *Y = _mm256_i32gather_ps(Base + 1, Indices, 4);
+    *Z = _mm256_i32gather_ps(Base + 2, Indices, 4);
+}
+
+static inline VOID LoadVec4(_In_reads_(MTH_LANES) CONST versor *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z, _Out_ MTH_VECTOR *W)
+{
+    CONST __m256i Indices = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    CONST FLOAT *Base = (CONST FLOAT *)Data;
+
+    *X = _mm256_i32gather_ps(Base, Indices, 4);
+    *Y = _mm256_i32gather_ps(Base + 1, Indices, 4);
+    *Z = _mm256_i32gather_ps(Base + 2, Indices, 4);
+    *W = _mm256_i32gather_ps(Base + 3, Indices, 4);
+}
+
+static inline VOID StoreColumn(_Out_writes_(MTH_LANES) mat4 *Transforms, _In_ UINT32 Column, _In_ MTH_VECTOR X,
+                               _In_ MTH_VECTOR Y, _In_ MTH_VECTOR Z, _In_ MTH_VECTOR W)
+{
+    __m256 XyLow = _mm256_unpacklo_ps(X, Y);
+    __m256 XyHigh = _mm256_unpackhi_ps(X, Y);
+    __m256 ZwLow = _mm256_unpacklo_ps(Z, W);
+    __m256 ZwHigh = _mm256_unpackhi_ps(Z, W);
+    __m256 Columns[4];
+    Columns[0] = _mm256_shuffle_ps(XyLow, ZwLow, _MM_SHUFFLE(1, 0, 1, 0));
+    Columns[1] = _mm256_shuffle_ps(XyLow, ZwLow, _MM_SHUFFLE(3, 2, 3, 2));
+    Columns[2] = _mm256_shuffle_ps(XyHigh, ZwHigh, _MM_SHUFFLE(1, 0, 1, 0));
+    Columns[3] = _mm256_shuffle_ps(XyHigh, ZwHigh, _MM_SHUFFLE(3, 2, 3, 2));
+
+    // Each 128-bit half has one of the first four matrices and one of the last four
+    for (UINT32 i = 0; i < 4; i++)
+    {
+        _mm_storeu_ps(Transforms[i][Column], _mm256_castps256_ps128(Columns[i]));
+        _mm_storeu_ps(Transforms[i + 4][Column], _mm256_extractf128_ps(Columns[i], 1));
+    }
+}
+#elif defined MTH_SSE2
+typedef __m128 MTH_VECTOR;
+typedef __m128i MTH_INT_VECTOR;
+typedef __m128 MTH_MASK;
+
+#define VecSet(Value) _mm_set1_ps(Value)
+#define VecAdd(A, B) _mm_add_ps(A, B)
+#define VecSub(A, B) _mm_sub_ps(A, B)
+#define VecMul(A, B) _mm_mul_ps(A, B)
+#define VecSelect(Mask, A, B) _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B))
+#define VecFlipSign(A, Bits) _mm_xor_ps(A, _mm_castsi128_ps(Bits))
+#define VecRound(A) _mm_cvtps_epi32(A)
+#define VecConvert(A) _mm_cvtepi32_ps(A)
+#define IntVecSet(Value) _mm_set1_epi32(Value)
+#define IntVecAdd(A, B) _mm_add_epi32(A, B)
+#define IntVecAnd(A, B) _mm_and_si128(A, B)
+#define IntVecShift(A, Count) _mm_slli_epi32(A, Count)
+#define IntVecEqual(A, B) _mm_castsi128_ps(_mm_cmpeq_epi32(A, B))
+
+static inline VOID LoadVec3(_In_reads_(MTH_LANES) CONST vec3 *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z)
+{
+    // x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3
+    CONST FLOAT *Base = (CONST FLOAT *)Data;
+    __m128 A = _mm_loadu_ps(Base);
+    __m128 B = _mm_loadu_ps(Base + 4);
+    __m128 C = _mm_loadu_ps(Base + 8);
+
+    *X = _mm_shuffle_ps(A, _mm_shuffle_ps(B, C, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+    *Y = _mm_shuffle_ps(_mm_shuffle_ps(A, B, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(B, C, _MM_SHUFFLE(2, 2, 3, 3)),
+                        _MM_SHUFFLE(2, 0, 2, 0));
+    *Z = _mm_shuffle_ps(_mm_shuffle_ps(A, B, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(C, C, _MM_SHUFFLE(3, 3, 0, 0)),
+                        _MM_SHUFFLE(2, 0, 2, 0));
+}
+
+static inline VOID LoadVec4(_In_reads_(MTH_LANES) CONST versor *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z, _Out_ MTH_VECTOR *W)
+{
+    CONST FLOAT *Base = (CONST FLOAT *)Data;
+    __m128 A = _mm_loadu_ps(Base);
+    __m128 B = _mm_loadu_ps(Base + 4);
+    __m128 C = _mm_loadu_ps(Base + 8);
+    __m128 D = _mm_loadu_ps(Base + 12);
+
+    _MM_TRANSPOSE4_PS(A, B, C, D);
+    *X = A;
+    *Y = B;
+    *Z = C;
+    *W = D;
+}
+
+static inline VOID StoreColumn(_Out_writes_(MTH_LANES) mat4 *Transforms, _In_ UINT32 Column, _In_ MTH_VECTOR X,
+                               _In_ MTH_VECTOR Y, _In_ MTH_VECTOR Z, _In_ MTH_VECTOR W)
+{
+    _MM_TRANSPOSE4_PS(X, Y, Z, W);
+    _mm_storeu_ps(Transforms[0][Column], X);
+    _mm_storeu_ps(Transforms[1][Column], Y);
+    _mm_storeu_ps(Transforms[2][Column], Z);
+    _mm_storeu_ps(Transforms[3][Column], W);
+}
+#elif defined MTH_NEON
+typedef float32x4_t MTH_VECTOR;
+typedef int32x4_t MTH_INT_VECTOR;
+typedef uint32x4_t MTH_MASK;
+
+#define VecSet(Value) vdupq_n_f32(Value)
+#define VecAdd(A, B) vaddq_f32(A, B)
+#define VecSub(A, B) vsubq_f32(A, B)
+#define VecMul(A, B) vmulq_f32(A, B)
+#define VecSelect(Mask, A, B) vbslq_f32(Mask, A, B)
+#define VecFlipSign(A, Bits) vreinterpretq_f32_s32(veorq_s32(vreinterpretq_s32_f32(A), Bits))
+#define VecRound(A) vcvtnq_s32_f32(A)
+#define VecConvert(A) vcvtq_f32_s32(A)
+#define IntVecSet(Value) vdupq_n_s32(Value)
+#define IntVecAdd(A, B) vaddq_s32(A, B)
+#define IntVecAnd(A, B) vandq_s32(A, B)
+#define IntVecShift(A, Count) vshlq_n_s32(A, Count)
+#define IntVecEqual(A, B) vceqq_s32(A, B)
+
+static inline VOID LoadVec3(_In_reads_(MTH_LANES) CONST vec3 *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z)
+{
+    float32x4x3_t Vectors = vld3q_f32((CONST FLOAT *)Data);
+    *X = Vectors.val[0];
+    *Y = Vectors.val[1];
+    *Z = Vectors.val[2];
+}
+
+static inline VOID LoadVec4(_In_reads_(MTH_LANES) CONST versor *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z, _Out_ MTH_VECTOR *W)
+{
+    float32x4x4_t Vectors = vld4q_f32((CONST FLOAT *)Data);
+    *X = Vectors.val[0];
+    *Y = Vectors.val[1];
+    *Z = Vectors.val[2];
+    *W = Vectors.val[3];
+}
+
+static inline VOID StoreColumn(_Out_writes_(MTH_LANES) mat4 *Transforms, _In_ UINT32 Column, _In_ MTH_VECTOR X,
+                               _In_ MTH_VECTOR Y, _In_ MTH_VECTOR Z, _In_ MTH_VECTOR W)
+{
+    float32x4x2_t Xz = vzipq_f32(X, Z);
+    float32x4x2_t Yw = vzipq_f32(Y, W);
+    float32x4x2_t Low = vzipq_f32(Xz.val[0], Yw.val[0]);
+    float32x4x2_t High = vzipq_f32(Xz.val[1], Yw.val[1]);
+    vst1q_f32(Transforms[0][Column], Low.val[0]);
+    vst1q_f32(Transforms[1][Column], Low.val[1]);
+    vst1q_f32(Transforms[2][Column], High.val[0]);
+    vst1q_f32(Transforms[3][Column], High.val[1]);
+}
+#else
+typedef FLOAT MTH_VECTOR;
+typedef INT32 MTH_INT_VECTOR;
+typedef BOOLEAN MTH_MASK;
+
+static inline FLOAT VecFlipSign(_In_ FLOAT A, _In_ INT32 Bits)
+{
+    UINT32 Value;
+    memcpy(&Value, &A, sizeof(FLOAT));
+    Value ^= (UINT32)Bits;
+    memcpy(&A, &Value, sizeof(FLOAT));
+    return A;
+}
+
+#define VecSet(Value) (Value)
+#define VecAdd(A, B) ((A) + (B))
+#define VecSub(A, B) ((A) - (B))
+#define VecMul(A, B) ((A) * (B))
+#define VecSelect(Mask, A, B) ((Mask) ? (A) : (B))
+#define VecRound(A) ((INT32)lrintf(A))
+#define VecConvert(A) ((FLOAT)(A))
+#define IntVecSet(Value) (Value)
+#define IntVecAdd(A, B) ((A) + (B))
+#define IntVecAnd(A, B) ((A) & (B))
+#define IntVecShift(A, Count) ((INT32)((UINT32)(A) << (Count)))
+#define IntVecEqual(A, B) ((A) == (B))
+
+static inline VOID LoadVec3(_In_reads_(MTH_LANES) CONST vec3 *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z)
+{
+    *X = Data[0][0];
+    *Y = Data[0][1];
+    *Z = Data[0][2];
+}
+
+static inline VOID LoadVec4(_In_reads_(MTH_LANES) CONST versor *Data, _Out_ MTH_VECTOR *X, _Out_ MTH_VECTOR *Y,
+                            _Out_ MTH_VECTOR *Z, _Out_ MTH_VECTOR *W)
+{
+    *X = Data[0][0];
+    *Y = Data[0][1];
+    *Z = Data[0][2];
+    *W = Data[0][3];
+}
+
+static inline VOID StoreColumn(_Out_writes_(MTH_LANES) mat4 *Transforms, _In_ UINT32 Column, _In_ MTH_VECTOR X,
+                               _In_ MTH_VECTOR Y, _In_ MTH_VECTOR Z, _In_ MTH_VECTOR W)
+{
+    Transforms[0][Column][0] = X;
+    Transforms[0][Column][1] = Y;
+    Transforms[0][Column][2] = Z;
+    Transforms[0][Column][3] = W;
+}
+#endif
+
+static inline VOID SinCos(_In_ MTH_VECTOR Angle, _Out_ MTH_VECTOR *Sine, _Out_ MTH_VECTOR *Cosine)
+{
+    // Reduce to [-pi/4, pi/4] around the nearest multiple of pi/2, with pi/2 split in three so the products are exact
+    MTH_INT_VECTOR Quadrant = VecRound(VecMul(Angle, VecSet(0.63661977236758134f)));
+    MTH_VECTOR QuadrantFloat = VecConvert(Quadrant);
+    MTH_VECTOR Reduced = VecSub(Angle, VecMul(QuadrantFloat, VecSet(1.5703125f)));
+    Reduced = VecSub(Reduced, VecMul(QuadrantFloat, VecSet(4.837512969970703125e-4f)));
+    Reduced = VecSub(Reduced, VecMul(QuadrantFloat, VecSet(7.54978995489188216e-8f)));
+    MTH_VECTOR Squared = VecMul(Reduced, Reduced);
+
+    MTH_VECTOR SinePoly = VecAdd(VecMul(Squared, VecSet(-1.9515295891e-4f)), VecSet(8.3321608736e-3f));
+    SinePoly = VecAdd(VecMul(Squared, SinePoly), VecSet(-1.6666654611e-1f));
+    SinePoly = VecAdd(VecMul(VecMul(Squared, Reduced), SinePoly), Reduced);
+
+    MTH_VECTOR CosinePoly = VecAdd(VecMul(Squared, VecSet(2.443315711809948e-5f)), VecSet(-1.388731625493765e-3f));
+    CosinePoly = VecAdd(VecMul(Squared, CosinePoly), VecSet(4.166664568298827e-2f));
+    CosinePoly = VecAdd(VecMul(VecMul(Squared, Squared), CosinePoly),
+                        VecSub(VecSet(1.0f), VecMul(Squared, VecSet(0.5f))));
+
+    // Odd quadrants swap sine and cosine, and the sign comes from which half of the circle the quadrant is in
+    MTH_MASK Swap = IntVecEqual(IntVecAnd(Quadrant, IntVecSet(1)), IntVecSet(1));
+    MTH_INT_VECTOR SineSign = IntVecShift(IntVecAnd(Quadrant, IntVecSet(2)), 30);
+    MTH_INT_VECTOR CosineSign = IntVecShift(IntVecAnd(IntVecAdd(Quadrant, IntVecSet(1)), IntVecSet(2)), 30);
+
+    *Sine = VecFlipSign(VecSelect(Swap, CosinePoly, SinePoly), SineSign);
+    *Cosine = VecFlipSign(VecSelect(Swap, SinePoly, CosinePoly), CosineSign);
+}
+
+// Fills in a rotation matrix from Euler angles, the same one glm_euler makes
+static inline VOID RotationFromEuler(_In_reads_(MTH_LANES) CONST vec3 *Rotations, _Out_writes_(9) MTH_VECTOR *Rotation)
+{
+    MTH_VECTOR AngleX;
+    MTH_VECTOR AngleY;
+    MTH_VECTOR AngleZ;
+    MTH_VECTOR SinX;
+    MTH_VECTOR SinY;
+    MTH_VECTOR SinZ;
+    MTH_VECTOR CosX;
+    MTH_VECTOR CosY;
+    MTH_VECTOR CosZ;
+
+    LoadVec3(Rotations, &AngleX, &AngleY, &AngleZ);
+    SinCos(AngleX, &SinX, &CosX);
+    SinCos(AngleY, &SinY, &CosY);
+    SinCos(AngleZ, &SinZ, &CosZ);
+
+    MTH_VECTOR Zero = VecSet(0.0f);
+    MTH_VECTOR CosZSinX = VecMul(CosZ, SinX);
+    MTH_VECTOR CosXCosZ = VecMul(CosX, CosZ);
+    MTH_VECTOR SinYSinZ = VecMul(SinY, SinZ);
+
+    Rotation[0] = VecMul(CosY, CosZ);
+    Rotation[1] = VecAdd(VecMul(CosZSinX, SinY), VecMul(CosX, SinZ));
+    Rotation[2] = VecSub(VecMul(SinX, SinZ), VecMul(CosXCosZ, SinY));
+    Rotation[3] = VecSub(Zero, VecMul(CosY, SinZ));
+    Rotation[4] = VecSub(CosXCosZ, VecMul(SinX, SinYSinZ));
+    Rotation[5] = VecAdd(CosZSinX, VecMul(CosX, SinYSinZ));
+    Rotation[6] = SinY;
+    Rotation[7] = VecSub(Zero, VecMul(CosY, SinX));
+    Rotation[8] = VecMul(CosX, CosY);
+}
+
+// Fills in a rotation matrix from normalized quaternions, the same one glm_quat_mat4 makes
+static inline VOID RotationFromQuaternion(_In_reads_(MTH_LANES) CONST versor *Orientations,
+                                          _Out_writes_(9) MTH_VECTOR *Rotation)
+{
+    MTH_VECTOR X;
+    MTH_VECTOR Y;
+    MTH_VECTOR Z;
+    MTH_VECTOR W;
+
+    LoadVec4(Orientations, &X, &Y, &Z, &W);
+
+    MTH_VECTOR One = VecSet(1.0f);
+    MTH_VECTOR X2 = VecAdd(X, X);
+    MTH_VECTOR Y2 = VecAdd(Y, Y);
+    MTH_VECTOR Z2 = VecAdd(Z, Z);
+    MTH_VECTOR XX = VecMul(X, X2);
+    MTH_VECTOR YY = VecMul(Y, Y2);
+    MTH_VECTOR ZZ = VecMul(Z, Z2);
+    MTH_VECTOR XY = VecMul(X, Y2);
+    MTH_VECTOR XZ = VecMul(X, Z2);
+    MTH_VECTOR YZ = VecMul(Y, Z2);
+    MTH_VECTOR WX = VecMul(W, X2);
+    MTH_VECTOR WY = VecMul(W, Y2);
+    MTH_VECTOR WZ = VecMul(W, Z2);
+
+    Rotation[0] = VecSub(One, VecAdd(YY, ZZ));
+    Rotation[1] = VecAdd(XY, WZ);
+    Rotation[2] = VecSub(XZ, WY);
+    Rotation[3] = VecSub(XY, WZ);
+    Rotation[4] = VecSub(One, VecAdd(XX, ZZ));
+    Rotation[5] = VecAdd(YZ, WX);
+    Rotation[6] = VecAdd(XZ, WY);
+    Rotation[7] = VecSub(YZ, WX);
+    Rotation[8] = VecSub(One, VecAdd(XX, YY));
+}
+
+// Does MTH_LANES transforms, all the inputs have to have that many elements
+static VOID CreateTransforms(_In_reads_opt_(MTH_LANES) CONST vec3 *Positions,
+                             _In_reads_opt_(MTH_LANES) CONST vec3 *Rotations,
+                             _In_reads_opt_(MTH_LANES) CONST versor *Orientations,
+                             _In_reads_opt_(MTH_LANES) CONST vec3 *Scales, _Out_writes_(MTH_LANES) mat4 *Transforms)
+{
+    MTH_VECTOR Zero = VecSet(0.0f);
+    MTH_VECTOR One = VecSet(1.0f);
+
+    MTH_VECTOR PositionX = Zero;
+    MTH_VECTOR PositionY = Zero;
+    MTH_VECTOR PositionZ = Zero;
+    if (Positions)
+    {
+        LoadVec3(Positions, &PositionX, &PositionY, &PositionZ);
+    }
+
+    MTH_VECTOR ScaleX = One;
+    MTH_VECTOR ScaleY = One;
+    MTH_VECTOR ScaleZ = One;
+    if (Scales)
+    {
+        LoadVec3(Scales, &ScaleX, &ScaleY, &ScaleZ);
+    }
+
+    // By column and then row, like a mat4
+    MTH_VECTOR Rotation[9] = {One, Zero, Zero, Zero, One, Zero, Zero, Zero, One};
+    if (Orientations)
+    {
+        RotationFromQuaternion(Orientations, Rotation);
+    }
+    else if (Rotations)
+    {
+        RotationFromEuler(Rotations, Rotation);
+    }
+
+    // Translating, scaling and then multiplying by the rotation comes out to each row of the rotation multiplied by the
+    // scale on that axis, with the position in the last column
+    for (UINT32 i = 0; i < 3; i++)
+    {
+        StoreColumn(Transforms, i, VecMul(ScaleX, Rotation[i * 3]), VecMul(ScaleY, Rotation[i * 3 + 1]),
+                    VecMul(ScaleZ, Rotation[i * 3 + 2]), Zero);
+    }
+    StoreColumn(Transforms, 3, PositionX, PositionY, PositionZ, One);
+}
+
+VOID MthCreateTransformMatrices(_In_ SIZE_T Count, _In_reads_opt_(Count) CONST vec3 *Positions,
+                                _In_reads_opt_(Count) CONST vec3 *Rotations,
+                                _In_reads_opt_(Count) CONST versor *Orientations,
+                                _In_reads_opt_(Count) CONST vec3 *Scales, _Out_writes_(Count) mat4 *Transforms)
+{
+    SIZE_T i = 0;
+    for (; i + MTH_LANES <= Count; i += MTH_LANES)
+    {
+        CreateTransforms(Positions ? Positions + i : NULL, Rotations ? Rotations + i : NULL,
+                         Orientations ? Orientations + i : NULL, Scales ? Scales + i : NULL, Transforms + i);
+    }
+
+    // The rest go through the same path, so an entity's transform doesn't depend on where it is in its table
+    SIZE_T Remaining = Count - i;
+    if (Remaining)
+    {
+        vec3 PaddedPositions[MTH_LANES] = {0};
+        vec3 PaddedRotations[MTH_LANES] = {0};
+        versor PaddedOrientations[MTH_LANES] = {0};
+        vec3 PaddedScales[MTH_LANES] = {0};
+        mat4 PaddedTransforms[MTH_LANES];
+
+        if (Positions)
+        {
+            memcpy(PaddedPositions, Positions + i, Remaining * sizeof(vec3));
+        }
+        if (Rotations)
+        {
+            memcpy(PaddedRotations, Rotations + i, Remaining * sizeof(vec3));
+        }
+        if (Orientations)
+        {
+            memcpy(PaddedOrientations, Orientations + i, Remaining * sizeof(versor));
+        }
+        if (Scales)
+        {
+            memcpy(PaddedScales, Scales + i, Remaining * sizeof(vec3));
+        }
+
+        CreateTransforms(Positions ? PaddedPositions : NULL, Rotations ? PaddedRotations : NULL,
+                         Orientations ? PaddedOrientations : NULL, Scales ? PaddedScales : NULL, PaddedTransforms);
+        memcpy(Transforms + i, PaddedTransforms, Remaining * sizeof(mat4));
+    }
+}
@@ -29,3 +29,106 @@ static inline VOID MthCreateTransformMatrix(_In_opt_ CONST vec3 Position, _In_op
     glm_euler((PFLOAT)(Rotation ? Rotation : DefaultRotation), RotationMatrix);
     glm_mat4_mul(Transform, RotationMatrix, Transform);
 }
+
+/// @brief Create a transformation matrix from a quaternion instead of Euler angles
+///
+/// @param[in] Position The translation to apply (default is 0, 0, 0)
+/// @param[in] Orientation The rotation to apply, which has to be normalized (default is the identity)
+/// @param[in] Scale The scaling to apply (default is 1, 1, 1)
+/// @param[out] Transform The transformation matrix to fill
+static inline VOID MthCreateTransformMatrixFromQuaternion(_In_opt_ CONST vec3 Position,
+                                                          _In_opt_ CONST versor Orientation, _In_opt_ CONST vec3 Scale,
+                                                          _Out_ mat4 Transform)
+{
+    if (Orientation)
+    {
+        glm_quat_mat4((PFLOAT)Orientation, Transform);
+    }
+    else
+    {
+        glm_mat4_identity(Transform);
+    }
+
+    // Translating and scaling before the rotation puts the scale on the rows and the position in the last column
+    if (Scale)
+    {
+        for (UINT32 i = 0; i < 3; i++)
+        {
+            glm_vec3_mul(Transform[i], (PFLOAT)Scale, Transform[i]);
+        }
+    }
+    if (Position)
+    {
+        glm_vec3_copy((PFLOAT)Position, Transform[3]);
+    }
+}
+
+/// @brief Convert Euler angles to a quaternion with the same rotation
+///
+/// The angles are in the same order as MthCreateTransformMatrix takes them, which is the order glm_euler uses.
+///
+/// @param[in] Rotation The Euler angles
+/// @param[out] Orientation The quaternion to fill
+static inline VOID MthEulerToQuaternion(_In_ CONST vec3 Rotation, _Out_ versor Orientation)
+{
+    FLOAT SinX = sinf(Rotation[0] * 0.5f);
+    FLOAT CosX = cosf(Rotation[0] * 0.5f);
+    FLOAT SinY = sinf(Rotation[1] * 0.5f);
+    FLOAT CosY = cosf(Rotation[1] * 0.5f);
+    FLOAT SinZ = sinf(Rotation[2] * 0.5f);
+    FLOAT CosZ = cosf(Rotation[2] * 0.5f);
+
+    // The product of the rotations around X, Y and Z, in that order
+    Orientation[0] = SinX * CosY * CosZ + CosX * SinY * SinZ;
+    Orientation[1] = CosX * SinY * CosZ - SinX * CosY * SinZ;
+    Orientation[2] = CosX * CosY * SinZ + SinX * SinY * CosZ;
+    Orientation[3] = CosX * CosY * CosZ - SinX * SinY * SinZ;
+}
+
+/// @brief Convert a quaternion to Euler angles with the same rotation
+///
+/// @param[in] Orientation The quaternion, which has to be normalized
+/// @param[out] Rotation The Euler angles to fill, in the order MthCreateTransformMatrix takes them
+static inline VOID MthQuaternionToEuler(_In_ CONST versor Orientation, _Out_ vec3 Rotation)
+{
+    FLOAT X = Orientation[0];
+    FLOAT Y = Orientation[1];
+    FLOAT Z = Orientation[2];
+    FLOAT W = Orientation[3];
+
+    // Elements of the rotation matrix, by row and then column
+    FLOAT Matrix02 = 2.0f * (X * Z + W * Y);
+    FLOAT Matrix10 = 2.0f * (X * Y + W * Z);
+    FLOAT Matrix11 = 1.0f - 2.0f * (X * X + Z * Z);
+    FLOAT Matrix12 = 2.0f * (Y * Z - W * X);
+    FLOAT Matrix20 = 2.0f * (X * Z - W * Y);
+    FLOAT Matrix21 = 2.0f * (Y * Z + W * X);
+    FLOAT Matrix22 = 1.0f - 2.0f * (X * X + Y * Y);
+
+    Rotation[0] = atan2f(-Matrix12, Matrix22);
+    Rotation[1] = atan2f(Matrix02, sqrtf(Matrix12 * Matrix12 + Matrix22 * Matrix22));
+
+    // Near a quarter turn around Y, X and Z turn around the same axis and X is mostly noise, so Z comes from what's left
+    // after undoing X instead of from the elements that go to 0, which keeps the whole rotation right
+    FLOAT SinX = sinf(Rotation[0]);
+    FLOAT CosX = cosf(Rotation[0]);
+    Rotation[2] = atan2f(CosX * Matrix10 + SinX * Matrix20, CosX * Matrix11 + SinX * Matrix21);
+}
+
+/// @brief Create transformation matrices for a batch of entities
+///
+/// Gives the same matrices as MthCreateTransformMatrix, but builds them straight from the sines and cosines of the
+/// angles instead of multiplying matrices together, and does several at once with SSE2, AVX2 or NEON, whichever the
+/// engine is compiled for. The arrays can be component columns straight from flecs. Quaternions don't need any
+/// trigonometry at all, so they're used instead of the Euler angles if they're given.
+///
+/// @param[in] Count The number of transforms
+/// @param[in] Positions The translations to apply, or NULL for 0, 0, 0
+/// @param[in] Rotations The rotations to apply as Euler angles, or NULL for 0, 0, 0
+/// @param[in] Orientations The rotations to apply as normalized quaternions, or NULL to use Rotations
+/// @param[in] Scales The scaling to apply, or NULL for 1, 1, 1
+/// @param[out] Transforms The transformation matrices to fill
+extern VOID MthCreateTransformMatrices(_In_ SIZE_T Count, _In_reads_opt_(Count) CONST vec3 *Positions,
+                                       _In_reads_opt_(Count) CONST vec3 *Rotations,
+                                       _In_reads_opt_(Count) CONST versor *Orientations,
+                                       _In_reads_opt_(Count) CONST vec3 *Scales, _Out_writes_(Count) mat4 *Transforms);
@@ -0,0 +1,322 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    profile.c
+
+Abstract:
+
+    This file implements the CPU profiler. Only the thread that owns a ring
+    writes to it, and it publishes each event by moving the head forward
+    after it's written, so the exporter can copy a ring while it's being
+    written to and then check the head again to see what got overwritten.
+    Timestamps are read from the cheapest clock available and converted to
+    microseconds when they're exported. Tracks are rings too, with each
+    zone stored as its start followed by its end.
+
+--*/
+
+#include "atomic.h"
+#include "profile.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef PURPL_UNIX
+#include <time.h>
+#endif
+
+/// @brief A zone beginning, or ending if Source is NULL
+PURPL_MAKE_TAG(struct, ENGINE_PROFILE_EVENT, {
+    PCENGINE_PROFILE_SOURCE Source;
+    UINT64 Time;
+})
+
+/// @brief A thread's events
+PURPL_MAKE_TAG(struct, ENGINE_PROFILE_RING, {
+    volatile INT64 Head; // total events written, only the owner changes it
+    UINT32 Id;
+    PCHAR Name;
+    BOOLEAN Track; // times are nanoseconds instead of ticks
+    ENGINE_PROFILE_EVENT Events[ENGINE_PROFILE_EVENT_COUNT];
+})
+
+static PAS_MUTEX RingLock;
+static PENGINE_PROFILE_RING *Rings;
+static ENGINE_THREAD_LOCAL PENGINE_PROFILE_RING CurrentRing;
+
+static UINT64 StartTicks;
+static UINT64 StartNanoseconds;
+
+VOID EngDefineProfileVariables(VOID)
+{
+    CONFIGVAR_DEFINE_BOOLEAN("eng_profile_export", FALSE, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+}
+
+static UINT64 ReadTicks(VOID)
+{
+#if defined _MSC_VER && (defined _M_X64 || defined _M_IX86)
+    return __rdtsc();
+#elif defined __x86_64__ || defined __i386__
+    return __builtin_ia32_rdtsc();
+#elif defined PURPL_UNIX
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (UINT64)Time.tv_sec * 1000000000 + Time.tv_nsec;
+#else
+    return PlatGetMilliseconds() * 1000000;
+#endif
+}
+
+static UINT64 GetNanoseconds(VOID)
+{
+#if defined PURPL_UNIX
+    struct timespec Time;
+    clock_gettime(CLOCK_MONOTONIC, &Time);
+    return (UINT64)Time.tv_sec * 1000000000 + Time.tv_nsec;
+#elif defined PURPL_WIN32
+    LARGE_INTEGER Counter;
+    LARGE_INTEGER Frequency;
+    QueryPerformanceCounter(&Counter);
+    QueryPerformanceFrequency(&Frequency);
+    return (UINT64)((DOUBLE)Counter.QuadPart / Frequency.QuadPart * 1000000000.0);
+#else
+    return PlatGetMilliseconds() * 1000000;
+#endif
+}
+
+static PENGINE_PROFILE_RING CreateRing(_In_opt_z_ PCSTR Name, _In_ BOOLEAN Track)
+{
+    PENGINE_PROFILE_RING Ring = CmnAllocType(1, ENGINE_PROFILE_RING);
+    Ring->Name = Name ? CmnDuplicateString(Name, 0) : NULL;
+    Ring->Track = Track;
+
+    AsLockMutex(RingLock, TRUE);
+    Ring->Id = (UINT32)stbds_arrlenu(Rings);
+    stbds_arrpush(Rings, Ring);
+    AsUnlockMutex(RingLock);
+
+    return Ring;
+}
+
+static PENGINE_PROFILE_RING GetRing(VOID)
+{
+    if (!CurrentRing)
+    {
+        CurrentRing = CreateRing(NULL, FALSE);
+    }
+
+    return CurrentRing;
+}
+
+static VOID Record(_Inout_ PENGINE_PROFILE_RING Ring, _In_opt_ PCENGINE_PROFILE_SOURCE Source, _In_ UINT64 Time)
+{
+    INT64 Head = Ring->Head;
+    PENGINE_PROFILE_EVENT Event = &Ring->Events[Head & (ENGINE_PROFILE_EVENT_COUNT - 1)];
+
+    Event->Source = Source;
+    Event->Time = Time;
+    ENGINE_ATOMIC_STORE(&Ring->Head, Head + 1);
+}
+
+VOID EngInitializeProfiler(VOID)
+{
+    LogInfo("Initializing profiler");
+
+    RingLock = AsCreateMutex();
+    StartTicks = ReadTicks();
+    StartNanoseconds = GetNanoseconds();
+
+    EngSetProfileThreadName("Main thread");
+}
+
+VOID EngShutdownProfiler(VOID)
+{
+    LogInfo("Shutting down profiler");
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(Rings); i++)
+    {
+        if (Rings[i]->Name)
+        {
+            CmnFree(Rings[i]->Name);
+        }
+        CmnFree(Rings[i]);
+    }
+    stbds_arrfree(Rings);
+    CurrentRing = NULL;
+
+    AsDestroyMutex(RingLock);
+    RingLock = NULL;
+}
+
+VOID EngBeginProfileZone(_In_ PCENGINE_PROFILE_SOURCE Source)
+{
+    Record(GetRing(), Source, ReadTicks());
+}
+
+VOID EngEndProfileZone(VOID)
+{
+    Record(GetRing(), NULL, ReadTicks());
+}
+
+VOID EngSetProfileThreadName(_In_z_ PCSTR Name)
+{
+    PENGINE_PROFILE_RING Ring = GetRing();
+
+    AsLockMutex(RingLock, TRUE);
+    if (Ring->Name)
+    {
+        CmnFree(Ring->Name);
+    }
+    Ring->Name = CmnDuplicateString(Name, 0);
+    AsUnlockMutex(RingLock);
+}
+
+UINT64 EngGetProfileTime(VOID)
+{
+    return GetNanoseconds();
+}
+
+PVOID EngCreateProfileTrack(_In_z_ PCSTR Name)
+{
+    return CreateRing(Name, TRUE);
+}
+
+VOID EngAddProfileZone(_In_ PVOID Track, _In_ PCENGINE_PROFILE_SOURCE Source, _In_ UINT64 Start, _In_ UINT64 End)
+{
+    Record(Track, Source, Start);
+    Record(Track, NULL, End);
+}
+
+static VOID WriteString(_In_ FILE *File, _In_z_ PCSTR String)
+{
+    fputc('"', File);
+    for (PCSTR Current = String; *Current; Current++)
+    {
+        if (*Current == '"' || *Current == '\\')
+        {
+            fprintf(File, "\\%c", *Current);
+        }
+        else if ((UINT8)*Current < ' ')
+        {
+            fprintf(File, "\\u%04x", (UINT8)*Current);
+        }
+        else
+        {
+            fputc(*Current, File);
+        }
+    }
+    fputc('"', File);
+}
+
+// Leaves the event open so the caller can add to it
+static VOID WriteZone(_In_ FILE *File, _In_ PCENGINE_PROFILE_RING Ring, _In_ PCENGINE_PROFILE_SOURCE Source,
+                      _In_z_ PCSTR Phase, _In_ DOUBLE Timestamp)
+{
+    fprintf(File, ",\n{\"name\":");
+    WriteString(File, Source->Name);
+    fprintf(File, ",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"file\":",
+            Ring->Track ? "track" : "cpu", Phase, Timestamp, Ring->Id);
+    WriteString(File, Source->File);
+    fprintf(File, ",\"line\":%u}", Source->Line);
+}
+
+static VOID WriteRing(_In_ FILE *File, _In_ PENGINE_PROFILE_RING Ring, _In_ PENGINE_PROFILE_EVENT Events,
+                      _In_ DOUBLE TicksPerMicrosecond)
+{
+    INT64 End = ENGINE_ATOMIC_LOAD(&Ring->Head);
+    INT64 Start = PURPL_MAX(End - ENGINE_PROFILE_EVENT_COUNT, 0);
+
+    for (INT64 i = Start; i < End; i++)
+    {
+        Events[i - Start] = Ring->Events[i & (ENGINE_PROFILE_EVENT_COUNT - 1)];
+    }
+
+    // Anything the owner got to while this was copying is garbage, including the slot it might be writing right now
+    INT64 Overwritten = ENGINE_ATOMIC_LOAD(&Ring->Head) - ENGINE_PROFILE_EVENT_COUNT + 1;
+    INT64 Valid = PURPL_MAX(Start, Overwritten);
+
+    fprintf(File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", Ring->Id);
+    if (Ring->Name)
+    {
+        WriteString(File, Ring->Name);
+    }
+    else
+    {
+        fprintf(File, "\"Thread %u\"", Ring->Id);
+    }
+    fprintf(File, "}}");
+
+    UINT64 Depth = 0;
+    for (INT64 i = Valid; i < End; i++)
+    {
+        PCENGINE_PROFILE_EVENT Event = &Events[i - Start];
+
+        if (Ring->Track)
+        {
+            // A zone's start is followed by its end, so they're written together as one complete event
+            if (Event->Source && i + 1 < End)
+            {
+                PCENGINE_PROFILE_EVENT Next = &Events[i + 1 - Start];
+                WriteZone(File, Ring, Event->Source, "X", (INT64)(Event->Time - StartNanoseconds) / 1000.0);
+                fprintf(File, ",\"dur\":%.3f}", (INT64)(Next->Time - Event->Time) / 1000.0);
+                i++;
+            }
+        }
+        else if (Event->Source)
+        {
+            WriteZone(File, Ring, Event->Source, "B", (INT64)(Event->Time - StartTicks) / TicksPerMicrosecond);
+            fprintf(File, "}");
+            Depth++;
+        }
+        else if (Depth > 0)
+        {
+            // Ends of zones that began before the oldest event still around are left out, so every E has a B
+            fprintf(File, ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                    (INT64)(Event->Time - StartTicks) / TicksPerMicrosecond, Ring->Id);
+            Depth--;
+        }
+    }
+}
+
+BOOLEAN EngExportProfile(_In_z_ PCSTR Path)
+{
+    LogInfo("Exporting profile to %s", Path);
+
+    FILE *File = fopen(Path, "wb");
+    if (!File)
+    {
+        LogError("Failed to open %s: %s", Path, strerror(errno));
+        return FALSE;
+    }
+
+    // Ticks aren't necessarily nanoseconds, so they're measured against a clock that is
+    UINT64 Ticks = ReadTicks() - StartTicks;
+    UINT64 Nanoseconds = GetNanoseconds() - StartNanoseconds;
+    DOUBLE TicksPerMicrosecond = Nanoseconds ? (DOUBLE)Ticks / Nanoseconds * 1000.0 : 1000.0;
+
+    PENGINE_PROFILE_EVENT Events = CmnAllocType(ENGINE_PROFILE_EVENT_COUNT, ENGINE_PROFILE_EVENT);
+
+    fprintf(File, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(File, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"purpl\"}}");
+    AsLockMutex(RingLock, TRUE);
+    for (SIZE_T i = 0; i < stbds_arrlenu(Rings); i++)
+    {
+        WriteRing(File, Rings[i], Events, TicksPerMicrosecond);
+    }
+    AsUnlockMutex(RingLock);
+    fprintf(File, "\n]}\n");
+
+    CmnFree(Events);
+
+    BOOLEAN Succeeded = !ferror(File);
+    fclose(File);
+    if (!Succeeded)
+    {
+        LogError("Failed to write %s", Path);
+    }
+
+    return Succeeded;
+}
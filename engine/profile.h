@@ -0,0 +1,108 @@
+/// @file profile.h
+///
+/// @brief This file declares the CPU profiler, which records nested timed zones on every thread.
+///
+/// Zones are marked with ENGINE_PROFILE_BEGIN and ENGINE_PROFILE_END, which have to pair up on the same thread. Each
+/// one writes a timestamp and a pointer to static information about where it is into a ring owned by the calling
+/// thread, so nothing is shared or locked while recording, and once a ring is full the oldest events get overwritten.
+/// The rings are written out on request as Chrome trace JSON, which chrome://tracing and Perfetto can open. Without
+/// PURPL_PROFILE, which is defined in every build but release, the macros compile to nothing.
+///
+/// Work timed by something other than a CPU thread, like the GPU, goes on a track instead. Finished zones are added to
+/// a track with their start and end in nanoseconds from EngGetProfileTime, so they line up with the threads.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/configvar.h"
+#include "common/log.h"
+
+#include "platform/async.h"
+#include "platform/platform.h"
+
+/// @brief Number of events in each thread's ring, must be a power of two
+#define ENGINE_PROFILE_EVENT_COUNT 32768
+
+/// @brief Where a zone is, there's one of these for each ENGINE_PROFILE_BEGIN
+PURPL_MAKE_TAG(struct, ENGINE_PROFILE_SOURCE, {
+    PCSTR Name;
+    PCSTR File;
+    UINT32 Line;
+})
+
+#ifdef PURPL_PROFILE
+/// @brief Start a zone on the calling thread
+#define ENGINE_PROFILE_BEGIN(ZoneName)                                                                                 \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        static CONST ENGINE_PROFILE_SOURCE ProfileSource_ = {(ZoneName), __FILE__, __LINE__};                          \
+        EngBeginProfileZone(&ProfileSource_);                                                                          \
+    } while (0)
+
+/// @brief End the calling thread's innermost zone
+#define ENGINE_PROFILE_END() EngEndProfileZone()
+
+/// @brief Name the calling thread in exported traces
+#define ENGINE_PROFILE_THREAD_NAME(ThreadName) EngSetProfileThreadName(ThreadName)
+#else
+#define ENGINE_PROFILE_BEGIN(ZoneName)
+#define ENGINE_PROFILE_END()
+#define ENGINE_PROFILE_THREAD_NAME(ThreadName)
+#endif
+
+/// @brief Define the profiler's config vars
+extern VOID EngDefineProfileVariables(VOID);
+
+/// @brief Initialize the profiler, the calling thread is named as the main thread
+extern VOID EngInitializeProfiler(VOID);
+
+/// @brief Free every thread's ring, nothing can be recording anymore
+extern VOID EngShutdownProfiler(VOID);
+
+/// @brief Record the start of a zone, use ENGINE_PROFILE_BEGIN instead
+///
+/// @param[in] Source Where the zone is, has to stay valid until the profiler is shut down
+extern VOID EngBeginProfileZone(_In_ PCENGINE_PROFILE_SOURCE Source);
+
+/// @brief Record the end of the innermost zone, use ENGINE_PROFILE_END instead
+extern VOID EngEndProfileZone(VOID);
+
+/// @brief Name the calling thread, use ENGINE_PROFILE_THREAD_NAME instead
+///
+/// @param[in] Name The name, which is copied
+extern VOID EngSetProfileThreadName(_In_z_ PCSTR Name);
+
+/// @brief Get the time on the clock tracks use
+///
+/// @return The time in nanoseconds
+extern UINT64 EngGetProfileTime(VOID);
+
+/// @brief Create a track, only one thread can add zones to it
+///
+/// @param[in] Name The name of the track, which is copied
+///
+/// @return The track, which lasts until the profiler is shut down
+extern PVOID EngCreateProfileTrack(_In_z_ PCSTR Name);
+
+/// @brief Add a finished zone to a track, zones have to be added in the order they started
+///
+/// @param[in] Track The track
+/// @param[in] Source What the zone is, has to stay valid until the profiler is shut down
+/// @param[in] Start When the zone started, from EngGetProfileTime
+/// @param[in] End When the zone ended
+extern VOID EngAddProfileZone(_In_ PVOID Track, _In_ PCENGINE_PROFILE_SOURCE Source, _In_ UINT64 Start,
+                              _In_ UINT64 End);
+
+/// @brief Write what every thread has recorded as a Chrome trace
+///
+/// This can be called while other threads are recording, events they overwrite while it's reading are left out.
+///
+/// @param[in] Path The file to write
+///
+/// @return Whether the file could be written
+extern BOOLEAN EngExportProfile(_In_z_ PCSTR Path);
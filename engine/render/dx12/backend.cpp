@@ -338,9 +338,11 @@ VOID Dx12InitializeBackend(_Out_ PRENDER_BACKEND Backend)
     Backend->DestroyShader = Dx12DestroyShader;
 
     Backend->UseTexture = Dx12UseTexture;
+    Backend->UpdateTexture = Dx12UpdateTexture;
     Backend->ReleaseTexture = Dx12ReleaseTexture;
 
     Backend->CreateModel = Dx12CreateModel;
+    Backend->UpdateModel = Dx12UpdateModel;
     Backend->DrawModel = Dx12DrawModel;
     Backend->DestroyModel = Dx12DestroyModel;
 
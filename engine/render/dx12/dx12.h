@@ -131,6 +131,9 @@ typedef struct DIRECTX12_MODEL_DATA
 {
     DIRECTX12_BUFFER VertexBuffer;
     DIRECTX12_BUFFER IndexBuffer;
+    UINT32 VertexStride;
+    DXGI_FORMAT IndexFormat;
+    UINT32 IndexCount;
 } DIRECTX12_MODEL_DATA, *PDIRECTX12_MODEL_DATA;
 
 /// @brief Data for an object
@@ -248,9 +251,10 @@ extern VOID Dx12CreateGeometryBuffers(VOID);
 /// @brief Create the pipeline state object for a shader
 ///
 /// @param[in] Name The name of the shader
+/// @param[in] Reload Whether to return NULL on failure instead of aborting
 ///
-/// @return The pipeline state object, or NULL on failure
-extern RENDER_HANDLE Dx12LoadShader(_In_z_ PCSTR Name);
+/// @return The pipeline state object, or NULL if Reload is set and it couldn't be created
+extern RENDER_HANDLE Dx12LoadShader(_In_z_ PCSTR Name, _In_ BOOLEAN Reload);
 
 /// @brief Destroy a shader
 ///
@@ -305,9 +309,20 @@ extern VOID Dx12CreateBufferWithData(_Out_ PDIRECTX12_BUFFER Buffer, PVOID Data,
 /// @brief Use a texture
 ///
 /// @param[in] Texture The texture to use
+/// @param[in] MipCount The number of mip levels in the texture's pixels, only the first is used
+/// @param[in] Name The name of the texture
 ///
 /// @return The handle to the texture
-extern RENDER_HANDLE Dx12UseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name);
+extern RENDER_HANDLE Dx12UseTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name);
+
+/// @brief Replace the contents of a texture, the GPU must be idle
+///
+/// @param[in] Handle The handle to the texture
+/// @param[in] Texture The new texture
+/// @param[in] MipCount The number of mip levels in the texture's pixels, only the first is used
+/// @param[in] Name The name of the texture
+extern VOID Dx12UpdateTexture(_In_ RENDER_HANDLE Handle, _In_ PTEXTURE Texture, _In_ UINT32 MipCount,
+                              _In_z_ PCSTR Name);
 
 /// @brief Destroy a texture
 ///
@@ -320,6 +335,13 @@ extern VOID Dx12ReleaseTexture(_In_ RENDER_HANDLE Handle);
 /// @param[in] Mesh The mesh to use
 extern VOID Dx12CreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh);
 
+/// @brief Replace the mesh of a model, the GPU must be idle
+///
+/// @param[in] Name The name of the model
+/// @param[in] Model The model to update
+/// @param[in] Mesh The mesh to use
+extern VOID Dx12UpdateModel(_In_z_ PCSTR Name, _In_ PMODEL Model, _In_ PMESH Mesh);
+
 /// @brief Draw a model
 ///
 /// @param[in] Model The model to render
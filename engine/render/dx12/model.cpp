@@ -1,5 +1,28 @@
 #include "dx12.h"
 
+static VOID CreateBuffers(_In_z_ PCSTR Name, _Inout_ PDIRECTX12_MODEL_DATA Data, _In_ PMESH Mesh)
+{
+    RENDER_MESH_DATA MeshData;
+    RdrPrepareMesh(Mesh, &MeshData);
+
+    CD3DX12_HEAP_PROPERTIES HeapProperties(D3D12_HEAP_TYPE_DEFAULT);
+    CD3DX12_RESOURCE_DESC ResourceDescription =
+        CD3DX12_RESOURCE_DESC::Buffer((UINT64)MeshData.VertexCount * MeshData.VertexStride);
+    Dx12CreateBufferWithData(&Data->VertexBuffer, (PVOID)MeshData.Vertices, &HeapProperties, D3D12_HEAP_FLAG_NONE,
+                             &ResourceDescription, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+    Dx12NameObject(Data->VertexBuffer.Resource, "Vertex buffer %s", Name);
+    ResourceDescription = CD3DX12_RESOURCE_DESC::Buffer((UINT64)MeshData.IndexCount * MeshData.IndexSize);
+    Dx12CreateBufferWithData(&Data->IndexBuffer, (PVOID)MeshData.Indices, &HeapProperties, D3D12_HEAP_FLAG_NONE,
+                             &ResourceDescription, D3D12_RESOURCE_STATE_INDEX_BUFFER);
+    Dx12NameObject(Data->IndexBuffer.Resource, "Index buffer %s", Name);
+
+    Data->VertexStride = MeshData.VertexStride;
+    Data->IndexFormat = MeshData.IndexSize == sizeof(UINT16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    Data->IndexCount = MeshData.IndexCount;
+
+    RdrFreeMeshData(&MeshData);
+}
+
 EXTERN_C
 VOID Dx12CreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh)
 {
@@ -11,15 +34,16 @@ VOID Dx12CreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh)
 
     Model->MeshHandle = (RENDER_HANDLE)Data;
 
-    CD3DX12_HEAP_PROPERTIES HeapProperties(D3D12_HEAP_TYPE_DEFAULT);
-    CD3DX12_RESOURCE_DESC ResourceDescription = CD3DX12_RESOURCE_DESC::Buffer(Mesh->VertexCount * sizeof(MESH_VERTEX));
-    Dx12CreateBufferWithData(&Data->VertexBuffer, Mesh->Vertices, &HeapProperties, D3D12_HEAP_FLAG_NONE,
-                             &ResourceDescription, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-    Dx12NameObject(Data->VertexBuffer.Resource, "Vertex buffer %s", Name);
-    ResourceDescription = CD3DX12_RESOURCE_DESC::Buffer(Mesh->IndexCount * sizeof(ivec3));
-    Dx12CreateBufferWithData(&Data->IndexBuffer, Mesh->Indices, &HeapProperties, D3D12_HEAP_FLAG_NONE,
-                             &ResourceDescription, D3D12_RESOURCE_STATE_INDEX_BUFFER);
-    Dx12NameObject(Data->IndexBuffer.Resource, "Index buffer %s", Name);
+    CreateBuffers(Name, Data, Mesh);
+}
+
+EXTERN_C
+VOID Dx12UpdateModel(_In_z_ PCSTR Name, _In_ PMODEL Model, _In_ PMESH Mesh)
+{
+    PDIRECTX12_MODEL_DATA Data = (PDIRECTX12_MODEL_DATA)Model->MeshHandle;
+    Data->VertexBuffer.Resource->Release();
+    Data->IndexBuffer.Resource->Release();
+    CreateBuffers(Name, Data, Mesh);
 }
 
 VOID Dx12DrawModel(_In_ PMODEL Model, _In_ PRENDER_OBJECT_UNIFORM Uniform, _In_ PRENDER_OBJECT_DATA Data)
@@ -35,13 +59,13 @@ VOID Dx12DrawModel(_In_ PMODEL Model, _In_ PRENDER_OBJECT_UNIFORM Uniform, _In_
     D3D12_VERTEX_BUFFER_VIEW VertexBufferView = {};
     VertexBufferView.BufferLocation = ModelData->VertexBuffer.Resource->GetGPUVirtualAddress();
     VertexBufferView.SizeInBytes = ModelData->VertexBuffer.Size;
-    VertexBufferView.StrideInBytes = sizeof(MESH_VERTEX);
+    VertexBufferView.StrideInBytes = ModelData->VertexStride;
     Dx12Data.CommandList->IASetVertexBuffers(0, 1, &VertexBufferView);
 
     D3D12_INDEX_BUFFER_VIEW IndexBufferView = {};
     IndexBufferView.BufferLocation = ModelData->IndexBuffer.Resource->GetGPUVirtualAddress();
     IndexBufferView.SizeInBytes = ModelData->IndexBuffer.Size;
-    IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
+    IndexBufferView.Format = ModelData->IndexFormat;
     Dx12Data.CommandList->IASetIndexBuffer(&IndexBufferView);
 
     DIRECTX12_SET_UNIFORM(ObjectData->UniformBufferAddress, Uniform);
@@ -57,7 +81,11 @@ VOID Dx12DrawModel(_In_ PMODEL Model, _In_ PRENDER_OBJECT_UNIFORM Uniform, _In_
     Dx12Data.CommandList->SetGraphicsRootDescriptorTable(Dx12RootParameterSampler, TextureDescriptor);
 
     Dx12Data.CommandList->SetPipelineState((ID3D12PipelineState *)Model->Material->ShaderHandle);
-    Dx12Data.CommandList->DrawIndexedInstanced(IndexBufferView.SizeInBytes / sizeof(INT32), 1, 0, 0, 0);
+
+    // Draw the level of detail RdrDrawModel picked, or everything if it didn't pick one
+    BOOLEAN DrawLod = Model->IndexCount && Model->FirstIndex + Model->IndexCount <= ModelData->IndexCount;
+    Dx12Data.CommandList->DrawIndexedInstanced(DrawLod ? Model->IndexCount : ModelData->IndexCount, 1,
+                                               DrawLod ? Model->FirstIndex : 0, 0, 0);
 }
 
 VOID Dx12DestroyModel(_Inout_ PMODEL Model)
@@ -65,36 +65,53 @@ static CONST D3D12_INPUT_ELEMENT_DESC MeshInputElementDescriptions[] = {
     {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, offsetof(MESH_VERTEX, Normal), D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,
      0}};
 
+static CONST D3D12_INPUT_ELEMENT_DESC PackedMeshInputElementDescriptions[] = {
+    {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_FLOAT, 0, offsetof(RENDER_PACKED_VERTEX, Position),
+     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, offsetof(RENDER_PACKED_VERTEX, Colour),
+     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    {"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(RENDER_PACKED_VERTEX, TextureCoordinate),
+     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    {"NORMAL", 0, DXGI_FORMAT_R8G8B8A8_SNORM, 0, offsetof(RENDER_PACKED_VERTEX, Normal),
+     D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
+
 EXTERN_C
-RENDER_HANDLE Dx12LoadShader(_In_z_ PCSTR Name)
+RENDER_HANDLE Dx12LoadShader(_In_z_ PCSTR Name, _In_ BOOLEAN Reload)
 {
-    PBYTE VertexShader;
-    UINT64 VertexShaderSize;
-    PBYTE PixelShader;
-    UINT64 PixelShaderSize;
+    ASSET_VIEW VertexShader = {};
+    ASSET_VIEW PixelShader = {};
 
     LogDebug("Creating pipeline state object for shader %s", Name);
 
-    VertexShaderSize = 0;
-    VertexShader = (PBYTE)FsReadFile(FALSE, EngGetAssetPath(EngAssetDirectoryShaders, "directx12/%s.vs.cso", Name), 0,
-                                     0, &VertexShaderSize, 0);
-    PixelShaderSize = 0;
-    PixelShader = (PBYTE)FsReadFile(FALSE, EngGetAssetPath(EngAssetDirectoryShaders, "directx12/%s.ps.cso", Name), 0, 0,
-                                    &PixelShaderSize, 0);
-
-    if (!VertexShaderSize || !PixelShaderSize)
+    if (!AstOpenView(EngGetAssetPath(EngAssetDirectoryShaders, "directx12/%s.vs.cso", Name), &VertexShader) ||
+        !AstOpenView(EngGetAssetPath(EngAssetDirectoryShaders, "directx12/%s.ps.cso", Name), &PixelShader))
     {
-        CmnError("DirectX 12 shader for %s not found", Name);
+        if (!Reload)
+        {
+            CmnError("DirectX 12 shader for %s not found", Name);
+        }
+        LogError("DirectX 12 shader for %s not found", Name);
+        AstCloseView(&VertexShader);
+        AstCloseView(&PixelShader);
+        return 0;
     }
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC PsoDescription = {};
-    PsoDescription.InputLayout.pInputElementDescs = MeshInputElementDescriptions;
-    PsoDescription.InputLayout.NumElements = PURPL_ARRAYSIZE(MeshInputElementDescriptions);
+    if (RdrGetVertexFormat() == RenderVertexFormatPacked)
+    {
+        PsoDescription.InputLayout.pInputElementDescs = PackedMeshInputElementDescriptions;
+        PsoDescription.InputLayout.NumElements = PURPL_ARRAYSIZE(PackedMeshInputElementDescriptions);
+    }
+    else
+    {
+        PsoDescription.InputLayout.pInputElementDescs = MeshInputElementDescriptions;
+        PsoDescription.InputLayout.NumElements = PURPL_ARRAYSIZE(MeshInputElementDescriptions);
+    }
     PsoDescription.pRootSignature = Dx12Data.RootSignature;
-    PsoDescription.VS.pShaderBytecode = VertexShader;
-    PsoDescription.VS.BytecodeLength = VertexShaderSize;
-    PsoDescription.PS.pShaderBytecode = PixelShader;
-    PsoDescription.PS.BytecodeLength = PixelShaderSize;
+    PsoDescription.VS.pShaderBytecode = VertexShader.Data;
+    PsoDescription.VS.BytecodeLength = VertexShader.Size;
+    PsoDescription.PS.pShaderBytecode = PixelShader.Data;
+    PsoDescription.PS.BytecodeLength = PixelShader.Size;
     PsoDescription.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     PsoDescription.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
     PsoDescription.SampleMask = UINT32_MAX;
@@ -112,9 +129,30 @@ RENDER_HANDLE Dx12LoadShader(_In_z_ PCSTR Name)
 
     PsoDescription.DepthStencilState = DepthStencilDescription;
 
-    ID3D12PipelineState *PipelineState;
-    HRESULT_CHECK(Dx12Data.Device->CreateGraphicsPipelineState(&PsoDescription, IID_PPV_ARGS(&PipelineState)));
-    Dx12NameObject(PipelineState, "Pipeline state object for shader %s", Name);
+    // A reload that fails leaves the old pipeline state in place
+    ID3D12PipelineState *PipelineState = NULL;
+    if (Reload)
+    {
+        HRESULT Result = Dx12Data.Device->CreateGraphicsPipelineState(&PsoDescription, IID_PPV_ARGS(&PipelineState));
+        if (!SUCCEEDED(Result))
+        {
+            _com_error Error(Result);
+            LogError("Failed to create pipeline state object for shader %s: %s (HRESULT 0x%08X)", Name,
+                     Error.ErrorMessage(), Result);
+            PipelineState = NULL;
+        }
+    }
+    else
+    {
+        HRESULT_CHECK(Dx12Data.Device->CreateGraphicsPipelineState(&PsoDescription, IID_PPV_ARGS(&PipelineState)));
+    }
+    if (PipelineState)
+    {
+        Dx12NameObject(PipelineState, "Pipeline state object for shader %s", Name);
+    }
+
+    AstCloseView(&VertexShader);
+    AstCloseView(&PixelShader);
 
     return (RENDER_HANDLE)PipelineState;
 }
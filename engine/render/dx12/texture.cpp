@@ -1,14 +1,7 @@
 #include "dx12.h"
 
-EXTERN_C
-RENDER_HANDLE Dx12UseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name)
+static VOID CreateTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name, _Inout_ PDIRECTX12_TEXTURE TextureData)
 {
-    PDIRECTX12_TEXTURE TextureData = CmnAllocType(1, DIRECTX12_TEXTURE);
-    if (!TextureData)
-    {
-        CmnError("Failed to allocate DirectX 12 texture data: %s", strerror(errno));
-    }
-
     CD3DX12_HEAP_PROPERTIES HeapProperties(D3D12_HEAP_TYPE_DEFAULT);
 
     DXGI_FORMAT Format;
@@ -28,9 +21,6 @@ RENDER_HANDLE Dx12UseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name)
                              &ResourceDescription, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
     Dx12NameObject(TextureData->Buffer.Resource, "Texture %s", Name);
 
-    // To know where this texture is in the heap for drawing
-    TextureData->Index = Dx12Data.TextureCount++;
-
     CD3DX12_CPU_DESCRIPTOR_HANDLE DescriptorHandle(
         DIRECTX12_GET_DESCRIPTOR_HANDLE_FOR_HEAP_START(Dx12Data.SrvHeap, CPU), TextureData->Index,
         Dx12Data.SrvDescriptorSize);
@@ -42,10 +32,38 @@ RENDER_HANDLE Dx12UseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name)
     SrvDescription.Texture2D.MipLevels = 1;
     Dx12Data.Device->CreateShaderResourceView(TextureData->Buffer.Resource, &SrvDescription,
                                               DescriptorHandle);
+}
+
+EXTERN_C
+RENDER_HANDLE Dx12UseTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name)
+{
+    UNREFERENCED_PARAMETER(MipCount);
+
+    PDIRECTX12_TEXTURE TextureData = CmnAllocType(1, DIRECTX12_TEXTURE);
+    if (!TextureData)
+    {
+        CmnError("Failed to allocate DirectX 12 texture data: %s", strerror(errno));
+    }
+
+    // To know where this texture is in the heap for drawing
+    TextureData->Index = Dx12Data.TextureCount++;
+
+    CreateTexture(Texture, Name, TextureData);
 
     return (RENDER_HANDLE)TextureData;
 }
 
+EXTERN_C
+VOID Dx12UpdateTexture(_In_ RENDER_HANDLE Handle, _In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name)
+{
+    UNREFERENCED_PARAMETER(MipCount);
+
+    // The new view goes in the same heap slot, so nothing else needs to know
+    PDIRECTX12_TEXTURE TextureData = (PDIRECTX12_TEXTURE)Handle;
+    TextureData->Buffer.Resource->Release();
+    CreateTexture(Texture, Name, TextureData);
+}
+
 EXTERN_C
 VOID Dx12ReleaseTexture(_In_ RENDER_HANDLE Handle)
 {
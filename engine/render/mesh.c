@@ -0,0 +1,164 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    mesh.c
+
+Abstract:
+
+    This file converts meshes into the vertex and index layouts the backends
+    upload. The packed layout stores positions and texture coordinates as
+    half floats, colours as unorm8 and normals as snorm8, and indices are
+    16-bit whenever the vertex count fits.
+
+--*/
+
+#include "render.h"
+
+static RENDER_VERTEX_FORMAT VertexFormat;
+
+UINT16 RdrFloatToHalf(_In_ FLOAT Value)
+{
+    UINT32 Bits;
+    memcpy(&Bits, &Value, sizeof(UINT32));
+
+    UINT16 Sign = (UINT16)((Bits >> 16) & 0x8000);
+    INT32 Exponent = (INT32)((Bits >> 23) & 0xFF) - 127 + 15;
+    UINT32 Mantissa = Bits & 0x7FFFFF;
+
+    if (((Bits >> 23) & 0xFF) == 0xFF)
+    {
+        // Infinity stays infinity, NaN stays NaN
+        return Sign | 0x7C00 | (Mantissa ? 0x200 : 0);
+    }
+    else if (Exponent >= 0x1F)
+    {
+        return Sign | 0x7C00;
+    }
+    else if (Exponent <= 0)
+    {
+        if (Exponent < -10)
+        {
+            return Sign;
+        }
+
+        // Denormal, shift in the implicit bit and round to nearest
+        Mantissa |= 0x800000;
+        UINT32 Shift = (UINT32)(14 - Exponent);
+        UINT32 Half = Mantissa >> Shift;
+        if ((Mantissa >> (Shift - 1)) & 1)
+        {
+            Half++;
+        }
+        return Sign | (UINT16)Half;
+    }
+
+    // Rounding can carry into the exponent, which is still correct
+    UINT32 Half = ((UINT32)Exponent << 10) | (Mantissa >> 13);
+    if (Mantissa & 0x1000)
+    {
+        Half++;
+    }
+    return Sign | (UINT16)PURPL_MIN(Half, 0x7C00);
+}
+
+static UINT8 PackUnorm8(_In_ FLOAT Value)
+{
+    return (UINT8)(glm_clamp(Value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static INT8 PackSnorm8(_In_ FLOAT Value)
+{
+    FLOAT Scaled = glm_clamp(Value, -1.0f, 1.0f) * 127.0f;
+    return (INT8)(Scaled < 0.0f ? Scaled - 0.5f : Scaled + 0.5f);
+}
+
+VOID RdrInitializeVertexFormat(VOID)
+{
+    VertexFormat = CONFIGVAR_GET_BOOLEAN("rdr_packed_vertices") ? RenderVertexFormatPacked : RenderVertexFormatFull;
+    LogInfo("Using %s vertices (%u bytes each)", VertexFormat == RenderVertexFormatPacked ? "packed" : "full",
+            RdrGetVertexStride());
+}
+
+RENDER_VERTEX_FORMAT RdrGetVertexFormat(VOID)
+{
+    return VertexFormat;
+}
+
+UINT32 RdrGetVertexStride(VOID)
+{
+    return VertexFormat == RenderVertexFormatPacked ? sizeof(RENDER_PACKED_VERTEX) : sizeof(MESH_VERTEX);
+}
+
+VOID RdrPrepareMesh(_In_ PCMESH Mesh, _Out_ PRENDER_MESH_DATA Data)
+{
+    memset(Data, 0, sizeof(RENDER_MESH_DATA));
+
+    Data->VertexCount = (UINT32)Mesh->VertexCount;
+    Data->VertexStride = RdrGetVertexStride();
+    Data->IndexCount = (UINT32)(Mesh->IndexCount * 3);
+    Data->IndexSize = Mesh->VertexCount <= UINT16_MAX + 1 ? sizeof(UINT16) : sizeof(UINT32);
+
+    BOOLEAN PackVertices = VertexFormat == RenderVertexFormatPacked;
+    UINT64 VerticesSize = PackVertices ? (UINT64)Data->VertexCount * Data->VertexStride : 0;
+    UINT64 IndicesSize = Data->IndexSize == sizeof(UINT16) ? (UINT64)Data->IndexCount * sizeof(UINT16) : 0;
+
+    // The full format with 32-bit indices is what the mesh already has, so there's nothing to convert
+    Data->Vertices = Mesh->Vertices;
+    Data->Indices = Mesh->Indices;
+    if (!VerticesSize && !IndicesSize)
+    {
+        return;
+    }
+
+    Data->Allocation = CmnAlloc(VerticesSize + IndicesSize, 1);
+    if (!Data->Allocation)
+    {
+        CmnError("Failed to allocate %llu bytes to convert mesh: %s", VerticesSize + IndicesSize, strerror(errno));
+    }
+
+    if (PackVertices)
+    {
+        PRENDER_PACKED_VERTEX Vertices = Data->Allocation;
+        for (UINT32 i = 0; i < Data->VertexCount; i++)
+        {
+            PCMESH_VERTEX Vertex = &Mesh->Vertices[i];
+            for (UINT32 j = 0; j < 3; j++)
+            {
+                Vertices[i].Position[j] = RdrFloatToHalf(Vertex->Position[j]);
+                Vertices[i].Normal[j] = PackSnorm8(Vertex->Normal[j]);
+            }
+            Vertices[i].Position[3] = RdrFloatToHalf(1.0f);
+            Vertices[i].Normal[3] = 0;
+            for (UINT32 j = 0; j < 4; j++)
+            {
+                Vertices[i].Colour[j] = PackUnorm8(Vertex->Colour[j]);
+            }
+            Vertices[i].TextureCoordinate[0] = RdrFloatToHalf(Vertex->TextureCoordinate[0]);
+            Vertices[i].TextureCoordinate[1] = RdrFloatToHalf(Vertex->TextureCoordinate[1]);
+        }
+        Data->Vertices = Vertices;
+    }
+
+    if (IndicesSize)
+    {
+        PUINT16 Indices = (PUINT16)((PBYTE)Data->Allocation + VerticesSize);
+        CONST UINT32 *Source = (CONST UINT32 *)Mesh->Indices;
+        for (UINT32 i = 0; i < Data->IndexCount; i++)
+        {
+            Indices[i] = (UINT16)Source[i];
+        }
+        Data->Indices = Indices;
+    }
+}
+
+VOID RdrFreeMeshData(_Inout_ PRENDER_MESH_DATA Data)
+{
+    if (Data->Allocation)
+    {
+        CmnFree(Data->Allocation);
+    }
+    memset(Data, 0, sizeof(RENDER_MESH_DATA));
+}
@@ -13,6 +13,7 @@ static VOID Initialize(VOID)
     glDepthFunc(GL_LESS);
 
     glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, (INT32 *)&GlData.UniformBufferAlignment);
+    GlCheckTextureFormats();
 
     GlData.UniformBuffer =
         GlCreateUniformBuffer(PURPL_ALIGN(GlData.UniformBufferAlignment, sizeof(RENDER_SCENE_UNIFORM)) +
@@ -24,9 +25,11 @@ static VOID Initialize(VOID)
 PURPL_MAKE_STRING_HASHMAP_ENTRY(SHADERMAP, RENDER_HANDLE);
 extern PSHADERMAP RdrShaders;
 
+static ENGINE_CONFIGVAR ClearColourVar = ENGINE_CONFIGVAR_INT("rdr_clear_colour");
+
 static VOID BeginFrame(_In_ BOOLEAN Resized, _In_ PRENDER_SCENE_UNIFORM Uniform)
 {
-    UINT64 ClearColourRaw = CONFIGVAR_GET_INT("rdr_clear_colour");
+    UINT64 ClearColourRaw = ENGINE_CONFIGVAR_GET_INT(ClearColourVar);
     vec4 ClearColour;
     ClearColour[0] = (UINT8)((ClearColourRaw >> 24) & 0xFF) / 255.0f;
     ClearColour[1] = (UINT8)((ClearColourRaw >> 16) & 0xFF) / 255.0f;
@@ -62,10 +65,14 @@ VOID GlInitializeBackend(_Out_ PRENDER_BACKEND Backend)
     Backend->LoadShader = GlLoadShader;
     Backend->DestroyShader = GlDestroyShader;
 
+    Backend->SupportsTextureFormat = GlSupportsTextureFormat;
     Backend->UseTexture = GlUseTexture;
+    Backend->UpdateTexture = GlUpdateTexture;
+    Backend->DefersTextureRelease = TRUE; // the driver keeps the old image for draws that are still queued
     Backend->ReleaseTexture = GlReleaseTexture;
 
     Backend->CreateModel = GlCreateModel;
+    Backend->UpdateModel = GlUpdateModel;
     Backend->DrawModel = GlDrawModel;
     Backend->DestroyModel = GlDestroyModel;
 
@@ -1,5 +1,25 @@
 #include "opengl.h"
 
+static VOID UploadBuffers(_Inout_ POPENGL_MODEL_DATA ModelData, _In_ PMESH Mesh)
+{
+    RENDER_MESH_DATA MeshData;
+    RdrPrepareMesh(Mesh, &MeshData);
+
+    glBindBuffer(GL_ARRAY_BUFFER, ModelData->VertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (SIZE_T)MeshData.VertexCount * MeshData.VertexStride, MeshData.Vertices,
+                 GL_STATIC_DRAW);
+
+    ModelData->ElementCount = MeshData.IndexCount;
+    ModelData->IndexType = MeshData.IndexSize == sizeof(UINT16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    // The element buffer binding is part of the vertex array, which has to be bound
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ModelData->IndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (SIZE_T)MeshData.IndexCount * MeshData.IndexSize, MeshData.Indices,
+                 GL_STATIC_DRAW);
+
+    RdrFreeMeshData(&MeshData);
+}
+
 VOID GlCreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh)
 {
     POPENGL_MODEL_DATA ModelData = CmnAllocType(1, OPENGL_MODEL_DATA);
@@ -12,24 +32,33 @@ VOID GlCreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh)
     glBindVertexArray(ModelData->VertexArray);
 
     glGenBuffers(1, &ModelData->VertexBuffer);
-    glBindBuffer(GL_ARRAY_BUFFER, ModelData->VertexBuffer);
-    glBufferData(GL_ARRAY_BUFFER, Mesh->VertexCount * sizeof(MESH_VERTEX), Mesh->Vertices, GL_STATIC_DRAW);
-    glObjectLabel(GL_BUFFER, ModelData->VertexBuffer, 13, "Vertex buffer");
-
-    ModelData->ElementCount = (UINT32)Mesh->IndexCount;
-
     glGenBuffers(1, &ModelData->IndexBuffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ModelData->IndexBuffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, ModelData->ElementCount * sizeof(ivec3), Mesh->Indices, GL_STATIC_DRAW);
+    UploadBuffers(ModelData, Mesh);
+    glObjectLabel(GL_BUFFER, ModelData->VertexBuffer, 13, "Vertex buffer");
     glObjectLabel(GL_BUFFER, ModelData->IndexBuffer, 12, "Index buffer");
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (PVOID)offsetof(MESH_VERTEX, Position));
+    if (RdrGetVertexFormat() == RenderVertexFormatPacked)
+    {
+        glVertexAttribPointer(0, 4, GL_HALF_FLOAT, GL_FALSE, sizeof(RENDER_PACKED_VERTEX),
+                              (PVOID)offsetof(RENDER_PACKED_VERTEX, Position));
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(RENDER_PACKED_VERTEX),
+                              (PVOID)offsetof(RENDER_PACKED_VERTEX, Colour));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(RENDER_PACKED_VERTEX),
+                              (PVOID)offsetof(RENDER_PACKED_VERTEX, TextureCoordinate));
+        glVertexAttribPointer(3, 4, GL_BYTE, GL_TRUE, sizeof(RENDER_PACKED_VERTEX),
+                              (PVOID)offsetof(RENDER_PACKED_VERTEX, Normal));
+    }
+    else
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (PVOID)offsetof(MESH_VERTEX, Position));
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (PVOID)offsetof(MESH_VERTEX, Colour));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX),
+                              (PVOID)offsetof(MESH_VERTEX, TextureCoordinate));
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (PVOID)offsetof(MESH_VERTEX, Normal));
+    }
     glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (PVOID)offsetof(MESH_VERTEX, Colour));
     glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (PVOID)offsetof(MESH_VERTEX, TextureCoordinate));
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(MESH_VERTEX), (PVOID)offsetof(MESH_VERTEX, Normal));
     glEnableVertexAttribArray(3);
 
     glBindVertexArray(0);
@@ -37,6 +66,19 @@ VOID GlCreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh)
     Model->MeshHandle = (RENDER_HANDLE)ModelData;
 }
 
+VOID GlUpdateModel(_In_z_ PCSTR Name, _In_ PMODEL Model, _In_ PMESH Mesh)
+{
+    UNREFERENCED_PARAMETER(Name);
+
+    // The vertex array refers to the buffers by name, so replacing their storage is enough
+    POPENGL_MODEL_DATA ModelData = (POPENGL_MODEL_DATA)Model->MeshHandle;
+
+    glBindVertexArray(ModelData->VertexArray);
+    UploadBuffers(ModelData, Mesh);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 VOID GlDrawModel(_In_ PMODEL Model, _In_ PRENDER_OBJECT_UNIFORM Uniform, _In_ PRENDER_OBJECT_DATA Data)
 {
     UNREFERENCED_PARAMETER(Data);
@@ -56,7 +98,11 @@ VOID GlDrawModel(_In_ PMODEL Model, _In_ PRENDER_OBJECT_UNIFORM Uniform, _In_ PR
     glBindTexture(GL_TEXTURE_2D, (UINT32)Model->Material->TextureHandle);
 
     glBindVertexArray(ModelData->VertexArray);
-    glDrawElements(GL_TRIANGLES, ModelData->ElementCount * 3, GL_UNSIGNED_INT, NULL);
+    // Draw the level of detail RdrDrawModel picked, or everything if it didn't pick one
+    BOOLEAN DrawLod = Model->IndexCount && Model->FirstIndex + Model->IndexCount <= ModelData->ElementCount;
+    UINT32 IndexSize = ModelData->IndexType == GL_UNSIGNED_SHORT ? sizeof(UINT16) : sizeof(UINT32);
+    glDrawElements(GL_TRIANGLES, DrawLod ? Model->IndexCount : ModelData->ElementCount, ModelData->IndexType,
+                   (PVOID)(SIZE_T)(DrawLod ? Model->FirstIndex * IndexSize : 0));
     glBindVertexArray(0);
 }
 
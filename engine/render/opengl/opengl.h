@@ -21,6 +21,17 @@
 #include "util/mesh.h"
 #include "util/texture.h"
 
+// Not every GL header has the sRGB block compressed formats
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
 /// @brief Data for a model
 typedef struct OPENGL_MODEL_DATA
 {
@@ -28,6 +39,7 @@ typedef struct OPENGL_MODEL_DATA
     UINT32 IndexBuffer;
     UINT32 VertexArray;
     UINT32 ElementCount;
+    UINT32 IndexType;
 } OPENGL_MODEL_DATA, *POPENGL_MODEL_DATA;
 
 /// @brief Global OpenGL stuff
@@ -35,6 +47,9 @@ typedef struct OPENGL_DATA
 {
     UINT32 UniformBufferAlignment;
     UINT32 UniformBuffer;
+
+    BOOLEAN SupportsS3tc; // BC1 and BC3, in sRGB
+    BOOLEAN SupportsBptc; // BC7
 } OPENGL_DATA, *POPENGL_DATA;
 
 extern OPENGL_DATA GlData;
@@ -42,9 +57,10 @@ extern OPENGL_DATA GlData;
 /// @brief Load a shader
 ///
 /// @param[in] Name The name of the shader to load
+/// @param[in] Reload Whether to return 0 on failure instead of aborting
 ///
-/// @return The handle to the shader
-extern UINT64 GlLoadShader(_In_ PCSTR Name);
+/// @return The handle to the shader, or 0 if Reload is set and it couldn't be loaded
+extern UINT64 GlLoadShader(_In_ PCSTR Name, _In_ BOOLEAN Reload);
 
 /// @brief Destroy a shader
 ///
@@ -57,8 +73,18 @@ extern UINT32 GlCreateUniformBuffer(UINT32 Size);
 /// @brief Write data to a uniform buffer
 extern VOID GlWriteUniformBuffer(UINT32 UniformBuffer, UINT32 Offset, PVOID Data, UINT32 Size);
 
+/// @brief Check which block compressed formats are supported
+extern VOID GlCheckTextureFormats(VOID);
+
+/// @brief Check if a texture format can be uploaded as-is
+extern BOOLEAN GlSupportsTextureFormat(_In_ UINT32 Format);
+
 /// @brief Use a texture
-extern RENDER_HANDLE GlUseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name);
+extern RENDER_HANDLE GlUseTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name);
+
+/// @brief Replace the contents of a texture
+extern VOID GlUpdateTexture(_In_ RENDER_HANDLE Handle, _In_ PTEXTURE Texture, _In_ UINT32 MipCount,
+                            _In_z_ PCSTR Name);
 
 /// @brief Release a texture
 extern VOID GlReleaseTexture(_In_ RENDER_HANDLE Handle);
@@ -69,6 +95,13 @@ extern VOID GlReleaseTexture(_In_ RENDER_HANDLE Handle);
 /// @param[in] Mesh The mesh to use
 extern VOID GlCreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh);
 
+/// @brief Replace the mesh of a model
+///
+/// @param[in] Name The name of the model
+/// @param[in] Model The model to update
+/// @param[in] Mesh The mesh to use
+extern VOID GlUpdateModel(_In_z_ PCSTR Name, _In_ PMODEL Model, _In_ PMESH Mesh);
+
 /// @brief Draw a model
 ///
 /// @param[in] Model The model to render
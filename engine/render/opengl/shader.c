@@ -19,11 +19,9 @@ static UINT32 LoadShader(UINT32 Type, PCSTR EntryPoint, PCSTR Name)
         break;
     }
 
-    UINT64 ShaderSourceSize = 0;
-    // Extra is used to NUL-terminate
-    PBYTE ShaderSource =
-        FsReadFile(FALSE, EngGetAssetPath(EngAssetDirectoryShaders, "opengl/%s.%cs.glsl", Name, Prefix), 0, 0, &ShaderSourceSize, 1);
-    if (!ShaderSource || !ShaderSourceSize)
+    // The length is passed explicitly, so the source doesn't need to be NUL-terminated and can come from a mapping
+    ASSET_VIEW ShaderSource = {0};
+    if (!AstOpenView(EngGetAssetPath(EngAssetDirectoryShaders, "opengl/%s.%cs.glsl", Name, Prefix), &ShaderSource))
     {
         LogError("Failed to load shader %s", Name);
         goto Done;
@@ -31,7 +29,8 @@ static UINT32 LoadShader(UINT32 Type, PCSTR EntryPoint, PCSTR Name)
 
     LogInfo("Compiling shader %s", Name);
     Shader = glCreateShader(Type);
-    glShaderSource(Shader, 1, (PCSTR *)&ShaderSource, NULL);
+    GLint ShaderSourceSize = (GLint)ShaderSource.Size;
+    glShaderSource(Shader, 1, (PCSTR *)&ShaderSource.Data, &ShaderSourceSize);
     glCompileShader(Shader);
     glGetShaderiv(Shader, GL_COMPILE_STATUS, &Success);
     if (!Success)
@@ -44,27 +43,29 @@ static UINT32 LoadShader(UINT32 Type, PCSTR EntryPoint, PCSTR Name)
     }
 
 Done:
-    if (ShaderSource)
-    {
-        CmnFree(ShaderSource);
-    }
+    AstCloseView(&ShaderSource);
     return Shader;
 }
 
-UINT64 GlLoadShader(_In_ PCSTR Name)
+UINT64 GlLoadShader(_In_ PCSTR Name, _In_ BOOLEAN Reload)
 {
     CHAR Buffer[512] = {0};
+    UINT32 Program = 0;
 
     LogInfo("Loading OpenGL shader %s", Name);
 
     UINT32 VertexShader = LoadShader(GL_VERTEX_SHADER, "VertexMain", Name);
     UINT32 PixelShader = LoadShader(GL_FRAGMENT_SHADER, "PixelMain", Name);
+    if (VertexShader == GL_INVALID_VALUE || PixelShader == GL_INVALID_VALUE)
+    {
+        goto Done;
+    }
 
-    UINT32 Program = glCreateProgram();
-    if (Program == GL_INVALID_VALUE)
+    Program = glCreateProgram();
+    if (!Program)
     {
         LogError("Failed to create shader program: %d", glGetError());
-        return GL_INVALID_VALUE;
+        goto Done;
     }
 
     glAttachShader(Program, VertexShader);
@@ -73,20 +74,35 @@ UINT64 GlLoadShader(_In_ PCSTR Name)
 
     INT32 Success;
     glGetProgramiv(Program, GL_LINK_STATUS, &Success);
+    glDetachShader(Program, VertexShader);
+    glDetachShader(Program, PixelShader);
     if (!Success)
     {
         glGetProgramInfoLog(Program, PURPL_ARRAYSIZE(Buffer), NULL, Buffer);
         LogError("Failed to link shader program %s: %s", Name, Buffer);
-        return GL_INVALID_VALUE;
+        glDeleteProgram(Program);
+        Program = 0;
+        goto Done;
     }
 
-    glDetachShader(Program, VertexShader);
-    glDeleteShader(VertexShader);
-    glDetachShader(Program, PixelShader);
-    glDeleteShader(PixelShader);
-
     glObjectLabel(GL_PROGRAM, Program, (INT32)strlen(Name), Name);
 
+Done:
+    if (VertexShader != GL_INVALID_VALUE)
+    {
+        glDeleteShader(VertexShader);
+    }
+    if (PixelShader != GL_INVALID_VALUE)
+    {
+        glDeleteShader(PixelShader);
+    }
+
+    // A reload that fails leaves the old program in place
+    if (!Program && !Reload)
+    {
+        CmnError("Failed to load OpenGL shader %s", Name);
+    }
+
     return Program;
 }
 
@@ -117,7 +133,6 @@ UINT32 GlCreateUniformBuffer(UINT32 Size)
 
 VOID GlWriteUniformBuffer(UINT32 UniformBuffer, UINT32 Offset, PVOID Data, UINT32 Size)
 {
-    LogTrace("Writing %u bytes at offset 0x%X in uniform buffer %u", Size, Offset, UniformBuffer);
     glBindBufferBase(GL_UNIFORM_BUFFER, 0, UniformBuffer);
     glBufferSubData(GL_UNIFORM_BUFFER, Offset, Size, Data);
 }
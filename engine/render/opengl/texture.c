@@ -1,6 +1,107 @@
 #include "opengl.h"
 
-RENDER_HANDLE GlUseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name)
+VOID GlCheckTextureFormats(VOID)
+{
+    INT32 Major = 0;
+    INT32 Minor = 0;
+    INT32 ExtensionCount = 0;
+    BOOLEAN HasS3tc = FALSE;
+    BOOLEAN HasS3tcSrgb = FALSE;
+
+    glGetIntegerv(GL_MAJOR_VERSION, &Major);
+    glGetIntegerv(GL_MINOR_VERSION, &Minor);
+    GlData.SupportsBptc = Major > 4 || (Major == 4 && Minor >= 2);
+
+    glGetIntegerv(GL_NUM_EXTENSIONS, &ExtensionCount);
+    for (INT32 i = 0; i < ExtensionCount; i++)
+    {
+        PCSTR Extension = (PCSTR)glGetStringi(GL_EXTENSIONS, (UINT32)i);
+        if (strcmp(Extension, "GL_EXT_texture_compression_s3tc") == 0)
+        {
+            HasS3tc = TRUE;
+        }
+        else if (strcmp(Extension, "GL_EXT_texture_sRGB") == 0 ||
+                 strcmp(Extension, "GL_EXT_texture_compression_s3tc_srgb") == 0)
+        {
+            HasS3tcSrgb = TRUE;
+        }
+        else if (strcmp(Extension, "GL_ARB_texture_compression_bptc") == 0)
+        {
+            GlData.SupportsBptc = TRUE;
+        }
+    }
+    GlData.SupportsS3tc = HasS3tc && HasS3tcSrgb;
+
+    LogDebug("BC1/BC3 textures are %ssupported, BC7 textures are %ssupported", GlData.SupportsS3tc ? "" : "not ",
+             GlData.SupportsBptc ? "" : "not ");
+}
+
+static UINT32 GetCompressedFormat(_In_ UINT32 Format)
+{
+    switch (Format)
+    {
+    case AssetTextureFormatBc1:
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+    case AssetTextureFormatBc3:
+        return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    case AssetTextureFormatBc7:
+        return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    default:
+        return 0;
+    }
+}
+
+BOOLEAN GlSupportsTextureFormat(_In_ UINT32 Format)
+{
+    switch (Format)
+    {
+    case AssetTextureFormatBc1:
+    case AssetTextureFormatBc3:
+        return GlData.SupportsS3tc;
+    case AssetTextureFormatBc7:
+        return GlData.SupportsBptc;
+    default:
+        return !AstIsBlockCompressed(Format);
+    }
+}
+
+// Uploads to the bound texture
+static VOID UploadTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount)
+{
+    UINT32 CompressedFormat = GetCompressedFormat(Texture->Format);
+
+    // Block compressed formats can't be rendered to, so glGenerateMipmap can't make mips for them
+    BOOLEAN GenerateMips = MipCount == 1 && !CompressedFormat;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    GenerateMips || MipCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GenerateMips ? 1000 : (INT32)MipCount - 1);
+
+    CONST UINT8 *Pixels = Texture->Pixels;
+    for (UINT32 i = 0; i < MipCount; i++)
+    {
+        INT32 Width = (INT32)PURPL_MAX(Texture->Width >> i, 1);
+        INT32 Height = (INT32)PURPL_MAX(Texture->Height >> i, 1);
+        UINT64 LevelSize = AstGetTextureLevelSize(Texture->Format, Texture->Width, Texture->Height, i);
+        if (CompressedFormat)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (INT32)i, CompressedFormat, Width, Height, 0, (INT32)LevelSize,
+                                   Pixels);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, (INT32)i, GL_SRGB8_ALPHA8, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         Pixels);
+        }
+        Pixels += LevelSize;
+    }
+
+    if (GenerateMips)
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+}
+
+RENDER_HANDLE GlUseTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name)
 {
     UINT32 TextureHandle = 0;
     glGenTextures(1, &TextureHandle);
@@ -8,11 +109,9 @@ RENDER_HANDLE GlUseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name)
     glBindTexture(GL_TEXTURE_2D, TextureHandle);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, Texture->Width, Texture->Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, Texture->Pixels);
-    glGenerateMipmap(GL_TEXTURE_2D);
+    UploadTexture(Texture, MipCount);
 
     glObjectLabel(GL_TEXTURE, TextureHandle, (UINT32)strlen(Name), Name);
 
@@ -21,9 +120,18 @@ RENDER_HANDLE GlUseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name)
     return TextureHandle;
 }
 
+VOID GlUpdateTexture(_In_ RENDER_HANDLE Handle, _In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name)
+{
+    UNREFERENCED_PARAMETER(Name);
+
+    // Same texture name, so anything that has the handle sees the new image
+    glBindTexture(GL_TEXTURE_2D, (UINT32)Handle);
+    UploadTexture(Texture, MipCount);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 VOID GlReleaseTexture(_In_ RENDER_HANDLE Handle)
 {
     UINT32 Texture = (UINT32)Handle;
     glDeleteTextures(1, &Texture);
 }
-
@@ -1,13 +1,129 @@
 #include "engine/engine.h"
+#include "engine/asset/pack.h"
 
 #include "render.h"
 
 ecs_entity_t ecs_id(MODEL);
+ecs_entity_t ecs_id(RENDER_OBJECT_UNIFORM);
 ecs_entity_t ecs_id(RENDER_OBJECT_DATA);
 
 static RENDER_BACKEND Backend;
-static UINT32 LastWidth;
-static UINT32 LastHeight;
+static RENDER_TARGET_STATE TargetState;
+static UINT64 RenderThread; // the thread RdrInitialize ran on, the backends are only used on it
+
+static ENGINE_CONFIGVAR InInitVar = ENGINE_CONFIGVAR_BOOLEAN("ecs_in_init");
+static ENGINE_CONFIGVAR LoadsPerFrameVar = ENGINE_CONFIGVAR_INT("ast_loads_per_frame");
+static ENGINE_CONFIGVAR LodErrorVar = ENGINE_CONFIGVAR_FLOAT("rdr_lod_error");
+static ENGINE_CONFIGVAR TextureBudgetVar = ENGINE_CONFIGVAR_INT("rdr_texture_budget");
+static ENGINE_CONFIGVAR ScaleVar = ENGINE_CONFIGVAR_FLOAT("rdr_scale");
+static ENGINE_CONFIGVAR DynamicResolutionVar = ENGINE_CONFIGVAR_BOOLEAN("rdr_dynamic_resolution");
+static ENGINE_CONFIGVAR TargetFrameTimeVar = ENGINE_CONFIGVAR_FLOAT("rdr_target_frame_time");
+static ENGINE_CONFIGVAR MinScaleVar = ENGINE_CONFIGVAR_FLOAT("rdr_min_scale");
+
+/// @brief How many frames the dynamic resolution scale stays the same before it's looked at again, every change
+/// recreates the render targets so it can't happen every frame
+#define RENDER_DYNAMIC_RESOLUTION_INTERVAL 30
+
+/// @brief How much the dynamic resolution scale changes at a time
+#define RENDER_DYNAMIC_RESOLUTION_STEP 0.05f
+
+/// @brief The scale only goes back up once frames take less than this fraction of the target, so it doesn't bounce
+/// between two steps
+#define RENDER_DYNAMIC_RESOLUTION_HEADROOM 0.8f
+
+static FLOAT DynamicScale = 1.0f;
+static DOUBLE AverageFrameTime; // milliseconds between the start of RdrBeginFrame and the end of RdrEndFrame
+static DOUBLE AverageGpuFrameTime;
+static UINT64 FrameStart;
+static UINT32 FramesSinceScaleChange;
+
+/// @brief An asynchronous load waiting to be uploaded
+PURPL_MAKE_TAG(struct, RENDER_PENDING_LOAD, {
+    UINT64 Id;
+    ASSET_LOAD_TYPE Type;
+    RENDER_HANDLE Handle; // 0 if it was destroyed before the load finished
+    PCHAR Name;
+    PFN_RENDER_LOAD_CALLBACK Callback;
+    PVOID Context;
+})
+
+static PRENDER_PENDING_LOAD *PendingLoads;
+static BOOLEAN GpuIdle;
+
+static PMATERIAL *Materials;  // everything made by RdrCreateMaterial, so reloaded shaders can be swapped into them
+static PCHAR *ChangedShaders; // names of shaders whose files changed, reloaded once all the changes have been seen
+
+/// @brief A texture or mesh, shared by every load with the same name or contents
+PURPL_MAKE_TAG(struct, RENDER_CACHE_ENTRY, {
+    ASSET_LOAD_TYPE Type;
+    RENDER_HANDLE Handle;
+    UINT64 ContentHash; // 0 until the data has been loaded
+    UINT32 References;
+    BOOLEAN Loading; // still a placeholder, waiting on an asynchronous load
+    PCHAR *Names;    // every name that resolves to this entry, the first one is what it was loaded as
+})
+
+PURPL_MAKE_STRING_HASHMAP_ENTRY(RENDER_CACHE_MAP, PRENDER_CACHE_ENTRY);
+static PRENDER_CACHE_MAP CacheNames[AssetLoadTypeCount];
+static PRENDER_CACHE_ENTRY *CacheEntries;
+
+/// @brief Levels of detail of a mesh
+PURPL_MAKE_TAG(struct, RENDER_MESH_LODS, {
+    FLOAT Radius; // furthest vertex from the origin of the mesh
+    UINT32 Count;
+    ASSET_MESH_LOD Lods[ASSET_MAX_MESH_LODS];
+})
+
+/// @brief Levels of detail by mesh handle
+PURPL_MAKE_TAG(struct, RENDER_LOD_MAP, {
+    RENDER_HANDLE key;
+    RENDER_MESH_LODS value;
+})
+
+static PRENDER_LOD_MAP MeshLods;
+
+/// @brief A coarser level of detail has to be this much under the threshold before switching to it, so models on the
+/// edge don't flicker between two levels
+#define RENDER_LOD_HYSTERESIS 0.8f
+
+static vec3 LodCameraPosition;
+static FLOAT LodProjectionScale; // pixels per unit of size at a distance of 1, 0 for orthographic cameras
+
+/// @brief A texture whose resolution follows how big it gets on screen
+///
+/// Levels are the mips of the cooked texture, and the uploaded chain starts at one of them and goes to the end. The
+/// chain from the smallest starting level is kept in memory so the texture can always drop back to it without loading
+/// anything, and larger ones are read from the pack without decompressing the rest of the texture.
+PURPL_MAKE_TAG(struct, RENDER_STREAMED_TEXTURE, {
+    PCHAR Name;
+    ASSET_PATH Path; // what the levels are loaded from, points to Name
+    UINT32 Format;
+    UINT32 Width; // of level 0
+    UINT32 Height;
+    UINT32 MipCount;       // levels in the cooked texture
+    UINT32 Level;          // the first level uploaded now
+    UINT32 RequestedLevel; // what's being loaded, the same as Level when nothing is
+    UINT32 MinLevel;       // the first level of LowMip, the smallest one
+    UINT64 LoadId;
+    FLOAT Usage; // largest size on screen in pixels over the last frame, 0 if it wasn't drawn
+    UINT64 LastUsed;
+    PTEXTURE LowMip; // MinLevel and every level after it
+})
+
+/// @brief Streamed textures by handle
+PURPL_MAKE_TAG(struct, RENDER_STREAM_MAP, {
+    RENDER_HANDLE key;
+    RENDER_STREAMED_TEXTURE value;
+})
+
+static PRENDER_STREAM_MAP StreamedTextures;
+static UINT64 StreamFrame;
+
+/// @brief Textures this size or smaller aren't streamed, and it's the size of the level streamed ones start at
+#define RENDER_STREAM_MIN_SIZE 64
+
+/// @brief Most levels that get loaded at once
+#define RENDER_STREAM_MAX_LOADS 4
 
 #ifdef PURPL_DIRECTX
 extern VOID Dx12InitializeBackend(_Out_ PRENDER_BACKEND Backend);
@@ -52,6 +168,9 @@ static VOID SwrsInitializeBackend(_Out_ PRENDER_BACKEND Backend)
 VOID RdrDefineVariables(VOID)
 {
     CONFIGVAR_DEFINE_FLOAT("rdr_scale", 1.0f, FALSE, ConfigVarSideClientOnly, FALSE, FALSE);
+    CONFIGVAR_DEFINE_BOOLEAN("rdr_dynamic_resolution", FALSE, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_FLOAT("rdr_target_frame_time", 1000.0f / 60.0f, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_FLOAT("rdr_min_scale", 0.5f, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
 
 #ifdef PURPL_GDKX
     static CONST RENDER_API DefaultApi = RenderApiDirect3D12;
@@ -70,6 +189,9 @@ VOID RdrDefineVariables(VOID)
                              TRUE);
 
     CONFIGVAR_DEFINE_INT("rdr_clear_colour", 0x000000FF, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_BOOLEAN("rdr_packed_vertices", FALSE, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_FLOAT("rdr_lod_error", 1.0f, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
+    CONFIGVAR_DEFINE_INT("rdr_texture_budget", 256, FALSE, ConfigVarSideClientOnly, FALSE, TRUE);
 }
 
 PURPL_MAKE_STRING_HASHMAP_ENTRY(SHADERMAP, RENDER_HANDLE);
@@ -81,7 +203,7 @@ static VOID LoadShaders(VOID)
 
     if (Backend.LoadShader)
     {
-#define LOAD(Name) stbds_shput(RdrShaders, Name, Backend.LoadShader(Name))
+#define LOAD(Name) stbds_shput(RdrShaders, Name, Backend.LoadShader(Name, FALSE))
         //LOAD("main_lit");
         //LOAD("main_textured");
         LOAD("main_lit_textured");
@@ -89,12 +211,92 @@ static VOID LoadShaders(VOID)
     }
 }
 
+static VOID UpdateTargetState(VOID)
+{
+    UINT32 OutputWidth;
+    UINT32 OutputHeight;
+
+    VidGetSize(&OutputWidth, &OutputHeight);
+
+    FLOAT Scale = (FLOAT)ENGINE_CONFIGVAR_GET_FLOAT(ScaleVar) * DynamicScale;
+    UINT32 Width = PURPL_MAX((UINT32)(OutputWidth * Scale), 1);
+    UINT32 Height = PURPL_MAX((UINT32)(OutputHeight * Scale), 1);
+
+    TargetState.Resized = EngHasVideoResized() || Width != TargetState.Width || Height != TargetState.Height;
+    TargetState.OutputWidth = OutputWidth;
+    TargetState.OutputHeight = OutputHeight;
+    TargetState.Scale = Scale;
+    TargetState.Width = Width;
+    TargetState.Height = Height;
+}
+
+static VOID UpdateFrameStats(VOID)
+{
+    DOUBLE FrameTime = (DOUBLE)(PlatGetMilliseconds() - FrameStart);
+    AverageFrameTime = AverageFrameTime > 0.0 ? AverageFrameTime * 0.9 + FrameTime * 0.1 : FrameTime;
+
+    // Results come back a few frames late, and are 0 until the first ones do
+    DOUBLE GpuFrameTime = Backend.GetGpuFrameTime ? Backend.GetGpuFrameTime() : 0.0;
+    AverageGpuFrameTime = AverageGpuFrameTime > 0.0 ? AverageGpuFrameTime * 0.9 + GpuFrameTime * 0.1 : GpuFrameTime;
+}
+
+// Moves the dynamic resolution scale a step towards keeping frames under the target time
+static VOID UpdateDynamicScale(VOID)
+{
+    if (!ENGINE_CONFIGVAR_GET_BOOLEAN(DynamicResolutionVar))
+    {
+        if (DynamicScale != 1.0f)
+        {
+            LogDebug("Dynamic resolution disabled, going back to full scale");
+            DynamicScale = 1.0f;
+        }
+        return;
+    }
+
+    if (++FramesSinceScaleChange < RENDER_DYNAMIC_RESOLUTION_INTERVAL)
+    {
+        return;
+    }
+
+    DOUBLE Target = ENGINE_CONFIGVAR_GET_FLOAT(TargetFrameTimeVar);
+    FLOAT MinScale = glm_clamp((FLOAT)ENGINE_CONFIGVAR_GET_FLOAT(MinScaleVar), RENDER_DYNAMIC_RESOLUTION_STEP, 1.0f);
+    FLOAT Scale = DynamicScale;
+    if (AverageFrameTime > Target)
+    {
+        Scale -= RENDER_DYNAMIC_RESOLUTION_STEP;
+    }
+    else if (AverageFrameTime < Target * RENDER_DYNAMIC_RESOLUTION_HEADROOM)
+    {
+        Scale += RENDER_DYNAMIC_RESOLUTION_STEP;
+    }
+    Scale = glm_clamp(Scale, MinScale, 1.0f);
+
+    if (Scale != DynamicScale)
+    {
+        LogDebug("Average frame time %.2f ms against a target of %.2f ms, changing dynamic resolution scale from %.2f "
+                 "to %.2f",
+                 AverageFrameTime, Target, DynamicScale, Scale);
+        DynamicScale = Scale;
+        FramesSinceScaleChange = 0;
+    }
+    else
+    {
+        // Nothing to do, so look again next frame instead of waiting a whole interval
+        FramesSinceScaleChange = RENDER_DYNAMIC_RESOLUTION_INTERVAL;
+    }
+}
+
 VOID RdrInitialize(_In_ ecs_iter_t *Iterator)
 {
     UNREFERENCED_PARAMETER(Iterator);
 
     LogInfo("Initializing renderer using API %s", RdrGetApiName(CONFIGVAR_GET_INT("rdr_api")));
 
+    RenderThread = EngGetThreadId();
+
+    // Shaders and models both depend on this, so it can't change after this point
+    RdrInitializeVertexFormat();
+
     switch (CONFIGVAR_GET_INT("rdr_api"))
     {
     case RenderApiDirect3D12:
@@ -114,6 +316,9 @@ VOID RdrInitialize(_In_ ecs_iter_t *Iterator)
         CmnError("Unknown renderer %d", CONFIGVAR_GET_INT("rdr_api"));
     }
 
+    // The backends size their render targets from this
+    UpdateTargetState();
+
     if (Backend.Initialize)
     {
         Backend.Initialize();
@@ -128,16 +333,31 @@ VOID RdrInitialize(_In_ ecs_iter_t *Iterator)
 }
 ecs_entity_t ecs_id(RdrInitialize);
 
+static VOID UpdateStreaming(VOID);
+static VOID ReloadChangedAssets(VOID);
+
 VOID RdrBeginFrame(_In_ ecs_iter_t *Iterator)
 {
-    if (CONFIGVAR_GET_BOOLEAN("ecs_in_init"))
+    if (ENGINE_CONFIGVAR_GET_BOOLEAN(InInitVar))
     {
         return;
     }
 
     UNREFERENCED_PARAMETER(Iterator);
+    PURPL_ASSERT(EngGetThreadId() == RenderThread);
+    ENGINE_PROFILE_BEGIN("RdrBeginFrame");
+
+    FrameStart = PlatGetMilliseconds();
+    UpdateTargetState();
+
+    // Nothing is recorded yet, so this is where finished loads get swapped in
+    GpuIdle = FALSE;
+    ENGINE_PROFILE_BEGIN("Finish loads");
+    AstPumpLoads((UINT32)ENGINE_CONFIGVAR_GET_INT(LoadsPerFrameVar));
+    ENGINE_PROFILE_END();
+    ReloadChangedAssets();
+    UpdateStreaming();
 
-    BOOLEAN Resized = EngHasVideoResized() || RdrGetWidth() != LastWidth || RdrGetHeight() != LastHeight;
     PCCAMERA Camera = ecs_get(EcsGetWorld(), EngGetMainCamera(), CAMERA);
     PCPOSITION Position = ecs_get(EcsGetWorld(), EngGetMainCamera(), POSITION);
     RENDER_SCENE_UNIFORM Uniform = {0};
@@ -145,55 +365,173 @@ VOID RdrBeginFrame(_In_ ecs_iter_t *Iterator)
     glm_mat4_copy(Camera->View, Uniform.View);
     glm_mat4_copy(Camera->Projection, Uniform.Projection);
 
+    // Orthographic cameras don't make things smaller with distance, so they always get the full meshes
+    glm_vec3_copy(Position, LodCameraPosition);
+    LodProjectionScale = Camera->Perspective ? Camera->Projection[1][1] * TargetState.Height / 2.0f : 0.0f;
+
     if (Backend.BeginFrame)
     {
-        Backend.BeginFrame(Resized, &Uniform);
+        ENGINE_PROFILE_BEGIN("Backend BeginFrame");
+        Backend.BeginFrame(TargetState.Resized, &Uniform);
+        ENGINE_PROFILE_END();
     }
+
+    ENGINE_PROFILE_END();
 }
 ecs_entity_t ecs_id(RdrBeginFrame);
 
+// How many pixels a unit of the mesh's size covers at the point of its bounds closest to the camera
+static FLOAT GetPixelsPerUnit(_In_ PCRENDER_MESH_LODS Lods, _In_ mat4 Transform)
+{
+    vec3 Scale;
+    glm_decompose_scalev(Transform, Scale);
+    FLOAT MaxScale = glm_vec3_max(Scale);
+    FLOAT Distance = glm_vec3_distance(Transform[3], LodCameraPosition) - Lods->Radius * MaxScale;
+    Distance = PURPL_MAX(Distance, 0.001f);
+
+    return MaxScale / Distance * LodProjectionScale;
+}
+
+static VOID SelectLod(_Inout_ PMODEL Model, _In_opt_ PCRENDER_MESH_LODS Lods, _In_ FLOAT PixelsPerUnit)
+{
+    if (!Lods || Lods->Count < 2 || PixelsPerUnit <= 0.0f)
+    {
+        Model->Lod = 0;
+        Model->FirstIndex = 0;
+        Model->IndexCount = 0;
+        return;
+    }
+
+    // Project each level's error onto the screen, and take the coarsest one that stays under the threshold
+    FLOAT Threshold = (FLOAT)ENGINE_CONFIGVAR_GET_FLOAT(LodErrorVar);
+    UINT32 Lod = 0;
+    for (UINT32 i = 1; i < Lods->Count; i++)
+    {
+        FLOAT Error = Lods->Lods[i].Error * PixelsPerUnit;
+        if (Error > (i > Model->Lod ? Threshold * RENDER_LOD_HYSTERESIS : Threshold))
+        {
+            break;
+        }
+        Lod = i;
+    }
+
+    Model->Lod = Lod;
+    Model->FirstIndex = (UINT32)(Lods->Lods[Lod].IndexOffset * 3);
+    Model->IndexCount = (UINT32)(Lods->Lods[Lod].IndexCount * 3);
+}
+
+static VOID NoteTextureUsage(_In_ RENDER_HANDLE Handle, _In_ FLOAT Usage)
+{
+    PRENDER_STREAM_MAP Entry = stbds_hmgetp_null(StreamedTextures, Handle);
+    if (Entry)
+    {
+        Entry->value.Usage = PURPL_MAX(Entry->value.Usage, Usage);
+        Entry->value.LastUsed = StreamFrame;
+    }
+}
+
+// Runs on any ECS thread, so it only writes the entity's own components, and only reads what doesn't change until the
+// next RdrBeginFrame
+VOID RdrExtractModel(_In_ ecs_iter_t *Iterator)
+{
+    if (ENGINE_CONFIGVAR_GET_BOOLEAN(InInitVar))
+    {
+        return;
+    }
+
+    ENGINE_PROFILE_BEGIN("RdrExtractModel");
+
+    PMODEL Model = ecs_field(Iterator, MODEL, 1);
+    PRENDER_OBJECT_UNIFORM Uniform = ecs_field(Iterator, RENDER_OBJECT_UNIFORM, 2);
+    PCWORLD_TRANSFORM Transform = ecs_field(Iterator, WORLD_TRANSFORM, 3);
+
+    for (INT32 i = 0; i < Iterator->count; i++)
+    {
+        if (Transform)
+        {
+            glm_mat4_copy((vec4 *)Transform[i].Value, Uniform[i].Model);
+        }
+        else
+        {
+            glm_mat4_identity(Uniform[i].Model);
+        }
+
+        // The plain lookup stores its result in the map, this one doesn't
+        ptrdiff_t LodIndex;
+        stbds_hmgeti_ts(MeshLods, Model[i].MeshHandle, LodIndex);
+        PCRENDER_MESH_LODS Lods = LodIndex >= 0 ? &MeshLods[LodIndex].value : NULL;
+        FLOAT PixelsPerUnit = Lods && LodProjectionScale > 0.0f ? GetPixelsPerUnit(Lods, Uniform[i].Model) : 0.0f;
+        SelectLod(&Model[i], Lods, PixelsPerUnit);
+
+        // Meshes that are still loading don't say anything about how big their textures need to be
+        if (Lods)
+        {
+            Model[i].TextureUsage = LodProjectionScale > 0.0f ? Lods->Radius * 2.0f * PixelsPerUnit : FLT_MAX;
+        }
+        else
+        {
+            Model[i].TextureUsage = 0.0f;
+        }
+    }
+
+    ENGINE_PROFILE_END();
+}
+ecs_entity_t ecs_id(RdrExtractModel);
+
 VOID RdrDrawModel(_In_ ecs_iter_t *Iterator)
 {
-    if (CONFIGVAR_GET_BOOLEAN("ecs_in_init"))
+    if (ENGINE_CONFIGVAR_GET_BOOLEAN(InInitVar))
     {
         return;
     }
 
+    PURPL_ASSERT(EngGetThreadId() == RenderThread);
+    ENGINE_PROFILE_BEGIN("RdrDrawModel");
+
     PRENDER_OBJECT_DATA ObjectData = ecs_field(Iterator, RENDER_OBJECT_DATA, 1);
     PMODEL Model = ecs_field(Iterator, MODEL, 2);
+    PRENDER_OBJECT_UNIFORM Uniform = ecs_field(Iterator, RENDER_OBJECT_UNIFORM, 3);
 
     if (Backend.DrawModel)
     {
         for (INT32 i = 0; i < Iterator->count; i++)
         {
-            RENDER_OBJECT_UNIFORM Uniform = {0};
-            PCPOSITION Position = ecs_get(Iterator->world, Iterator->entities[i], POSITION);
-            PCROTATION Rotation = ecs_get(Iterator->world, Iterator->entities[i], ROTATION);
-            PCSCALE Scale = ecs_get(Iterator->world, Iterator->entities[i], SCALE);
-            MthCreateTransformMatrix(Position ? Position->Value : NULL, Rotation ? Rotation->Value : NULL,
-                                     Scale ? Scale->Value : NULL, Uniform.Model);
-            Backend.DrawModel(&Model[i], &Uniform, &ObjectData[i]);
+            // Models can share a texture, so this is done here instead of in RdrExtractModel
+            if (Model[i].TextureUsage > 0.0f && Model[i].Material)
+            {
+                NoteTextureUsage(Model[i].Material->TextureHandle, Model[i].TextureUsage);
+            }
+
+            Backend.DrawModel(&Model[i], &Uniform[i], &ObjectData[i]);
         }
     }
+
+    ENGINE_PROFILE_END();
 }
 ecs_entity_t ecs_id(RdrDrawModel);
 
 VOID RdrEndFrame(_In_ ecs_iter_t *Iterator)
 {
-    if (CONFIGVAR_GET_BOOLEAN("ecs_in_init"))
+    if (ENGINE_CONFIGVAR_GET_BOOLEAN(InInitVar))
     {
         return;
     }
 
     UNREFERENCED_PARAMETER(Iterator);
+    PURPL_ASSERT(EngGetThreadId() == RenderThread);
+    ENGINE_PROFILE_BEGIN("RdrEndFrame");
 
     if (Backend.EndFrame)
     {
+        ENGINE_PROFILE_BEGIN("Backend EndFrame");
         Backend.EndFrame();
+        ENGINE_PROFILE_END();
     }
 
-    LastWidth = RdrGetWidth();
-    LastHeight = RdrGetHeight();
+    UpdateFrameStats();
+    UpdateDynamicScale();
+
+    ENGINE_PROFILE_END();
 }
 ecs_entity_t ecs_id(RdrEndFrame);
 
@@ -222,7 +560,21 @@ VOID RdrFinishRendering(VOID)
 
 VOID RdrShutdown(VOID)
 {
+    if (stbds_arrlenu(CacheEntries))
+    {
+        LogWarning("%zu textures and meshes were never released", stbds_arrlenu(CacheEntries));
+    }
+
     DestroyShaders();
+    stbds_hmfree(MeshLods);
+
+    for (SIZE_T i = 0; i < stbds_hmlenu(StreamedTextures); i++)
+    {
+        CmnFree(StreamedTextures[i].value.Name);
+        CmnFree(StreamedTextures[i].value.LowMip);
+    }
+    stbds_hmfree(StreamedTextures);
+    stbds_arrfree(Materials);
 
     if (Backend.Shutdown)
     {
@@ -237,32 +589,741 @@ VOID RenderImport(_In_ ecs_world_t *World)
     ECS_MODULE(World, Render);
 
     ECS_COMPONENT_DEFINE(World, MODEL);
+    ECS_COMPONENT_DEFINE(World, RENDER_OBJECT_UNIFORM);
     ECS_COMPONENT_DEFINE(World, RENDER_OBJECT_DATA);
 
+    ecs_add_pair(World, ecs_id(MODEL), EcsWith, ecs_id(RENDER_OBJECT_UNIFORM));
+
+    // Handles register themselves the first time they're read, which can't happen on another thread
+    EngResolveConfigVar(&InInitVar);
+    EngResolveConfigVar(&LodErrorVar);
+
     ECS_SYSTEM_DEFINE(World, RdrInitialize, EcsOnStart);
-    ECS_SYSTEM_DEFINE(World, RdrBeginFrame, EcsPreUpdate);
-    ECS_SYSTEM_DEFINE(World, RdrDrawModel, EcsOnUpdate, RENDER_OBJECT_DATA, MODEL);
-    ECS_SYSTEM_DEFINE(World, RdrEndFrame, EcsPostUpdate);
+    ECS_SYSTEM_DEFINE_EX(World, RdrBeginFrame, EcsPreUpdate, FALSE, 0);
+    // After EcsUpdateTransforms, so models are drawn where they are this frame
+    ECS_SYSTEM_DEFINE_EX(World, RdrExtractModel, EcsPostUpdate, TRUE, 0, MODEL, [out] RENDER_OBJECT_UNIFORM,
+                         [in] ?WORLD_TRANSFORM);
+    ECS_SYSTEM_DEFINE_EX(World, RdrDrawModel, EcsPostUpdate, FALSE, 0, RENDER_OBJECT_DATA, [in] MODEL,
+                         [in] RENDER_OBJECT_UNIFORM);
+    ECS_SYSTEM_DEFINE_EX(World, RdrEndFrame, EcsPostUpdate, FALSE, 0);
 }
 
-RENDER_HANDLE RdrLoadTexture(_In_z_ PCSTR Name)
+static PRENDER_CACHE_ENTRY CacheFind(_In_ ASSET_LOAD_TYPE Type, _In_z_ PCSTR Name)
+{
+    return stbds_shget(CacheNames[Type], Name);
+}
+
+static PRENDER_CACHE_ENTRY CacheFindContent(_In_ ASSET_LOAD_TYPE Type, _In_ UINT64 ContentHash)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(CacheEntries); i++)
+    {
+        if (CacheEntries[i]->Type == Type && CacheEntries[i]->ContentHash == ContentHash)
+        {
+            return CacheEntries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static PRENDER_CACHE_ENTRY CacheFindHandle(_In_ ASSET_LOAD_TYPE Type, _In_ RENDER_HANDLE Handle)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(CacheEntries); i++)
+    {
+        if (CacheEntries[i]->Type == Type && CacheEntries[i]->Handle == Handle)
+        {
+            return CacheEntries[i];
+        }
+    }
+
+    return NULL;
+}
+
+static VOID CacheAddName(_Inout_ PRENDER_CACHE_ENTRY Entry, _In_z_ PCSTR Name)
+{
+    // The copy is the key, so it has to live as long as the entry
+    PCHAR Key = CmnDuplicateString(Name, 0);
+    stbds_arrpush(Entry->Names, Key);
+    stbds_shput(CacheNames[Entry->Type], Key, Entry);
+}
+
+static PRENDER_CACHE_ENTRY CacheAdd(_In_ ASSET_LOAD_TYPE Type, _In_z_ PCSTR Name, _In_ RENDER_HANDLE Handle,
+                                    _In_ UINT64 ContentHash, _In_ BOOLEAN Loading)
+{
+    PRENDER_CACHE_ENTRY Entry = CmnAllocType(1, RENDER_CACHE_ENTRY);
+    if (!Entry)
+    {
+        CmnError("Failed to allocate cache entry for %s: %s", Name, strerror(errno));
+    }
+
+    Entry->Type = Type;
+    Entry->Handle = Handle;
+    Entry->ContentHash = ContentHash;
+    Entry->References = 1;
+    Entry->Loading = Loading;
+    CacheAddName(Entry, Name);
+    stbds_arrpush(CacheEntries, Entry);
+
+    return Entry;
+}
+
+// Returns TRUE if that was the last reference and the caller should destroy the handle
+static BOOLEAN CacheRelease(_In_ ASSET_LOAD_TYPE Type, _In_ RENDER_HANDLE Handle)
+{
+    PRENDER_CACHE_ENTRY Entry = CacheFindHandle(Type, Handle);
+    if (!Entry)
+    {
+        return TRUE;
+    }
+
+    if (--Entry->References > 0)
+    {
+        return FALSE;
+    }
+
+    LogDebug("Evicting %s from the cache", Entry->Names[0]);
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(CacheEntries); i++)
+    {
+        if (CacheEntries[i] == Entry)
+        {
+            stbds_arrdelswap(CacheEntries, i);
+            break;
+        }
+    }
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(Entry->Names); i++)
+    {
+        stbds_shdel(CacheNames[Type], Entry->Names[i]);
+        CmnFree(Entry->Names[i]);
+    }
+    stbds_arrfree(Entry->Names);
+    CmnFree(Entry);
+
+    return TRUE;
+}
+
+// Block compressed textures get decoded for backends that can't sample them, returns NULL if nothing was decoded
+static PTEXTURE DecodeTexture(_In_z_ PCSTR Name, _In_ PCTEXTURE Texture)
+{
+    if (!AstIsBlockCompressed(Texture->Format) ||
+        (Backend.SupportsTextureFormat && Backend.SupportsTextureFormat(Texture->Format)))
+    {
+        return NULL;
+    }
+
+    LogDebug("Decoding texture %s on the CPU", Name);
+    return AstDecodeTexture(Texture);
+}
+
+// Anything replaced could still be in use by frames in flight, but that only needs to be waited for once a frame
+static VOID WaitForGpu(VOID)
+{
+    if (!GpuIdle)
+    {
+        ENGINE_PROFILE_BEGIN("Wait for GPU");
+        RdrFinishRendering();
+        ENGINE_PROFILE_END();
+        GpuIdle = TRUE;
+    }
+}
+
+// Anything frames in flight might use has to be waited for before a texture is replaced, unless the backend does it
+static VOID WaitForTextureRelease(VOID)
+{
+    if (!Backend.DefersTextureRelease)
+    {
+        WaitForGpu();
+    }
+}
+
+// Everything uploaded when the chain starts at the given level, which is what counts against the budget
+static UINT64 GetLevelSize(_In_ PCRENDER_STREAMED_TEXTURE Texture, _In_ UINT32 Level)
+{
+    UINT64 Size = 0;
+    for (UINT32 i = Level; i < Texture->MipCount; i++)
+    {
+        Size += AstGetTextureLevelSize(Texture->Format, Texture->Width, Texture->Height, i);
+    }
+
+    return Size;
+}
+
+// Copies the chain starting at the level a texture would start streaming from, or returns NULL if it can't be streamed.
+// Only cooked textures with mips can be, since that's where the levels come from.
+static PTEXTURE CreateLowMip(_In_ PCTEXTURE Texture, _In_ UINT32 MipCount, _Out_ PUINT32 MinLevel)
+{
+    *MinLevel = 0;
+    if (!Backend.UpdateTexture || MipCount < 2)
+    {
+        return NULL;
+    }
+
+    UINT32 Size = PURPL_MAX(Texture->Width, Texture->Height);
+    while ((Size >> *MinLevel) > RENDER_STREAM_MIN_SIZE && *MinLevel < MipCount - 1)
+    {
+        (*MinLevel)++;
+    }
+    if (!*MinLevel)
+    {
+        return NULL;
+    }
+
+    UINT64 Offset = 0;
+    UINT64 PixelsSize = 0;
+    for (UINT32 i = 0; i < MipCount; i++)
+    {
+        UINT64 LevelSize = AstGetTextureLevelSize(Texture->Format, Texture->Width, Texture->Height, i);
+        if (i < *MinLevel)
+        {
+            Offset += LevelSize;
+        }
+        else
+        {
+            PixelsSize += LevelSize;
+        }
+    }
+
+    PTEXTURE LowMip = CmnAlloc(sizeof(TEXTURE) + PixelsSize, 1);
+    if (!LowMip)
+    {
+        CmnError("Failed to allocate %llu bytes for smallest levels of texture: %s", sizeof(TEXTURE) + PixelsSize,
+                 strerror(errno));
+    }
+
+    *LowMip = *Texture;
+    LowMip->Width = PURPL_MAX(Texture->Width >> *MinLevel, 1);
+    LowMip->Height = PURPL_MAX(Texture->Height >> *MinLevel, 1);
+    LowMip->Pixels = LowMip + 1;
+    memcpy(LowMip->Pixels, (CONST BYTE *)Texture->Pixels + Offset, PixelsSize);
+
+    return LowMip;
+}
+
+static VOID AddStreamedTexture(_In_ RENDER_HANDLE Handle, _In_z_ PCSTR Name, _In_ PCTEXTURE Texture,
+                               _In_ UINT32 MipCount, _In_ PTEXTURE LowMip, _In_ UINT32 MinLevel)
 {
-    PTEXTURE Texture = LoadTexture(EngGetAssetPath(EngAssetDirectoryTextures, Name));
+    RENDER_STREAMED_TEXTURE Streamed = {0};
+    Streamed.Name = CmnDuplicateString(Name, 0);
+    EngMakeAssetPath(EngAssetDirectoryTextures, Streamed.Name, &Streamed.Path);
+    Streamed.Format = Texture->Format;
+    Streamed.Width = Texture->Width;
+    Streamed.Height = Texture->Height;
+    Streamed.MipCount = MipCount;
+    Streamed.Level = MinLevel;
+    Streamed.RequestedLevel = MinLevel;
+    Streamed.MinLevel = MinLevel;
+    Streamed.LastUsed = StreamFrame;
+    Streamed.LowMip = LowMip;
+    stbds_hmput(StreamedTextures, Handle, Streamed);
+
+    LogDebug("Streaming texture %s, starting at %ux%u", Name, LowMip->Width, LowMip->Height);
+}
+
+static VOID RemoveStreamedTexture(_In_ RENDER_HANDLE Handle)
+{
+    PRENDER_STREAM_MAP Entry = stbds_hmgetp_null(StreamedTextures, Handle);
+    if (!Entry)
+    {
+        return;
+    }
+
+    if (Entry->value.LoadId)
+    {
+        AstCancelLoad(Entry->value.LoadId);
+    }
+    CmnFree(Entry->value.Name);
+    CmnFree(Entry->value.LowMip);
+    stbds_hmdel(StreamedTextures, Handle);
+}
+
+static VOID FinishStream(_In_ PASSET_LOAD_REQUEST Request, _In_opt_ PVOID Context)
+{
+    // The texture could've been destroyed, or even replaced by another one at the same address
+    RENDER_HANDLE Handle = (RENDER_HANDLE)(SIZE_T)Context;
+    PRENDER_STREAM_MAP Entry = stbds_hmgetp_null(StreamedTextures, Handle);
+    if (!Entry || Entry->value.LoadId != Request->Id)
+    {
+        return;
+    }
+
+    PRENDER_STREAMED_TEXTURE Streamed = &Entry->value;
+    Streamed->LoadId = 0;
+    if (Request->Status != AssetLoadStatusSucceeded)
+    {
+        Streamed->RequestedLevel = Streamed->Level;
+        return;
+    }
+
+    // The levels come back as a texture whose full size is the first one
+    PCTEXTURE Texture = &Request->Texture;
+    UINT32 MipCount = AstGetTextureMipCount(&Request->View);
+    if (Texture->Format != Streamed->Format ||
+        Texture->Width != PURPL_MAX(Streamed->Width >> Streamed->RequestedLevel, 1) ||
+        Texture->Height != PURPL_MAX(Streamed->Height >> Streamed->RequestedLevel, 1) ||
+        MipCount != Streamed->MipCount - Streamed->RequestedLevel)
+    {
+        LogWarning("Texture %s changed while it was streamed, keeping the level it has", Streamed->Name);
+        Streamed->RequestedLevel = Streamed->Level;
+        return;
+    }
+
+    LogTrace("Streaming in level %u of %s", Streamed->RequestedLevel, Streamed->Name);
+    WaitForTextureRelease();
+    ENGINE_PROFILE_BEGIN("Stream texture");
+    Backend.UpdateTexture(Handle, &Request->Texture, MipCount, Streamed->Name);
+    ENGINE_PROFILE_END();
+    Streamed->Level = Streamed->RequestedLevel;
+}
+
+// The finest level worth having for how big the texture was on screen
+static UINT32 GetWantedLevel(_In_ PCRENDER_STREAMED_TEXTURE Texture)
+{
+    if (Texture->Usage <= 0.0f)
+    {
+        return Texture->MinLevel;
+    }
+
+    UINT32 Size = PURPL_MAX(Texture->Width, Texture->Height);
+    UINT32 Level = 0;
+    while (Level < Texture->MinLevel && (FLOAT)(Size >> (Level + 1)) >= Texture->Usage)
+    {
+        Level++;
+    }
+
+    return Level;
+}
+
+// Drops the least used textures to their smallest level until enough is freed, only taking ones used less than Usage
+static UINT64 EvictTextures(_In_ UINT64 Needed, _In_ FLOAT Usage, _In_opt_ PCRENDER_STREAMED_TEXTURE Except)
+{
+    UINT64 Freed = 0;
+    while (Freed < Needed)
+    {
+        PRENDER_STREAM_MAP Victim = NULL;
+        for (SIZE_T i = 0; i < stbds_hmlenu(StreamedTextures); i++)
+        {
+            PRENDER_STREAM_MAP Entry = &StreamedTextures[i];
+            PCRENDER_STREAMED_TEXTURE Streamed = &Entry->value;
+            if (Streamed == Except || Streamed->LoadId || Streamed->Level >= Streamed->MinLevel ||
+                Streamed->Usage >= Usage)
+            {
+                continue;
+            }
+
+            // Whatever went unseen the longest goes first, then whatever's smallest on screen
+            if (!Victim || Streamed->LastUsed < Victim->value.LastUsed ||
+                (Streamed->LastUsed == Victim->value.LastUsed && Streamed->Usage < Victim->value.Usage))
+            {
+                Victim = Entry;
+            }
+        }
+
+        if (!Victim)
+        {
+            break;
+        }
+
+        PRENDER_STREAMED_TEXTURE Streamed = &Victim->value;
+        LogTrace("Evicting %s down to level %u", Streamed->Name, Streamed->MinLevel);
+        Freed += GetLevelSize(Streamed, Streamed->Level) - GetLevelSize(Streamed, Streamed->MinLevel);
+        WaitForTextureRelease();
+        Backend.UpdateTexture(Victim->key, Streamed->LowMip, Streamed->MipCount - Streamed->MinLevel, Streamed->Name);
+        Streamed->Level = Streamed->MinLevel;
+        Streamed->RequestedLevel = Streamed->MinLevel;
+    }
+
+    return Freed;
+}
+
+static INT CompareStreamUsage(_In_ CONST VOID *A, _In_ CONST VOID *B)
+{
+    FLOAT UsageA = (*(CONST PRENDER_STREAM_MAP *)A)->value.Usage;
+    FLOAT UsageB = (*(CONST PRENDER_STREAM_MAP *)B)->value.Usage;
+    return (UsageA < UsageB) - (UsageA > UsageB);
+}
+
+// Called at the start of a frame with the usage from the last one, loads the levels that were needed and makes room for
+// them under the budget
+static VOID UpdateStreaming(VOID)
+{
+    UINT64 Budget = (UINT64)PURPL_MAX(ENGINE_CONFIGVAR_GET_INT(TextureBudgetVar), 0) * 1024 * 1024;
+
+    // Levels being loaded count as if they were already there
+    UINT64 Used = 0;
+    UINT32 Loading = 0;
+    PRENDER_STREAM_MAP *Wanted = NULL;
+    for (SIZE_T i = 0; i < stbds_hmlenu(StreamedTextures); i++)
+    {
+        PRENDER_STREAMED_TEXTURE Streamed = &StreamedTextures[i].value;
+        Used += GetLevelSize(Streamed, PURPL_MIN(Streamed->Level, Streamed->RequestedLevel));
+        if (Streamed->LoadId)
+        {
+            Loading++;
+        }
+        else if (GetWantedLevel(Streamed) < Streamed->Level)
+        {
+            stbds_arrpush(Wanted, &StreamedTextures[i]);
+        }
+    }
+
+    if (Budget && Used > Budget)
+    {
+        Used -= EvictTextures(Used - Budget, FLT_MAX, NULL);
+    }
 
-    if (Texture && Backend.UseTexture)
+    // The biggest ones on screen are the most noticeable, so they go first
+    if (stbds_arrlenu(Wanted))
     {
-        RENDER_HANDLE Handle = Backend.UseTexture(Texture, Name);
-        CmnFree(Texture); // Not needed anymore, should be uploaded to the GPU
+        qsort(Wanted, stbds_arrlenu(Wanted), sizeof(PRENDER_STREAM_MAP), CompareStreamUsage);
+    }
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(Wanted) && Loading < RENDER_STREAM_MAX_LOADS; i++)
+    {
+        PRENDER_STREAMED_TEXTURE Streamed = &Wanted[i]->value;
+        UINT64 Current = GetLevelSize(Streamed, Streamed->Level);
+
+        // If the level it wants doesn't fit, a coarser one that's still better than what it has might
+        UINT32 Level = GetWantedLevel(Streamed);
+        for (; Level < Streamed->Level; Level++)
+        {
+            UINT64 Cost = GetLevelSize(Streamed, Level) - Current;
+            if (Budget && Used + Cost > Budget)
+            {
+                Used -= EvictTextures(Used + Cost - Budget, Streamed->Usage, Streamed);
+            }
+            if (!Budget || Used + Cost <= Budget)
+            {
+                Used += Cost;
+                break;
+            }
+        }
+
+        if (Level < Streamed->Level)
+        {
+            Streamed->RequestedLevel = Level;
+            Streamed->LoadId = AstQueueTextureLevelLoad(&Streamed->Path, Level, AssetLoadPriorityNormal, FinishStream,
+                                                        (PVOID)(SIZE_T)Wanted[i]->key);
+            Loading++;
+        }
+    }
+    stbds_arrfree(Wanted);
+
+    for (SIZE_T i = 0; i < stbds_hmlenu(StreamedTextures); i++)
+    {
+        StreamedTextures[i].value.Usage = 0.0f;
+    }
+    StreamFrame++;
+}
+
+static RENDER_HANDLE UploadTexture(_In_z_ PCSTR Name, _In_ PTEXTURE Texture, _Inout_ PASSET_VIEW View)
+{
+    PTEXTURE Decoded = DecodeTexture(Name, Texture);
+    if (Backend.UseTexture)
+    {
+        // Uploaded straight from the view, which is usually the pack mapping, unless it's streamed and only the
+        // smallest levels are needed
+        PTEXTURE Source = Decoded ? Decoded : Texture;
+        UINT32 MipCount = Decoded ? 1 : AstGetTextureMipCount(View);
+        UINT32 MinLevel;
+        PTEXTURE LowMip = CreateLowMip(Source, MipCount, &MinLevel);
+        ENGINE_PROFILE_BEGIN("Upload texture");
+        RENDER_HANDLE Handle = Backend.UseTexture(LowMip ? LowMip : Source, MipCount - MinLevel, Name);
+        ENGINE_PROFILE_END();
+        if (LowMip)
+        {
+            AddStreamedTexture(Handle, Name, Source, MipCount, LowMip, MinLevel);
+        }
+        if (Decoded)
+        {
+            CmnFree(Decoded);
+        }
+        AstCloseView(View);
         return Handle;
     }
+    else if (Decoded)
+    {
+        // Laid out like a loaded texture, so it's freed the same way
+        AstCloseView(View);
+        return (RENDER_HANDLE)Decoded;
+    }
+    else if (View->Allocation)
+    {
+        return (RENDER_HANDLE)View->Allocation;
+    }
     else
     {
-        return (RENDER_HANDLE)Texture;
+        // The backend keeps the texture on the CPU, the pixels stay in the mapping
+        PTEXTURE Copy = CmnAllocType(1, TEXTURE);
+        if (!Copy)
+        {
+            CmnError("Failed to allocate texture %s: %s", Name, strerror(errno));
+        }
+        *Copy = *Texture;
+        return (RENDER_HANDLE)Copy;
+    }
+}
+
+RENDER_HANDLE RdrLoadTexture(_In_z_ PCSTR Name)
+{
+    PRENDER_CACHE_ENTRY Entry = CacheFind(AssetLoadTypeTexture, Name);
+    if (Entry)
+    {
+        Entry->References++;
+        return Entry->Handle;
+    }
+
+    ASSET_PATH Path;
+    EngMakeAssetPath(EngAssetDirectoryTextures, Name, &Path);
+
+    TEXTURE Texture = {0};
+    ASSET_VIEW View = {0};
+    if (!AstLoadTexture(&Path, &Texture, &View))
+    {
+        return 0;
+    }
+
+    UINT64 ContentHash = AstHashTexture(&Texture);
+    Entry = CacheFindContent(AssetLoadTypeTexture, ContentHash);
+    if (Entry)
+    {
+        LogDebug("Texture %s is identical to %s, sharing it", Name, Entry->Names[0]);
+        AstCloseView(&View);
+        CacheAddName(Entry, Name);
+        Entry->References++;
+        return Entry->Handle;
+    }
+
+    RENDER_HANDLE Handle = UploadTexture(Name, &Texture, &View);
+    CacheAdd(AssetLoadTypeTexture, Name, Handle, ContentHash, FALSE);
+    return Handle;
+}
+
+static VOID FinishWaiters(_In_ ASSET_LOAD_TYPE Type, _In_ RENDER_HANDLE Handle, _In_ ASSET_LOAD_STATUS Status)
+{
+    for (SIZE_T i = stbds_arrlenu(PendingLoads); i-- > 0;)
+    {
+        PRENDER_PENDING_LOAD Waiter = PendingLoads[i];
+        if (!Waiter->Id && Waiter->Type == Type && Waiter->Handle == Handle)
+        {
+            stbds_arrdelswap(PendingLoads, i);
+            if (Waiter->Callback)
+            {
+                Waiter->Callback(Handle, Status, Waiter->Context);
+            }
+            CmnFree(Waiter->Name);
+            CmnFree(Waiter);
+        }
+    }
+}
+
+// The other levels of detail come after the full mesh in the same index buffer, so they get uploaded with it
+static VOID PrepareMeshLods(_Inout_ PMESH Mesh, _In_ PCASSET_VIEW View, _Out_ PRENDER_MESH_LODS Lods)
+{
+    Lods->Count = AstGetMeshLods(Mesh, View, Lods->Lods);
+    Mesh->IndexCount = Lods->Lods[Lods->Count - 1].IndexOffset + Lods->Lods[Lods->Count - 1].IndexCount;
+
+    Lods->Radius = 0.0f;
+    for (SIZE_T i = 0; i < Mesh->VertexCount; i++)
+    {
+        Lods->Radius = PURPL_MAX(Lods->Radius, glm_vec3_norm(Mesh->Vertices[i].Position));
+    }
+}
+
+static VOID FinishLoad(_In_ PASSET_LOAD_REQUEST Request, _In_opt_ PVOID Context)
+{
+    PRENDER_PENDING_LOAD Load = Context;
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(PendingLoads); i++)
+    {
+        if (PendingLoads[i] == Load)
+        {
+            stbds_arrdelswap(PendingLoads, i);
+            break;
+        }
+    }
+
+    if (Load->Handle)
+    {
+        PRENDER_CACHE_ENTRY Entry = CacheFindHandle(Load->Type, Load->Handle);
+        if (Entry)
+        {
+            Entry->Loading = FALSE;
+            Entry->ContentHash = Request->ContentHash;
+        }
+    }
+
+    if (Load->Handle && Request->Status == AssetLoadStatusSucceeded)
+    {
+        LogDebug("Uploading %s", Load->Name);
+        switch (Load->Type)
+        {
+        case AssetLoadTypeTexture: {
+            PTEXTURE Decoded = DecodeTexture(Load->Name, &Request->Texture);
+            PTEXTURE Source = Decoded ? Decoded : &Request->Texture;
+            UINT32 MipCount = Decoded ? 1 : AstGetTextureMipCount(&Request->View);
+            UINT32 MinLevel;
+            PTEXTURE LowMip = CreateLowMip(Source, MipCount, &MinLevel);
+            RemoveStreamedTexture(Load->Handle); // reloaded textures start streaming over
+            WaitForTextureRelease();
+            ENGINE_PROFILE_BEGIN("Upload texture");
+            Backend.UpdateTexture(Load->Handle, LowMip ? LowMip : Source, MipCount - MinLevel, Load->Name);
+            ENGINE_PROFILE_END();
+            if (LowMip)
+            {
+                AddStreamedTexture(Load->Handle, Load->Name, Source, MipCount, LowMip, MinLevel);
+            }
+            if (Decoded)
+            {
+                CmnFree(Decoded);
+            }
+            break;
+        }
+        case AssetLoadTypeMesh: {
+            MODEL Model = {0};
+            RENDER_MESH_LODS Lods;
+            Model.MeshHandle = Load->Handle;
+            PrepareMeshLods(&Request->Mesh, &Request->View, &Lods);
+            WaitForGpu();
+            ENGINE_PROFILE_BEGIN("Upload mesh");
+            Backend.UpdateModel(Load->Name, &Model, &Request->Mesh);
+            ENGINE_PROFILE_END();
+            stbds_hmput(MeshLods, Load->Handle, Lods);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (Load->Callback)
+    {
+        Load->Callback(Load->Handle, Request->Status, Load->Context);
+    }
+    if (Load->Handle)
+    {
+        FinishWaiters(Load->Type, Load->Handle, Request->Status);
+    }
+
+    CmnFree(Load->Name);
+    CmnFree(Load);
+}
+
+static PRENDER_PENDING_LOAD AddPendingLoad(_In_ ASSET_LOAD_TYPE Type, _In_z_ PCSTR Name, _In_ RENDER_HANDLE Handle,
+                                           _In_opt_ PFN_RENDER_LOAD_CALLBACK Callback, _In_opt_ PVOID Context)
+{
+    PRENDER_PENDING_LOAD Load = CmnAllocType(1, RENDER_PENDING_LOAD);
+    if (!Load)
+    {
+        CmnError("Failed to allocate pending load for %s: %s", Name, strerror(errno));
+    }
+
+    Load->Type = Type;
+    Load->Handle = Handle;
+    Load->Name = CmnDuplicateString(Name, 0);
+    Load->Callback = Callback;
+    Load->Context = Context;
+    stbds_arrpush(PendingLoads, Load);
+
+    return Load;
+}
+
+static UINT64 QueueLoad(_In_ ASSET_LOAD_TYPE Type, _In_z_ PCSTR Name, _In_ RENDER_HANDLE Handle,
+                        _In_ ASSET_LOAD_PRIORITY Priority, _In_opt_ PFN_RENDER_LOAD_CALLBACK Callback,
+                        _In_opt_ PVOID Context)
+{
+    ASSET_PATH Path;
+    EngMakeAssetPath(Type == AssetLoadTypeTexture ? EngAssetDirectoryTextures : EngAssetDirectoryModels, Name, &Path);
+
+    PRENDER_PENDING_LOAD Load = AddPendingLoad(Type, Name, Handle, Callback, Context);
+    Load->Id = AstQueueLoad(Type, &Path, Priority, FinishLoad, Load);
+    return Load->Id;
+}
+
+// Another request for something that's already loading, its callback is called when the first one finishes
+static VOID WaitForLoad(_In_ PRENDER_CACHE_ENTRY Entry, _In_z_ PCSTR Name, _In_opt_ PFN_RENDER_LOAD_CALLBACK Callback,
+                        _In_opt_ PVOID Context)
+{
+    if (Entry->Loading)
+    {
+        AddPendingLoad(Entry->Type, Name, Entry->Handle, Callback, Context);
+    }
+    else if (Callback)
+    {
+        Callback(Entry->Handle, AssetLoadStatusSucceeded, Context);
+    }
+}
+
+static VOID CancelLoads(_In_ ASSET_LOAD_TYPE Type, _In_ RENDER_HANDLE Handle)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(PendingLoads); i++)
+    {
+        if (PendingLoads[i]->Id && PendingLoads[i]->Type == Type && PendingLoads[i]->Handle == Handle)
+        {
+            AstCancelLoad(PendingLoads[i]->Id);
+            PendingLoads[i]->Handle = 0;
+        }
+    }
+
+    FinishWaiters(Type, Handle, AssetLoadStatusCancelled);
+}
+
+RENDER_HANDLE RdrLoadTextureAsync(_In_z_ PCSTR Name, _In_ ASSET_LOAD_PRIORITY Priority,
+                                  _In_opt_ PFN_RENDER_LOAD_CALLBACK Callback, _In_opt_ PVOID Context,
+                                  _Out_opt_ PUINT64 LoadId)
+{
+    if (LoadId)
+    {
+        *LoadId = 0;
+    }
+
+    PRENDER_CACHE_ENTRY Entry = CacheFind(AssetLoadTypeTexture, Name);
+    if (Entry)
+    {
+        Entry->References++;
+        WaitForLoad(Entry, Name, Callback, Context);
+        return Entry->Handle;
     }
+
+    // Backends that can't replace a texture in place just get it synchronously
+    if (!Backend.UseTexture || !Backend.UpdateTexture)
+    {
+        RENDER_HANDLE Handle = RdrLoadTexture(Name);
+        if (Callback)
+        {
+            Callback(Handle, Handle ? AssetLoadStatusSucceeded : AssetLoadStatusFailed, Context);
+        }
+        return Handle;
+    }
+
+    static UINT8 PlaceholderPixels[] = {0x80, 0x80, 0x80, 0xFF};
+    TEXTURE Placeholder = {0};
+    Placeholder.Format = TextureFormatRgba8;
+    Placeholder.Width = 1;
+    Placeholder.Height = 1;
+    Placeholder.Pixels = PlaceholderPixels;
+
+    RENDER_HANDLE Handle = Backend.UseTexture(&Placeholder, 1, Name);
+    CacheAdd(AssetLoadTypeTexture, Name, Handle, 0, TRUE);
+    UINT64 Id = QueueLoad(AssetLoadTypeTexture, Name, Handle, Priority, Callback, Context);
+    if (LoadId)
+    {
+        *LoadId = Id;
+    }
+
+    return Handle;
 }
 
 VOID RdrDestroyTexture(_In_ RENDER_HANDLE TextureHandle)
 {
+    if (!CacheRelease(AssetLoadTypeTexture, TextureHandle))
+    {
+        return;
+    }
+
+    CancelLoads(AssetLoadTypeTexture, TextureHandle);
+    RemoveStreamedTexture(TextureHandle);
+
     if (TextureHandle && Backend.ReleaseTexture)
     {
         Backend.ReleaseTexture(TextureHandle);
@@ -292,12 +1353,22 @@ BOOLEAN RdrCreateMaterial(_Out_ PMATERIAL Material, _In_ RENDER_HANDLE TextureHa
     {
         Backend.CreateMaterial(Material);
     }
+    stbds_arrpush(Materials, Material);
 
     return TRUE;
 }
 
 VOID RdrDestroyMaterial(_In_ PMATERIAL Material)
 {
+    for (SIZE_T i = 0; i < stbds_arrlenu(Materials); i++)
+    {
+        if (Materials[i] == Material)
+        {
+            stbds_arrdelswap(Materials, i);
+            break;
+        }
+    }
+
     if (Material->Handle && Backend.DestroyMaterial)
     {
         Backend.DestroyMaterial(Material);
@@ -305,6 +1376,34 @@ VOID RdrDestroyMaterial(_In_ PMATERIAL Material)
     Material->Handle = 0;
 }
 
+static VOID UploadModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh, _Inout_ PASSET_VIEW View)
+{
+    if (Backend.CreateModel)
+    {
+        RENDER_MESH_LODS Lods;
+        PrepareMeshLods(Mesh, View, &Lods);
+        ENGINE_PROFILE_BEGIN("Upload mesh");
+        Backend.CreateModel(Name, Model, Mesh);
+        ENGINE_PROFILE_END();
+        stbds_hmput(MeshLods, Model->MeshHandle, Lods);
+        AstCloseView(View);
+    }
+    else if (View->Allocation)
+    {
+        Model->MeshHandle = (RENDER_HANDLE)View->Allocation;
+    }
+    else
+    {
+        PMESH Copy = CmnAllocType(1, MESH);
+        if (!Copy)
+        {
+            CmnError("Failed to allocate mesh %s: %s", Name, strerror(errno));
+        }
+        *Copy = *Mesh;
+        Model->MeshHandle = (RENDER_HANDLE)Copy;
+    }
+}
+
 BOOLEAN RdrLoadModel(_Out_ PMODEL Model, _In_z_ PCSTR Name, _In_ PMATERIAL Material)
 {
     if (!Model || !Name || !Material)
@@ -312,16 +1411,95 @@ BOOLEAN RdrLoadModel(_Out_ PMODEL Model, _In_z_ PCSTR Name, _In_ PMATERIAL Mater
         return FALSE;
     }
 
-    PMESH Mesh = LoadMesh(EngGetAssetPath(EngAssetDirectoryModels, Name));
-
     Model->Material = Material;
-    if (Mesh && Backend.CreateModel)
+
+    PRENDER_CACHE_ENTRY Entry = CacheFind(AssetLoadTypeMesh, Name);
+    if (Entry)
     {
-        Backend.CreateModel(Name, Model, Mesh);
+        Entry->References++;
+        Model->MeshHandle = Entry->Handle;
+        return TRUE;
     }
-    else
+
+    ASSET_PATH Path;
+    EngMakeAssetPath(EngAssetDirectoryModels, Name, &Path);
+
+    MESH Mesh = {0};
+    ASSET_VIEW View = {0};
+    if (!AstLoadMesh(&Path, &Mesh, &View))
+    {
+        return FALSE;
+    }
+
+    UINT64 ContentHash = AstHashMesh(&Mesh);
+    Entry = CacheFindContent(AssetLoadTypeMesh, ContentHash);
+    if (Entry)
+    {
+        LogDebug("Mesh %s is identical to %s, sharing it", Name, Entry->Names[0]);
+        AstCloseView(&View);
+        CacheAddName(Entry, Name);
+        Entry->References++;
+        Model->MeshHandle = Entry->Handle;
+        return TRUE;
+    }
+
+    UploadModel(Name, Model, &Mesh, &View);
+    CacheAdd(AssetLoadTypeMesh, Name, Model->MeshHandle, ContentHash, FALSE);
+
+    return TRUE;
+}
+
+BOOLEAN RdrLoadModelAsync(_Out_ PMODEL Model, _In_z_ PCSTR Name, _In_ PMATERIAL Material,
+                          _In_ ASSET_LOAD_PRIORITY Priority, _In_opt_ PFN_RENDER_LOAD_CALLBACK Callback,
+                          _In_opt_ PVOID Context, _Out_opt_ PUINT64 LoadId)
+{
+    if (LoadId)
+    {
+        *LoadId = 0;
+    }
+
+    if (!Model || !Name || !Material)
+    {
+        return FALSE;
+    }
+
+    PRENDER_CACHE_ENTRY Entry = CacheFind(AssetLoadTypeMesh, Name);
+    if (Entry)
+    {
+        Entry->References++;
+        Model->Material = Material;
+        Model->MeshHandle = Entry->Handle;
+        WaitForLoad(Entry, Name, Callback, Context);
+        return TRUE;
+    }
+
+    if (!Backend.CreateModel || !Backend.UpdateModel)
+    {
+        BOOLEAN Loaded = RdrLoadModel(Model, Name, Material);
+        if (Callback)
+        {
+            Callback(Loaded ? Model->MeshHandle : 0, Loaded ? AssetLoadStatusSucceeded : AssetLoadStatusFailed,
+                     Context);
+        }
+        return Loaded;
+    }
+
+    // One degenerate triangle, so the backends don't need to handle empty buffers
+    static MESH_VERTEX PlaceholderVertices[3];
+    static ivec3 PlaceholderIndices[1];
+    MESH Placeholder = {0};
+    Placeholder.Vertices = PlaceholderVertices;
+    Placeholder.VertexCount = PURPL_ARRAYSIZE(PlaceholderVertices);
+    Placeholder.Indices = PlaceholderIndices;
+    Placeholder.IndexCount = PURPL_ARRAYSIZE(PlaceholderIndices);
+
+    Model->Material = Material;
+    Backend.CreateModel(Name, Model, &Placeholder);
+    CacheAdd(AssetLoadTypeMesh, Name, Model->MeshHandle, 0, TRUE);
+    UINT64 Id = QueueLoad(AssetLoadTypeMesh, Name, Model->MeshHandle, Priority, Callback, Context);
+    if (LoadId)
     {
-        Model->MeshHandle = (RENDER_HANDLE)Mesh;
+        *LoadId = Id;
     }
 
     return TRUE;
@@ -329,13 +1507,129 @@ BOOLEAN RdrLoadModel(_Out_ PMODEL Model, _In_z_ PCSTR Name, _In_ PMATERIAL Mater
 
 VOID RdrDestroyModel(_In_ PMODEL Model)
 {
-    if (Model->MeshHandle && Backend.DestroyModel)
+    if (CacheRelease(AssetLoadTypeMesh, Model->MeshHandle))
     {
-        Backend.DestroyModel(Model);
+        CancelLoads(AssetLoadTypeMesh, Model->MeshHandle);
+        stbds_hmdel(MeshLods, Model->MeshHandle);
+
+        if (Model->MeshHandle && Backend.DestroyModel)
+        {
+            Backend.DestroyModel(Model);
+        }
+        else
+        {
+            CmnFree(Model->MeshHandle);
+        }
     }
     Model->MeshHandle = 0;
 }
 
+// Returns the part of the path after the asset directory, or NULL if it's in a different one
+static PCSTR GetAssetName(_In_z_ PCSTR Path, _In_ ENGINE_ASSET_DIRECTORY Directory)
+{
+    SIZE_T Length = strlen(EngAssetDirectories[Directory]);
+    if (strncmp(Path, EngAssetDirectories[Directory], Length) == 0 && Path[Length] == '/')
+    {
+        return Path + Length + 1;
+    }
+
+    return NULL;
+}
+
+static VOID ReloadCached(_In_ ASSET_LOAD_TYPE Type, _In_z_ PCSTR Path, _In_z_ PCSTR Name)
+{
+    PRENDER_CACHE_ENTRY Entry = CacheFind(Type, Name);
+    if (!Entry || Entry->Loading)
+    {
+        return;
+    }
+
+    if (Type == AssetLoadTypeTexture ? !Backend.UpdateTexture : !Backend.UpdateModel)
+    {
+        LogWarning("%s changed, but the %s backend can't replace it", Path, Backend.Name);
+        return;
+    }
+
+    // Everything sharing the entry gets the new contents, and FinishLoad swaps them in at the start of a frame
+    LogInfo("Reloading %s", Path);
+    Entry->Loading = TRUE;
+    QueueLoad(Type, Name, Entry->Handle, AssetLoadPriorityHigh, NULL, NULL);
+}
+
+static VOID NoteChangedAsset(_In_z_ PCSTR Path, _In_opt_ PVOID Context)
+{
+    UNREFERENCED_PARAMETER(Context);
+
+    PCSTR Name;
+    if ((Name = GetAssetName(Path, EngAssetDirectoryTextures)))
+    {
+        ReloadCached(AssetLoadTypeTexture, Path, Name);
+    }
+    else if ((Name = GetAssetName(Path, EngAssetDirectoryModels)))
+    {
+        ReloadCached(AssetLoadTypeMesh, Path, Name);
+    }
+    else if ((Name = GetAssetName(Path, EngAssetDirectoryShaders)))
+    {
+        // Each backend has its own directory with a file for each stage named <shader>.<stage>.<extension>
+        PCSTR FileName = strrchr(Name, '/');
+        FileName = FileName ? FileName + 1 : Name;
+        PCHAR ShaderName = CmnFormatString("%.*s", (INT)strcspn(FileName, "."), FileName);
+        for (SIZE_T i = 0; ShaderName && i < stbds_arrlenu(ChangedShaders); i++)
+        {
+            if (strcmp(ChangedShaders[i], ShaderName) == 0)
+            {
+                CmnFree(ShaderName);
+                ShaderName = NULL;
+            }
+        }
+        if (ShaderName)
+        {
+            stbds_arrpush(ChangedShaders, ShaderName);
+        }
+    }
+}
+
+static VOID ReloadChangedAssets(VOID)
+{
+    AstPollWatcher(NoteChangedAsset, NULL);
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(ChangedShaders); i++)
+    {
+        PSHADERMAP Pair = stbds_shgetp_null(RdrShaders, ChangedShaders[i]);
+        if (Pair && Backend.LoadShader)
+        {
+            LogInfo("Reloading shader %s", Pair->key);
+
+            // The old pipeline can't be destroyed while a frame in flight is using it
+            WaitForGpu();
+            RENDER_HANDLE OldHandle = Pair->value;
+            RENDER_HANDLE NewHandle = Backend.LoadShader(Pair->key, TRUE);
+            if (NewHandle)
+            {
+                for (SIZE_T j = 0; j < stbds_arrlenu(Materials); j++)
+                {
+                    if (Materials[j]->ShaderHandle == OldHandle)
+                    {
+                        Materials[j]->ShaderHandle = NewHandle;
+                    }
+                }
+                Pair->value = NewHandle;
+                if (Backend.DestroyShader)
+                {
+                    Backend.DestroyShader(OldHandle);
+                }
+            }
+            else
+            {
+                LogError("Failed to reload shader %s, keeping the old one", Pair->key);
+            }
+        }
+        CmnFree(ChangedShaders[i]);
+    }
+    stbds_arrfree(ChangedShaders);
+}
+
 VOID RdrInitializeObject(_In_z_ PCSTR Name, _Inout_ PRENDER_OBJECT_DATA Data, _In_ PMODEL Model)
 {
     if (Backend.InitializeObject)
@@ -380,22 +1674,26 @@ VOID RdrDrawRectangle(_In_ PCMESH_VERTEX Vertices, _In_opt_ PMATERIAL Material,
     RdrDrawGeometry(Vertices, 4, Indices, PURPL_ARRAYSIZE(Indices), Material, Transform, FALSE);
 }
 
-UINT32 RdrGetWidth(VOID)
+PCRENDER_TARGET_STATE RdrGetTargetState(VOID)
 {
-    UINT32 Width;
+    // Only written by RdrInitialize and RdrBeginFrame, which run on the main thread while nothing else is reading it
+    return &TargetState;
+}
 
-    VidGetSize(&Width, NULL);
+VOID RdrGetFrameStats(_Out_ PRENDER_FRAME_STATS Stats)
+{
+    Stats->CpuTime = AverageFrameTime;
+    Stats->GpuTime = AverageGpuFrameTime;
+}
 
-    return (UINT32)(Width * CONFIGVAR_GET_FLOAT("rdr_scale"));
+UINT32 RdrGetWidth(VOID)
+{
+    return RdrGetTargetState()->Width;
 }
 
 UINT32 RdrGetHeight(VOID)
 {
-    UINT32 Height;
-
-    VidGetSize(NULL, &Height);
-
-    return (UINT32)(Height * CONFIGVAR_GET_FLOAT("rdr_scale"));
+    return RdrGetTargetState()->Height;
 }
 
 PCSTR RdrGetApiName(_In_ RENDER_API Api)
@@ -12,6 +12,10 @@
 #include "common/configvar.h"
 #include "common/log.h"
 
+#include "engine/confighandle.h"
+
+#include "engine/asset/bcn.h"
+#include "engine/asset/loader.h"
 #include "engine/math/transform.h"
 
 #include "platform/video.h"
@@ -38,6 +42,12 @@ PURPL_MAKE_TAG(struct, MATERIAL, {
 PURPL_MAKE_COMPONENT(struct, MODEL, {
     RENDER_HANDLE MeshHandle;
     PMATERIAL Material;
+
+    // Level of detail picked by RdrExtractModel, the range is in individual indices and a count of 0 draws everything
+    UINT32 Lod;
+    UINT32 FirstIndex;
+    UINT32 IndexCount;
+    FLOAT TextureUsage; // how many pixels across the texture covers on screen, 0 if the mesh is still loading
 })
 
 /// @brief Maximum number of models
@@ -71,11 +81,38 @@ PURPL_MAKE_TAG(struct, RENDER_SCENE_UNIFORM, {
     mat4 Projection;
 })
 
-/// @brief Uniform data for individual objects
-PURPL_MAKE_TAG(struct, RENDER_OBJECT_UNIFORM, { mat4 Model; })
+/// @brief Uniform data for individual objects, filled in for every model by RdrExtractModel
+PURPL_MAKE_COMPONENT(struct, RENDER_OBJECT_UNIFORM, { mat4 Model; })
 
 PURPL_MAKE_COMPONENT(struct, RENDER_OBJECT_DATA, { RENDER_HANDLE Handle; })
 
+/// @brief Vertex layout used for models, picked once when the renderer starts
+PURPL_MAKE_TAG(enum, RENDER_VERTEX_FORMAT, {
+    RenderVertexFormatFull,   // MESH_VERTEX as-is
+    RenderVertexFormatPacked, // RENDER_PACKED_VERTEX
+})
+
+/// @brief Packed vertex, 20 bytes instead of the 48 of MESH_VERTEX
+///
+/// The input assembler converts everything back to floats, so shaders see the same inputs either way.
+PURPL_MAKE_TAG(struct, RENDER_PACKED_VERTEX, {
+    UINT16 Position[4];          // half floats, W is 1 (3 component half formats aren't widely supported)
+    UINT8 Colour[4];             // unorm8
+    UINT16 TextureCoordinate[2]; // half floats
+    INT8 Normal[4];              // snorm8, W is 0
+})
+
+/// @brief Mesh data in the layout the backends upload
+PURPL_MAKE_TAG(struct, RENDER_MESH_DATA, {
+    CONST VOID *Vertices;
+    UINT32 VertexCount;
+    UINT32 VertexStride;
+    CONST VOID *Indices;
+    UINT32 IndexCount; // individual indices, not triangles
+    UINT32 IndexSize;  // 2 if every vertex can be reached with 16-bit indices, otherwise 4
+    PVOID Allocation;  // converted data, NULL if the mesh is used as-is
+})
+
 /// @brief Renderer backend
 PURPL_MAKE_TAG(struct, RENDER_BACKEND, {
     PCSTR Name;
@@ -86,16 +123,25 @@ PURPL_MAKE_TAG(struct, RENDER_BACKEND, {
     VOID (*FinishRendering)(VOID);
     VOID (*Shutdown)(VOID);
 
-    RENDER_HANDLE (*LoadShader)(_In_z_ PCSTR Name);
+    // Failing to load a shader is fatal unless Reload is set, in which case 0 is returned and the old one is kept
+    RENDER_HANDLE (*LoadShader)(_In_z_ PCSTR Name, _In_ BOOLEAN Reload);
     VOID (*DestroyShader)(_In_ RENDER_HANDLE Handle);
 
-    RENDER_HANDLE (*UseTexture)(_In_ PTEXTURE Texture, _In_z_ PCSTR Name);
+    BOOLEAN (*SupportsTextureFormat)(_In_ UINT32 Format); // NULL if only the formats in TEXTURE_FORMAT work
+    // The pixels have MipCount levels one after the other, from AstGetTextureMipCount, and backends make the rest of
+    // the chain themselves if they want more
+    RENDER_HANDLE (*UseTexture)(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name);
+    VOID (*UpdateTexture)(_In_ RENDER_HANDLE Handle, _In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name);
+    // UpdateTexture keeps the old texture until the frames in flight are done with it, otherwise the GPU is waited for
+    // before it's called
+    BOOLEAN DefersTextureRelease;
     VOID (*ReleaseTexture)(_In_ RENDER_HANDLE Handle);
 
     VOID (*CreateMaterial)(_Inout_ PMATERIAL Material);
     VOID (*DestroyMaterial)(_In_ PMATERIAL Material);
 
     VOID (*CreateModel)(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ CONST PMESH Mesh);
+    VOID (*UpdateModel)(_In_z_ PCSTR Name, _In_ PMODEL Model, _In_ CONST PMESH Mesh);
     VOID(*DrawModel)
     (_In_ PMODEL Model, _In_ CONST PRENDER_OBJECT_UNIFORM Uniform, _In_ CONST PRENDER_OBJECT_DATA Data);
     VOID (*DestroyModel)(_Inout_ PMODEL Model);
@@ -108,6 +154,7 @@ PURPL_MAKE_TAG(struct, RENDER_BACKEND, {
     VOID (*DestroyObject)(_Inout_ PRENDER_OBJECT_DATA Data);
 
     PCSTR (*GetGpuName)(VOID);
+    DOUBLE (*GetGpuFrameTime)(VOID); // NULL if the backend can't time the GPU
 })
 
 /// @brief Define configuration variables
@@ -116,23 +163,57 @@ extern VOID RdrDefineVariables(VOID);
 /// @brief Initialize the render system
 extern ECS_SYSTEM_DECLARE(RdrInitialize);
 
-/// @brief Start recording a frame
+// The backends aren't thread safe, so RdrBeginFrame, RdrDrawModel and RdrEndFrame are sync points. They aren't
+// multi-threaded, so flecs only runs them on the main thread once every multi-threaded system before them has finished,
+// and its other threads wait until they return. They check that they're on the thread RdrInitialize ran on.
+
+/// @brief Start recording a frame, a sync point
 extern ECS_SYSTEM_DECLARE(RdrBeginFrame);
 
-/// @brief Draw a model
+/// @brief Pick the level of detail and fill in the uniform of each model, multi-threaded
+extern ECS_SYSTEM_DECLARE(RdrExtractModel);
+
+/// @brief Draw a model, a sync point
 extern ECS_SYSTEM_DECLARE(RdrDrawModel);
 
-/// @brief Finish recording a frame and present it
+/// @brief Finish recording a frame and present it, a sync point
 extern ECS_SYSTEM_DECLARE(RdrEndFrame);
 
 /// @brief Use a texture
 ///
+/// Textures are cached by name and by contents, so loading the same texture again returns the same handle with
+/// another reference, which has to be released with RdrDestroyTexture like any other.
+///
 /// @param[in] Name The name of the texture to load
 ///
 /// @return A texture handle.
 extern RENDER_HANDLE RdrLoadTexture(_In_z_ PCSTR Name);
 
-/// @brief Release a texture
+/// @brief Called when an asynchronous load is done
+///
+/// @param[in] Handle The texture handle, or the mesh handle of the model
+/// @param[in] Status How the load went, the placeholder is still in use if it didn't succeed
+/// @param[in] Context The context passed when the load was started
+typedef VOID (*PFN_RENDER_LOAD_CALLBACK)(_In_ RENDER_HANDLE Handle, _In_ ASSET_LOAD_STATUS Status,
+                                         _In_opt_ PVOID Context);
+
+/// @brief Load a texture in the background
+///
+/// The handle refers to a placeholder until the texture is loaded, then the texture is uploaded at the start of a
+/// frame and the same handle refers to it.
+///
+/// @param[in] Name The name of the texture to load
+/// @param[in] Priority The priority of the load
+/// @param[in] Callback Called on the render thread when the load is done
+/// @param[in] Context Passed to the callback
+/// @param[out] LoadId The load, for AstCancelLoad and AstSetLoadPriority, 0 if the texture was already cached
+///
+/// @return A texture handle.
+extern RENDER_HANDLE RdrLoadTextureAsync(_In_z_ PCSTR Name, _In_ ASSET_LOAD_PRIORITY Priority,
+                                         _In_opt_ PFN_RENDER_LOAD_CALLBACK Callback, _In_opt_ PVOID Context,
+                                         _Out_opt_ PUINT64 LoadId);
+
+/// @brief Release a texture, it's destroyed once the last reference is released
 ///
 /// @param[in] TextureHandle The texture handle to release
 extern VOID RdrDestroyTexture(_In_ RENDER_HANDLE TextureHandle);
@@ -153,6 +234,8 @@ extern VOID RdrDestroyMaterial(_In_ PMATERIAL Material);
 
 /// @brief Create a model
 ///
+/// Meshes are cached like textures, so models of the same mesh share its GPU buffers.
+///
 /// @param[out] Model The model to create
 /// @param[in] Name The name of the mesh to use
 /// @param[in] Material The material to use
@@ -160,7 +243,25 @@ extern VOID RdrDestroyMaterial(_In_ PMATERIAL Material);
 /// @return A model. This must not outlive the source mesh.
 extern BOOLEAN RdrLoadModel(_Out_ PMODEL Model, _In_z_ PCSTR Name, _In_ PMATERIAL Material);
 
-/// @brief Destroy a model
+/// @brief Create a model and load its mesh in the background
+///
+/// The model draws nothing until the mesh is loaded, then the mesh is uploaded at the start of a frame. Copies of
+/// the model share the mesh handle, so they all see it.
+///
+/// @param[out] Model The model to create
+/// @param[in] Name The name of the mesh to use
+/// @param[in] Material The material to use
+/// @param[in] Priority The priority of the load
+/// @param[in] Callback Called on the render thread when the load is done
+/// @param[in] Context Passed to the callback
+/// @param[out] LoadId The load, for AstCancelLoad and AstSetLoadPriority, 0 if the mesh was already cached
+///
+/// @return Whether the model could be created
+extern BOOLEAN RdrLoadModelAsync(_Out_ PMODEL Model, _In_z_ PCSTR Name, _In_ PMATERIAL Material,
+                                 _In_ ASSET_LOAD_PRIORITY Priority, _In_opt_ PFN_RENDER_LOAD_CALLBACK Callback,
+                                 _In_opt_ PVOID Context, _Out_opt_ PUINT64 LoadId);
+
+/// @brief Destroy a model, its mesh is destroyed once no other models use it
 ///
 /// @param Model The model to destroy
 extern VOID RdrDestroyModel(_In_ PMODEL Model);
@@ -194,6 +295,55 @@ extern VOID RdrDrawLine(_In_ vec3 Start, _In_ vec3 End, _In_ vec4 Colour, _In_op
 
 extern VOID RdrDrawRectangle(_In_ PCMESH_VERTEX Vertices, _In_opt_ PMATERIAL Material, _In_opt_ mat4 Transform);
 
+/// @brief Read rdr_packed_vertices, called before any shaders or models are created
+extern VOID RdrInitializeVertexFormat(VOID);
+
+/// @brief Get the vertex layout models use
+extern RENDER_VERTEX_FORMAT RdrGetVertexFormat(VOID);
+
+/// @brief Get the size of a vertex in the layout models use
+extern UINT32 RdrGetVertexStride(VOID);
+
+/// @brief Convert a float to a half float, rounding to nearest
+extern UINT16 RdrFloatToHalf(_In_ FLOAT Value);
+
+/// @brief Convert a mesh to the layout models use
+///
+/// @param[in] Mesh The mesh to convert, which must outlive the data if nothing needed converting
+/// @param[out] Data Receives the converted mesh, free it with RdrFreeMeshData once it's uploaded
+extern VOID RdrPrepareMesh(_In_ PCMESH Mesh, _Out_ PRENDER_MESH_DATA Data);
+
+/// @brief Free mesh data from RdrPrepareMesh
+extern VOID RdrFreeMeshData(_Inout_ PRENDER_MESH_DATA Data);
+
+/// @brief Size of the render output, worked out once at the start of every frame
+PURPL_MAKE_TAG(struct, RENDER_TARGET_STATE, {
+    UINT32 OutputWidth;  // size of the window
+    UINT32 OutputHeight;
+    FLOAT Scale;         // rdr_scale times the dynamic resolution scale
+    UINT32 Width;        // size of the render targets
+    UINT32 Height;
+    BOOLEAN Resized;     // the window or the scale changed this frame, so the render targets have to be recreated
+})
+
+/// @brief Get the size of the render output for this frame
+///
+/// The state is set by RdrInitialize, which runs in the ECS's first frame, before the ECS starts any other threads.
+///
+/// @return The render target state, which stays valid until RdrShutdown
+extern PCRENDER_TARGET_STATE RdrGetTargetState(VOID);
+
+/// @brief Recent frame times, in milliseconds
+PURPL_MAKE_TAG(struct, RENDER_FRAME_STATS, {
+    DOUBLE CpuTime; // averaged, from the start of RdrBeginFrame to the end of RdrEndFrame
+    DOUBLE GpuTime; // averaged, of the backend's main pass a few frames ago, 0 if the backend can't time the GPU
+})
+
+/// @brief Get recent frame times
+///
+/// @param[out] Stats Receives the frame times
+extern VOID RdrGetFrameStats(_Out_ PRENDER_FRAME_STATS Stats);
+
 /// @brief Get the width of the render output
 ///
 /// @return The scaled width of the render output
@@ -15,18 +15,24 @@ static VOID Initialize(VOID)
     LogDebug("Successfully initialized software rasteriser");
 }
 
+static ENGINE_CONFIGVAR ClearColourVar = ENGINE_CONFIGVAR_INT("rdr_clear_colour");
+
+static VOID ClearRows(_In_ PUINT32 Pixel, _In_ UINT64 Start, _In_ UINT64 End)
+{
+    for (UINT64 i = Start * SwrsData.Framebuffer->Width; i < End * SwrsData.Framebuffer->Width; i++)
+    {
+        SwrsData.Framebuffer->Pixels[i] = *Pixel;
+    }
+}
+
 static VOID BeginFrame(_In_ BOOLEAN Resized, _In_ CONST PRENDER_SCENE_UNIFORM Uniform)
 {
     vec4 ClearColour = {0};
-    VIDEO_UNPACK_COLOUR(ClearColour, CONFIGVAR_GET_INT("rdr_clear_colour"));
+    VIDEO_UNPACK_COLOUR(ClearColour, ENGINE_CONFIGVAR_GET_INT(ClearColourVar));
 
-    for (UINT32 Y = 0; Y < SwrsData.Framebuffer->Height; Y++)
-    {
-        for (UINT32 X = 0; X < SwrsData.Framebuffer->Width; X++)
-        {
-            SwrsPutPixel((ivec2){X, Y}, ClearColour);
-        }
-    }
+    // Every pixel is the same, so it's only converted once, and each tile of rows is cleared by a different job
+    UINT32 Pixel = VidConvertPixel(VIDEO_PACK_COLOUR(ClearColour));
+    EngParallelFor(SwrsData.Framebuffer->Height, SWRAST_TILE_ROWS, (PFN_ENGINE_PARALLEL_FOR)ClearRows, &Pixel);
 
     glm_mat4_mul(Uniform->Projection, Uniform->View, SwrsData.ViewProjection);
 }
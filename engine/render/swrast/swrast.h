@@ -21,6 +21,9 @@
 #include "util/mesh.h"
 #include "util/texture.h"
 
+/// @brief Number of rows in a tile, the framebuffer is split into tiles this tall to spread work across the job system
+#define SWRAST_TILE_ROWS 32
+
 PURPL_MAKE_TAG(struct, SWRAST_DATA, {
     PVIDEO_FRAMEBUFFER Framebuffer;
     mat4 ViewProjection;
@@ -69,6 +69,8 @@ VOID VlkCreateAllocator(VOID)
     VULKAN_CHECK(vmaCreateAllocator(&AllocatorCreateInformation, &VlkData.Allocator));
 }
 
+static ENGINE_CONFIGVAR ClearColourVar = ENGINE_CONFIGVAR_INT("rdr_clear_colour");
+
 static VOID Initialize(VOID)
 {
     if (VlkData.Initialized)
@@ -92,6 +94,7 @@ static VOID Initialize(VOID)
     VlkCreateSemaphores();
     VlkCreateCommandPools();
     VlkAllocateCommandBuffers();
+    VlkCreateQueryPool();
     VlkCreateAllocator();
     VlkCreateSwapChain();
     VlkCreateMainRenderPass();
@@ -166,6 +169,7 @@ static VOID BeginFrame(_In_ BOOLEAN WindowResized, _In_ PRENDER_SCENE_UNIFORM Un
 
     VULKAN_CHECK(
         vkWaitForFences(VlkData.Device, 1, &VlkData.CommandBufferFences[VlkData.FrameIndex], TRUE, UINT64_MAX));
+    VlkFreeRetiredObjects(FALSE);
 
     VlkData.SwapChainIndex = 0;
     Result =
@@ -200,9 +204,12 @@ static VOID BeginFrame(_In_ BOOLEAN WindowResized, _In_ PRENDER_SCENE_UNIFORM Un
     CommandBufferBeginInformation.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     VULKAN_CHECK(vkBeginCommandBuffer(CurrentCommandBuffer, &CommandBufferBeginInformation));
 
+    // The fence was waited for, so the queries this frame last used are done
+    VlkBeginFrameQueries(CurrentCommandBuffer);
+
     VkClearValue ClearValues[3] = {0};
 
-    INT64 ClearColour = CONFIGVAR_GET_INT("rdr_clear_colour");
+    INT64 ClearColour = ENGINE_CONFIGVAR_GET_INT(ClearColourVar);
     ClearValues[0].color.float32[0] = ((ClearColour >> 24) & 0xFF) / 255.0f;
     ClearValues[0].color.float32[1] = ((ClearColour >> 16) & 0xFF) / 255.0f;
     ClearValues[0].color.float32[2] = ((ClearColour >> 8) & 0xFF) / 255.0f;
@@ -223,6 +230,7 @@ static VOID BeginFrame(_In_ BOOLEAN WindowResized, _In_ PRENDER_SCENE_UNIFORM Un
     RenderPassBeginInformation.clearValueCount = PURPL_ARRAYSIZE(ClearValues);
     RenderPassBeginInformation.renderArea = Scissor;
 
+    VULKAN_BEGIN_GPU_SCOPE(CurrentCommandBuffer, "Main render pass", VlkData.MainPassScope);
     vkCmdBeginRenderPass(CurrentCommandBuffer, &RenderPassBeginInformation, VK_SUBPASS_CONTENTS_INLINE);
 
     VkViewport Viewport = {0};
@@ -256,6 +264,7 @@ static VOID EndFrame(VOID)
     CurrentCommandBuffer = VlkData.CommandBuffers[VlkData.FrameIndex];
 
     vkCmdEndRenderPass(CurrentCommandBuffer);
+    VlkEndGpuScope(CurrentCommandBuffer, VlkData.MainPassScope);
     VULKAN_CHECK(vkEndCommandBuffer(CurrentCommandBuffer));
 
     VkSubmitInfo SubmitInformation = {0};
@@ -271,6 +280,7 @@ static VOID EndFrame(VOID)
     SubmitInformation.pCommandBuffers = &CurrentCommandBuffer;
     SubmitInformation.commandBufferCount = 1;
 
+    VlkEndFrameQueries();
     VULKAN_CHECK(
         vkQueueSubmit(VlkData.GraphicsQueue, 1, &SubmitInformation, VlkData.CommandBufferFences[VlkData.FrameIndex]));
 
@@ -289,11 +299,18 @@ static VOID EndFrame(VOID)
     }
 
     IncrementFrameIndex();
+    VlkData.FrameNumber++;
 }
 
 static VOID FinishRendering(VOID)
 {
     vkDeviceWaitIdle(VlkData.Device);
+    VlkFreeRetiredObjects(TRUE);
+}
+
+static DOUBLE GetGpuFrameTime(VOID)
+{
+    return VlkData.GpuFrameTime;
 }
 
 static VOID Shutdown(VOID)
@@ -303,6 +320,7 @@ static VOID Shutdown(VOID)
     LogDebug("Shutting down Vulkan");
     VlkData.Initialized = FALSE;
     vkDeviceWaitIdle(VlkData.Device);
+    VlkFreeRetiredObjects(TRUE);
 
     if (VlkData.PipelineLayout)
     {
@@ -362,6 +380,8 @@ static VOID Shutdown(VOID)
 
     VlkDestroySwapChain();
 
+    VlkDestroyQueryPool();
+
     LogDebug("Destroying command fences");
     for (i = 0; i < VULKAN_FRAME_COUNT; i++)
     {
@@ -489,10 +509,14 @@ VOID VlkInitializeBackend(_Out_ PRENDER_BACKEND Backend)
     Backend->LoadShader = VlkLoadShader;
     Backend->DestroyShader = VlkDestroyShader;
 
+    Backend->SupportsTextureFormat = VlkSupportsTextureFormat;
     Backend->UseTexture = VlkUseTexture;
+    Backend->UpdateTexture = VlkUpdateTexture;
+    Backend->DefersTextureRelease = TRUE;
     Backend->ReleaseTexture = VlkDestroyTexture;
 
     Backend->CreateModel = VlkCreateModel;
+    Backend->UpdateModel = VlkUpdateModel;
     Backend->DrawModel = VlkDrawModel;
     Backend->DestroyModel = VlkDestroyModel;
 
@@ -500,6 +524,7 @@ VOID VlkInitializeBackend(_Out_ PRENDER_BACKEND Backend)
     Backend->DestroyObject = VlkDestroyObject;
 
     Backend->GetGpuName = GetGpuName;
+    Backend->GetGpuFrameTime = GetGpuFrameTime;
 
     memset(&VlkData, 0, sizeof(VULKAN_DATA));
 }
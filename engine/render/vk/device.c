@@ -197,6 +197,9 @@ VOID VlkEnumeratePhysicalDevices(VOID)
         LogTrace("Getting properties");
         vkGetPhysicalDeviceProperties(CurrentGpu->Device, &CurrentGpu->Properties);
 
+        LogTrace("Getting features");
+        vkGetPhysicalDeviceFeatures(CurrentGpu->Device, &CurrentGpu->Features);
+
         UsableCount++;
         if (CurrentGpu->Usable)
         {
@@ -243,6 +246,7 @@ VOID VlkCreateLogicalDevice(VOID)
 
     VkPhysicalDeviceFeatures DeviceFeatures = {0};
     DeviceFeatures.samplerAnisotropy = TRUE;
+    DeviceFeatures.textureCompressionBC = VlkData.Gpu->Features.textureCompressionBC;
 
     //VkPhysicalDeviceVulkan12Features Device12Features = {0};
     //Device12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
@@ -1,7 +1,7 @@
 #include "vk.h"
 
 VOID VlkCreateImageView(_Out_ VkImageView *ImageView, _In_ VkImage Image, _In_ VkFormat Format,
-                        _In_ VkImageAspectFlags Aspect)
+                        _In_ VkImageAspectFlags Aspect, _In_ UINT32 MipLevels)
 {
     VkImageViewCreateInfo ImageViewCreateInformation = {0};
     ImageViewCreateInformation.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -14,7 +14,7 @@ VOID VlkCreateImageView(_Out_ VkImageView *ImageView, _In_ VkImage Image, _In_ V
 
     ImageViewCreateInformation.subresourceRange.aspectMask = Aspect;
     ImageViewCreateInformation.subresourceRange.baseMipLevel = 0;
-    ImageViewCreateInformation.subresourceRange.levelCount = 1;
+    ImageViewCreateInformation.subresourceRange.levelCount = MipLevels;
     ImageViewCreateInformation.subresourceRange.baseArrayLayer = 0;
     ImageViewCreateInformation.subresourceRange.layerCount = 1;
     ImageViewCreateInformation.flags = 0;
@@ -50,7 +50,8 @@ VkFormat VlkChooseFormat(VkFormat *Formats, UINT32 FormatCount, VkImageTiling Im
     //    return VK_FORMAT_UNDEFINED;
 }
 
-VOID VlkTransitionImageLayout(_Inout_ VkImage Image, _In_ VkImageLayout OldLayout, _In_ VkImageLayout NewLayout)
+VOID VlkTransitionImageLayout(_Inout_ VkImage Image, _In_ VkImageLayout OldLayout, _In_ VkImageLayout NewLayout,
+                              _In_ UINT32 MipLevels)
 {
     VkCommandBuffer TransferBuffer;
     VkPipelineStageFlags SourceStage;
@@ -79,7 +80,7 @@ VOID VlkTransitionImageLayout(_Inout_ VkImage Image, _In_ VkImageLayout OldLayou
         Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     }
     Barrier.subresourceRange.baseMipLevel = 0;
-    Barrier.subresourceRange.levelCount = 1;
+    Barrier.subresourceRange.levelCount = MipLevels;
     Barrier.subresourceRange.baseArrayLayer = 0;
     Barrier.subresourceRange.layerCount = 1;
 
@@ -176,13 +177,35 @@ VOID VlkCopyBufferToImage(_In_ VkBuffer Buffer, _Out_ VkImage Image, _In_ UINT32
     VlkEndTransfer(TransferBuffer);
 }
 
-VOID VlkCreateImage(_In_ UINT32 Width, _In_ UINT32 Height, _In_ VkFormat Format, _In_ VkImageLayout Layout,
-                    _In_ VkImageUsageFlags Usage, _In_ VmaMemoryUsage MemoryUsage, _In_ VkImageAspectFlags Aspect,
-                    _Out_ PVULKAN_IMAGE Image)
+UINT32 VlkGetMipLevels(_In_ UINT32 Width, _In_ UINT32 Height, _In_ VkFormat Format)
+{
+    // Blitting needs linear filtering in both directions, which compressed formats never have
+    VkFormatProperties Properties = {0};
+    vkGetPhysicalDeviceFormatProperties(VlkData.Gpu->Device, Format, &Properties);
+    VkFormatFeatureFlags Required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((Properties.optimalTilingFeatures & Required) != Required)
+    {
+        return 1;
+    }
+
+    UINT32 MipLevels = 1;
+    for (UINT32 Size = PURPL_MAX(Width, Height); Size > 1; Size >>= 1)
+    {
+        MipLevels++;
+    }
+
+    return MipLevels;
+}
+
+VOID VlkCreateImage(_In_ UINT32 Width, _In_ UINT32 Height, _In_ UINT32 MipLevels, _In_ VkFormat Format,
+                    _In_ VkImageLayout Layout, _In_ VkImageUsageFlags Usage, _In_ VmaMemoryUsage MemoryUsage,
+                    _In_ VkImageAspectFlags Aspect, _Out_ PVULKAN_IMAGE Image)
 {
     memset(Image, 0, sizeof(VULKAN_IMAGE));
 
     Image->Format = Format;
+    Image->MipLevels = PURPL_MAX(MipLevels, 1);
 
     VkImageCreateInfo ImageCreateInformation = {0};
     ImageCreateInformation.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -190,7 +213,7 @@ VOID VlkCreateImage(_In_ UINT32 Width, _In_ UINT32 Height, _In_ VkFormat Format,
     ImageCreateInformation.extent.width = Width;
     ImageCreateInformation.extent.height = Height;
     ImageCreateInformation.extent.depth = 1;
-    ImageCreateInformation.mipLevels = 1;
+    ImageCreateInformation.mipLevels = Image->MipLevels;
     ImageCreateInformation.arrayLayers = 1;
     ImageCreateInformation.tiling = VK_IMAGE_TILING_OPTIMAL;
     ImageCreateInformation.format = Format;
@@ -204,13 +227,118 @@ VOID VlkCreateImage(_In_ UINT32 Width, _In_ UINT32 Height, _In_ VkFormat Format,
 
     VULKAN_CHECK(vmaCreateImage(VlkData.Allocator, &ImageCreateInformation, &AllocationCreateInformation,
                                 &Image->Handle, &Image->Allocation, NULL));
-    VlkTransitionImageLayout(Image->Handle, VK_IMAGE_LAYOUT_UNDEFINED, Layout);
-    VlkCreateImageView(&Image->View, Image->Handle, Format, Aspect);
+    VlkTransitionImageLayout(Image->Handle, VK_IMAGE_LAYOUT_UNDEFINED, Layout, Image->MipLevels);
+    VlkCreateImageView(&Image->View, Image->Handle, Format, Aspect, Image->MipLevels);
+}
+
+static VOID MipBarrier(_In_ VkCommandBuffer CommandBuffer, _In_ VkImage Image, _In_ UINT32 Level,
+                       _In_ VkImageLayout OldLayout, _In_ VkImageLayout NewLayout, _In_ VkAccessFlags SourceAccess,
+                       _In_ VkAccessFlags DestinationAccess, _In_ VkPipelineStageFlags DestinationStage)
+{
+    VkImageMemoryBarrier Barrier = {0};
+    Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    Barrier.oldLayout = OldLayout;
+    Barrier.newLayout = NewLayout;
+    Barrier.srcAccessMask = SourceAccess;
+    Barrier.dstAccessMask = DestinationAccess;
+    Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.image = Image;
+    Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    Barrier.subresourceRange.baseMipLevel = Level;
+    Barrier.subresourceRange.levelCount = 1;
+    Barrier.subresourceRange.baseArrayLayer = 0;
+    Barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, DestinationStage, 0, 0, NULL, 0, NULL, 1,
+                         &Barrier);
+}
+
+static VOID GenerateMips(_In_ VkCommandBuffer TransferBuffer, _In_ VkBuffer Buffer, _In_ PVULKAN_IMAGE Image,
+                         _In_ UINT32 Width, _In_ UINT32 Height, _In_ VkImageLayout Layout)
+{
+    VkBufferImageCopy Region = {0};
+    Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    Region.imageSubresource.mipLevel = 0;
+    Region.imageSubresource.baseArrayLayer = 0;
+    Region.imageSubresource.layerCount = 1;
+    Region.imageExtent.width = Width;
+    Region.imageExtent.height = Height;
+    Region.imageExtent.depth = 1;
+    vkCmdCopyBufferToImage(TransferBuffer, Buffer, Image->Handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Region);
+
+    INT32 LevelWidth = (INT32)Width;
+    INT32 LevelHeight = (INT32)Height;
+    for (UINT32 i = 1; i < Image->MipLevels; i++)
+    {
+        // The previous level is finished once it's written, so it becomes the blit source
+        MipBarrier(TransferBuffer, Image->Handle, i - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        INT32 NextWidth = PURPL_MAX(LevelWidth / 2, 1);
+        INT32 NextHeight = PURPL_MAX(LevelHeight / 2, 1);
+
+        VkImageBlit Blit = {0};
+        Blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        Blit.srcSubresource.mipLevel = i - 1;
+        Blit.srcSubresource.layerCount = 1;
+        Blit.srcOffsets[1].x = LevelWidth;
+        Blit.srcOffsets[1].y = LevelHeight;
+        Blit.srcOffsets[1].z = 1;
+        Blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        Blit.dstSubresource.mipLevel = i;
+        Blit.dstSubresource.layerCount = 1;
+        Blit.dstOffsets[1].x = NextWidth;
+        Blit.dstOffsets[1].y = NextHeight;
+        Blit.dstOffsets[1].z = 1;
+        vkCmdBlitImage(TransferBuffer, Image->Handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Image->Handle,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Blit, VK_FILTER_LINEAR);
+
+        MipBarrier(TransferBuffer, Image->Handle, i - 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, Layout,
+                   VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+        LevelWidth = NextWidth;
+        LevelHeight = NextHeight;
+    }
+
+    MipBarrier(TransferBuffer, Image->Handle, Image->MipLevels - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, Layout,
+               VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+static VOID CopyMips(_In_ VkCommandBuffer TransferBuffer, _In_ VkBuffer Buffer, _In_ PVULKAN_IMAGE Image,
+                     _In_ UINT32 Width, _In_ UINT32 Height, _In_opt_ CONST UINT64 *LevelOffsets,
+                     _In_ VkImageLayout Layout)
+{
+    // Every level is already in the buffer, so they all go in one copy
+    VkBufferImageCopy Regions[ASSET_MAX_TEXTURE_MIPS] = {0};
+    UINT32 LevelCount = PURPL_MIN(Image->MipLevels, ASSET_MAX_TEXTURE_MIPS);
+    for (UINT32 i = 0; i < LevelCount; i++)
+    {
+        Regions[i].bufferOffset = LevelOffsets ? LevelOffsets[i] : 0;
+        Regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        Regions[i].imageSubresource.mipLevel = i;
+        Regions[i].imageSubresource.baseArrayLayer = 0;
+        Regions[i].imageSubresource.layerCount = 1;
+        Regions[i].imageExtent.width = PURPL_MAX(Width >> i, 1);
+        Regions[i].imageExtent.height = PURPL_MAX(Height >> i, 1);
+        Regions[i].imageExtent.depth = 1;
+    }
+
+    vkCmdCopyBufferToImage(TransferBuffer, Buffer, Image->Handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, LevelCount,
+                           Regions);
+    for (UINT32 i = 0; i < LevelCount; i++)
+    {
+        MipBarrier(TransferBuffer, Image->Handle, i, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, Layout,
+                   VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    }
 }
 
 VOID VlkCreateImageWithData(_In_ PVOID Data, _In_ VkDeviceSize Size, _In_ UINT32 Width, _In_ UINT32 Height,
+                            _In_ UINT32 MipLevels, _In_reads_opt_(MipLevels) CONST UINT64 *LevelOffsets,
                             _In_ VkFormat Format, _In_ VkImageLayout Layout, _In_ VkImageUsageFlags Usage,
-                            _In_ VmaMemoryUsage MemoryUsage, _In_ VkImageAspectFlags Aspect, _Out_ PVULKAN_IMAGE Image)
+                            _In_ VmaMemoryUsage MemoryUsage, _In_ VkImageAspectFlags Aspect,
+                            _Out_ PVULKAN_IMAGE Image)
 {
     VULKAN_BUFFER StagingBuffer;
     PVOID ImageBuffer;
@@ -223,14 +351,43 @@ VOID VlkCreateImageWithData(_In_ PVOID Data, _In_ VkDeviceSize Size, _In_ UINT32
     memcpy(ImageBuffer, Data, Size);
     vmaUnmapMemory(VlkData.Allocator, StagingBuffer.Allocation);
 
-    VlkCreateImage(Width, Height, Format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+    // The layout is left undefined so nothing is submitted yet, the transition goes in the same command buffer as the
+    // copies
+    VlkCreateImage(Width, Height, MipLevels, Format, VK_IMAGE_LAYOUT_UNDEFINED,
                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | Usage, MemoryUsage, Aspect,
                    Image);
 
-    VlkCopyBufferToImage(StagingBuffer.Buffer, Image->Handle, Width, Height);
-    VlkTransitionImageLayout(Image->Handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, Layout);
+    VkCommandBuffer TransferBuffer = VlkBeginTransfer();
+
+    VkImageMemoryBarrier Barrier = {0};
+    Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    Barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    Barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    Barrier.srcAccessMask = 0;
+    Barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    Barrier.image = Image->Handle;
+    Barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    Barrier.subresourceRange.baseMipLevel = 0;
+    Barrier.subresourceRange.levelCount = Image->MipLevels;
+    Barrier.subresourceRange.baseArrayLayer = 0;
+    Barrier.subresourceRange.layerCount = 1;
+    vkCmdPipelineBarrier(TransferBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL,
+                         0, NULL, 1, &Barrier);
+
+    if (!LevelOffsets && Image->MipLevels > 1)
+    {
+        GenerateMips(TransferBuffer, StagingBuffer.Buffer, Image, Width, Height, Layout);
+    }
+    else
+    {
+        CopyMips(TransferBuffer, StagingBuffer.Buffer, Image, Width, Height, LevelOffsets, Layout);
+    }
 
-    VlkFreeBuffer(&StagingBuffer);
+    // Frames submitted later are ordered after the barriers, so nothing has to wait for the upload to finish
+    VlkSubmitTransfer(TransferBuffer);
+    VlkRetireBuffer(&StagingBuffer);
 }
 
 VOID VlkDestroyImage(_Inout_ PVULKAN_IMAGE Image)
@@ -245,6 +402,7 @@ VOID VlkCreateSampler(VOID)
     VkSamplerCreateInfo CreateInformation = {0};
     CreateInformation.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     CreateInformation.magFilter = VK_FILTER_NEAREST;
+    CreateInformation.minFilter = VK_FILTER_LINEAR;
     CreateInformation.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
     CreateInformation.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
     CreateInformation.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
@@ -254,8 +412,8 @@ VOID VlkCreateSampler(VOID)
     CreateInformation.compareOp = VK_COMPARE_OP_NEVER;
     CreateInformation.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
     CreateInformation.minLod = 0.0;
-    CreateInformation.maxLod = FLT_MAX;
-    CreateInformation.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    CreateInformation.maxLod = VK_LOD_CLAMP_NONE;
+    CreateInformation.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 
     VULKAN_CHECK(vkCreateSampler(VlkData.Device, &CreateInformation, VlkGetAllocationCallbacks(), &VlkData.Sampler));
 }
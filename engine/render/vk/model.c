@@ -1,5 +1,25 @@
 #include "vk.h"
 
+static VOID CreateBuffers(_In_z_ PCSTR Name, _Out_ PVULKAN_MODEL_DATA ModelData, _In_ PMESH Mesh)
+{
+    RENDER_MESH_DATA MeshData;
+    RdrPrepareMesh(Mesh, &MeshData);
+
+    VlkAllocateBufferWithData((PVOID)MeshData.Vertices, (VkDeviceSize)MeshData.VertexCount * MeshData.VertexStride,
+                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &ModelData->VertexBuffer);
+    VlkNameBuffer(&ModelData->VertexBuffer, "Vertex buffer for %s", Name);
+    VlkAllocateBufferWithData((PVOID)MeshData.Indices, (VkDeviceSize)MeshData.IndexCount * MeshData.IndexSize,
+                              VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                              &ModelData->IndexBuffer);
+    VlkNameBuffer(&ModelData->IndexBuffer, "Index buffer for %s", Name);
+
+    ModelData->IndexType = MeshData.IndexSize == sizeof(UINT16) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    ModelData->IndexCount = MeshData.IndexCount;
+
+    RdrFreeMeshData(&MeshData);
+}
+
 VOID VlkCreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh)
 {
     PVULKAN_MODEL_DATA ModelData = CmnAllocType(1, VULKAN_MODEL_DATA);
@@ -8,33 +28,46 @@ VOID VlkCreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh)
         CmnError("Failed to allocate model data for %s: %s", Name, strerror(errno));
     }
 
-    VlkAllocateBufferWithData(Mesh->Vertices, Mesh->VertexCount * sizeof(MESH_VERTEX),
-                              VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &ModelData->VertexBuffer);
-    VlkNameBuffer(&ModelData->VertexBuffer, "Vertex buffer for %s", Name);
-    VlkAllocateBufferWithData(Mesh->Indices, Mesh->IndexCount * sizeof(ivec3), VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &ModelData->IndexBuffer);
-    VlkNameBuffer(&ModelData->IndexBuffer, "Index buffer for %s", Name);
+    CreateBuffers(Name, ModelData, Mesh);
 
     Model->MeshHandle = (RENDER_HANDLE)ModelData;
 }
 
+VOID VlkUpdateModel(_In_z_ PCSTR Name, _In_ PMODEL Model, _In_ PMESH Mesh)
+{
+    PVULKAN_MODEL_DATA ModelData = (PVULKAN_MODEL_DATA)Model->MeshHandle;
+    VlkFreeBuffer(&ModelData->IndexBuffer);
+    VlkFreeBuffer(&ModelData->VertexBuffer);
+    CreateBuffers(Name, ModelData, Mesh);
+}
+
 VOID VlkDrawModel(_In_ PMODEL Model, _In_ PRENDER_OBJECT_UNIFORM Uniform, _In_ PRENDER_OBJECT_DATA Data)
 {
     PVULKAN_MODEL_DATA ModelData = (PVULKAN_MODEL_DATA)Model->MeshHandle;
     PVULKAN_OBJECT_DATA ObjectData = (PVULKAN_OBJECT_DATA)Data->Handle;
     VkCommandBuffer CommandBuffer = VlkData.CommandBuffers[VlkData.FrameIndex];
 
+    // The texture was replaced, so the object needs a set with the new view
+    PVULKAN_IMAGE Texture = (PVULKAN_IMAGE)Model->Material->TextureHandle;
+    if (Texture->Generation != ObjectData->TextureGeneration)
+    {
+        VlkWriteObjectTexture(ObjectData, Texture);
+    }
+
     VkDescriptorSet DescriptorSets[] = {VlkData.SceneDescriptorSet, ObjectData->DescriptorSet};
 
     VULKAN_SET_UNIFORM(ObjectData->UniformBufferAddress, Uniform);
     VkDeviceSize Offset = 0;
     vkCmdBindVertexBuffers(CommandBuffer, 0, 1, &ModelData->VertexBuffer.Buffer, &Offset);
-    vkCmdBindIndexBuffer(CommandBuffer, ModelData->IndexBuffer.Buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindIndexBuffer(CommandBuffer, ModelData->IndexBuffer.Buffer, 0, ModelData->IndexType);
     vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, VlkData.PipelineLayout, 0,
                             PURPL_ARRAYSIZE(DescriptorSets), DescriptorSets, 0, NULL);
     vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, (VkPipeline)Model->Material->ShaderHandle);
-    vkCmdDrawIndexed(CommandBuffer, (UINT32)(ModelData->IndexBuffer.Size / sizeof(ivec3) * 3), 1, 0, 0, 0);
+
+    // Draw the level of detail RdrDrawModel picked, or everything if it didn't pick one
+    BOOLEAN DrawLod = Model->IndexCount && Model->FirstIndex + Model->IndexCount <= ModelData->IndexCount;
+    vkCmdDrawIndexed(CommandBuffer, DrawLod ? Model->IndexCount : ModelData->IndexCount, 1,
+                     DrawLod ? Model->FirstIndex : 0, 0, 0);
 }
 
 VOID VlkDestroyModel(_Inout_ PMODEL Model)
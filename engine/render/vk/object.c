@@ -11,6 +11,19 @@ VOID VlkInitializeObject(_In_z_ PCSTR Name, _Inout_ PRENDER_OBJECT_DATA Data, _I
     VlkCreateUniformBuffer(&ObjectData->UniformBuffer, &ObjectData->UniformBufferAddress,
                            sizeof(VULKAN_OBJECT_UNIFORM) * VULKAN_FRAME_COUNT);
 
+    VlkWriteObjectTexture(ObjectData, (PVULKAN_IMAGE)Model->Material->TextureHandle);
+
+    Data->Handle = (RENDER_HANDLE)ObjectData;
+}
+
+VOID VlkWriteObjectTexture(_Inout_ PVULKAN_OBJECT_DATA ObjectData, _In_ PVULKAN_IMAGE Texture)
+{
+    // Frames in flight could be using the old set, which can't be updated until they're done, so it gets replaced
+    if (ObjectData->DescriptorSet)
+    {
+        VlkRetireDescriptorSet(ObjectData->DescriptorSet);
+    }
+
     VkDescriptorSetAllocateInfo AllocateInformation = {0};
     AllocateInformation.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     AllocateInformation.descriptorPool = VlkData.DescriptorPool;
@@ -23,7 +36,6 @@ VOID VlkInitializeObject(_In_z_ PCSTR Name, _Inout_ PRENDER_OBJECT_DATA Data, _I
     UniformInformation.offset = 0;
     UniformInformation.range = sizeof(RENDER_OBJECT_UNIFORM);
 
-    PVULKAN_IMAGE Texture = (PVULKAN_IMAGE)Model->Material->TextureHandle;
     VkDescriptorImageInfo TextureInformation = {0};
     TextureInformation.sampler = VlkData.Sampler;
     TextureInformation.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -46,7 +58,7 @@ VOID VlkInitializeObject(_In_z_ PCSTR Name, _Inout_ PRENDER_OBJECT_DATA Data, _I
 
     vkUpdateDescriptorSets(VlkData.Device, PURPL_ARRAYSIZE(Writes), Writes, 0, NULL);
 
-    Data->Handle = (RENDER_HANDLE)ObjectData;
+    ObjectData->TextureGeneration = Texture->Generation;
 }
 
 VOID VlkDestroyObject(_Inout_ PRENDER_OBJECT_DATA Data)
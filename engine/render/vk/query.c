@@ -0,0 +1,155 @@
+#include "vk.h"
+
+// Only one thread renders, so there's only one thing adding to this
+static PVOID GpuTrack;
+
+VOID VlkCreateQueryPool(VOID)
+{
+    UINT32 ValidBits = VlkData.Gpu->QueueFamilyProperties[VlkData.Gpu->GraphicsFamilyIndex].timestampValidBits;
+    FLOAT Period = VlkData.Gpu->Properties.limits.timestampPeriod;
+
+    if (!ValidBits || Period <= 0.0f)
+    {
+        LogInfo("GPU can't write timestamps on its graphics queue, GPU times won't be measured");
+        return;
+    }
+
+    LogDebug("Creating timestamp query pool with %u queries", VULKAN_FRAME_COUNT * VULKAN_MAX_GPU_SCOPES * 2);
+
+    VkQueryPoolCreateInfo QueryPoolCreateInformation = {0};
+    QueryPoolCreateInformation.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    QueryPoolCreateInformation.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    QueryPoolCreateInformation.queryCount = VULKAN_FRAME_COUNT * VULKAN_MAX_GPU_SCOPES * 2;
+    VULKAN_CHECK(vkCreateQueryPool(VlkData.Device, &QueryPoolCreateInformation, VlkGetAllocationCallbacks(),
+                                   &VlkData.TimestampPool));
+    VlkSetObjectName((UINT64)VlkData.TimestampPool, VK_OBJECT_TYPE_QUERY_POOL, "Timestamp query pool");
+
+    VlkData.TimestampPeriod = Period;
+    VlkData.TimestampMask = ValidBits < 64 ? (1ull << ValidBits) - 1 : UINT64_MAX;
+
+    if (!GpuTrack)
+    {
+        GpuTrack = EngCreateProfileTrack("GPU");
+    }
+}
+
+VOID VlkDestroyQueryPool(VOID)
+{
+    if (VlkData.TimestampPool)
+    {
+        LogDebug("Destroying timestamp query pool 0x%llX", (UINT64)VlkData.TimestampPool);
+        vkDestroyQueryPool(VlkData.Device, VlkData.TimestampPool, VlkGetAllocationCallbacks());
+        VlkData.TimestampPool = VK_NULL_HANDLE;
+    }
+}
+
+static UINT32 GetFirstQuery(VOID)
+{
+    return VlkData.FrameIndex * VULKAN_MAX_GPU_SCOPES * 2;
+}
+
+static VOID ReadResults(_Inout_ PVULKAN_FRAME_QUERIES Queries)
+{
+    UINT64 Results[VULKAN_MAX_GPU_SCOPES * 2][2]; // the timestamp, then whether it was written
+
+    // The frame's fence has been waited for, so this doesn't wait for anything
+    VkResult Result = vkGetQueryPoolResults(VlkData.Device, VlkData.TimestampPool, GetFirstQuery(),
+                                            Queries->ScopeCount * 2, sizeof(Results), Results, sizeof(Results[0]),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (Result != VK_SUCCESS && Result != VK_NOT_READY)
+    {
+        LogWarning("Failed to get timestamps: %s (VkResult %d)", VlkGetResultString(Result), Result);
+        return;
+    }
+
+    // Everything is measured from when the main render pass, which is always the first scope, started
+    if (!Results[0][1] || !Results[1][1])
+    {
+        return;
+    }
+    UINT64 First = Results[0][0];
+
+    // The GPU's clock isn't the CPU's, so the frame goes where it could've started, once it was submitted and the one
+    // before it was done
+    UINT64 Base = PURPL_MAX(Queries->SubmitTime, VlkData.LastGpuEnd);
+
+    for (UINT32 i = 0; i < Queries->ScopeCount; i++)
+    {
+        if (!Results[i * 2][1] || !Results[i * 2 + 1][1])
+        {
+            continue;
+        }
+
+        UINT64 Start = (UINT64)(((Results[i * 2][0] - First) & VlkData.TimestampMask) * VlkData.TimestampPeriod);
+        UINT64 End = (UINT64)(((Results[i * 2 + 1][0] - First) & VlkData.TimestampMask) * VlkData.TimestampPeriod);
+        if (i == 0)
+        {
+            VlkData.GpuFrameTime = (End - Start) / 1000000.0;
+            VlkData.LastGpuEnd = Base + End;
+        }
+
+        EngAddProfileZone(GpuTrack, Queries->Scopes[i], Base + Start, Base + End);
+    }
+}
+
+VOID VlkBeginFrameQueries(_In_ VkCommandBuffer CommandBuffer)
+{
+    if (!VlkData.TimestampPool)
+    {
+        return;
+    }
+
+    PVULKAN_FRAME_QUERIES Queries = &VlkData.FrameQueries[VlkData.FrameIndex];
+    if (Queries->Submitted && Queries->ScopeCount)
+    {
+        ReadResults(Queries);
+    }
+
+    Queries->ScopeCount = 0;
+    Queries->Submitted = FALSE;
+    vkCmdResetQueryPool(CommandBuffer, VlkData.TimestampPool, GetFirstQuery(), VULKAN_MAX_GPU_SCOPES * 2);
+}
+
+VOID VlkEndFrameQueries(VOID)
+{
+    if (!VlkData.TimestampPool)
+    {
+        return;
+    }
+
+    PVULKAN_FRAME_QUERIES Queries = &VlkData.FrameQueries[VlkData.FrameIndex];
+    Queries->SubmitTime = EngGetProfileTime();
+    Queries->Submitted = TRUE;
+}
+
+UINT32 VlkBeginGpuScope(_In_ VkCommandBuffer CommandBuffer, _In_ PCENGINE_PROFILE_SOURCE Source)
+{
+    if (!VlkData.TimestampPool)
+    {
+        return UINT32_MAX;
+    }
+
+    PVULKAN_FRAME_QUERIES Queries = &VlkData.FrameQueries[VlkData.FrameIndex];
+    if (Queries->ScopeCount >= VULKAN_MAX_GPU_SCOPES)
+    {
+        return UINT32_MAX;
+    }
+
+    UINT32 Scope = Queries->ScopeCount++;
+    Queries->Scopes[Scope] = Source;
+    vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VlkData.TimestampPool,
+                        GetFirstQuery() + Scope * 2);
+
+    return Scope;
+}
+
+VOID VlkEndGpuScope(_In_ VkCommandBuffer CommandBuffer, _In_ UINT32 Scope)
+{
+    if (!VlkData.TimestampPool || Scope == UINT32_MAX)
+    {
+        return;
+    }
+
+    vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VlkData.TimestampPool,
+                        GetFirstQuery() + Scope * 2 + 1);
+}
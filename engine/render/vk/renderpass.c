@@ -83,12 +83,12 @@ VOID VlkCreateMainRenderPass(VOID)
 VOID VlkCreateRenderTargets(VOID)
 {
     LogDebug("Creating color image");
-    VlkCreateImage(RdrGetWidth(), RdrGetHeight(), VlkData.SurfaceFormat.format,
+    VlkCreateImage(RdrGetWidth(), RdrGetHeight(), 1, VlkData.SurfaceFormat.format,
                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
                    VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_ASPECT_COLOR_BIT, &VlkData.ColorTarget);
 
     LogDebug("Creating depth image");
-    VlkCreateImage(RdrGetWidth(), RdrGetHeight(), VK_FORMAT_D32_SFLOAT_S8_UINT,
+    VlkCreateImage(RdrGetWidth(), RdrGetHeight(), 1, VK_FORMAT_D32_SFLOAT_S8_UINT,
                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
                    VMA_MEMORY_USAGE_GPU_ONLY, VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_DEPTH_BIT,
                    &VlkData.DepthTarget);
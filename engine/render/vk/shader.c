@@ -7,6 +7,13 @@ static CONST VkVertexInputAttributeDescription TexturedVertexAttributeDescriptio
     {3, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(MESH_VERTEX, Normal)},
 };
 
+static CONST VkVertexInputAttributeDescription PackedVertexAttributeDescriptions[] = {
+    {0, 0, VK_FORMAT_R16G16B16A16_SFLOAT, offsetof(RENDER_PACKED_VERTEX, Position)},
+    {1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(RENDER_PACKED_VERTEX, Colour)},
+    {2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(RENDER_PACKED_VERTEX, TextureCoordinate)},
+    {3, 0, VK_FORMAT_R8G8B8A8_SNORM, offsetof(RENDER_PACKED_VERTEX, Normal)},
+};
+
 VOID VlkCreatePipelineLayout(VOID)
 {
     LogDebug("Creating pipeline layout");
@@ -34,39 +41,75 @@ VOID VlkCreateUniformBuffer(_Out_ PVULKAN_BUFFER UniformBuffer, _Out_ PVOID *Uni
     VULKAN_CHECK(vmaMapMemory(VlkData.Allocator, UniformBuffer->Allocation, UniformBufferAddress));
 }
 
-RENDER_HANDLE VlkLoadShader(_In_z_ PCSTR Name)
+// A reload that fails leaves the old pipeline in place, anything else has nothing to fall back on
+static BOOLEAN CheckShaderResult(_In_ VkResult Result, _In_z_ PCSTR Call, _In_z_ PCSTR Name, _In_ BOOLEAN Reload)
 {
-    LogDebug("Creating pipeline for shader %s", Name);
+    if (Result == VK_SUCCESS)
+    {
+        return TRUE;
+    }
 
-    UINT64 VertexShaderSize = 0;
-    PVOID VertexShader = FsReadFile(FALSE, EngGetAssetPath(EngAssetDirectoryShaders, "vulkan/%s.vs.spv", Name), 0, 0,
-                                    &VertexShaderSize, 0);
+    if (!Reload)
+    {
+        CmnError("Vulkan call %s for shader %s: %s (VkResult %d)", Call, Name, VlkGetResultString(Result), Result);
+    }
+    LogError("Vulkan call %s for shader %s: %s (VkResult %d)", Call, Name, VlkGetResultString(Result), Result);
+    return FALSE;
+}
 
-    UINT64 FragmentShaderSize = 0;
-    PVOID FragmentShader = FsReadFile(FALSE, EngGetAssetPath(EngAssetDirectoryShaders, "vulkan/%s.ps.spv", Name), 0, 0,
-                                      &FragmentShaderSize, 0);
+RENDER_HANDLE VlkLoadShader(_In_z_ PCSTR Name, _In_ BOOLEAN Reload)
+{
+    VkShaderModule VertexModule = VK_NULL_HANDLE;
+    VkShaderModule FragmentModule = VK_NULL_HANDLE;
+    VkPipeline Pipeline = VK_NULL_HANDLE;
 
-    if (!VertexShaderSize || !FragmentShaderSize)
+    LogDebug("Creating pipeline for shader %s", Name);
+
+    // Pack entries are aligned, so SPIR-V can be used straight from the mapping
+    ASSET_VIEW VertexShader = {0};
+    ASSET_VIEW FragmentShader = {0};
+    if (!AstOpenView(EngGetAssetPath(EngAssetDirectoryShaders, "vulkan/%s.vs.spv", Name), &VertexShader) ||
+        !AstOpenView(EngGetAssetPath(EngAssetDirectoryShaders, "vulkan/%s.ps.spv", Name), &FragmentShader))
     {
-        CmnError("Vulkan shader for %s not found", Name);
+        if (!Reload)
+        {
+            CmnError("Vulkan shader for %s not found", Name);
+        }
+        LogError("Vulkan shader for %s not found", Name);
+        AstCloseView(&VertexShader);
+        AstCloseView(&FragmentShader);
+        return 0;
     }
 
     VkShaderModuleCreateInfo VertexCreateInformation = {0};
     VertexCreateInformation.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    VertexCreateInformation.pCode = VertexShader;
-    VertexCreateInformation.codeSize = VertexShaderSize;
+    VertexCreateInformation.pCode = VertexShader.Data;
+    VertexCreateInformation.codeSize = VertexShader.Size;
 
     VkShaderModuleCreateInfo FragmentCreateInformation = {0};
     FragmentCreateInformation.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    FragmentCreateInformation.pCode = FragmentShader;
-    FragmentCreateInformation.codeSize = FragmentShaderSize;
+    FragmentCreateInformation.pCode = FragmentShader.Data;
+    FragmentCreateInformation.codeSize = FragmentShader.Size;
 
-    VkShaderModule VertexModule = VK_NULL_HANDLE;
-    VULKAN_CHECK(
-        vkCreateShaderModule(VlkData.Device, &VertexCreateInformation, VlkGetAllocationCallbacks(), &VertexModule));
-    VkShaderModule FragmentModule = VK_NULL_HANDLE;
-    VULKAN_CHECK(
-        vkCreateShaderModule(VlkData.Device, &FragmentCreateInformation, VlkGetAllocationCallbacks(), &FragmentModule));
+    // Handles written by a failed call aren't valid, so they're reset before the cleanup destroys them
+    if (!CheckShaderResult(vkCreateShaderModule(VlkData.Device, &VertexCreateInformation, VlkGetAllocationCallbacks(),
+                                                &VertexModule),
+                           "vkCreateShaderModule", Name, Reload))
+    {
+        VertexModule = VK_NULL_HANDLE;
+    }
+    else if (!CheckShaderResult(vkCreateShaderModule(VlkData.Device, &FragmentCreateInformation,
+                                                     VlkGetAllocationCallbacks(), &FragmentModule),
+                                "vkCreateShaderModule", Name, Reload))
+    {
+        FragmentModule = VK_NULL_HANDLE;
+    }
+    AstCloseView(&VertexShader);
+    AstCloseView(&FragmentShader);
+    if (!VertexModule || !FragmentModule)
+    {
+        goto Done;
+    }
 
     CONST VkDynamicState DynamicStates[] = {
         VK_DYNAMIC_STATE_VIEWPORT,
@@ -96,12 +139,17 @@ RENDER_HANDLE VlkLoadShader(_In_z_ PCSTR Name)
 
     VkVertexInputBindingDescription VertexBindingDescription = {0};
     VertexBindingDescription.binding = 0;
-    VertexBindingDescription.stride = sizeof(MESH_VERTEX);
+    VertexBindingDescription.stride = RdrGetVertexStride();
     VertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
     // TODO: when multiple types of "renderable" are added, make dynamic
-    VkVertexInputAttributeDescription *VertexAttributeDescriptions = TexturedVertexAttributeDescriptions;
+    CONST VkVertexInputAttributeDescription *VertexAttributeDescriptions = TexturedVertexAttributeDescriptions;
     UINT32 VertexAttributeCount = (UINT32)PURPL_ARRAYSIZE(TexturedVertexAttributeDescriptions);
+    if (RdrGetVertexFormat() == RenderVertexFormatPacked)
+    {
+        VertexAttributeDescriptions = PackedVertexAttributeDescriptions;
+        VertexAttributeCount = (UINT32)PURPL_ARRAYSIZE(PackedVertexAttributeDescriptions);
+    }
 
     VkPipelineInputAssemblyStateCreateInfo InputAssemblyState = {0};
     InputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -181,11 +229,18 @@ RENDER_HANDLE VlkLoadShader(_In_z_ PCSTR Name)
     PipelineCreateInformation.layout = VlkData.PipelineLayout;
     PipelineCreateInformation.renderPass = VlkData.MainRenderPass;
 
-    VkPipeline Pipeline = VK_NULL_HANDLE;
-    VULKAN_CHECK(vkCreateGraphicsPipelines(VlkData.Device, VK_NULL_HANDLE, 1, &PipelineCreateInformation,
-                                           VlkGetAllocationCallbacks(), &Pipeline));
-    VlkSetObjectName((UINT64)Pipeline, VK_OBJECT_TYPE_PIPELINE, "%s pipeline", Name);
+    if (CheckShaderResult(vkCreateGraphicsPipelines(VlkData.Device, VK_NULL_HANDLE, 1, &PipelineCreateInformation,
+                                                    VlkGetAllocationCallbacks(), &Pipeline),
+                          "vkCreateGraphicsPipelines", Name, Reload))
+    {
+        VlkSetObjectName((UINT64)Pipeline, VK_OBJECT_TYPE_PIPELINE, "%s pipeline", Name);
+    }
+    else
+    {
+        Pipeline = VK_NULL_HANDLE;
+    }
 
+Done:
     vkDestroyShaderModule(VlkData.Device, VertexModule, VlkGetAllocationCallbacks());
     vkDestroyShaderModule(VlkData.Device, FragmentModule, VlkGetAllocationCallbacks());
 
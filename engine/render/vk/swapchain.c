@@ -138,7 +138,7 @@ VOID VlkCreateSwapChain(VOID)
     for (i = 0; i < stbds_arrlenu(VlkData.SwapChainImageViews); i++)
     {
         VlkCreateImageView(&VlkData.SwapChainImageViews[i], VlkData.SwapChainImages[i], VlkData.SurfaceFormat.format,
-                           VK_IMAGE_ASPECT_COLOR_BIT);
+                           VK_IMAGE_ASPECT_COLOR_BIT, 1);
         VlkSetObjectName((UINT64)VlkData.SwapChainImages[i], VK_OBJECT_TYPE_IMAGE, "Swap chain image %u", i);
         VlkSetObjectName((UINT64)VlkData.SwapChainImageViews[i], VK_OBJECT_TYPE_IMAGE_VIEW, "Swap chain image view %u", i);
     }
@@ -21,3 +21,96 @@ VOID VlkCreateSemaphores(VOID)
                          "Render completion semaphore %u", i);
     }
 }
+
+static VOID Retire(_In_ PVULKAN_RETIRED_OBJECT Object)
+{
+    Object->Frame = VlkData.FrameNumber;
+    stbds_arrpush(VlkData.RetiredObjects, *Object);
+}
+
+VOID VlkRetireImage(_In_ PVULKAN_IMAGE Image)
+{
+    VULKAN_RETIRED_OBJECT Object = {0};
+    Object.Image = *Image;
+    Retire(&Object);
+}
+
+VOID VlkRetireBuffer(_In_ PVULKAN_BUFFER Buffer)
+{
+    VULKAN_RETIRED_OBJECT Object = {0};
+    Object.Buffer = *Buffer;
+    Retire(&Object);
+}
+
+VOID VlkRetireDescriptorSet(_In_ VkDescriptorSet DescriptorSet)
+{
+    VULKAN_RETIRED_OBJECT Object = {0};
+    Object.DescriptorSet = DescriptorSet;
+    Retire(&Object);
+}
+
+VOID VlkSubmitTransfer(_In_ VkCommandBuffer TransferBuffer)
+{
+    VULKAN_RETIRED_OBJECT Object = {0};
+    Object.CommandBuffer = TransferBuffer;
+
+    VkFenceCreateInfo FenceCreateInformation = {0};
+    FenceCreateInformation.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VULKAN_CHECK(vkCreateFence(VlkData.Device, &FenceCreateInformation, VlkGetAllocationCallbacks(), &Object.Fence));
+
+    VULKAN_CHECK(vkEndCommandBuffer(TransferBuffer));
+
+    VkSubmitInfo SubmitInformation = {0};
+    SubmitInformation.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitInformation.commandBufferCount = 1;
+    SubmitInformation.pCommandBuffers = &TransferBuffer;
+    VULKAN_CHECK(vkQueueSubmit(VlkData.GraphicsQueue, 1, &SubmitInformation, Object.Fence));
+
+    Retire(&Object);
+}
+
+VOID VlkFreeRetiredObjects(_In_ BOOLEAN All)
+{
+    // A frame's fence is waited for before its slot is reused, so once the frame being recorded has waited, every frame
+    // VULKAN_FRAME_COUNT or more before it is done
+    for (SIZE_T i = 0; i < stbds_arrlenu(VlkData.RetiredObjects);)
+    {
+        PVULKAN_RETIRED_OBJECT Object = &VlkData.RetiredObjects[i];
+        if (!All && Object->Frame + VULKAN_FRAME_COUNT > VlkData.FrameNumber)
+        {
+            i++;
+            continue;
+        }
+
+        // Transfers aren't part of a frame, so they're waited for on their own, but they're done long before this
+        if (Object->Fence)
+        {
+            VULKAN_CHECK(vkWaitForFences(VlkData.Device, 1, &Object->Fence, TRUE, UINT64_MAX));
+            vkDestroyFence(VlkData.Device, Object->Fence, VlkGetAllocationCallbacks());
+        }
+        if (Object->CommandBuffer)
+        {
+            vkFreeCommandBuffers(VlkData.Device, VlkData.TransferCommandPool, 1, &Object->CommandBuffer);
+        }
+        if (Object->Image.Handle)
+        {
+            VlkDestroyImage(&Object->Image);
+        }
+        if (Object->Buffer.Buffer)
+        {
+            VlkFreeBuffer(&Object->Buffer);
+        }
+        if (Object->DescriptorSet)
+        {
+            vkFreeDescriptorSets(VlkData.Device, VlkData.DescriptorPool, 1, &Object->DescriptorSet);
+        }
+
+        stbds_arrdelswap(VlkData.RetiredObjects, i);
+    }
+
+    if (All)
+    {
+        stbds_arrfree(VlkData.RetiredObjects);
+        VlkData.RetiredObjects = NULL;
+    }
+}
@@ -1,33 +1,89 @@
 #include "vk.h"
 
-RENDER_HANDLE VlkUseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name)
+static VkFormat GetFormat(_In_ UINT32 Format)
 {
-    VkFormat Format;
-    switch (Texture->Format)
+    switch (Format)
     {
     default:
     case TextureFormatRgba8:
-        Format = VK_FORMAT_R8G8B8A8_SRGB;
-        break;
+        return VK_FORMAT_R8G8B8A8_SRGB;
     case TextureFormatDepth:
-        Format = VK_FORMAT_D32_SFLOAT;
-        break;
+        return VK_FORMAT_D32_SFLOAT;
+    case AssetTextureFormatBc1:
+        return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case AssetTextureFormatBc3:
+        return VK_FORMAT_BC3_SRGB_BLOCK;
+    case AssetTextureFormatBc7:
+        return VK_FORMAT_BC7_SRGB_BLOCK;
     }
+}
+
+BOOLEAN VlkSupportsTextureFormat(_In_ UINT32 Format)
+{
+    if (AstIsBlockCompressed(Format) && !VlkData.Gpu->Features.textureCompressionBC)
+    {
+        return FALSE;
+    }
+
+    VkFormatProperties Properties = {0};
+    vkGetPhysicalDeviceFormatProperties(VlkData.Gpu->Device, GetFormat(Format), &Properties);
+    return (Properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+}
 
+static VOID CreateTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _Out_ PVULKAN_IMAGE Image)
+{
+    VkFormat Format = GetFormat(Texture->Format);
+
+    // Cooked textures come with every level, which are copied as they are
+    UINT64 LevelOffsets[ASSET_MAX_TEXTURE_MIPS];
+    UINT64 Size = 0;
+    UINT32 LoadedLevels = PURPL_MIN(PURPL_MAX(MipCount, 1), ASSET_MAX_TEXTURE_MIPS);
+    for (UINT32 i = 0; i < LoadedLevels; i++)
+    {
+        LevelOffsets[i] = Size;
+        Size += AstGetTextureLevelSize(Texture->Format, Texture->Width, Texture->Height, i);
+    }
+
+    // Otherwise the rest are blitted from the first, which depth and compressed formats can't do
+    UINT32 MipLevels = LoadedLevels;
+    if (LoadedLevels == 1 && Texture->Format != TextureFormatDepth && !AstIsBlockCompressed(Texture->Format))
+    {
+        MipLevels = VlkGetMipLevels(Texture->Width, Texture->Height, Format);
+    }
+
+    VlkCreateImageWithData(
+        Texture->Pixels, Size, Texture->Width, Texture->Height, MipLevels, LoadedLevels > 1 ? LevelOffsets : NULL,
+        Format, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT,
+        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+        Texture->Format == TextureFormatDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT, Image);
+}
+
+RENDER_HANDLE VlkUseTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name)
+{
     PVULKAN_IMAGE Image = CmnAllocType(1, VULKAN_IMAGE);
     if (!Image)
     {
         CmnError("Failed to allocate image data for %s: %s", Name, strerror(errno));
     }
 
-    VlkCreateImageWithData(
-        Texture->Pixels, GetTextureSize(*Texture), Texture->Width, Texture->Height, Format,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
-        Texture->Format == TextureFormatDepth ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT, Image);
+    CreateTexture(Texture, MipCount, Image);
 
     return (RENDER_HANDLE)Image;
 }
 
+VOID VlkUpdateTexture(_In_ RENDER_HANDLE Handle, _In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name)
+{
+    UNREFERENCED_PARAMETER(Name);
+
+    // Frames in flight can still be sampling the old image, and objects using it notice it changed and get new
+    // descriptor sets when they're drawn
+    PVULKAN_IMAGE Image = (PVULKAN_IMAGE)Handle;
+    UINT32 Generation = Image->Generation;
+    VlkRetireImage(Image);
+    CreateTexture(Texture, MipCount, Image);
+    Image->Generation = Generation + 1;
+}
+
 VOID VlkDestroyTexture(_In_ RENDER_HANDLE Handle)
 {
     PVULKAN_IMAGE Image = (PVULKAN_IMAGE)Handle;
@@ -252,9 +252,16 @@ VOID VlkEndTransfer(_In_ VkCommandBuffer TransferBuffer)
     SubmitInformation.commandBufferCount = 1;
     SubmitInformation.pCommandBuffers = &TransferBuffer;
 
+    // Only this submission is waited for, not the frames in flight
+    VkFenceCreateInfo FenceCreateInformation = {0};
+    FenceCreateInformation.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence Fence;
+    VULKAN_CHECK(vkCreateFence(VlkData.Device, &FenceCreateInformation, VlkGetAllocationCallbacks(), &Fence));
+
     // LogTrace("Submitting transfer command buffer");
-    vkQueueSubmit(VlkData.GraphicsQueue, 1, &SubmitInformation, VK_NULL_HANDLE);
-    vkQueueWaitIdle(VlkData.GraphicsQueue);
+    vkQueueSubmit(VlkData.GraphicsQueue, 1, &SubmitInformation, Fence);
+    VULKAN_CHECK(vkWaitForFences(VlkData.Device, 1, &Fence, TRUE, UINT64_MAX));
+    vkDestroyFence(VlkData.Device, Fence, VlkGetAllocationCallbacks());
 
     // LogTrace("Destroying transfer command buffer");
     vkFreeCommandBuffers(VlkData.Device, VlkData.TransferCommandPool, 1, &TransferBuffer);
@@ -45,6 +45,9 @@ END_EXTERN_C
 #define VULKAN_FRAME_COUNT 3
 #define VULKAN_MAX_DESCRIPTOR_SETS 1000
 
+/// @brief Most GPU scopes timed in a frame, each one uses two timestamp queries
+#define VULKAN_MAX_GPU_SCOPES 32
+
 /// @brief Hard error if a VkResult isn't VK_SUCCESS
 ///
 /// @param[in] Call The call/expression to check
@@ -71,6 +74,8 @@ PURPL_MAKE_TAG(struct, VULKAN_BUFFER, {
 PURPL_MAKE_TAG(struct, VULKAN_MODEL_DATA, {
     VULKAN_BUFFER VertexBuffer;
     VULKAN_BUFFER IndexBuffer;
+    VkIndexType IndexType;
+    UINT32 IndexCount;
 })
 
 #define VULKAN_UNIFORM_ALIGNMENT 64
@@ -93,6 +98,15 @@ PURPL_MAKE_TAG(struct, VULKAN_OBJECT_DATA, {
     VkDescriptorSet DescriptorSet;
     VULKAN_BUFFER UniformBuffer;
     PVULKAN_OBJECT_UNIFORM UniformBufferAddress;
+    UINT32 TextureGeneration; // of the texture in the descriptor set, rewritten if the texture is replaced
+})
+
+/// @brief The timestamp queries of a frame
+PURPL_MAKE_TAG(struct, VULKAN_FRAME_QUERIES, {
+    PCENGINE_PROFILE_SOURCE Scopes[VULKAN_MAX_GPU_SCOPES]; // the timestamps of scope i are queries i * 2 and i * 2 + 1
+    UINT32 ScopeCount;
+    UINT64 SubmitTime; // from EngGetProfileTime
+    BOOLEAN Submitted; // the results haven't been read yet
 })
 
 /// @brief Information about a GPU
@@ -100,6 +114,7 @@ PURPL_MAKE_TAG(struct, VULKAN_GPU_INFO, {
     VkPhysicalDevice Device;
 
     VkPhysicalDeviceProperties Properties;
+    VkPhysicalDeviceFeatures Features;
     VkPhysicalDeviceMemoryProperties MemoryProperties;
 
     VkSurfaceCapabilitiesKHR SurfaceCapabilities;
@@ -122,6 +137,18 @@ PURPL_MAKE_TAG(struct, VULKAN_IMAGE, {
     VmaAllocation Allocation;
     VkImageView View;
     VkFormat Format;
+    UINT32 MipLevels;
+    UINT32 Generation; // incremented when the image is replaced
+})
+
+/// @brief Something a frame in flight could still be using, freed once every frame up to Frame is done
+PURPL_MAKE_TAG(struct, VULKAN_RETIRED_OBJECT, {
+    UINT64 Frame;                  // the frame being recorded when it was retired
+    VULKAN_IMAGE Image;            // destroyed if Handle isn't NULL
+    VULKAN_BUFFER Buffer;          // freed if Buffer isn't NULL
+    VkDescriptorSet DescriptorSet; // freed if it isn't NULL
+    VkCommandBuffer CommandBuffer; // a transfer that wasn't waited for, freed once Fence signals
+    VkFence Fence;
 })
 
 /// @brief Vulkan data
@@ -231,6 +258,12 @@ PURPL_MAKE_TAG(struct, VULKAN_DATA, {
     /// @brief Current frame index
     UINT8 FrameIndex;
 
+    /// @brief Number of frames submitted
+    UINT64 FrameNumber;
+
+    /// @brief Objects waiting for the frames that could use them to finish
+    PVULKAN_RETIRED_OBJECT RetiredObjects;
+
     /// @brief Whether Vulkan is initialized
     BOOLEAN Initialized;
 
@@ -245,6 +278,27 @@ PURPL_MAKE_TAG(struct, VULKAN_DATA, {
 
     /// @brief Sampler
     VkSampler Sampler;
+
+    /// @brief Timestamp queries, VULKAN_MAX_GPU_SCOPES * 2 for each frame, NULL if the GPU can't write timestamps
+    VkQueryPool TimestampPool;
+
+    /// @brief Nanoseconds per timestamp tick
+    DOUBLE TimestampPeriod;
+
+    /// @brief The bits of a timestamp that are valid
+    UINT64 TimestampMask;
+
+    /// @brief Timestamp queries of each frame
+    VULKAN_FRAME_QUERIES FrameQueries[VULKAN_FRAME_COUNT];
+
+    /// @brief Scope of the main render pass in the current frame
+    UINT32 MainPassScope;
+
+    /// @brief Milliseconds the main render pass of the last frame with results took on the GPU
+    DOUBLE GpuFrameTime;
+
+    /// @brief When the last frame with results finished on the GPU, from EngGetProfileTime
+    UINT64 LastGpuEnd;
 })
 
 extern VULKAN_DATA VlkData;
@@ -299,6 +353,68 @@ extern VOID VlkCreateCommandPools(VOID);
 /// @brief Allocate the main command buffers
 extern VOID VlkAllocateCommandBuffers(VOID);
 
+/// @brief Destroy an image once the frames that could be using it are done
+///
+/// @param[in] Image The image, which is copied and can be reused right away
+extern VOID VlkRetireImage(_In_ PVULKAN_IMAGE Image);
+
+/// @brief Free a buffer once the frames that could be using it are done
+///
+/// @param[in] Buffer The buffer, which is copied and can be reused right away
+extern VOID VlkRetireBuffer(_In_ PVULKAN_BUFFER Buffer);
+
+/// @brief Free a descriptor set once the frames that could be using it are done
+///
+/// @param[in] DescriptorSet The descriptor set
+extern VOID VlkRetireDescriptorSet(_In_ VkDescriptorSet DescriptorSet);
+
+/// @brief Free retired objects
+///
+/// @param[in] All Whether to free everything, which the caller has to have waited for the device to be idle for, or
+/// only what the frames whose fences have been waited for were using
+extern VOID VlkFreeRetiredObjects(_In_ BOOLEAN All);
+
+/// @brief Create the timestamp query pool, if the GPU supports timestamps
+extern VOID VlkCreateQueryPool(VOID);
+
+/// @brief Destroy the timestamp query pool
+extern VOID VlkDestroyQueryPool(VOID);
+
+/// @brief Read the results of the last frame to use the current frame's queries and reset them, the frame's fence has
+/// to have been waited for
+///
+/// @param[in] CommandBuffer The frame's command buffer, outside a render pass
+extern VOID VlkBeginFrameQueries(_In_ VkCommandBuffer CommandBuffer);
+
+/// @brief Note when the current frame's queries were submitted, right before the frame is submitted
+extern VOID VlkEndFrameQueries(VOID);
+
+/// @brief Start timing commands on the GPU
+///
+/// @param[in] CommandBuffer The frame's command buffer
+/// @param[in] Source What the scope is, has to stay valid until the profiler is shut down
+///
+/// @return The scope, to pass to VlkEndGpuScope
+extern UINT32 VlkBeginGpuScope(_In_ VkCommandBuffer CommandBuffer, _In_ PCENGINE_PROFILE_SOURCE Source);
+
+/// @brief Stop timing a scope from VlkBeginGpuScope
+///
+/// @param[in] CommandBuffer The frame's command buffer
+/// @param[in] Scope The scope
+extern VOID VlkEndGpuScope(_In_ VkCommandBuffer CommandBuffer, _In_ UINT32 Scope);
+
+/// @brief Start a GPU scope with a static name
+///
+/// @param[in] CommandBuffer The frame's command buffer
+/// @param[in] ScopeName The name of the scope
+/// @param[out] Scope Receives the scope, to pass to VlkEndGpuScope
+#define VULKAN_BEGIN_GPU_SCOPE(CommandBuffer, ScopeName, Scope)                                                        \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        static CONST ENGINE_PROFILE_SOURCE GpuScopeSource_ = {(ScopeName), __FILE__, __LINE__};                        \
+        (Scope) = VlkBeginGpuScope((CommandBuffer), &GpuScopeSource_);                                                 \
+    } while (0)
+
 /// @brief Allocate a buffer
 ///
 /// @param[in] Size The size of the buffer
@@ -337,6 +453,14 @@ extern VkCommandBuffer VlkBeginTransfer(VOID);
 /// submit and free
 extern VOID VlkEndTransfer(_In_ VkCommandBuffer TransferBuffer);
 
+/// @brief Submits a command buffer from VlkBeginTransfer without waiting for it
+///
+/// Frames submitted after it are ordered after it by its barriers, so they can use what it writes. The command buffer
+/// is retired, and freed once it's done.
+///
+/// @param[in] TransferBuffer The transfer command buffer from VlkBeginTransfer to submit
+extern VOID VlkSubmitTransfer(_In_ VkCommandBuffer TransferBuffer);
+
 /// @brief Copy a buffer to another buffer
 ///
 /// @param[in] Source The source buffer
@@ -350,8 +474,9 @@ extern VOID VlkCopyBuffer(_In_ PVULKAN_BUFFER Source, _In_ PVULKAN_BUFFER Destin
 /// @param[in] Image The image to create the view for
 /// @param[in] Format The format of the image
 /// @param[in] Aspect The aspect of the image for the view
+/// @param[in] MipLevels The number of mip levels the view covers
 extern VOID VlkCreateImageView(_Out_ VkImageView *ImageView, _In_ VkImage Image, _In_ VkFormat Format,
-                               _In_ VkImageAspectFlags Aspect);
+                               _In_ VkImageAspectFlags Aspect, _In_ UINT32 MipLevels);
 
 /// @brief Chooses a format
 ///
@@ -369,7 +494,9 @@ extern VkFormat VlkChooseFormat(_In_ VkFormat *Formats, _In_ UINT32 FormatCount,
 /// @param[in,out] Image The image to transition the layout of
 /// @param[in] OldLayout The current layout of the image
 /// @param[in] NewLayout The layout to transition it to
-extern VOID VlkTransitionImageLayout(_Inout_ VkImage Image, _In_ VkImageLayout OldLayout, _In_ VkImageLayout NewLayout);
+/// @param[in] MipLevels The number of mip levels in the image
+extern VOID VlkTransitionImageLayout(_Inout_ VkImage Image, _In_ VkImageLayout OldLayout, _In_ VkImageLayout NewLayout,
+                                     _In_ UINT32 MipLevels);
 
 /// @brief Copy a buffer into an image
 ///
@@ -379,26 +506,39 @@ extern VOID VlkTransitionImageLayout(_Inout_ VkImage Image, _In_ VkImageLayout O
 /// @param[in] Height The height of the image
 extern VOID VlkCopyBufferToImage(_In_ VkBuffer Buffer, _Out_ VkImage Image, _In_ UINT32 Width, _In_ UINT32 Height);
 
+/// @brief Get the length of the mip chain an image can have
+///
+/// @param[in] Width The width of the image
+/// @param[in] Height The height of the image
+/// @param[in] Format The format of the image
+///
+/// @return The number of levels down to 1x1, or 1 if the format can't be blitted to generate them
+extern UINT32 VlkGetMipLevels(_In_ UINT32 Width, _In_ UINT32 Height, _In_ VkFormat Format);
+
 /// @brief Create an image
 ///
 /// @param[in] Width The width of the image
 /// @param[in] Height The height of the image
+/// @param[in] MipLevels The number of mip levels in the image
 /// @param[in] Format The format of the image
 /// @param[in] Layout The layout of the image
 /// @param[in] Usage The usage of the image
 /// @param[in] MemoryUsage The memory usage of the image (where to store it)
 /// @param[in] Aspect The aspect of the image
 /// @param[out] Image This parameter receives the created image
-extern VOID VlkCreateImage(_In_ UINT32 Width, _In_ UINT32 Height, _In_ VkFormat Format, _In_ VkImageLayout Layout,
-                           _In_ VkImageUsageFlags Usage, _In_ VmaMemoryUsage MemoryUsage,
+extern VOID VlkCreateImage(_In_ UINT32 Width, _In_ UINT32 Height, _In_ UINT32 MipLevels, _In_ VkFormat Format,
+                           _In_ VkImageLayout Layout, _In_ VkImageUsageFlags Usage, _In_ VmaMemoryUsage MemoryUsage,
                            _In_ VkImageAspectFlags Aspect, _Out_ PVULKAN_IMAGE Image);
 
-/// @brief Create an initialized image
+/// @brief Create an initialized image, the upload isn't waited for and the staging buffer is retired
 ///
 /// @param[in] Data The pixel data for the image
 /// @param[in] Size The size of the data
 /// @param[in] Width The width of the image
 /// @param[in] Height The height of the image
+/// @param[in] MipLevels The number of mip levels
+/// @param[in] LevelOffsets Where each mip level is in the data, or NULL to generate every level after the first with
+/// blits
 /// @param[in] Format The format of the image
 /// @param[in] Layout The layout of the image
 /// @param[in] Usage The usage of the image
@@ -406,6 +546,7 @@ extern VOID VlkCreateImage(_In_ UINT32 Width, _In_ UINT32 Height, _In_ VkFormat
 /// @param[in] Aspect The aspect of the image
 /// @param[out] Image This parameter receives the created image
 extern VOID VlkCreateImageWithData(_In_ PVOID Data, _In_ VkDeviceSize Size, _In_ UINT32 Width, _In_ UINT32 Height,
+                                   _In_ UINT32 MipLevels, _In_reads_opt_(MipLevels) CONST UINT64 *LevelOffsets,
                                    _In_ VkFormat Format, _In_ VkImageLayout Layout, _In_ VkImageUsageFlags Usage,
                                    _In_ VmaMemoryUsage MemoryUsage, _In_ VkImageAspectFlags Aspect,
                                    _Out_ PVULKAN_IMAGE Image);
@@ -486,13 +627,25 @@ extern VOID VlkCreateUniformBuffer(_Out_ PVULKAN_BUFFER UniformBuffer, _Out_ PVO
 extern VOID VlkCreateSceneDescriptorSet(VOID);
 
 /// @brief Load a shader
-extern RENDER_HANDLE VlkLoadShader(_In_z_ PCSTR Name);
+///
+/// @param[in] Name The name of the shader
+/// @param[in] Reload Whether to return 0 on failure instead of aborting
+///
+/// @return The pipeline, or 0 if Reload is set and it couldn't be created
+extern RENDER_HANDLE VlkLoadShader(_In_z_ PCSTR Name, _In_ BOOLEAN Reload);
 
 /// @brief Destroy a shader
 extern VOID VlkDestroyShader(_In_ RENDER_HANDLE Shader);
 
+/// @brief Check if a texture format can be uploaded as-is
+extern BOOLEAN VlkSupportsTextureFormat(_In_ UINT32 Format);
+
 /// @brief Use a texture
-extern RENDER_HANDLE VlkUseTexture(_In_ PTEXTURE Texture, _In_z_ PCSTR Name);
+extern RENDER_HANDLE VlkUseTexture(_In_ PTEXTURE Texture, _In_ UINT32 MipCount, _In_z_ PCSTR Name);
+
+/// @brief Replace the contents of a texture, the old image is retired
+extern VOID VlkUpdateTexture(_In_ RENDER_HANDLE Handle, _In_ PTEXTURE Texture, _In_ UINT32 MipCount,
+                             _In_z_ PCSTR Name);
 
 /// @brief Destroy a texture
 extern VOID VlkDestroyTexture(_In_ RENDER_HANDLE Handle);
@@ -500,6 +653,9 @@ extern VOID VlkDestroyTexture(_In_ RENDER_HANDLE Handle);
 /// @brief Create a model (load a mesh onto the GPU)
 extern VOID VlkCreateModel(_In_z_ PCSTR Name, _Inout_ PMODEL Model, _In_ PMESH Mesh);
 
+/// @brief Replace the mesh of a model, the GPU must be idle
+extern VOID VlkUpdateModel(_In_z_ PCSTR Name, _In_ PMODEL Model, _In_ PMESH Mesh);
+
 /// @brief Draw a model
 extern VOID VlkDrawModel(_In_ PMODEL Model, _In_ PRENDER_OBJECT_UNIFORM Uniform, _In_ PRENDER_OBJECT_DATA Data);
 
@@ -509,5 +665,8 @@ extern VOID VlkDestroyModel(_Inout_ PMODEL Model);
 /// @brief Initialize an object
 extern VOID VlkInitializeObject(_In_z_ PCSTR Name, _Inout_ PRENDER_OBJECT_DATA Data, _In_ PMODEL Model);
 
+/// @brief Give an object a new descriptor set pointing at a texture, retiring the old one
+extern VOID VlkWriteObjectTexture(_Inout_ PVULKAN_OBJECT_DATA ObjectData, _In_ PVULKAN_IMAGE Texture);
+
 /// @brief Destroy an object
 extern VOID VlkDestroyObject(_Inout_ PRENDER_OBJECT_DATA Data);
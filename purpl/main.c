@@ -15,7 +15,7 @@ VOID CameraControl(_In_ ecs_iter_t* Iterator)
 {
     PCCAMERA Camera = ecs_field(Iterator, CAMERA, 1);
     PPOSITION Position = ecs_field(Iterator, POSITION, 2);
-    PROTATION Rotation = ecs_field(Iterator, ROTATION, 3);
+    PORIENTATION Orientation = ecs_field(Iterator, ORIENTATION, 3);
 
     vec3 Forward = {0};
     CamGetVectors(Iterator->entities[0], Forward, NULL);
@@ -24,8 +24,14 @@ VOID CameraControl(_In_ ecs_iter_t* Iterator)
 
     glm_vec3_add(Position[0].Value, Forward, Position[0].Value);
 
-    Rotation[0].Value[0] += InState.RightAxis[1];
-    Rotation[0].Value[1] += InState.RightAxis[0];
+    // Yaw around the world's up axis and pitch around the camera's own right axis, so looking around never rolls
+    versor Yaw;
+    versor Pitch;
+    glm_quatv(Yaw, InState.RightAxis[0], (vec3){0.0, 1.0, 0.0});
+    glm_quatv(Pitch, InState.RightAxis[1], (vec3){1.0, 0.0, 0.0});
+    glm_quat_mul(Yaw, Orientation[0].Value, Orientation[0].Value);
+    glm_quat_mul(Orientation[0].Value, Pitch, Orientation[0].Value);
+    glm_quat_normalize(Orientation[0].Value);
 }
 
 INT PurplMain(_In_ PCHAR *Arguments, _In_ UINT ArgumentCount)
@@ -34,12 +40,12 @@ INT PurplMain(_In_ PCHAR *Arguments, _In_ UINT ArgumentCount)
     CmnInitialize(Arguments, ArgumentCount);
     EngInitialize();
 
-    ECS_SYSTEM(EcsGetWorld(), CameraControl, EcsOnUpdate, CAMERA, POSITION, ROTATION);
+    ECS_SYSTEM(EcsGetWorld(), CameraControl, EcsOnUpdate, CAMERA, POSITION, ORIENTATION);
 
     ecs_entity_t CameraEntity = EcsCreateEntity("camera");
     CamAddPerspective(CameraEntity, CONFIGVAR_GET_FLOAT("cam_fov"), FALSE, 0.1, 1000.0);
     ecs_set(EcsGetWorld(), CameraEntity, POSITION, {{0.0, 3.0, 3.0}});
-    ecs_set(EcsGetWorld(), CameraEntity, ROTATION, {{0.0, 0.0, 0.0}});
+    ecs_set(EcsGetWorld(), CameraEntity, ORIENTATION, {GLM_QUAT_IDENTITY_INIT});
     EngSetMainCamera(CameraEntity);
 
     ecs_entity_t TestEntity = EcsCreateEntity("test");
@@ -0,0 +1,163 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    mathbench.c
+
+Abstract:
+
+    This file implements a benchmark of the transform kernels. It builds the
+    same random transforms one at a time with MthCreateTransformMatrix, the
+    way the engine used to, and in batches with MthCreateTransformMatrices,
+    then prints how long each took per transform and how far apart their
+    results are.
+
+--*/
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/log.h"
+
+#include "engine/math/transform.h"
+
+#include <time.h>
+
+/// @brief Default number of transforms
+#define MATHBENCH_DEFAULT_COUNT 100000
+
+/// @brief Default number of times each kernel builds every transform
+#define MATHBENCH_DEFAULT_ITERATIONS 50
+
+static UINT64 GetNanoseconds(VOID)
+{
+    struct timespec Time;
+    timespec_get(&Time, TIME_UTC);
+    return (UINT64)Time.tv_sec * 1000000000 + Time.tv_nsec;
+}
+
+// xorshift64, so every run gets the same transforms
+static FLOAT RandomFloat(_Inout_ PUINT64 State, _In_ FLOAT Minimum, _In_ FLOAT Maximum)
+{
+    *State ^= *State << 13;
+    *State ^= *State >> 7;
+    *State ^= *State << 17;
+    return Minimum + (FLOAT)((*State >> 40) / (DOUBLE)(1ull << 24)) * (Maximum - Minimum);
+}
+
+static VOID PrintUsage(_In_z_ PCSTR Name)
+{
+    LogError("Usage: %s [-n count] [-i iterations]", Name);
+    LogError("  -n: number of transforms (default %u)", MATHBENCH_DEFAULT_COUNT);
+    LogError("  -i: number of times each kernel builds every transform (default %u)", MATHBENCH_DEFAULT_ITERATIONS);
+}
+
+INT PurplMain(_In_ PCHAR *Arguments, _In_ UINT ArgumentCount)
+{
+    SIZE_T Count = MATHBENCH_DEFAULT_COUNT;
+    UINT32 Iterations = MATHBENCH_DEFAULT_ITERATIONS;
+    UINT i;
+
+    CmnInitialize(Arguments, ArgumentCount);
+
+    for (i = 1; i < ArgumentCount; i++)
+    {
+        if (strcmp(Arguments[i], "-n") == 0 && i + 1 < ArgumentCount)
+        {
+            Count = (SIZE_T)strtoull(Arguments[++i], NULL, 0);
+        }
+        else if (strcmp(Arguments[i], "-i") == 0 && i + 1 < ArgumentCount)
+        {
+            Iterations = (UINT32)strtoul(Arguments[++i], NULL, 0);
+        }
+        else
+        {
+            PrintUsage(Arguments[0]);
+            CmnShutdown();
+            return 1;
+        }
+    }
+
+    if (!Count || !Iterations)
+    {
+        PrintUsage(Arguments[0]);
+        CmnShutdown();
+        return 1;
+    }
+
+    vec3 *Positions = CmnAllocType(Count, vec3);
+    vec3 *Rotations = CmnAllocType(Count, vec3);
+    vec3 *Scales = CmnAllocType(Count, vec3);
+    mat4 *Scalar = CmnAllocType(Count, mat4);
+    mat4 *Batched = CmnAllocType(Count, mat4);
+    if (!Positions || !Rotations || !Scales || !Scalar || !Batched)
+    {
+        CmnError("Failed to allocate %zu transforms: %s", Count, strerror(errno));
+    }
+
+    UINT64 State = 0x9E3779B97F4A7C15ull;
+    for (SIZE_T j = 0; j < Count; j++)
+    {
+        for (UINT32 k = 0; k < 3; k++)
+        {
+            Positions[j][k] = RandomFloat(&State, -1000.0f, 1000.0f);
+            Rotations[j][k] = RandomFloat(&State, -GLM_PIf, GLM_PIf);
+            Scales[j][k] = RandomFloat(&State, 0.1f, 10.0f);
+        }
+    }
+
+    LogInfo("Building %zu transforms %u times with each kernel", Count, Iterations);
+
+    UINT64 Start = GetNanoseconds();
+    for (UINT32 Iteration = 0; Iteration < Iterations; Iteration++)
+    {
+        for (SIZE_T j = 0; j < Count; j++)
+        {
+            MthCreateTransformMatrix(Positions[j], Rotations[j], Scales[j], Scalar[j]);
+        }
+    }
+    UINT64 ScalarTime = GetNanoseconds() - Start;
+
+    Start = GetNanoseconds();
+    for (UINT32 Iteration = 0; Iteration < Iterations; Iteration++)
+    {
+        MthCreateTransformMatrices(Count, Positions, Rotations, NULL, Scales, Batched);
+    }
+    UINT64 BatchedTime = GetNanoseconds() - Start;
+
+    // Relative to the largest element of each matrix, so translations don't hide error in the rotation
+    DOUBLE MaxDifference = 0.0;
+    for (SIZE_T j = 0; j < Count; j++)
+    {
+        DOUBLE Largest = 0.0;
+        DOUBLE Difference = 0.0;
+        for (UINT32 k = 0; k < 16; k++)
+        {
+            Largest = PURPL_MAX(Largest, fabs(Scalar[j][k / 4][k % 4]));
+            Difference = PURPL_MAX(Difference, fabs(Scalar[j][k / 4][k % 4] - Batched[j][k / 4][k % 4]));
+        }
+        if (Largest > 0.0)
+        {
+            MaxDifference = PURPL_MAX(MaxDifference, Difference / Largest);
+        }
+    }
+
+    DOUBLE Transforms = (DOUBLE)Count * Iterations;
+    LogInfo("MthCreateTransformMatrix:   %.2f ns per transform", ScalarTime / Transforms);
+    LogInfo("MthCreateTransformMatrices: %.2f ns per transform", BatchedTime / Transforms);
+    LogInfo("Speedup: %.2fx, largest relative difference: %g", BatchedTime ? (DOUBLE)ScalarTime / BatchedTime : 0.0,
+            MaxDifference);
+
+    CmnFree(Positions);
+    CmnFree(Rotations);
+    CmnFree(Scales);
+    CmnFree(Scalar);
+    CmnFree(Batched);
+
+    CmnShutdown();
+
+    return 0;
+}
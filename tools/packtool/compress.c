@@ -0,0 +1,170 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    compress.c
+
+Abstract:
+
+    This file compresses pack entries into chunks of standalone zstd frames,
+    and trains the dictionary shared by the many small files in a pack.
+
+--*/
+
+#include "packtool.h"
+
+#include "zdict.h"
+#include "zstd.h"
+
+PBYTE PackTrainDictionary(_In_ PCPACK_INPUT Inputs, _Out_ PUINT64 DictionarySize)
+{
+    PBYTE Samples = NULL;
+    SIZE_T *SampleSizes = NULL;
+
+    *DictionarySize = 0;
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(Inputs); i++)
+    {
+        if (!Inputs[i].Original && Inputs[i].Size && Inputs[i].Size <= PACK_DICTIONARY_MAX_ENTRY_SIZE)
+        {
+            SIZE_T Offset = stbds_arrlenu(Samples);
+            stbds_arraddn(Samples, (SIZE_T)Inputs[i].Size);
+            memcpy(Samples + Offset, Inputs[i].Data, (SIZE_T)Inputs[i].Size);
+            stbds_arrpush(SampleSizes, (SIZE_T)Inputs[i].Size);
+        }
+    }
+
+    // zstd wants a reasonable number of samples, a dictionary trained on a handful of files isn't worth it
+    if (stbds_arrlenu(SampleSizes) < 8)
+    {
+        LogInfo("Only %zu small files, not training a dictionary", stbds_arrlenu(SampleSizes));
+        stbds_arrfree(Samples);
+        stbds_arrfree(SampleSizes);
+        return NULL;
+    }
+
+    PBYTE Dictionary = CmnAlloc(PACK_DICTIONARY_SIZE, 1);
+    if (!Dictionary)
+    {
+        CmnError("Failed to allocate dictionary: %s", strerror(errno));
+    }
+
+    LogInfo("Training dictionary on %zu files (%zu bytes)", stbds_arrlenu(SampleSizes), stbds_arrlenu(Samples));
+    SIZE_T Result = ZDICT_trainFromBuffer(Dictionary, PACK_DICTIONARY_SIZE, Samples, SampleSizes,
+                                          (UINT32)stbds_arrlenu(SampleSizes));
+    stbds_arrfree(Samples);
+    stbds_arrfree(SampleSizes);
+    if (ZDICT_isError(Result))
+    {
+        LogWarning("Failed to train dictionary: %s", ZDICT_getErrorName(Result));
+        CmnFree(Dictionary);
+        return NULL;
+    }
+
+    LogInfo("Trained %zu byte dictionary", Result);
+    *DictionarySize = Result;
+    return Dictionary;
+}
+
+PVOID PackCreateCompressionDictionary(_In_ CONST VOID *Dictionary, _In_ UINT64 DictionarySize,
+                                      _In_ PCPACK_OPTIONS Options)
+{
+    // Loading the dictionary is most of the work of compressing a small file, so it's only done once
+    ZSTD_CDict *CompressionDictionary = ZSTD_createCDict(Dictionary, (SIZE_T)DictionarySize, Options->CompressionLevel);
+    if (!CompressionDictionary)
+    {
+        CmnError("Failed to create zstd compression dictionary");
+    }
+
+    return CompressionDictionary;
+}
+
+VOID PackFreeCompressionDictionary(_In_ PVOID CompressionDictionary)
+{
+    ZSTD_freeCDict(CompressionDictionary);
+}
+
+VOID PackCompressInput(_Inout_ PPACK_INPUT Input, _In_ PCPACK_OPTIONS Options,
+                       _In_opt_ CONST VOID *CompressionDictionary)
+{
+    Input->StoredData = Input->Data;
+    Input->StoredSize = Input->Size;
+
+    if (!Options->CompressionLevel || !Input->Size)
+    {
+        return;
+    }
+
+    BOOLEAN UseDictionary = CompressionDictionary && Input->Size <= PACK_DICTIONARY_MAX_ENTRY_SIZE;
+    UINT32 ChunkCount = (UINT32)((Input->Size + Options->ChunkSize - 1) / Options->ChunkSize);
+    UINT64 TableSize = sizeof(ASSET_COMPRESSED_HEADER) + (ChunkCount + 1) * sizeof(UINT64);
+    UINT64 Capacity = TableSize + ChunkCount * ZSTD_compressBound(Options->ChunkSize);
+
+    PBYTE Data = CmnAlloc(Capacity, 1);
+    if (!Data)
+    {
+        CmnError("Failed to allocate %llu bytes to compress %s: %s", Capacity, Input->Name, strerror(errno));
+    }
+
+    PASSET_COMPRESSED_HEADER Header = (PASSET_COMPRESSED_HEADER)Data;
+    UINT64 *ChunkOffsets = (UINT64 *)(Header + 1);
+    Header->ChunkSize = Options->ChunkSize;
+    Header->ChunkCount = ChunkCount;
+
+    ZSTD_CCtx *Context = ZSTD_createCCtx();
+    if (!Context)
+    {
+        CmnError("Failed to create zstd compression context");
+    }
+
+    UINT64 Offset = TableSize;
+    for (UINT32 i = 0; i < ChunkCount; i++)
+    {
+        UINT64 ChunkStart = (UINT64)i * Options->ChunkSize;
+        UINT64 ChunkLength = PURPL_MIN(Options->ChunkSize, Input->Size - ChunkStart);
+
+        SIZE_T Result;
+        if (UseDictionary)
+        {
+            Result = ZSTD_compress_usingCDict(Context, Data + Offset, (SIZE_T)(Capacity - Offset),
+                                              Input->Data + ChunkStart, (SIZE_T)ChunkLength, CompressionDictionary);
+        }
+        else
+        {
+            Result = ZSTD_compressCCtx(Context, Data + Offset, (SIZE_T)(Capacity - Offset), Input->Data + ChunkStart,
+                                       (SIZE_T)ChunkLength, Options->CompressionLevel);
+        }
+
+        if (ZSTD_isError(Result))
+        {
+            CmnError("Failed to compress chunk %u of %s: %s", i, Input->Name, ZSTD_getErrorName(Result));
+        }
+
+        ChunkOffsets[i] = Offset;
+        Offset += Result;
+    }
+    ChunkOffsets[ChunkCount] = Offset;
+
+    ZSTD_freeCCtx(Context);
+
+    // Uncompressed entries can be used straight from the mapping, so compression has to be worth losing that
+    if (Offset >= Input->Size - Input->Size / 16)
+    {
+        LogDebug("Storing %s uncompressed (%llu -> %llu bytes)", Input->Name, Input->Size, Offset);
+        CmnFree(Data);
+        return;
+    }
+
+    LogDebug("Compressed %s%s (%llu -> %llu bytes)", Input->Name, UseDictionary ? " with dictionary" : "",
+             Input->Size, Offset);
+
+    Input->StoredData = Data;
+    Input->StoredSize = Offset;
+    Input->Flags |= AssetPackEntryCompressed;
+    if (UseDictionary)
+    {
+        Input->Flags |= AssetPackEntryDictionary;
+    }
+}
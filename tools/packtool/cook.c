@@ -0,0 +1,194 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    cook.c
+
+Abstract:
+
+    This file converts textures and meshes into the layout the engine can use
+    directly from a mapped pack, so loading them is a pointer fixup instead of
+    a parse into a new allocation.
+
+--*/
+
+#include "packtool.h"
+
+static BOOLEAN HasExtension(_In_z_ PCSTR Name, _In_z_ PCSTR Extension)
+{
+    SIZE_T NameLength = strlen(Name);
+    SIZE_T ExtensionLength = strlen(Extension);
+
+    return NameLength > ExtensionLength && strcmp(Name + NameLength - ExtensionLength, Extension) == 0;
+}
+
+static VOID CookTexture(_Inout_ PPACK_INPUT Input, _In_ PCPACK_OPTIONS Options)
+{
+    PTEXTURE Texture = LoadTexture(Input->Name);
+    if (!Texture)
+    {
+        LogWarning("Failed to load texture %s, storing it as-is", Input->Name);
+        return;
+    }
+
+    UINT32 Format = PackChooseTextureFormat(Texture, Options);
+
+    // Each level is made from the one before it, down to 1x1, so the engine never has to make any itself
+    PTEXTURE Levels[ASSET_MAX_TEXTURE_MIPS] = {Texture};
+    UINT32 MipCount = 1;
+    if (Texture->Format == TextureFormatRgba8)
+    {
+        MipCount = PURPL_MIN(AstGetFullMipCount(Texture->Width, Texture->Height), ASSET_MAX_TEXTURE_MIPS);
+        for (UINT32 i = 1; i < MipCount; i++)
+        {
+            Levels[i] = PackDownsampleTexture(Levels[i - 1]);
+        }
+    }
+
+    UINT64 PixelsOffset = PACK_ALIGN(sizeof(ASSET_COOKED_TEXTURE), Options->Alignment);
+    UINT64 PixelsSize = 0;
+    for (UINT32 i = 0; i < MipCount; i++)
+    {
+        PixelsSize += AstGetTextureLevelSize(Format, Texture->Width, Texture->Height, i);
+    }
+    UINT64 Size = PixelsOffset + PixelsSize;
+
+    PBYTE Data = CmnAlloc(Size, 1);
+    if (!Data)
+    {
+        CmnError("Failed to allocate %llu bytes for cooked texture %s: %s", Size, Input->Name, strerror(errno));
+    }
+
+    PASSET_COOKED_TEXTURE Cooked = (PASSET_COOKED_TEXTURE)Data;
+    Cooked->Format = Format;
+    Cooked->Width = Texture->Width;
+    Cooked->Height = Texture->Height;
+    Cooked->MipCount = MipCount;
+    Cooked->PixelsOffset = PixelsOffset;
+    Cooked->PixelsSize = PixelsSize;
+
+    UINT64 Offset = PixelsOffset;
+    for (UINT32 i = 0; i < MipCount; i++)
+    {
+        UINT64 LevelSize = AstGetTextureLevelSize(Format, Texture->Width, Texture->Height, i);
+        Cooked->MipOffsets[i] = Offset;
+        if (Format != (UINT32)Texture->Format)
+        {
+            PackEncodeTexture(Levels[i], Format, Data + Offset);
+        }
+        else
+        {
+            memcpy(Data + Offset, Levels[i]->Pixels, LevelSize);
+        }
+        Offset += LevelSize;
+
+        if (i > 0)
+        {
+            CmnFree(Levels[i]);
+        }
+    }
+
+    LogDebug("Cooked texture %s (%ux%u, %u mips, format 0x%X, %llu bytes)", Input->Name, Cooked->Width,
+             Cooked->Height, Cooked->MipCount, Cooked->Format, Size);
+
+    CmnFree(Texture);
+    CmnFree(Input->Data);
+    Input->Data = Data;
+    Input->Size = Size;
+    Input->Flags |= AssetPackEntryCookedTexture;
+}
+
+static BOOLEAN CheckMeshIndices(_In_z_ PCSTR Name, _In_ PCMESH Mesh)
+{
+    for (UINT64 i = 0; i < Mesh->IndexCount; i++)
+    {
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            if (Mesh->Indices[i][j] < 0 || (UINT64)Mesh->Indices[i][j] >= Mesh->VertexCount)
+            {
+                LogWarning("Mesh %s has an out of range index in triangle %llu, not optimising it", Name, i);
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+static VOID CookMesh(_Inout_ PPACK_INPUT Input, _In_ PCPACK_OPTIONS Options)
+{
+    PMESH Mesh = LoadMesh(Input->Name);
+    if (!Mesh)
+    {
+        LogWarning("Failed to load mesh %s, storing it as-is", Input->Name);
+        return;
+    }
+
+    ASSET_MESH_LOD Lods[ASSET_MAX_MESH_LODS] = {0};
+    UINT32 LodCount = 1;
+    ivec3 *LodIndices = NULL;
+    Lods[0].IndexCount = Mesh->IndexCount;
+    if (CheckMeshIndices(Input->Name, Mesh))
+    {
+        // The levels of detail replace the original indices, which stay in the mesh's allocation
+        LodCount = PackGenerateLods(Input->Name, Mesh, Options, &LodIndices, Lods);
+        Mesh->Indices = LodIndices;
+        Mesh->IndexCount = Lods[LodCount - 1].IndexOffset + Lods[LodCount - 1].IndexCount;
+
+        PackOptimizeMesh(Input->Name, Mesh, Lods, LodCount, Options);
+    }
+
+    UINT64 VerticesOffset = PACK_ALIGN(sizeof(ASSET_COOKED_MESH), Options->Alignment);
+    UINT64 VerticesSize = Mesh->VertexCount * sizeof(MESH_VERTEX);
+    UINT64 IndicesOffset = PACK_ALIGN(VerticesOffset + VerticesSize, Options->Alignment);
+    UINT64 IndicesSize = Mesh->IndexCount * sizeof(ivec3);
+    UINT64 Size = IndicesOffset + IndicesSize;
+
+    PBYTE Data = CmnAlloc(Size, 1);
+    if (!Data)
+    {
+        CmnError("Failed to allocate %llu bytes for cooked mesh %s: %s", Size, Input->Name, strerror(errno));
+    }
+
+    PASSET_COOKED_MESH Cooked = (PASSET_COOKED_MESH)Data;
+    Cooked->VertexCount = Mesh->VertexCount;
+    Cooked->IndexCount = Lods[0].IndexCount;
+    Cooked->LodCount = LodCount;
+    memcpy(Cooked->Lods, Lods, sizeof(Lods));
+    Cooked->VerticesOffset = VerticesOffset;
+    Cooked->IndicesOffset = IndicesOffset;
+    memcpy(Data + VerticesOffset, Mesh->Vertices, VerticesSize);
+    memcpy(Data + IndicesOffset, Mesh->Indices, IndicesSize);
+
+    LogDebug("Cooked mesh %s (%llu vertices, %llu triangles, %u levels of detail)", Input->Name, Cooked->VertexCount,
+             Cooked->IndexCount, Cooked->LodCount);
+
+    if (LodIndices)
+    {
+        CmnFree(LodIndices);
+    }
+    CmnFree(Mesh);
+    CmnFree(Input->Data);
+    Input->Data = Data;
+    Input->Size = Size;
+    Input->Flags |= AssetPackEntryCookedMesh;
+}
+
+VOID PackCookInput(_Inout_ PPACK_INPUT Input, _In_ PCPACK_OPTIONS Options)
+{
+    if (!Options->Cook)
+    {
+        return;
+    }
+
+    if (HasExtension(Input->Name, ".ptex"))
+    {
+        CookTexture(Input, Options);
+    }
+    else if (HasExtension(Input->Name, ".pmdl"))
+    {
+        CookMesh(Input, Options);
+    }
+}
@@ -0,0 +1,544 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    encode.c
+
+Abstract:
+
+    This file block compresses cooked textures. Each block's colours are fit
+    to a line through their principal axis, the endpoints are quantised to
+    the format and every pixel takes the closest point on the line that the
+    format can represent. BC7 always uses mode 6, one subset with 4-bit
+    indices and RGBA endpoints, which handles both opaque and transparent
+    textures well without the cost of searching partitions.
+
+--*/
+
+#include "packtool.h"
+
+/// @brief Number of power iterations used to find the principal axis of a block
+#define ENCODE_AXIS_ITERATIONS 8
+
+/// @brief Interpolation weights of 4-bit BC7 indices, out of 64
+static CONST UINT8 Bc7Weights[] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Reads a 4x4 block, repeating the last row and column for blocks that hang off the edge
+static VOID GetBlock(_In_ PCTEXTURE Texture, _In_ UINT32 BlockX, _In_ UINT32 BlockY, _Out_ FLOAT Pixels[16][4])
+{
+    CONST UINT8 *Source = Texture->Pixels;
+
+    for (UINT32 Y = 0; Y < 4; Y++)
+    {
+        UINT32 SourceY = PURPL_MIN(BlockY * 4 + Y, Texture->Height - 1);
+        for (UINT32 X = 0; X < 4; X++)
+        {
+            UINT32 SourceX = PURPL_MIN(BlockX * 4 + X, Texture->Width - 1);
+            CONST UINT8 *Pixel = Source + ((UINT64)SourceY * Texture->Width + SourceX) * 4;
+            for (UINT32 Channel = 0; Channel < 4; Channel++)
+            {
+                Pixels[Y * 4 + X][Channel] = Pixel[Channel];
+            }
+        }
+    }
+}
+
+static FLOAT GetDistance(_In_ CONST FLOAT *A, _In_ CONST UINT8 *B, _In_ UINT32 Channels)
+{
+    FLOAT Distance = 0.0f;
+    for (UINT32 i = 0; i < Channels; i++)
+    {
+        FLOAT Difference = A[i] - B[i];
+        Distance += Difference * Difference;
+    }
+
+    return Distance;
+}
+
+// Fits a line through the pixels in Mask along their principal axis, Start and End are the extremes on it
+static VOID FitLine(_In_ CONST FLOAT Pixels[16][4], _In_ UINT32 Mask, _In_ UINT32 Channels, _Out_ FLOAT Start[4],
+                    _Out_ FLOAT End[4])
+{
+    FLOAT Mean[4] = {0};
+    UINT32 Count = 0;
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        if (Mask & (1u << i))
+        {
+            for (UINT32 Channel = 0; Channel < Channels; Channel++)
+            {
+                Mean[Channel] += Pixels[i][Channel];
+            }
+            Count++;
+        }
+    }
+    for (UINT32 Channel = 0; Channel < 4; Channel++)
+    {
+        Mean[Channel] = Count ? Mean[Channel] / Count : 0.0f;
+        Start[Channel] = Mean[Channel];
+        End[Channel] = Mean[Channel];
+    }
+
+    FLOAT Covariance[4][4] = {0};
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        if (Mask & (1u << i))
+        {
+            for (UINT32 Row = 0; Row < Channels; Row++)
+            {
+                for (UINT32 Column = 0; Column < Channels; Column++)
+                {
+                    Covariance[Row][Column] += (Pixels[i][Row] - Mean[Row]) * (Pixels[i][Column] - Mean[Column]);
+                }
+            }
+        }
+    }
+
+    FLOAT Axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (UINT32 Iteration = 0; Iteration < ENCODE_AXIS_ITERATIONS; Iteration++)
+    {
+        FLOAT Next[4] = {0};
+        FLOAT Length = 0.0f;
+        for (UINT32 Row = 0; Row < Channels; Row++)
+        {
+            for (UINT32 Column = 0; Column < Channels; Column++)
+            {
+                Next[Row] += Covariance[Row][Column] * Axis[Column];
+            }
+            Length = PURPL_MAX(Length, fabsf(Next[Row]));
+        }
+
+        // Every pixel is the same, so the mean is exact
+        if (Length <= 0.0f)
+        {
+            return;
+        }
+        for (UINT32 Channel = 0; Channel < Channels; Channel++)
+        {
+            Axis[Channel] = Next[Channel] / Length;
+        }
+    }
+
+    FLOAT Length = 0.0f;
+    for (UINT32 Channel = 0; Channel < Channels; Channel++)
+    {
+        Length += Axis[Channel] * Axis[Channel];
+    }
+    Length = sqrtf(Length);
+
+    FLOAT Minimum = 0.0f;
+    FLOAT Maximum = 0.0f;
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        if (Mask & (1u << i))
+        {
+            FLOAT Projection = 0.0f;
+            for (UINT32 Channel = 0; Channel < Channels; Channel++)
+            {
+                Projection += (Pixels[i][Channel] - Mean[Channel]) * Axis[Channel] / Length;
+            }
+            Minimum = PURPL_MIN(Minimum, Projection);
+            Maximum = PURPL_MAX(Maximum, Projection);
+        }
+    }
+
+    for (UINT32 Channel = 0; Channel < Channels; Channel++)
+    {
+        Start[Channel] = glm_clamp(Mean[Channel] + Axis[Channel] / Length * Minimum, 0.0f, 255.0f);
+        End[Channel] = glm_clamp(Mean[Channel] + Axis[Channel] / Length * Maximum, 0.0f, 255.0f);
+    }
+}
+
+static UINT16 Pack565(_In_ CONST FLOAT Colour[3])
+{
+    UINT32 Red = (UINT32)(Colour[0] * 31.0f / 255.0f + 0.5f);
+    UINT32 Green = (UINT32)(Colour[1] * 63.0f / 255.0f + 0.5f);
+    UINT32 Blue = (UINT32)(Colour[2] * 31.0f / 255.0f + 0.5f);
+
+    return (UINT16)((Red << 11) | (Green << 5) | Blue);
+}
+
+static VOID Unpack565(_In_ UINT16 Colour, _Out_ UINT8 Rgb[3])
+{
+    UINT32 Red = (Colour >> 11) & 0x1F;
+    UINT32 Green = (Colour >> 5) & 0x3F;
+    UINT32 Blue = Colour & 0x1F;
+
+    Rgb[0] = (UINT8)((Red << 3) | (Red >> 2));
+    Rgb[1] = (UINT8)((Green << 2) | (Green >> 4));
+    Rgb[2] = (UINT8)((Blue << 3) | (Blue >> 2));
+}
+
+// Encodes a BC1 colour block, transparent pixels use BC1's three colour mode if they're allowed
+static VOID EncodeColour(_In_ CONST FLOAT Pixels[16][4], _In_ BOOLEAN AllowTransparent, _Out_ UINT8 Block[8])
+{
+    UINT32 Opaque = 0;
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        if (!AllowTransparent || Pixels[i][3] >= 128.0f)
+        {
+            Opaque |= 1u << i;
+        }
+    }
+    BOOLEAN ThreeColours = Opaque != 0xFFFF;
+
+    FLOAT Start[4];
+    FLOAT End[4];
+    FitLine(Pixels, Opaque, 3, Start, End);
+
+    // Pull the ends in a little, the extremes are usually outliers and the middle of the line matters more
+    if (!ThreeColours)
+    {
+        for (UINT32 Channel = 0; Channel < 3; Channel++)
+        {
+            FLOAT Inset = (End[Channel] - Start[Channel]) / 16.0f;
+            Start[Channel] += Inset;
+            End[Channel] -= Inset;
+        }
+    }
+
+    UINT16 Colour0 = Pack565(End);
+    UINT16 Colour1 = Pack565(Start);
+
+    // The order of the endpoints picks the mode
+    if ((ThreeColours && Colour0 > Colour1) || (!ThreeColours && Colour0 < Colour1))
+    {
+        UINT16 Swap = Colour0;
+        Colour0 = Colour1;
+        Colour1 = Swap;
+    }
+
+    UINT8 Palette[4][3];
+    Unpack565(Colour0, Palette[0]);
+    Unpack565(Colour1, Palette[1]);
+    for (UINT32 Channel = 0; Channel < 3; Channel++)
+    {
+        if (ThreeColours)
+        {
+            Palette[2][Channel] = (UINT8)((Palette[0][Channel] + Palette[1][Channel]) / 2);
+        }
+        else
+        {
+            Palette[2][Channel] = (UINT8)((2 * Palette[0][Channel] + Palette[1][Channel] + 1) / 3);
+            Palette[3][Channel] = (UINT8)((Palette[0][Channel] + 2 * Palette[1][Channel] + 1) / 3);
+        }
+    }
+
+    UINT32 Indices = 0;
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        UINT32 Best = 3;
+        if (Opaque & (1u << i))
+        {
+            FLOAT BestDistance = FLT_MAX;
+            for (UINT32 j = 0; j < (ThreeColours ? 3u : 4u); j++)
+            {
+                FLOAT Distance = GetDistance(Pixels[i], Palette[j], 3);
+                if (Distance < BestDistance)
+                {
+                    Best = j;
+                    BestDistance = Distance;
+                }
+            }
+        }
+        Indices |= Best << (i * 2);
+    }
+
+    Block[0] = (UINT8)Colour0;
+    Block[1] = (UINT8)(Colour0 >> 8);
+    Block[2] = (UINT8)Colour1;
+    Block[3] = (UINT8)(Colour1 >> 8);
+    for (UINT32 i = 0; i < 4; i++)
+    {
+        Block[4 + i] = (UINT8)(Indices >> (i * 8));
+    }
+}
+
+static VOID EncodeAlpha(_In_ CONST FLOAT Pixels[16][4], _Out_ UINT8 Block[8])
+{
+    FLOAT Minimum = 255.0f;
+    FLOAT Maximum = 0.0f;
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        Minimum = PURPL_MIN(Minimum, Pixels[i][3]);
+        Maximum = PURPL_MAX(Maximum, Pixels[i][3]);
+    }
+
+    // Eight interpolated values, which needs the first endpoint to be bigger
+    UINT8 Palette[8];
+    Palette[0] = (UINT8)(Maximum + 0.5f);
+    Palette[1] = (UINT8)(Minimum + 0.5f);
+    for (UINT32 i = 2; i < 8; i++)
+    {
+        Palette[i] = (UINT8)(((8 - i) * Palette[0] + (i - 1) * Palette[1] + 3) / 7);
+    }
+
+    UINT64 Indices = 0;
+    if (Palette[0] > Palette[1])
+    {
+        for (UINT32 i = 0; i < 16; i++)
+        {
+            UINT64 Best = 0;
+            FLOAT BestDistance = FLT_MAX;
+            for (UINT32 j = 0; j < 8; j++)
+            {
+                FLOAT Distance = fabsf(Pixels[i][3] - Palette[j]);
+                if (Distance < BestDistance)
+                {
+                    Best = j;
+                    BestDistance = Distance;
+                }
+            }
+            Indices |= Best << (i * 3);
+        }
+    }
+
+    Block[0] = Palette[0];
+    Block[1] = Palette[1];
+    for (UINT32 i = 0; i < 6; i++)
+    {
+        Block[2 + i] = (UINT8)(Indices >> (i * 8));
+    }
+}
+
+static VOID WriteBits(_Inout_ UINT8 Block[16], _Inout_ PUINT32 Position, _In_ UINT32 Value, _In_ UINT32 Count)
+{
+    for (UINT32 i = 0; i < Count; i++, (*Position)++)
+    {
+        Block[*Position / 8] |= (UINT8)(((Value >> i) & 1) << (*Position % 8));
+    }
+}
+
+// Quantises an endpoint to 7 bits per channel and the shared parity bit that gets closest
+static VOID QuantizeBc7Endpoint(_In_ CONST FLOAT Endpoint[4], _Out_ UINT32 Values[4], _Out_ PUINT32 Parity)
+{
+    FLOAT BestError = FLT_MAX;
+    for (UINT32 Bit = 0; Bit < 2; Bit++)
+    {
+        UINT32 Candidate[4];
+        FLOAT Error = 0.0f;
+        for (UINT32 Channel = 0; Channel < 4; Channel++)
+        {
+            FLOAT Value = glm_clamp((Endpoint[Channel] - Bit) / 2.0f + 0.5f, 0.0f, 127.0f);
+            Candidate[Channel] = (UINT32)Value;
+            FLOAT Difference = (FLOAT)((Candidate[Channel] << 1) | Bit) - Endpoint[Channel];
+            Error += Difference * Difference;
+        }
+
+        if (Error < BestError)
+        {
+            memcpy(Values, Candidate, sizeof(Candidate));
+            *Parity = Bit;
+            BestError = Error;
+        }
+    }
+}
+
+static VOID EncodeBc7(_In_ CONST FLOAT Pixels[16][4], _Out_ UINT8 Block[16])
+{
+    FLOAT Endpoints[2][4];
+    FitLine(Pixels, 0xFFFF, 4, Endpoints[0], Endpoints[1]);
+
+    UINT32 Values[2][4];
+    UINT32 Parities[2];
+    QuantizeBc7Endpoint(Endpoints[0], Values[0], &Parities[0]);
+    QuantizeBc7Endpoint(Endpoints[1], Values[1], &Parities[1]);
+
+    UINT8 Ends[2][4];
+    for (UINT32 i = 0; i < 2; i++)
+    {
+        for (UINT32 Channel = 0; Channel < 4; Channel++)
+        {
+            Ends[i][Channel] = (UINT8)((Values[i][Channel] << 1) | Parities[i]);
+        }
+    }
+
+    UINT8 Palette[16][4];
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        for (UINT32 Channel = 0; Channel < 4; Channel++)
+        {
+            Palette[i][Channel] =
+                (UINT8)(((64 - Bc7Weights[i]) * Ends[0][Channel] + Bc7Weights[i] * Ends[1][Channel] + 32) >> 6);
+        }
+    }
+
+    UINT32 Indices[16];
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        FLOAT BestDistance = FLT_MAX;
+        for (UINT32 j = 0; j < 16; j++)
+        {
+            FLOAT Distance = GetDistance(Pixels[i], Palette[j], 4);
+            if (Distance < BestDistance)
+            {
+                Indices[i] = j;
+                BestDistance = Distance;
+            }
+        }
+    }
+
+    // The first pixel's index doesn't store its top bit, so the endpoints get swapped if it would be set
+    if (Indices[0] & 8)
+    {
+        for (UINT32 Channel = 0; Channel < 4; Channel++)
+        {
+            UINT32 Swap = Values[0][Channel];
+            Values[0][Channel] = Values[1][Channel];
+            Values[1][Channel] = Swap;
+        }
+        UINT32 Swap = Parities[0];
+        Parities[0] = Parities[1];
+        Parities[1] = Swap;
+        for (UINT32 i = 0; i < 16; i++)
+        {
+            Indices[i] = 15 - Indices[i];
+        }
+    }
+
+    memset(Block, 0, 16);
+    UINT32 Position = 0;
+    WriteBits(Block, &Position, 1 << 6, 7);
+    for (UINT32 Channel = 0; Channel < 4; Channel++)
+    {
+        WriteBits(Block, &Position, Values[0][Channel], 7);
+        WriteBits(Block, &Position, Values[1][Channel], 7);
+    }
+    WriteBits(Block, &Position, Parities[0], 1);
+    WriteBits(Block, &Position, Parities[1], 1);
+    for (UINT32 i = 0; i < 16; i++)
+    {
+        WriteBits(Block, &Position, Indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+UINT32 PackChooseTextureFormat(_In_ PCTEXTURE Texture, _In_ PCPACK_OPTIONS Options)
+{
+    if (Texture->Format != TextureFormatRgba8 || !Texture->Width || !Texture->Height)
+    {
+        return Texture->Format;
+    }
+
+    switch (Options->TextureCompression)
+    {
+    case PackTextureCompressionNone:
+    default:
+        return Texture->Format;
+    case PackTextureCompressionBc1:
+        return AssetTextureFormatBc1;
+    case PackTextureCompressionBc3:
+        return AssetTextureFormatBc3;
+    case PackTextureCompressionBc7:
+        return AssetTextureFormatBc7;
+    case PackTextureCompressionAuto:
+        break;
+    }
+
+    // BC1 is half the size, but only good for opaque textures
+    CONST UINT8 *Pixels = Texture->Pixels;
+    for (UINT64 i = 0; i < (UINT64)Texture->Width * Texture->Height; i++)
+    {
+        if (Pixels[i * 4 + 3] != 255)
+        {
+            return AssetTextureFormatBc7;
+        }
+    }
+
+    return AssetTextureFormatBc1;
+}
+
+VOID PackEncodeTexture(_In_ PCTEXTURE Texture, _In_ UINT32 Format, _Out_ PBYTE Data)
+{
+    UINT32 BlocksWide = (Texture->Width + 3) / 4;
+    UINT32 BlocksHigh = (Texture->Height + 3) / 4;
+    UINT32 BlockSize = Format == AssetTextureFormatBc1 ? 8 : 16;
+
+    for (UINT32 BlockY = 0; BlockY < BlocksHigh; BlockY++)
+    {
+        for (UINT32 BlockX = 0; BlockX < BlocksWide; BlockX++, Data += BlockSize)
+        {
+            FLOAT Pixels[16][4];
+            GetBlock(Texture, BlockX, BlockY, Pixels);
+
+            switch (Format)
+            {
+            case AssetTextureFormatBc1:
+                EncodeColour(Pixels, TRUE, Data);
+                break;
+            case AssetTextureFormatBc3:
+                EncodeAlpha(Pixels, Data);
+                EncodeColour(Pixels, FALSE, Data + 8);
+                break;
+            case AssetTextureFormatBc7:
+                EncodeBc7(Pixels, Data);
+                break;
+            }
+        }
+    }
+}
+
+static FLOAT SrgbToLinear(_In_ FLOAT Value)
+{
+    return Value <= 0.04045f ? Value / 12.92f : powf((Value + 0.055f) / 1.055f, 2.4f);
+}
+
+static FLOAT LinearToSrgb(_In_ FLOAT Value)
+{
+    return Value <= 0.0031308f ? Value * 12.92f : 1.055f * powf(Value, 1.0f / 2.4f) - 0.055f;
+}
+
+PTEXTURE PackDownsampleTexture(_In_ PCTEXTURE Texture)
+{
+    UINT32 Width = PURPL_MAX(Texture->Width / 2, 1);
+    UINT32 Height = PURPL_MAX(Texture->Height / 2, 1);
+    UINT64 PixelsSize = (UINT64)Width * Height * 4;
+    PTEXTURE Mip = CmnAlloc(sizeof(TEXTURE) + PixelsSize, 1);
+    if (!Mip)
+    {
+        CmnError("Failed to allocate %llu bytes for mip level: %s", sizeof(TEXTURE) + PixelsSize, strerror(errno));
+    }
+
+    *Mip = *Texture;
+    Mip->Width = Width;
+    Mip->Height = Height;
+    Mip->Pixels = Mip + 1;
+
+    // The engine samples textures as sRGB, so colours are averaged after undoing the curve or every level gets darker
+    FLOAT Linear[256];
+    for (UINT32 i = 0; i < PURPL_ARRAYSIZE(Linear); i++)
+    {
+        Linear[i] = SrgbToLinear(i / 255.0f);
+    }
+
+    CONST UINT8 *Source = Texture->Pixels;
+    PBYTE Destination = Mip->Pixels;
+    for (UINT32 Y = 0; Y < Height; Y++)
+    {
+        // Odd sizes leave the last row or column out of the 2x2 box, which is what GPUs do too
+        UINT32 SourceY[2] = {PURPL_MIN(Y * 2, Texture->Height - 1), PURPL_MIN(Y * 2 + 1, Texture->Height - 1)};
+        for (UINT32 X = 0; X < Width; X++, Destination += 4)
+        {
+            UINT32 SourceX[2] = {PURPL_MIN(X * 2, Texture->Width - 1), PURPL_MIN(X * 2 + 1, Texture->Width - 1)};
+
+            FLOAT Sum[4] = {0};
+            for (UINT32 i = 0; i < 4; i++)
+            {
+                CONST UINT8 *Pixel = Source + ((UINT64)SourceY[i / 2] * Texture->Width + SourceX[i % 2]) * 4;
+                Sum[0] += Linear[Pixel[0]];
+                Sum[1] += Linear[Pixel[1]];
+                Sum[2] += Linear[Pixel[2]];
+                Sum[3] += Pixel[3];
+            }
+
+            for (UINT32 Channel = 0; Channel < 3; Channel++)
+            {
+                Destination[Channel] = (UINT8)(LinearToSrgb(Sum[Channel] / 4.0f) * 255.0f + 0.5f);
+            }
+            Destination[3] = (UINT8)(Sum[3] / 4.0f + 0.5f);
+        }
+    }
+
+    return Mip;
+}
@@ -0,0 +1,482 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    optimize.c
+
+Abstract:
+
+    This file reorders meshes for the GPU. Triangles are ordered for the
+    post-transform vertex cache with Tom Forsyth's linear-speed algorithm,
+    optionally split into clusters that are sorted so the ones facing out
+    from the middle of the mesh draw first, and vertices are then reordered
+    by first use so fetches walk the vertex buffer in order.
+
+--*/
+
+#include "packtool.h"
+
+/// @brief Size of the modelled LRU cache, bigger than any real one so its tail still counts for something
+#define OPTIMIZE_CACHE_SIZE 32
+
+/// @brief Size of the FIFO cache used to report the average cache miss ratio
+#define OPTIMIZE_STATS_CACHE_SIZE 16
+
+/// @brief How much worse a cluster's cache miss ratio can get from splitting it for overdraw sorting
+#define OPTIMIZE_OVERDRAW_THRESHOLD 1.05f
+
+/// @brief Score of the vertices of the last triangle, lower than the next few so strips don't only grow one way
+#define OPTIMIZE_LAST_TRIANGLE_SCORE 0.75f
+
+/// @brief How much to favour vertices with few triangles left, so they don't get stranded
+#define OPTIMIZE_VALENCE_BOOST_SCALE 2.0f
+
+/// @brief Per-vertex state for the cache optimiser
+PURPL_MAKE_TAG(struct, OPTIMIZE_VERTEX, {
+    UINT32 *Triangles; // triangles that use this vertex and haven't been emitted, points into one shared array
+    UINT32 TriangleCount;
+    INT32 CachePosition; // -1 if not in the cache
+    FLOAT Score;
+})
+
+static FLOAT ScoreVertex(_In_ PCOPTIMIZE_VERTEX Vertex)
+{
+    if (!Vertex->TriangleCount)
+    {
+        return -1.0f;
+    }
+
+    FLOAT Score = 0.0f;
+    if (Vertex->CachePosition >= 0)
+    {
+        if (Vertex->CachePosition < 3)
+        {
+            Score = OPTIMIZE_LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            Score = 1.0f - (FLOAT)(Vertex->CachePosition - 3) / (OPTIMIZE_CACHE_SIZE - 3);
+            Score = powf(Score, 1.5f);
+        }
+    }
+
+    return Score + OPTIMIZE_VALENCE_BOOST_SCALE / sqrtf((FLOAT)Vertex->TriangleCount);
+}
+
+static FLOAT ScoreTriangle(_In_ PCOPTIMIZE_VERTEX Vertices, _In_ CONST ivec3 Triangle)
+{
+    return Vertices[Triangle[0]].Score + Vertices[Triangle[1]].Score + Vertices[Triangle[2]].Score;
+}
+
+static UINT32 CountCacheMisses(_In_ CONST ivec3 Triangle, _Inout_ PUINT64 Timestamps, _Inout_ PUINT64 Time)
+{
+    // A vertex is in a FIFO cache if it was last added less than a cache size of misses ago
+    UINT32 Misses = 0;
+    for (UINT32 i = 0; i < 3; i++)
+    {
+        UINT32 Vertex = (UINT32)Triangle[i];
+        if (*Time - Timestamps[Vertex] >= OPTIMIZE_STATS_CACHE_SIZE)
+        {
+            Timestamps[Vertex] = ++*Time;
+            Misses++;
+        }
+    }
+
+    return Misses;
+}
+
+static FLOAT GetCacheMissRatio(_In_ PCMESH Mesh)
+{
+    PUINT64 Timestamps = CmnAllocType(Mesh->VertexCount, UINT64);
+    if (!Timestamps)
+    {
+        CmnError("Failed to allocate cache timestamps: %s", strerror(errno));
+    }
+
+    UINT64 Time = OPTIMIZE_STATS_CACHE_SIZE;
+    UINT64 Misses = 0;
+    for (UINT64 i = 0; i < Mesh->IndexCount; i++)
+    {
+        Misses += CountCacheMisses(Mesh->Indices[i], Timestamps, &Time);
+    }
+
+    CmnFree(Timestamps);
+
+    return Mesh->IndexCount ? (FLOAT)Misses / Mesh->IndexCount : 0.0f;
+}
+
+static VOID OptimizeVertexCache(_Inout_ PMESH Mesh, _Inout_ UINT32 **DeadEnds)
+{
+    UINT32 TriangleCount = (UINT32)Mesh->IndexCount;
+    UINT32 VertexCount = (UINT32)Mesh->VertexCount;
+
+    POPTIMIZE_VERTEX Vertices = CmnAllocType(VertexCount, OPTIMIZE_VERTEX);
+    UINT32 *Adjacency = CmnAllocType(TriangleCount * 3, UINT32);
+    FLOAT *TriangleScores = CmnAllocType(TriangleCount, FLOAT);
+    BOOLEAN *Emitted = CmnAllocType(TriangleCount, BOOLEAN);
+    ivec3 *Output = CmnAllocType(TriangleCount, ivec3);
+    if (!Vertices || !Adjacency || !TriangleScores || !Emitted || !Output)
+    {
+        CmnError("Failed to allocate vertex cache optimiser state: %s", strerror(errno));
+    }
+
+    // Count the triangles of each vertex, carve the adjacency array up between them, then fill it in
+    for (UINT32 i = 0; i < TriangleCount; i++)
+    {
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            Vertices[Mesh->Indices[i][j]].TriangleCount++;
+        }
+    }
+
+    UINT32 Offset = 0;
+    for (UINT32 i = 0; i < VertexCount; i++)
+    {
+        Vertices[i].Triangles = Adjacency + Offset;
+        Offset += Vertices[i].TriangleCount;
+        Vertices[i].TriangleCount = 0;
+        Vertices[i].CachePosition = -1;
+    }
+
+    for (UINT32 i = 0; i < TriangleCount; i++)
+    {
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            POPTIMIZE_VERTEX Vertex = &Vertices[Mesh->Indices[i][j]];
+            Vertex->Triangles[Vertex->TriangleCount++] = i;
+        }
+    }
+
+    for (UINT32 i = 0; i < VertexCount; i++)
+    {
+        Vertices[i].Score = ScoreVertex(&Vertices[i]);
+    }
+    for (UINT32 i = 0; i < TriangleCount; i++)
+    {
+        TriangleScores[i] = ScoreTriangle(Vertices, Mesh->Indices[i]);
+    }
+
+    // Three extra slots hold the vertices pushed out by the last triangle, so their scores get updated
+    INT32 Cache[OPTIMIZE_CACHE_SIZE + 3];
+    UINT32 CacheCount = 0;
+    UINT32 Cursor = 0;
+    INT64 Best = -1;
+
+    for (UINT32 Count = 0; Count < TriangleCount; Count++)
+    {
+        if (Best < 0)
+        {
+            // Dead end, nothing in the cache has triangles left, so start a new cluster from the next unused one
+            while (Emitted[Cursor])
+            {
+                Cursor++;
+            }
+            Best = Cursor;
+            stbds_arrpush(*DeadEnds, Count);
+        }
+
+        UINT32 Triangle = (UINT32)Best;
+        Emitted[Triangle] = TRUE;
+        memcpy(Output[Count], Mesh->Indices[Triangle], sizeof(ivec3));
+
+        // Move the triangle's vertices to the front of the cache and take the triangle off their lists
+        INT32 NewCache[OPTIMIZE_CACHE_SIZE + 3 + 3];
+        UINT32 NewCacheCount = 0;
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            UINT32 Index = (UINT32)Mesh->Indices[Triangle][j];
+            POPTIMIZE_VERTEX Vertex = &Vertices[Index];
+            for (UINT32 k = 0; k < Vertex->TriangleCount; k++)
+            {
+                if (Vertex->Triangles[k] == Triangle)
+                {
+                    Vertex->Triangles[k] = Vertex->Triangles[--Vertex->TriangleCount];
+                    break;
+                }
+            }
+            if (!NewCacheCount || (NewCache[NewCacheCount - 1] != (INT32)Index && NewCache[0] != (INT32)Index))
+            {
+                NewCache[NewCacheCount++] = (INT32)Index;
+            }
+        }
+        UINT32 TriangleVertexCount = NewCacheCount;
+        for (UINT32 j = 0; j < CacheCount; j++)
+        {
+            BOOLEAN Duplicate = FALSE;
+            for (UINT32 k = 0; k < TriangleVertexCount; k++)
+            {
+                Duplicate |= Cache[j] == NewCache[k];
+            }
+            if (!Duplicate)
+            {
+                NewCache[NewCacheCount++] = Cache[j];
+            }
+        }
+
+        // Rescore everything that was in the cache, and the triangles that use it
+        Best = -1;
+        FLOAT BestScore = -1.0f;
+        for (UINT32 j = 0; j < NewCacheCount; j++)
+        {
+            POPTIMIZE_VERTEX Vertex = &Vertices[NewCache[j]];
+            Vertex->CachePosition = j < OPTIMIZE_CACHE_SIZE ? (INT32)j : -1;
+            Vertex->Score = ScoreVertex(Vertex);
+        }
+        for (UINT32 j = 0; j < NewCacheCount; j++)
+        {
+            PCOPTIMIZE_VERTEX Vertex = &Vertices[NewCache[j]];
+            for (UINT32 k = 0; k < Vertex->TriangleCount; k++)
+            {
+                UINT32 Other = Vertex->Triangles[k];
+                TriangleScores[Other] = ScoreTriangle(Vertices, Mesh->Indices[Other]);
+                if (TriangleScores[Other] > BestScore)
+                {
+                    Best = Other;
+                    BestScore = TriangleScores[Other];
+                }
+            }
+        }
+
+        CacheCount = PURPL_MIN(NewCacheCount, OPTIMIZE_CACHE_SIZE);
+        memcpy(Cache, NewCache, CacheCount * sizeof(INT32));
+    }
+
+    memcpy(Mesh->Indices, Output, TriangleCount * sizeof(ivec3));
+
+    CmnFree(Output);
+    CmnFree(Emitted);
+    CmnFree(TriangleScores);
+    CmnFree(Adjacency);
+    CmnFree(Vertices);
+}
+
+static VOID SplitClusters(_In_ PCMESH Mesh, _In_ CONST UINT32 *DeadEnds, _Inout_ UINT32 **ClusterStarts)
+{
+    UINT32 TriangleCount = (UINT32)Mesh->IndexCount;
+    PUINT64 Timestamps = CmnAllocType(Mesh->VertexCount, UINT64);
+    if (!Timestamps)
+    {
+        CmnError("Failed to allocate cache timestamps: %s", strerror(errno));
+    }
+
+    // Bumping the time by a cache size empties the simulated cache
+    UINT64 Time = OPTIMIZE_STATS_CACHE_SIZE;
+    for (SIZE_T i = 0; i < stbds_arrlenu(DeadEnds); i++)
+    {
+        UINT32 Start = DeadEnds[i];
+        UINT32 End = i + 1 < stbds_arrlenu(DeadEnds) ? DeadEnds[i + 1] : TriangleCount;
+
+        UINT64 Misses = 0;
+        for (UINT32 j = Start; j < End; j++)
+        {
+            Misses += CountCacheMisses(Mesh->Indices[j], Timestamps, &Time);
+        }
+        Time += OPTIMIZE_STATS_CACHE_SIZE;
+        FLOAT Target = (FLOAT)Misses / (End - Start) * OPTIMIZE_OVERDRAW_THRESHOLD;
+
+        // Cut wherever the piece so far is about as cache friendly as the whole run, so splitting costs little
+        stbds_arrpush(*ClusterStarts, Start);
+        UINT32 ClusterStart = Start;
+        UINT64 ClusterMisses = 0;
+        for (UINT32 j = Start; j + 1 < End; j++)
+        {
+            ClusterMisses += CountCacheMisses(Mesh->Indices[j], Timestamps, &Time);
+            if ((FLOAT)ClusterMisses / (j + 1 - ClusterStart) <= Target)
+            {
+                stbds_arrpush(*ClusterStarts, j + 1);
+                ClusterStart = j + 1;
+                ClusterMisses = 0;
+                Time += OPTIMIZE_STATS_CACHE_SIZE;
+            }
+        }
+        Time += OPTIMIZE_STATS_CACHE_SIZE;
+    }
+
+    CmnFree(Timestamps);
+}
+
+/// @brief A run of triangles from the cache optimiser that gets drawn as a unit
+PURPL_MAKE_TAG(struct, OPTIMIZE_CLUSTER, {
+    UINT32 Start;
+    UINT32 Count;
+    FLOAT Sort;
+})
+
+static INT CompareClusters(_In_ CONST VOID *A, _In_ CONST VOID *B)
+{
+    PCOPTIMIZE_CLUSTER First = A;
+    PCOPTIMIZE_CLUSTER Second = B;
+
+    // Descending, the clusters most likely to occlude others go first
+    if (First->Sort > Second->Sort)
+    {
+        return -1;
+    }
+    else if (First->Sort < Second->Sort)
+    {
+        return 1;
+    }
+    return (INT)First->Start - (INT)Second->Start;
+}
+
+static VOID OptimizeOverdraw(_Inout_ PMESH Mesh, _In_ CONST UINT32 *DeadEnds)
+{
+    UINT32 TriangleCount = (UINT32)Mesh->IndexCount;
+    UINT32 *ClusterStarts = NULL;
+    SplitClusters(Mesh, DeadEnds, &ClusterStarts);
+    UINT32 ClusterCount = (UINT32)stbds_arrlenu(ClusterStarts);
+    if (ClusterCount < 2)
+    {
+        stbds_arrfree(ClusterStarts);
+        return;
+    }
+
+    vec3 MeshCentre = {0};
+    for (UINT64 i = 0; i < Mesh->VertexCount; i++)
+    {
+        glm_vec3_add(MeshCentre, Mesh->Vertices[i].Position, MeshCentre);
+    }
+    glm_vec3_scale(MeshCentre, 1.0f / Mesh->VertexCount, MeshCentre);
+
+    POPTIMIZE_CLUSTER Clusters = CmnAllocType(ClusterCount, OPTIMIZE_CLUSTER);
+    ivec3 *Output = CmnAllocType(TriangleCount, ivec3);
+    if (!Clusters || !Output)
+    {
+        CmnError("Failed to allocate overdraw optimiser state: %s", strerror(errno));
+    }
+
+    // Clusters facing away from the centre are on the outside, so drawing them first hides more of the rest
+    for (UINT32 i = 0; i < ClusterCount; i++)
+    {
+        POPTIMIZE_CLUSTER Cluster = &Clusters[i];
+        Cluster->Start = ClusterStarts[i];
+        Cluster->Count = (i + 1 < ClusterCount ? ClusterStarts[i + 1] : TriangleCount) - Cluster->Start;
+
+        vec3 Centre = {0};
+        vec3 Normal = {0};
+        FLOAT Area = 0.0f;
+        for (UINT32 j = Cluster->Start; j < Cluster->Start + Cluster->Count; j++)
+        {
+            PCMESH_VERTEX A = &Mesh->Vertices[Mesh->Indices[j][0]];
+            PCMESH_VERTEX B = &Mesh->Vertices[Mesh->Indices[j][1]];
+            PCMESH_VERTEX C = &Mesh->Vertices[Mesh->Indices[j][2]];
+
+            vec3 Edge1;
+            vec3 Edge2;
+            vec3 Cross;
+            glm_vec3_sub((FLOAT *)B->Position, (FLOAT *)A->Position, Edge1);
+            glm_vec3_sub((FLOAT *)C->Position, (FLOAT *)A->Position, Edge2);
+            glm_vec3_cross(Edge1, Edge2, Cross);
+            FLOAT TriangleArea = glm_vec3_norm(Cross);
+
+            // The cross product's length is twice the area, so it weights the normal and the centre correctly
+            glm_vec3_add(Normal, Cross, Normal);
+            vec3 TriangleCentre;
+            glm_vec3_add((FLOAT *)A->Position, (FLOAT *)B->Position, TriangleCentre);
+            glm_vec3_add(TriangleCentre, (FLOAT *)C->Position, TriangleCentre);
+            glm_vec3_muladds(TriangleCentre, TriangleArea / 3.0f, Centre);
+            Area += TriangleArea;
+        }
+
+        if (Area > 0.0f)
+        {
+            glm_vec3_scale(Centre, 1.0f / Area, Centre);
+        }
+        glm_vec3_normalize(Normal);
+        glm_vec3_sub(Centre, MeshCentre, Centre);
+        Cluster->Sort = glm_vec3_dot(Centre, Normal);
+    }
+
+    qsort(Clusters, ClusterCount, sizeof(OPTIMIZE_CLUSTER), CompareClusters);
+
+    UINT32 Offset = 0;
+    for (UINT32 i = 0; i < ClusterCount; i++)
+    {
+        memcpy(Output[Offset], Mesh->Indices[Clusters[i].Start], Clusters[i].Count * sizeof(ivec3));
+        Offset += Clusters[i].Count;
+    }
+    memcpy(Mesh->Indices, Output, TriangleCount * sizeof(ivec3));
+
+    LogDebug("Sorted %u clusters for overdraw", ClusterCount);
+
+    CmnFree(Output);
+    CmnFree(Clusters);
+    stbds_arrfree(ClusterStarts);
+}
+
+static VOID OptimizeVertexFetch(_Inout_ PMESH Mesh)
+{
+    UINT32 *Remap = CmnAllocType(Mesh->VertexCount, UINT32);
+    PMESH_VERTEX Vertices = CmnAllocType(Mesh->VertexCount, MESH_VERTEX);
+    if (!Remap || !Vertices)
+    {
+        CmnError("Failed to allocate vertex fetch optimiser state: %s", strerror(errno));
+    }
+
+    // Number vertices in the order the index buffer first reaches them, which also drops unused ones
+    memset(Remap, 0xFF, Mesh->VertexCount * sizeof(UINT32));
+    UINT32 VertexCount = 0;
+    for (UINT64 i = 0; i < Mesh->IndexCount; i++)
+    {
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            UINT32 Index = (UINT32)Mesh->Indices[i][j];
+            if (Remap[Index] == UINT32_MAX)
+            {
+                Remap[Index] = VertexCount;
+                Vertices[VertexCount++] = Mesh->Vertices[Index];
+            }
+            Mesh->Indices[i][j] = (INT32)Remap[Index];
+        }
+    }
+
+    if (VertexCount < Mesh->VertexCount)
+    {
+        LogDebug("Dropped %llu unused vertices", (UINT64)(Mesh->VertexCount - VertexCount));
+    }
+
+    memcpy(Mesh->Vertices, Vertices, VertexCount * sizeof(MESH_VERTEX));
+    Mesh->VertexCount = VertexCount;
+
+    CmnFree(Vertices);
+    CmnFree(Remap);
+}
+
+VOID PackOptimizeMesh(_In_z_ PCSTR Name, _Inout_ PMESH Mesh, _In_ PCASSET_MESH_LOD Lods, _In_ UINT32 LodCount,
+                      _In_ PCPACK_OPTIONS Options)
+{
+    if (!Options->OptimizeMeshes || !Mesh->IndexCount || !Mesh->VertexCount)
+    {
+        return;
+    }
+
+    // Each level of detail is drawn on its own, so each one gets ordered for the cache by itself
+    for (UINT32 i = 0; i < LodCount; i++)
+    {
+        MESH Lod = *Mesh;
+        Lod.Indices = Mesh->Indices + Lods[i].IndexOffset;
+        Lod.IndexCount = Lods[i].IndexCount;
+        if (!Lod.IndexCount)
+        {
+            continue;
+        }
+
+        FLOAT Before = GetCacheMissRatio(&Lod);
+
+        UINT32 *DeadEnds = NULL;
+        OptimizeVertexCache(&Lod, &DeadEnds);
+        if (Options->OptimizeOverdraw)
+        {
+            OptimizeOverdraw(&Lod, DeadEnds);
+        }
+        stbds_arrfree(DeadEnds);
+
+        LogDebug("Optimised level of detail %u of mesh %s, average cache miss ratio %.3f -> %.3f", i, Name, Before,
+                 GetCacheMissRatio(&Lod));
+    }
+
+    // The vertices are shared, and the first level of detail comes first, so it decides their order
+    OptimizeVertexFetch(Mesh);
+}
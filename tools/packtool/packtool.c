@@ -0,0 +1,755 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    packtool.c
+
+Abstract:
+
+    This file implements the mapped pack builder. It collects the files in
+    one or more asset directories, cooks what it can, and writes a pack the
+    engine maps with AstMountPack.
+
+--*/
+
+#include "packtool.h"
+
+#ifdef PURPL_UNIX
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+VOID PackListFiles(_In_z_ PCSTR Root, _In_opt_z_ PCSTR Relative, _Inout_ PCHAR **Names)
+{
+    PCHAR Directory = Relative ? CmnFormatString("%s/%s", Root, Relative) : CmnFormatString("%s", Root);
+
+#if defined PURPL_UNIX
+    DIR *Handle = opendir(Directory);
+    if (!Handle)
+    {
+        LogWarning("Failed to open directory %s: %s", Directory, strerror(errno));
+        CmnFree(Directory);
+        return;
+    }
+
+    struct dirent *Entry;
+    while ((Entry = readdir(Handle)))
+    {
+        if (strcmp(Entry->d_name, ".") == 0 || strcmp(Entry->d_name, "..") == 0)
+        {
+            continue;
+        }
+
+        PCHAR Name = Relative ? CmnFormatString("%s/%s", Relative, Entry->d_name) : CmnFormatString("%s", Entry->d_name);
+        PCHAR Full = CmnFormatString("%s/%s", Root, Name);
+
+        struct stat Stat = {0};
+        if (stat(Full, &Stat) == 0 && S_ISDIR(Stat.st_mode))
+        {
+            PackListFiles(Root, Name, Names);
+            CmnFree(Name);
+        }
+        else
+        {
+            stbds_arrpush(*Names, Name);
+        }
+
+        CmnFree(Full);
+    }
+
+    closedir(Handle);
+#elif defined PURPL_WIN32
+    PCHAR Pattern = CmnFormatString("%s/*", Directory);
+    WIN32_FIND_DATAA FindData = {0};
+    HANDLE Handle = FindFirstFileA(Pattern, &FindData);
+    CmnFree(Pattern);
+    if (Handle == INVALID_HANDLE_VALUE)
+    {
+        LogWarning("Failed to open directory %s: error 0x%X", Directory, GetLastError());
+        CmnFree(Directory);
+        return;
+    }
+
+    do
+    {
+        if (strcmp(FindData.cFileName, ".") == 0 || strcmp(FindData.cFileName, "..") == 0)
+        {
+            continue;
+        }
+
+        PCHAR Name =
+            Relative ? CmnFormatString("%s/%s", Relative, FindData.cFileName) : CmnFormatString("%s", FindData.cFileName);
+        if (FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            PackListFiles(Root, Name, Names);
+            CmnFree(Name);
+        }
+        else
+        {
+            stbds_arrpush(*Names, Name);
+        }
+    } while (FindNextFileA(Handle, &FindData));
+
+    FindClose(Handle);
+#else
+    LogError("Listing directories isn't supported on this platform");
+#endif
+
+    CmnFree(Directory);
+}
+
+/// @brief A bucket of the entry index, while it's being built
+PURPL_MAKE_TAG(struct, PACK_INDEX_BUCKET, {
+    UINT32 Bucket;
+    UINT32 Start; // into the bucket members
+    UINT32 Count;
+})
+
+static INT CompareBuckets(_In_ CONST VOID *A, _In_ CONST VOID *B)
+{
+    PCPACK_INDEX_BUCKET BucketA = A;
+    PCPACK_INDEX_BUCKET BucketB = B;
+
+    // Biggest first, the small ones are easier to fit into the slots that are left
+    if (BucketA->Count != BucketB->Count)
+    {
+        return BucketA->Count > BucketB->Count ? -1 : 1;
+    }
+    else
+    {
+        return BucketA->Bucket < BucketB->Bucket ? -1 : BucketA->Bucket > BucketB->Bucket;
+    }
+}
+
+// Builds the entry index (hash and displace, see AstGetPackSlot) and puts the inputs in the order of their slots
+static VOID BuildIndex(_Inout_ PPACK_INPUT Inputs, _In_ UINT32 EntryCount, _Out_ PUINT32 *Seeds,
+                       _Out_ UINT32 *BucketCount)
+{
+    *BucketCount = PURPL_MAX((EntryCount + ASSET_PACK_INDEX_BUCKET_SIZE - 1) / ASSET_PACK_INDEX_BUCKET_SIZE, 1);
+    *Seeds = CmnAllocType(*BucketCount, UINT32);
+    PPACK_INDEX_BUCKET Buckets = CmnAllocType(*BucketCount, PACK_INDEX_BUCKET);
+    PUINT32 Members = CmnAllocType(EntryCount ? EntryCount : 1, UINT32);
+    PUINT32 Slots = CmnAllocType(EntryCount ? EntryCount : 1, UINT32);
+    if (!*Seeds || !Buckets || !Members || !Slots)
+    {
+        CmnError("Failed to allocate entry index: %s", strerror(errno));
+    }
+
+    // Group the inputs by bucket
+    for (UINT32 i = 0; i < *BucketCount; i++)
+    {
+        Buckets[i].Bucket = i;
+    }
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        Buckets[AstGetPackBucket(Inputs[i].Hash, *BucketCount)].Count++;
+    }
+    for (UINT32 i = 0, Start = 0; i < *BucketCount; i++)
+    {
+        Buckets[i].Start = Start;
+        Start += Buckets[i].Count;
+        Buckets[i].Count = 0;
+    }
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        PPACK_INDEX_BUCKET Bucket = &Buckets[AstGetPackBucket(Inputs[i].Hash, *BucketCount)];
+        Members[Bucket->Start + Bucket->Count++] = i;
+    }
+
+    qsort(Buckets, *BucketCount, sizeof(PACK_INDEX_BUCKET), CompareBuckets);
+
+    // Find a seed for each bucket that puts all of its inputs in free slots
+    memset(Slots, 0xFF, (EntryCount ? EntryCount : 1) * sizeof(UINT32));
+    for (UINT32 i = 0; i < *BucketCount && Buckets[i].Count; i++)
+    {
+        PCPACK_INDEX_BUCKET Bucket = &Buckets[i];
+        UINT32 Seed = 0;
+        while (TRUE)
+        {
+            UINT32 Placed = 0;
+            for (; Placed < Bucket->Count; Placed++)
+            {
+                UINT32 Input = Members[Bucket->Start + Placed];
+                UINT32 Slot = AstGetPackSlot(Inputs[Input].Hash, Seed, EntryCount);
+                if (Slots[Slot] != UINT32_MAX)
+                {
+                    break;
+                }
+                Slots[Slot] = Input;
+            }
+
+            if (Placed == Bucket->Count)
+            {
+                break;
+            }
+
+            for (UINT32 j = 0; j < Placed; j++)
+            {
+                Slots[AstGetPackSlot(Inputs[Members[Bucket->Start + j]].Hash, Seed, EntryCount)] = UINT32_MAX;
+            }
+
+            if (++Seed == 0)
+            {
+                CmnError("Failed to find a seed for bucket %u of the entry index", Bucket->Bucket);
+            }
+        }
+
+        (*Seeds)[Bucket->Bucket] = Seed;
+    }
+
+    PPACK_INPUT Sorted = CmnAllocType(EntryCount ? EntryCount : 1, PACK_INPUT);
+    if (!Sorted)
+    {
+        CmnError("Failed to allocate entry index: %s", strerror(errno));
+    }
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        Sorted[i] = Inputs[Slots[i]];
+    }
+    memcpy(Inputs, Sorted, EntryCount * sizeof(PACK_INPUT));
+
+    LogInfo("Built entry index with %u buckets for %u entries", *BucketCount, EntryCount);
+
+    CmnFree(Sorted);
+    CmnFree(Slots);
+    CmnFree(Members);
+    CmnFree(Buckets);
+}
+
+static VOID CollectInputs(_In_z_ PCSTR Directory, _Inout_ PPACK_INPUT *Inputs)
+{
+    PCHAR *Names = NULL;
+
+    LogInfo("Collecting files from %s", Directory);
+    FsAddDirectorySource(Directory);
+    PackListFiles(Directory, NULL, &Names);
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(Names); i++)
+    {
+        PACK_INPUT Input = {0};
+        Input.Name = Names[i];
+        Input.Hash = AstHashPath(Input.Name);
+
+        // Later directories override earlier ones, like the engine's sources
+        BOOLEAN Replaced = FALSE;
+        for (SIZE_T j = 0; j < stbds_arrlenu(*Inputs); j++)
+        {
+            if ((*Inputs)[j].Hash == Input.Hash)
+            {
+                if (strcmp((*Inputs)[j].Name, Input.Name) != 0)
+                {
+                    CmnError("Hash collision between %s and %s", (*Inputs)[j].Name, Input.Name);
+                }
+
+                CmnFree((*Inputs)[j].Name);
+                (*Inputs)[j] = Input;
+                Replaced = TRUE;
+                break;
+            }
+        }
+
+        if (!Replaced)
+        {
+            stbds_arrpush(*Inputs, Input);
+        }
+    }
+
+    stbds_arrfree(Names);
+}
+
+static VOID LoadInput(_Inout_ PPACK_INPUT Input, _In_ PCPACK_OPTIONS Options)
+{
+    Input->Data = FsReadFile(FALSE, Input->Name, 0, 0, &Input->Size, 0);
+    if (!Input->Data)
+    {
+        CmnError("Failed to read %s", Input->Name);
+    }
+
+    PackCookInput(Input, Options);
+    Input->ContentHash = AstHashData(Input->Data, Input->Size, 0);
+}
+
+static VOID LoadInputs(_Inout_ PPACK_INPUT Inputs, _In_ PCPACK_OPTIONS Options)
+{
+    LogInfo("Loading %zu files on %u threads", stbds_arrlenu(Inputs), Options->ThreadCount);
+    PackRunParallel(Inputs, Options, (PFN_PACK_INPUT_WORK)LoadInput, (PVOID)Options);
+}
+
+/// @brief The first input seen with some contents
+PURPL_MAKE_TAG(struct, PACK_CONTENT_MAP, {
+    UINT64 key;
+    SIZE_T value;
+})
+
+static VOID DeduplicateInputs(_Inout_ PPACK_INPUT Inputs)
+{
+    PPACK_CONTENT_MAP Contents = NULL;
+    UINT32 DuplicateCount = 0;
+    UINT64 SavedSize = 0;
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(Inputs); i++)
+    {
+        PPACK_INPUT Input = &Inputs[i];
+        PPACK_CONTENT_MAP Existing = stbds_hmgetp_null(Contents, Input->ContentHash);
+        if (!Existing)
+        {
+            stbds_hmput(Contents, Input->ContentHash, i);
+            continue;
+        }
+
+        // Cooking can change the size and flags, so identical contents can still be stored differently
+        PCPACK_INPUT Original = &Inputs[Existing->value];
+        if (Original->Size != Input->Size || Original->Flags != Input->Flags ||
+            memcmp(Original->Data, Input->Data, (SIZE_T)Input->Size) != 0)
+        {
+            continue;
+        }
+
+        LogDebug("%s is identical to %s", Input->Name, Original->Name);
+        Input->Original = Original->Name;
+        DuplicateCount++;
+        SavedSize += Input->Size;
+    }
+
+    if (DuplicateCount)
+    {
+        LogInfo("Found %u duplicate files (%llu bytes)", DuplicateCount, SavedSize);
+    }
+
+    stbds_hmfree(Contents);
+}
+
+/// @brief What CompressInput needs besides the input
+PURPL_MAKE_TAG(struct, PACK_COMPRESS_CONTEXT, {
+    PCPACK_OPTIONS Options;
+    CONST VOID *CompressionDictionary;
+})
+
+static VOID CompressInput(_Inout_ PPACK_INPUT Input, _In_ PCPACK_COMPRESS_CONTEXT Context)
+{
+    if (!Input->Original)
+    {
+        PackCompressInput(Input, Context->Options, Context->CompressionDictionary);
+    }
+}
+
+static VOID CompressInputs(_Inout_ PPACK_INPUT Inputs, _In_ PCPACK_OPTIONS Options, _In_opt_ CONST VOID *Dictionary,
+                           _In_ UINT64 DictionarySize)
+{
+    PACK_COMPRESS_CONTEXT Context = {Options, NULL};
+    UINT64 TotalSize = 0;
+    UINT64 TotalStoredSize = 0;
+
+    if (Options->CompressionLevel && Dictionary)
+    {
+        Context.CompressionDictionary = PackCreateCompressionDictionary(Dictionary, DictionarySize, Options);
+    }
+
+    PackRunParallel(Inputs, Options, (PFN_PACK_INPUT_WORK)CompressInput, &Context);
+
+    if (Context.CompressionDictionary)
+    {
+        PackFreeCompressionDictionary((PVOID)Context.CompressionDictionary);
+    }
+
+    for (SIZE_T i = 0; i < stbds_arrlenu(Inputs); i++)
+    {
+        if (!Inputs[i].Original)
+        {
+            TotalSize += Inputs[i].Size;
+            TotalStoredSize += Inputs[i].StoredSize;
+        }
+    }
+
+    if (Options->CompressionLevel)
+    {
+        LogInfo("Compressed %llu bytes to %llu bytes (%.1f%%)", TotalSize, TotalStoredSize,
+                TotalSize ? (DOUBLE)TotalStoredSize / (DOUBLE)TotalSize * 100.0 : 100.0);
+    }
+}
+
+// Reads a load order trace, one asset path per line in the order the engine first opened them
+static VOID ReadLoadOrder(_Inout_ PPACK_INPUT Inputs, _In_opt_z_ PCSTR Path)
+{
+    for (SIZE_T i = 0; i < stbds_arrlenu(Inputs); i++)
+    {
+        Inputs[i].LoadOrder = UINT32_MAX;
+    }
+
+    if (!Path)
+    {
+        return;
+    }
+
+    FILE *File = fopen(Path, "rb");
+    if (!File)
+    {
+        LogWarning("Failed to open load order trace %s, ignoring it: %s", Path, strerror(errno));
+        return;
+    }
+
+    CHAR Line[1024];
+    UINT32 Position = 0;
+    UINT32 Matched = 0;
+    while (fgets(Line, PURPL_ARRAYSIZE(Line), File))
+    {
+        Line[strcspn(Line, "\r\n")] = 0;
+        if (!Line[0] || Line[0] == '#')
+        {
+            continue;
+        }
+
+        // The paths are hashed the same way as the entries, so they don't have to be spelled the same
+        UINT64 Hash = AstHashPath(Line);
+        for (SIZE_T i = 0; i < stbds_arrlenu(Inputs); i++)
+        {
+            if (Inputs[i].Hash == Hash && Inputs[i].LoadOrder == UINT32_MAX)
+            {
+                Inputs[i].LoadOrder = Position;
+                Matched++;
+                break;
+            }
+        }
+        Position++;
+    }
+
+    fclose(File);
+
+    // Duplicates don't have their own data, so the data they share goes wherever the first of them was loaded
+    for (SIZE_T i = 0; i < stbds_arrlenu(Inputs); i++)
+    {
+        for (SIZE_T j = 0; Inputs[i].Original && j < stbds_arrlenu(Inputs); j++)
+        {
+            if (Inputs[j].Name == Inputs[i].Original)
+            {
+                Inputs[j].LoadOrder = PURPL_MIN(Inputs[j].LoadOrder, Inputs[i].LoadOrder);
+                break;
+            }
+        }
+    }
+
+    LogInfo("Matched %u of %u paths in load order trace %s", Matched, Position, Path);
+}
+
+static INT CompareLoadOrder(_In_ CONST VOID *A, _In_ CONST VOID *B)
+{
+    PCPACK_INPUT InputA = *(CONST PCPACK_INPUT *)A;
+    PCPACK_INPUT InputB = *(CONST PCPACK_INPUT *)B;
+
+    // Traced files first in the order they were loaded, then everything else by name so directories stay together
+    if (InputA->LoadOrder != InputB->LoadOrder)
+    {
+        return InputA->LoadOrder < InputB->LoadOrder ? -1 : 1;
+    }
+    else
+    {
+        return strcmp(InputA->Name, InputB->Name);
+    }
+}
+
+static VOID WritePadding(_In_ FILE *File, _In_ UINT64 Alignment)
+{
+    static CONST BYTE Zeroes[64] = {0};
+
+    UINT64 Position = (UINT64)ftell(File);
+    UINT64 Padding = PACK_ALIGN(Position, Alignment) - Position;
+    while (Padding)
+    {
+        UINT64 Count = PURPL_MIN(Padding, sizeof(Zeroes));
+        fwrite(Zeroes, 1, (SIZE_T)Count, File);
+        Padding -= Count;
+    }
+}
+
+static VOID WritePack(_In_ PPACK_INPUT Inputs, _In_ PCPACK_OPTIONS Options, _In_opt_ CONST VOID *Dictionary,
+                      _In_ UINT64 DictionarySize)
+{
+    UINT32 EntryCount = (UINT32)stbds_arrlenu(Inputs);
+
+    PUINT32 Seeds;
+    UINT32 BucketCount;
+    BuildIndex(Inputs, EntryCount, &Seeds, &BucketCount);
+
+    ASSET_PACK_HEADER Header = {0};
+    memcpy(Header.Signature, ASSET_PACK_SIGNATURE, sizeof(Header.Signature));
+    Header.Version = ASSET_PACK_VERSION;
+    Header.EntryCount = EntryCount;
+    Header.Alignment = Options->Alignment;
+    Header.EntryTableOffset = PACK_ALIGN(sizeof(ASSET_PACK_HEADER), 16);
+    Header.IndexOffset = Header.EntryTableOffset + (UINT64)EntryCount * sizeof(ASSET_PACK_ENTRY);
+    Header.IndexBucketCount = BucketCount;
+    Header.NameTableOffset = Header.IndexOffset + (UINT64)BucketCount * sizeof(UINT32);
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        Header.NameTableSize += strlen(Inputs[i].Name) + 1;
+    }
+    if (Dictionary)
+    {
+        Header.DictionaryOffset = PACK_ALIGN(Header.NameTableOffset + Header.NameTableSize, 16);
+        Header.DictionarySize = DictionarySize;
+        Header.DataOffset = PACK_ALIGN(Header.DictionaryOffset + Header.DictionarySize, Options->Alignment);
+    }
+    else
+    {
+        Header.DataOffset = PACK_ALIGN(Header.NameTableOffset + Header.NameTableSize, Options->Alignment);
+    }
+
+    PASSET_PACK_ENTRY Entries = CmnAllocType(EntryCount ? EntryCount : 1, ASSET_PACK_ENTRY);
+    if (!Entries)
+    {
+        CmnError("Failed to allocate entry table: %s", strerror(errno));
+    }
+
+    // The entry table is in index order, but the data is laid out in load order so startup reads are sequential
+    PPACK_INPUT *DataOrder = CmnAllocType(EntryCount ? EntryCount : 1, PPACK_INPUT);
+    if (!DataOrder)
+    {
+        CmnError("Failed to allocate data order: %s", strerror(errno));
+    }
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        DataOrder[i] = &Inputs[i];
+    }
+    qsort(DataOrder, EntryCount, sizeof(PPACK_INPUT), CompareLoadOrder);
+
+    UINT32 NameOffset = 0;
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        Entries[i].PathHash = Inputs[i].Hash;
+        Entries[i].Size = Inputs[i].Size;
+        Entries[i].NameOffset = NameOffset;
+
+        NameOffset += (UINT32)strlen(Inputs[i].Name) + 1;
+    }
+
+    UINT64 Offset = Header.DataOffset;
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        PCPACK_INPUT Input = DataOrder[i];
+        PASSET_PACK_ENTRY Entry = &Entries[Input - Inputs];
+        if (Input->Original)
+        {
+            continue;
+        }
+
+        Entry->Offset = Offset;
+        Entry->StoredSize = Input->StoredSize;
+        Entry->Flags = Input->Flags;
+
+        Offset = PACK_ALIGN(Offset + Entry->StoredSize, Options->Alignment);
+    }
+
+    // Duplicates point at the data of the input they're identical to, which is found with the index like the engine
+    // would
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        if (Inputs[i].Original)
+        {
+            UINT64 Hash = AstHashPath(Inputs[i].Original);
+            PCASSET_PACK_ENTRY Original =
+                &Entries[AstGetPackSlot(Hash, Seeds[AstGetPackBucket(Hash, BucketCount)], EntryCount)];
+            Entries[i].Offset = Original->Offset;
+            Entries[i].StoredSize = Original->StoredSize;
+            Entries[i].Flags = Original->Flags;
+        }
+    }
+
+    FILE *File = fopen(Options->OutputPath, "wb");
+    if (!File)
+    {
+        CmnError("Failed to open %s: %s", Options->OutputPath, strerror(errno));
+    }
+
+    fwrite(&Header, sizeof(ASSET_PACK_HEADER), 1, File);
+    WritePadding(File, 16);
+    fwrite(Entries, sizeof(ASSET_PACK_ENTRY), EntryCount, File);
+    fwrite(Seeds, sizeof(UINT32), BucketCount, File);
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        fwrite(Inputs[i].Name, 1, strlen(Inputs[i].Name) + 1, File);
+    }
+
+    if (Dictionary)
+    {
+        WritePadding(File, 16);
+        fwrite(Dictionary, 1, (SIZE_T)DictionarySize, File);
+    }
+
+    for (UINT32 i = 0; i < EntryCount; i++)
+    {
+        if (!DataOrder[i]->Original)
+        {
+            WritePadding(File, Options->Alignment);
+            fwrite(DataOrder[i]->StoredData, 1, (SIZE_T)DataOrder[i]->StoredSize, File);
+        }
+    }
+
+    LogInfo("Wrote %u entries to %s (%llu bytes)", EntryCount, Options->OutputPath, (UINT64)ftell(File));
+
+    fclose(File);
+    CmnFree(DataOrder);
+    CmnFree(Entries);
+    CmnFree(Seeds);
+}
+
+static BOOLEAN ParseTextureCompression(_In_z_ PCSTR Name, _Out_ PPACK_TEXTURE_COMPRESSION Compression)
+{
+    static CONST PCSTR Names[] = {"none", "auto", "bc1", "bc3", "bc7"};
+
+    for (UINT32 i = 0; i < PURPL_ARRAYSIZE(Names); i++)
+    {
+        if (strcmp(Name, Names[i]) == 0)
+        {
+            *Compression = (PACK_TEXTURE_COMPRESSION)i;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static VOID Usage(VOID)
+{
+    LogError("Usage: packtool [-a alignment] [-r] [-m] [-d] [-l count] [-t format] [-c level] [-s chunk size] [-n] "
+             "[-j threads] [-o load order] <output pack> <input directory> [input directories...]");
+    LogError("  -a: alignment of entry data in bytes (default %u, must be a power of two)",
+             ASSET_PACK_DEFAULT_ALIGNMENT);
+    LogError("  -r: store textures and meshes as-is instead of cooking them");
+    LogError("  -m: don't optimise cooked meshes for the vertex cache and vertex fetch");
+    LogError("  -d: don't sort the triangles of optimised meshes to reduce overdraw");
+    LogError("  -l: most levels of detail for cooked meshes, including the full mesh, 1 to disable (default %u)",
+             ASSET_MAX_MESH_LODS);
+    LogError("  -t: block compression for cooked textures, none, bc1, bc3, bc7 or auto for BC1 if opaque and BC7 "
+             "otherwise (default auto)");
+    LogError("  -c: zstd compression level, 0 to disable compression (default %d)", PACK_DEFAULT_COMPRESSION_LEVEL);
+    LogError("  -s: size of independently decompressible chunks (default %u)", ASSET_PACK_DEFAULT_CHUNK_SIZE);
+    LogError("  -n: don't train a dictionary for small files");
+    LogError("  -j: number of threads to load, cook and compress files on (default the number of processors)");
+    LogError("  -o: load order trace written by the engine, entries in it are laid out in the order they were loaded");
+}
+
+INT PurplMain(_In_ PCHAR *Arguments, _In_ UINT ArgumentCount)
+{
+    PACK_OPTIONS Options = {0};
+    PPACK_INPUT Inputs = NULL;
+    UINT i;
+
+    CmnInitialize(Arguments, ArgumentCount);
+
+    Options.Alignment = ASSET_PACK_DEFAULT_ALIGNMENT;
+    Options.Cook = TRUE;
+    Options.CompressionLevel = PACK_DEFAULT_COMPRESSION_LEVEL;
+    Options.ChunkSize = ASSET_PACK_DEFAULT_CHUNK_SIZE;
+    Options.TrainDictionary = TRUE;
+    Options.OptimizeMeshes = TRUE;
+    Options.OptimizeOverdraw = TRUE;
+    Options.LodCount = ASSET_MAX_MESH_LODS;
+    Options.TextureCompression = PackTextureCompressionAuto;
+    Options.ThreadCount = PackGetProcessorCount();
+
+    for (i = 1; i < ArgumentCount && Arguments[i][0] == '-'; i++)
+    {
+        if (strcmp(Arguments[i], "-a") == 0 && i + 1 < ArgumentCount)
+        {
+            Options.Alignment = (UINT32)strtoul(Arguments[++i], NULL, 0);
+        }
+        else if (strcmp(Arguments[i], "-r") == 0)
+        {
+            Options.Cook = FALSE;
+        }
+        else if (strcmp(Arguments[i], "-m") == 0)
+        {
+            Options.OptimizeMeshes = FALSE;
+        }
+        else if (strcmp(Arguments[i], "-d") == 0)
+        {
+            Options.OptimizeOverdraw = FALSE;
+        }
+        else if (strcmp(Arguments[i], "-l") == 0 && i + 1 < ArgumentCount)
+        {
+            Options.LodCount = (UINT32)strtoul(Arguments[++i], NULL, 0);
+        }
+        else if (strcmp(Arguments[i], "-t") == 0 && i + 1 < ArgumentCount)
+        {
+            if (!ParseTextureCompression(Arguments[++i], &Options.TextureCompression))
+            {
+                Usage();
+                return 1;
+            }
+        }
+        else if (strcmp(Arguments[i], "-c") == 0 && i + 1 < ArgumentCount)
+        {
+            Options.CompressionLevel = (INT32)strtol(Arguments[++i], NULL, 0);
+        }
+        else if (strcmp(Arguments[i], "-s") == 0 && i + 1 < ArgumentCount)
+        {
+            Options.ChunkSize = (UINT32)strtoul(Arguments[++i], NULL, 0);
+        }
+        else if (strcmp(Arguments[i], "-n") == 0)
+        {
+            Options.TrainDictionary = FALSE;
+        }
+        else if (strcmp(Arguments[i], "-j") == 0 && i + 1 < ArgumentCount)
+        {
+            Options.ThreadCount = (UINT32)strtoul(Arguments[++i], NULL, 0);
+        }
+        else if (strcmp(Arguments[i], "-o") == 0 && i + 1 < ArgumentCount)
+        {
+            Options.LoadOrderPath = Arguments[++i];
+        }
+        else
+        {
+            Usage();
+            return 1;
+        }
+    }
+
+    if (ArgumentCount - i < 2 || !Options.Alignment || (Options.Alignment & (Options.Alignment - 1)) ||
+        !Options.ChunkSize || !Options.LodCount || !Options.ThreadCount)
+    {
+        Usage();
+        return 1;
+    }
+
+    Options.OutputPath = Arguments[i++];
+    for (; i < ArgumentCount; i++)
+    {
+        CollectInputs(Arguments[i], &Inputs);
+    }
+
+    LoadInputs(Inputs, &Options);
+    DeduplicateInputs(Inputs);
+    ReadLoadOrder(Inputs, Options.LoadOrderPath);
+
+    PBYTE Dictionary = NULL;
+    UINT64 DictionarySize = 0;
+    if (Options.CompressionLevel && Options.TrainDictionary)
+    {
+        Dictionary = PackTrainDictionary(Inputs, &DictionarySize);
+    }
+
+    CompressInputs(Inputs, &Options, Dictionary, DictionarySize);
+    WritePack(Inputs, &Options, Dictionary, DictionarySize);
+
+    for (SIZE_T j = 0; j < stbds_arrlenu(Inputs); j++)
+    {
+        if (Inputs[j].StoredData && Inputs[j].StoredData != Inputs[j].Data)
+        {
+            CmnFree(Inputs[j].StoredData);
+        }
+        CmnFree(Inputs[j].Name);
+        CmnFree(Inputs[j].Data);
+    }
+    stbds_arrfree(Inputs);
+
+    if (Dictionary)
+    {
+        CmnFree(Dictionary);
+    }
+
+    CmnShutdown();
+
+    return 0;
+}
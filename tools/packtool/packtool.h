@@ -0,0 +1,177 @@
+/// @file packtool.h
+///
+/// @brief This file declares the internal API of the mapped pack builder.
+///
+/// @copyright (c) 2024 Randomcode Developers
+
+#pragma once
+
+#include "purpl/purpl.h"
+
+#include "common/alloc.h"
+#include "common/common.h"
+#include "common/filesystem.h"
+#include "common/log.h"
+
+#include "util/mesh.h"
+#include "util/texture.h"
+
+#include "engine/asset/packformat.h"
+
+/// @brief A file going into the pack
+PURPL_MAKE_TAG(struct, PACK_INPUT, {
+    PCHAR Name; // path inside the pack, relative to the input directory
+    UINT64 Hash;
+    PBYTE Data; // contents as the engine sees them, after cooking
+    UINT64 Size;
+    PBYTE StoredData; // contents as they're written, Data if not compressed
+    UINT64 StoredSize;
+    UINT32 Flags;
+    UINT64 ContentHash; // of Data, to find duplicates
+    PCSTR Original;     // name of an identical input whose stored data this one shares, NULL if it has its own
+    UINT32 LoadOrder;   // position in the load order trace, UINT32_MAX if it isn't in it
+})
+
+/// @brief How cooked textures are block compressed
+typedef enum PACK_TEXTURE_COMPRESSION
+{
+    PackTextureCompressionNone,
+    PackTextureCompressionAuto, // BC1 for opaque textures, BC7 for the rest
+    PackTextureCompressionBc1,
+    PackTextureCompressionBc3,
+    PackTextureCompressionBc7,
+} PACK_TEXTURE_COMPRESSION, *PPACK_TEXTURE_COMPRESSION;
+
+/// @brief Pack builder options
+PURPL_MAKE_TAG(struct, PACK_OPTIONS, {
+    PCSTR OutputPath;
+    UINT32 Alignment;
+    BOOLEAN Cook;           // convert textures and meshes to the cooked layout
+    INT32 CompressionLevel; // 0 to store everything uncompressed
+    UINT32 ChunkSize;
+    BOOLEAN TrainDictionary;
+    BOOLEAN OptimizeMeshes;   // reorder cooked meshes for the vertex cache and vertex fetch
+    BOOLEAN OptimizeOverdraw; // also sort clusters of triangles to reduce overdraw
+    UINT32 LodCount;          // most levels of detail to generate for cooked meshes, including the full mesh
+    PACK_TEXTURE_COMPRESSION TextureCompression;
+    UINT32 ThreadCount;
+    PCSTR LoadOrderPath; // load order trace to lay entry data out in, NULL to only sort it by name
+})
+
+/// @brief Default zstd compression level
+#define PACK_DEFAULT_COMPRESSION_LEVEL 19
+
+/// @brief Largest entry that gets compressed with the dictionary and used to train it
+#define PACK_DICTIONARY_MAX_ENTRY_SIZE (128 * 1024)
+
+/// @brief Size of trained dictionaries
+#define PACK_DICTIONARY_SIZE (112 * 1024)
+
+/// @brief Work done on each input by PackRunParallel
+typedef VOID (*PFN_PACK_INPUT_WORK)(_Inout_ PPACK_INPUT Input, _In_opt_ PVOID Context);
+
+/// @brief Round a size up to an alignment
+#define PACK_ALIGN(Value, Alignment) (((Value) + (Alignment) - 1) / (Alignment) * (Alignment))
+
+/// @brief Recursively list the files in a directory
+///
+/// @param[in] Root The directory to list
+/// @param[in] Relative The subdirectory being listed, NULL for the root
+/// @param[in,out] Names A stb_ds array that receives the relative path of each file
+extern VOID PackListFiles(_In_z_ PCSTR Root, _In_opt_z_ PCSTR Relative, _Inout_ PCHAR **Names);
+
+/// @brief Get the number of processors, for the default thread count
+///
+/// @return The number of processors, at least 1
+extern UINT32 PackGetProcessorCount(VOID);
+
+/// @brief Do some work on every input, spread across Options->ThreadCount threads
+///
+/// @param[in,out] Inputs The inputs
+/// @param[in] Options The builder options
+/// @param[in] Work The work to do on each input, which has to be safe to run on several inputs at once
+/// @param[in] Context Passed to Work
+extern VOID PackRunParallel(_Inout_ PPACK_INPUT Inputs, _In_ PCPACK_OPTIONS Options, _In_ PFN_PACK_INPUT_WORK Work,
+                            _In_opt_ PVOID Context);
+
+/// @brief Convert a file into the form it's stored in, based on its extension
+///
+/// @param[in,out] Input The file, Data/Size/Flags are replaced if it's cooked
+/// @param[in] Options The builder options
+extern VOID PackCookInput(_Inout_ PPACK_INPUT Input, _In_ PCPACK_OPTIONS Options);
+
+/// @brief Pick the format a texture should be cooked in
+///
+/// @param[in] Texture The texture
+/// @param[in] Options The builder options
+///
+/// @return The texture's current format, or the block compressed format to encode it in
+extern UINT32 PackChooseTextureFormat(_In_ PCTEXTURE Texture, _In_ PCPACK_OPTIONS Options);
+
+/// @brief Block compress an RGBA8 texture
+///
+/// @param[in] Texture The texture
+/// @param[in] Format The block compressed format
+/// @param[out] Data Receives the blocks, AstGetBlockCompressedSize bytes
+extern VOID PackEncodeTexture(_In_ PCTEXTURE Texture, _In_ UINT32 Format, _Out_ PBYTE Data);
+
+/// @brief Make the next mip level of an RGBA8 texture, half its size in each direction
+///
+/// @param[in] Texture The texture
+///
+/// @return The level, with its pixels in the same allocation, free it with CmnFree
+extern PTEXTURE PackDownsampleTexture(_In_ PCTEXTURE Texture);
+
+/// @brief Generate levels of detail for a mesh by collapsing edges, all sharing its vertices
+///
+/// @param[in] Name The name of the mesh, for logging
+/// @param[in] Mesh The mesh, which must have valid indices
+/// @param[in] Options The builder options
+/// @param[out] Indices Receives the triangles of every level of detail back to back, free with CmnFree
+/// @param[out] Lods Receives the range and error of each level of detail, ASSET_MAX_MESH_LODS entries
+///
+/// @return The number of levels of detail, at least 1
+extern UINT32 PackGenerateLods(_In_z_ PCSTR Name, _In_ PCMESH Mesh, _In_ PCPACK_OPTIONS Options, _Out_ ivec3 **Indices,
+                               _Out_ PASSET_MESH_LOD Lods);
+
+/// @brief Reorder each level of detail of a mesh for the post-transform vertex cache and optionally overdraw, then the
+/// vertices for fetch locality. Unused vertices are dropped.
+///
+/// @param[in] Name The name of the mesh, for logging
+/// @param[in,out] Mesh The mesh to optimise in place, with the indices of every level of detail
+/// @param[in] Lods The levels of detail
+/// @param[in] LodCount The number of levels of detail
+/// @param[in] Options The builder options
+extern VOID PackOptimizeMesh(_In_z_ PCSTR Name, _Inout_ PMESH Mesh, _In_ PCASSET_MESH_LOD Lods, _In_ UINT32 LodCount,
+                             _In_ PCPACK_OPTIONS Options);
+
+/// @brief Train a zstd dictionary on the small entries of a pack
+///
+/// @param[in] Inputs The files going into the pack
+/// @param[out] DictionarySize The size of the dictionary
+///
+/// @return The dictionary, or NULL if there wasn't enough to train on
+extern PBYTE PackTrainDictionary(_In_ PCPACK_INPUT Inputs, _Out_ PUINT64 DictionarySize);
+
+/// @brief Prepare a dictionary for compression, this is read only so every thread can share it
+///
+/// @param[in] Dictionary The dictionary, which has to outlive the prepared one
+/// @param[in] DictionarySize The size of the dictionary
+/// @param[in] Options The builder options
+///
+/// @return The prepared dictionary
+extern PVOID PackCreateCompressionDictionary(_In_ CONST VOID *Dictionary, _In_ UINT64 DictionarySize,
+                                             _In_ PCPACK_OPTIONS Options);
+
+/// @brief Free a dictionary from PackCreateCompressionDictionary
+///
+/// @param[in] CompressionDictionary The prepared dictionary
+extern VOID PackFreeCompressionDictionary(_In_ PVOID CompressionDictionary);
+
+/// @brief Compress a file into chunked zstd frames, or leave it as-is if that doesn't save space
+///
+/// @param[in,out] Input The file, StoredData/StoredSize/Flags are set
+/// @param[in] Options The builder options
+/// @param[in] CompressionDictionary The dictionary to use for small files from PackCreateCompressionDictionary, or NULL
+extern VOID PackCompressInput(_Inout_ PPACK_INPUT Input, _In_ PCPACK_OPTIONS Options,
+                              _In_opt_ CONST VOID *CompressionDictionary);
@@ -0,0 +1,121 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    parallel.c
+
+Abstract:
+
+    This file spreads the per-file work of the pack builder across threads.
+    Each thread takes the next input that hasn't been started yet, so big
+    files don't hold up a whole share of the others.
+
+--*/
+
+#include "packtool.h"
+
+#include "platform/async.h"
+
+#if defined PURPL_UNIX
+#include <unistd.h>
+#endif
+
+/// @brief Work shared between the threads
+PURPL_MAKE_TAG(struct, PACK_WORK_QUEUE, {
+    PAS_MUTEX Lock;
+    PPACK_INPUT Inputs;
+    UINT32 Count;
+    UINT32 Next;
+    PFN_PACK_INPUT_WORK Work;
+    PVOID Context;
+})
+
+UINT32 PackGetProcessorCount(VOID)
+{
+#if defined PURPL_UNIX
+    INT64 Count = (INT64)sysconf(_SC_NPROCESSORS_ONLN);
+    return Count > 0 ? (UINT32)Count : 1;
+#elif defined PURPL_WIN32
+    SYSTEM_INFO Info = {0};
+    GetSystemInfo(&Info);
+    return PURPL_MAX(Info.dwNumberOfProcessors, 1);
+#else
+    return 1;
+#endif
+}
+
+static INT WorkerThread(_In_ PPACK_WORK_QUEUE Queue)
+{
+    while (TRUE)
+    {
+        AsLockMutex(Queue->Lock, TRUE);
+        UINT32 Index = Queue->Next;
+        if (Index < Queue->Count)
+        {
+            Queue->Next++;
+        }
+        AsUnlockMutex(Queue->Lock);
+
+        if (Index >= Queue->Count)
+        {
+            break;
+        }
+
+        Queue->Work(&Queue->Inputs[Index], Queue->Context);
+    }
+
+    return 0;
+}
+
+VOID PackRunParallel(_Inout_ PPACK_INPUT Inputs, _In_ PCPACK_OPTIONS Options, _In_ PFN_PACK_INPUT_WORK Work,
+                     _In_opt_ PVOID Context)
+{
+    UINT32 Count = (UINT32)stbds_arrlenu(Inputs);
+    UINT32 ThreadCount = PURPL_MIN(Options->ThreadCount, Count);
+
+    if (ThreadCount <= 1)
+    {
+        for (UINT32 i = 0; i < Count; i++)
+        {
+            Work(&Inputs[i], Context);
+        }
+        return;
+    }
+
+    PACK_WORK_QUEUE Queue = {0};
+    Queue.Lock = AsCreateMutex();
+    if (!Queue.Lock)
+    {
+        CmnError("Failed to create work queue mutex");
+    }
+    Queue.Inputs = Inputs;
+    Queue.Count = Count;
+    Queue.Work = Work;
+    Queue.Context = Context;
+
+    PAS_THREAD *Threads = CmnAllocType(ThreadCount, PAS_THREAD);
+    if (!Threads)
+    {
+        CmnError("Failed to allocate threads: %s", strerror(errno));
+    }
+
+    for (UINT32 i = 0; i < ThreadCount; i++)
+    {
+        Threads[i] = AsCreateThread(CmnFormatTempString("Pack worker %u", i), PURPL_DEFAULT_THREAD_STACK_SIZE,
+                                    (PFN_THREAD_START)WorkerThread, &Queue);
+        if (!Threads[i])
+        {
+            CmnError("Failed to create pack worker thread %u", i);
+        }
+    }
+
+    for (UINT32 i = 0; i < ThreadCount; i++)
+    {
+        AsJoinThread(Threads[i]);
+    }
+
+    CmnFree(Threads);
+    AsDestroyMutex(Queue.Lock);
+}
@@ -0,0 +1,553 @@
+/*++
+
+Copyright (c) 2024 Randomcode Developers
+
+Module Name:
+
+    simplify.c
+
+Abstract:
+
+    This file generates levels of detail for meshes by collapsing edges in
+    order of quadric error. Vertices are only ever collapsed onto other
+    vertices, so every level of detail can share the full mesh's vertex
+    buffer and only needs its own indices. Vertices on UV or normal seams
+    are locked, and vertices on open borders can only slide along them.
+
+--*/
+
+#include "packtool.h"
+
+/// @brief Each level of detail aims for this fraction of the previous one's triangles
+#define SIMPLIFY_LOD_RATIO 0.5
+
+/// @brief A level of detail that doesn't get below this fraction of the previous one isn't worth keeping
+#define SIMPLIFY_MIN_REDUCTION 0.85
+
+/// @brief At most this fraction of the candidate edges are collapsed per pass, before costs are recomputed
+#define SIMPLIFY_PASS_FRACTION 0.25
+
+/// @brief Weight of the planes that keep open borders in place
+#define SIMPLIFY_BORDER_WEIGHT 10.0
+
+/// @brief Symmetric 4x4 matrix measuring the squared distance to a set of planes
+PURPL_MAKE_TAG(struct, SIMPLIFY_QUADRIC, {
+    DOUBLE A2, AB, AC, AD;
+    DOUBLE B2, BC, BD;
+    DOUBLE C2, CD;
+    DOUBLE D2;
+})
+
+/// @brief A possible collapse of one vertex onto another
+PURPL_MAKE_TAG(struct, SIMPLIFY_COLLAPSE, {
+    UINT32 From;
+    UINT32 To;
+    DOUBLE Cost;
+})
+
+/// @brief A vertex's position along with its index, so sorting doesn't need the vertices
+PURPL_MAKE_TAG(struct, SIMPLIFY_SORTED_VERTEX, {
+    FLOAT Position[3];
+    UINT32 Index;
+})
+
+static VOID AddPlane(_Inout_ PSIMPLIFY_QUADRIC Quadric, _In_ CONST DOUBLE Normal[3], _In_ DOUBLE Distance,
+                     _In_ DOUBLE Weight)
+{
+    DOUBLE A = Normal[0];
+    DOUBLE B = Normal[1];
+    DOUBLE C = Normal[2];
+    DOUBLE D = Distance;
+
+    Quadric->A2 += A * A * Weight;
+    Quadric->AB += A * B * Weight;
+    Quadric->AC += A * C * Weight;
+    Quadric->AD += A * D * Weight;
+    Quadric->B2 += B * B * Weight;
+    Quadric->BC += B * C * Weight;
+    Quadric->BD += B * D * Weight;
+    Quadric->C2 += C * C * Weight;
+    Quadric->CD += C * D * Weight;
+    Quadric->D2 += D * D * Weight;
+}
+
+static VOID AddQuadric(_Inout_ PSIMPLIFY_QUADRIC Quadric, _In_ PCSIMPLIFY_QUADRIC Other)
+{
+    Quadric->A2 += Other->A2;
+    Quadric->AB += Other->AB;
+    Quadric->AC += Other->AC;
+    Quadric->AD += Other->AD;
+    Quadric->B2 += Other->B2;
+    Quadric->BC += Other->BC;
+    Quadric->BD += Other->BD;
+    Quadric->C2 += Other->C2;
+    Quadric->CD += Other->CD;
+    Quadric->D2 += Other->D2;
+}
+
+static DOUBLE EvaluateQuadric(_In_ PCSIMPLIFY_QUADRIC Quadric, _In_ CONST FLOAT Point[3])
+{
+    DOUBLE X = Point[0];
+    DOUBLE Y = Point[1];
+    DOUBLE Z = Point[2];
+
+    DOUBLE Error = Quadric->A2 * X * X + 2 * Quadric->AB * X * Y + 2 * Quadric->AC * X * Z + 2 * Quadric->AD * X +
+                   Quadric->B2 * Y * Y + 2 * Quadric->BC * Y * Z + 2 * Quadric->BD * Y + Quadric->C2 * Z * Z +
+                   2 * Quadric->CD * Z + Quadric->D2;
+
+    // Rounding can take it slightly negative
+    return Error > 0.0 ? Error : 0.0;
+}
+
+static VOID GetNormal(_In_ CONST FLOAT A[3], _In_ CONST FLOAT B[3], _In_ CONST FLOAT C[3], _Out_ DOUBLE Normal[3])
+{
+    DOUBLE Edge1[3] = {B[0] - A[0], B[1] - A[1], B[2] - A[2]};
+    DOUBLE Edge2[3] = {C[0] - A[0], C[1] - A[1], C[2] - A[2]};
+
+    Normal[0] = Edge1[1] * Edge2[2] - Edge1[2] * Edge2[1];
+    Normal[1] = Edge1[2] * Edge2[0] - Edge1[0] * Edge2[2];
+    Normal[2] = Edge1[0] * Edge2[1] - Edge1[1] * Edge2[0];
+}
+
+static DOUBLE Normalize(_Inout_ DOUBLE Vector[3])
+{
+    DOUBLE Length = sqrt(Vector[0] * Vector[0] + Vector[1] * Vector[1] + Vector[2] * Vector[2]);
+    if (Length > 0.0)
+    {
+        Vector[0] /= Length;
+        Vector[1] /= Length;
+        Vector[2] /= Length;
+    }
+
+    return Length;
+}
+
+static INT CompareVertexPositions(_In_ CONST VOID *A, _In_ CONST VOID *B)
+{
+    CONST FLOAT *First = ((PCSIMPLIFY_SORTED_VERTEX)A)->Position;
+    CONST FLOAT *Second = ((PCSIMPLIFY_SORTED_VERTEX)B)->Position;
+
+    for (UINT32 i = 0; i < 3; i++)
+    {
+        if (First[i] != Second[i])
+        {
+            return First[i] < Second[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static INT CompareCollapses(_In_ CONST VOID *A, _In_ CONST VOID *B)
+{
+    PCSIMPLIFY_COLLAPSE First = A;
+    PCSIMPLIFY_COLLAPSE Second = B;
+
+    return First->Cost < Second->Cost ? -1 : First->Cost > Second->Cost ? 1 : 0;
+}
+
+// Vertices that share a position with another are on a seam, collapsing them would tear it open
+static VOID FindSeams(_In_ PCMESH Mesh, _Out_ BOOLEAN *Locked)
+{
+    UINT32 VertexCount = (UINT32)Mesh->VertexCount;
+    PSIMPLIFY_SORTED_VERTEX Order = CmnAllocType(VertexCount, SIMPLIFY_SORTED_VERTEX);
+    if (!Order)
+    {
+        CmnError("Failed to allocate simplifier state: %s", strerror(errno));
+    }
+
+    for (UINT32 i = 0; i < VertexCount; i++)
+    {
+        memcpy(Order[i].Position, Mesh->Vertices[i].Position, sizeof(Order[i].Position));
+        Order[i].Index = i;
+    }
+
+    qsort(Order, VertexCount, sizeof(SIMPLIFY_SORTED_VERTEX), CompareVertexPositions);
+
+    for (UINT32 i = 0; i + 1 < VertexCount; i++)
+    {
+        if (CompareVertexPositions(&Order[i], &Order[i + 1]) == 0)
+        {
+            Locked[Order[i].Index] = TRUE;
+            Locked[Order[i + 1].Index] = TRUE;
+        }
+    }
+
+    CmnFree(Order);
+}
+
+// Offsets has VertexCount + 1 entries, the triangles of vertex i are VertexTriangles[Offsets[i]..Offsets[i + 1]]
+static VOID BuildAdjacency(_In_ CONST ivec3 *Triangles, _In_ UINT32 TriangleCount, _In_ UINT32 VertexCount,
+                           _Out_ UINT32 *Offsets, _Out_ UINT32 *VertexTriangles)
+{
+    memset(Offsets, 0, (VertexCount + 1) * sizeof(UINT32));
+    for (UINT32 i = 0; i < TriangleCount; i++)
+    {
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            Offsets[Triangles[i][j] + 1]++;
+        }
+    }
+    for (UINT32 i = 0; i < VertexCount; i++)
+    {
+        Offsets[i + 1] += Offsets[i];
+    }
+
+    // Fill each vertex's range using its start as a cursor, which leaves it at the next vertex's start
+    for (UINT32 i = 0; i < TriangleCount; i++)
+    {
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            VertexTriangles[Offsets[Triangles[i][j]]++] = i;
+        }
+    }
+    for (UINT32 i = VertexCount; i > 0; i--)
+    {
+        Offsets[i] = Offsets[i - 1];
+    }
+    Offsets[0] = 0;
+}
+
+static BOOLEAN HasEdge(_In_ CONST ivec3 *Triangles, _In_ CONST UINT32 *VertexTriangles, _In_ CONST UINT32 *Offsets,
+                       _In_ UINT32 From, _In_ UINT32 To)
+{
+    for (UINT32 i = Offsets[From]; i < Offsets[From + 1]; i++)
+    {
+        CONST INT32 *Triangle = Triangles[VertexTriangles[i]];
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            if ((UINT32)Triangle[j] == From && (UINT32)Triangle[(j + 1) % 3] == To)
+            {
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+// Collapsing From onto To mustn't flip any of the triangles around From that survive
+static BOOLEAN FlipsTriangles(_In_ PCMESH Mesh, _In_ CONST ivec3 *Triangles, _In_ CONST UINT32 *VertexTriangles,
+                              _In_ CONST UINT32 *Offsets, _In_ UINT32 From, _In_ UINT32 To)
+{
+    for (UINT32 i = Offsets[From]; i < Offsets[From + 1]; i++)
+    {
+        CONST INT32 *Triangle = Triangles[VertexTriangles[i]];
+        if ((UINT32)Triangle[0] == To || (UINT32)Triangle[1] == To || (UINT32)Triangle[2] == To)
+        {
+            continue;
+        }
+
+        CONST FLOAT *Before[3];
+        CONST FLOAT *After[3];
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            Before[j] = Mesh->Vertices[Triangle[j]].Position;
+            After[j] = (UINT32)Triangle[j] == From ? Mesh->Vertices[To].Position : Before[j];
+        }
+
+        DOUBLE OldNormal[3];
+        DOUBLE NewNormal[3];
+        GetNormal(Before[0], Before[1], Before[2], OldNormal);
+        GetNormal(After[0], After[1], After[2], NewNormal);
+        if (Normalize(NewNormal) <= 0.0)
+        {
+            return TRUE;
+        }
+        Normalize(OldNormal);
+        if (OldNormal[0] * NewNormal[0] + OldNormal[1] * NewNormal[1] + OldNormal[2] * NewNormal[2] < 0.25)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+// Returns the number of triangles left in Triangles, which is simplified in place
+static UINT32 Simplify(_In_ PCMESH Mesh, _Inout_ ivec3 *Triangles, _In_ UINT32 TriangleCount,
+                       _In_ UINT32 TargetCount, _In_ CONST BOOLEAN *Locked, _Inout_ PSIMPLIFY_QUADRIC Quadrics,
+                       _Inout_ DOUBLE *MaxError)
+{
+    UINT32 VertexCount = (UINT32)Mesh->VertexCount;
+    UINT32 *Offsets = CmnAllocType(VertexCount + 1, UINT32);
+    UINT32 *VertexTriangles = CmnAllocType(TriangleCount * 3, UINT32);
+    BOOLEAN *Border = CmnAllocType(VertexCount, BOOLEAN);
+    BOOLEAN *Touched = CmnAllocType(VertexCount, BOOLEAN);
+    UINT32 *Remap = CmnAllocType(VertexCount, UINT32);
+    if (!Offsets || !VertexTriangles || !Border || !Touched || !Remap)
+    {
+        CmnError("Failed to allocate simplifier state: %s", strerror(errno));
+    }
+
+    while (TriangleCount > TargetCount)
+    {
+        BuildAdjacency(Triangles, TriangleCount, VertexCount, Offsets, VertexTriangles);
+
+        // An edge is on a border if no triangle has it going the other way
+        memset(Border, 0, VertexCount * sizeof(BOOLEAN));
+        for (UINT32 i = 0; i < TriangleCount; i++)
+        {
+            for (UINT32 j = 0; j < 3; j++)
+            {
+                UINT32 From = (UINT32)Triangles[i][j];
+                UINT32 To = (UINT32)Triangles[i][(j + 1) % 3];
+                if (!HasEdge(Triangles, VertexTriangles, Offsets, To, From))
+                {
+                    Border[From] = TRUE;
+                    Border[To] = TRUE;
+                }
+            }
+        }
+
+        SIMPLIFY_COLLAPSE *Collapses = NULL;
+        for (UINT32 i = 0; i < TriangleCount; i++)
+        {
+            for (UINT32 j = 0; j < 3; j++)
+            {
+                UINT32 A = (UINT32)Triangles[i][j];
+                UINT32 B = (UINT32)Triangles[i][(j + 1) % 3];
+                BOOLEAN BorderEdge = !HasEdge(Triangles, VertexTriangles, Offsets, B, A);
+
+                // Interior edges show up twice, only take them once
+                if (A == B || (!BorderEdge && A > B))
+                {
+                    continue;
+                }
+
+                // Border vertices can only move along the border
+                SIMPLIFY_COLLAPSE Best = {0, 0, -1.0};
+                UINT32 Ends[2][2] = {{A, B}, {B, A}};
+                for (UINT32 k = 0; k < 2; k++)
+                {
+                    UINT32 From = Ends[k][0];
+                    UINT32 To = Ends[k][1];
+                    if (Locked[From] || (Border[From] && !BorderEdge))
+                    {
+                        continue;
+                    }
+
+                    SIMPLIFY_QUADRIC Combined = Quadrics[From];
+                    AddQuadric(&Combined, &Quadrics[To]);
+                    DOUBLE Cost = EvaluateQuadric(&Combined, Mesh->Vertices[To].Position);
+                    if (Best.Cost < 0.0 || Cost < Best.Cost)
+                    {
+                        Best.From = From;
+                        Best.To = To;
+                        Best.Cost = Cost;
+                    }
+                }
+
+                if (Best.Cost >= 0.0)
+                {
+                    stbds_arrpush(Collapses, Best);
+                }
+            }
+        }
+
+        UINT32 CandidateCount = (UINT32)stbds_arrlenu(Collapses);
+        if (!CandidateCount)
+        {
+            break;
+        }
+        qsort(Collapses, CandidateCount, sizeof(SIMPLIFY_COLLAPSE), CompareCollapses);
+
+        // Take the cheapest collapses that don't overlap, a vertex's neighbourhood is only valid until it changes
+        for (UINT32 i = 0; i < VertexCount; i++)
+        {
+            Remap[i] = i;
+        }
+        memset(Touched, 0, VertexCount * sizeof(BOOLEAN));
+
+        UINT32 MaxCollapses = PURPL_MAX((UINT32)(CandidateCount * SIMPLIFY_PASS_FRACTION), 1);
+        UINT32 Removed = 0;
+        UINT32 Collapsed = 0;
+        for (UINT32 i = 0; i < CandidateCount && Collapsed < MaxCollapses && TriangleCount - Removed > TargetCount;
+             i++)
+        {
+            PCSIMPLIFY_COLLAPSE Collapse = &Collapses[i];
+            if (Touched[Collapse->From] || Touched[Collapse->To] ||
+                FlipsTriangles(Mesh, Triangles, VertexTriangles, Offsets, Collapse->From, Collapse->To))
+            {
+                continue;
+            }
+
+            for (UINT32 j = Offsets[Collapse->From]; j < Offsets[Collapse->From + 1]; j++)
+            {
+                CONST INT32 *Triangle = Triangles[VertexTriangles[j]];
+                BOOLEAN Shared = FALSE;
+                for (UINT32 k = 0; k < 3; k++)
+                {
+                    Touched[Triangle[k]] = TRUE;
+                    Shared |= (UINT32)Triangle[k] == Collapse->To;
+                }
+                Removed += Shared;
+            }
+
+            Remap[Collapse->From] = Collapse->To;
+            AddQuadric(&Quadrics[Collapse->To], &Quadrics[Collapse->From]);
+            *MaxError = PURPL_MAX(*MaxError, Collapse->Cost);
+            Collapsed++;
+        }
+        stbds_arrfree(Collapses);
+
+        if (!Collapsed)
+        {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles that became degenerate
+        UINT32 Kept = 0;
+        for (UINT32 i = 0; i < TriangleCount; i++)
+        {
+            UINT32 A = Remap[Triangles[i][0]];
+            UINT32 B = Remap[Triangles[i][1]];
+            UINT32 C = Remap[Triangles[i][2]];
+            if (A != B && B != C && C != A)
+            {
+                Triangles[Kept][0] = (INT32)A;
+                Triangles[Kept][1] = (INT32)B;
+                Triangles[Kept][2] = (INT32)C;
+                Kept++;
+            }
+        }
+        TriangleCount = Kept;
+    }
+
+    CmnFree(Remap);
+    CmnFree(Touched);
+    CmnFree(Border);
+    CmnFree(VertexTriangles);
+    CmnFree(Offsets);
+
+    return TriangleCount;
+}
+
+static VOID InitializeQuadrics(_In_ PCMESH Mesh, _Out_ PSIMPLIFY_QUADRIC Quadrics)
+{
+    UINT32 VertexCount = (UINT32)Mesh->VertexCount;
+    UINT32 TriangleCount = (UINT32)Mesh->IndexCount;
+    UINT32 *Offsets = CmnAllocType(VertexCount + 1, UINT32);
+    UINT32 *VertexTriangles = CmnAllocType(TriangleCount * 3, UINT32);
+    if (!Offsets || !VertexTriangles)
+    {
+        CmnError("Failed to allocate simplifier state: %s", strerror(errno));
+    }
+
+    BuildAdjacency(Mesh->Indices, TriangleCount, VertexCount, Offsets, VertexTriangles);
+    memset(Quadrics, 0, VertexCount * sizeof(SIMPLIFY_QUADRIC));
+
+    for (UINT32 i = 0; i < TriangleCount; i++)
+    {
+        CONST INT32 *Triangle = Mesh->Indices[i];
+        CONST FLOAT *Positions[3] = {Mesh->Vertices[Triangle[0]].Position, Mesh->Vertices[Triangle[1]].Position,
+                                     Mesh->Vertices[Triangle[2]].Position};
+
+        DOUBLE Normal[3];
+        GetNormal(Positions[0], Positions[1], Positions[2], Normal);
+        if (Normalize(Normal) <= 0.0)
+        {
+            continue;
+        }
+
+        DOUBLE Distance = -(Normal[0] * Positions[0][0] + Normal[1] * Positions[0][1] + Normal[2] * Positions[0][2]);
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            AddPlane(&Quadrics[Triangle[j]], Normal, Distance, 1.0);
+        }
+
+        // Border edges also get a plane through them perpendicular to the triangle, to keep the outline in place
+        for (UINT32 j = 0; j < 3; j++)
+        {
+            UINT32 From = (UINT32)Triangle[j];
+            UINT32 To = (UINT32)Triangle[(j + 1) % 3];
+            if (HasEdge(Mesh->Indices, VertexTriangles, Offsets, To, From))
+            {
+                continue;
+            }
+
+            CONST FLOAT *Start = Positions[j];
+            CONST FLOAT *End = Positions[(j + 1) % 3];
+            DOUBLE Edge[3] = {End[0] - Start[0], End[1] - Start[1], End[2] - Start[2]};
+            DOUBLE Perpendicular[3] = {Edge[1] * Normal[2] - Edge[2] * Normal[1],
+                                       Edge[2] * Normal[0] - Edge[0] * Normal[2],
+                                       Edge[0] * Normal[1] - Edge[1] * Normal[0]};
+            if (Normalize(Perpendicular) <= 0.0)
+            {
+                continue;
+            }
+
+            DOUBLE PerpendicularDistance =
+                -(Perpendicular[0] * Start[0] + Perpendicular[1] * Start[1] + Perpendicular[2] * Start[2]);
+            AddPlane(&Quadrics[From], Perpendicular, PerpendicularDistance, SIMPLIFY_BORDER_WEIGHT);
+            AddPlane(&Quadrics[To], Perpendicular, PerpendicularDistance, SIMPLIFY_BORDER_WEIGHT);
+        }
+    }
+
+    CmnFree(VertexTriangles);
+    CmnFree(Offsets);
+}
+
+UINT32 PackGenerateLods(_In_z_ PCSTR Name, _In_ PCMESH Mesh, _In_ PCPACK_OPTIONS Options, _Out_ ivec3 **Indices,
+                        _Out_ PASSET_MESH_LOD Lods)
+{
+    UINT32 TriangleCount = (UINT32)Mesh->IndexCount;
+
+    memset(Lods, 0, ASSET_MAX_MESH_LODS * sizeof(ASSET_MESH_LOD));
+    Lods[0].IndexCount = TriangleCount;
+
+    // Every level of detail goes in one array, each one starts as a copy of the last and gets simplified in place
+    *Indices = CmnAllocType((UINT64)TriangleCount * ASSET_MAX_MESH_LODS, ivec3);
+    if (!*Indices)
+    {
+        CmnError("Failed to allocate indices for levels of detail of %s: %s", Name, strerror(errno));
+    }
+    memcpy(*Indices, Mesh->Indices, TriangleCount * sizeof(ivec3));
+
+    UINT32 LodCount = 1;
+    UINT32 MaxLods = PURPL_MIN(Options->LodCount, ASSET_MAX_MESH_LODS);
+    if (MaxLods < 2 || !TriangleCount)
+    {
+        return LodCount;
+    }
+
+    PSIMPLIFY_QUADRIC Quadrics = CmnAllocType(Mesh->VertexCount, SIMPLIFY_QUADRIC);
+    BOOLEAN *Locked = CmnAllocType(Mesh->VertexCount, BOOLEAN);
+    if (!Quadrics || !Locked)
+    {
+        CmnError("Failed to allocate simplifier state: %s", strerror(errno));
+    }
+
+    InitializeQuadrics(Mesh, Quadrics);
+    FindSeams(Mesh, Locked);
+
+    // The quadrics keep accumulating, so each level's error is measured against the full mesh
+    DOUBLE MaxError = 0.0;
+    while (LodCount < MaxLods)
+    {
+        PCASSET_MESH_LOD Previous = &Lods[LodCount - 1];
+        UINT32 Offset = (UINT32)(Previous->IndexOffset + Previous->IndexCount);
+        ivec3 *Triangles = *Indices + Offset;
+        memcpy(Triangles, *Indices + Previous->IndexOffset, Previous->IndexCount * sizeof(ivec3));
+
+        UINT32 Target = (UINT32)(Previous->IndexCount * SIMPLIFY_LOD_RATIO);
+        UINT32 Count = Simplify(Mesh, Triangles, (UINT32)Previous->IndexCount, Target, Locked, Quadrics, &MaxError);
+        if (!Count || Count > Previous->IndexCount * SIMPLIFY_MIN_REDUCTION)
+        {
+            LogDebug("Stopping at %u levels of detail for %s, level %u only got down to %u of %llu triangles",
+                     LodCount, Name, LodCount, Count, Previous->IndexCount);
+            break;
+        }
+
+        Lods[LodCount].IndexOffset = Offset;
+        Lods[LodCount].IndexCount = Count;
+        Lods[LodCount].Error = (FLOAT)sqrt(MaxError);
+        LogDebug("Level of detail %u of %s has %u triangles, error %f", LodCount, Name, Count,
+                 Lods[LodCount].Error);
+        LodCount++;
+    }
+
+    CmnFree(Locked);
+    CmnFree(Quadrics);
+
+    return LodCount;
+}
@@ -48,8 +48,12 @@ local swrast = is_plat("gdk", "windows", "baremetal")
 
 local discord = is_plat("gdk", "gdkx", "windows", "macos", "linux", "freebsd")
 local use_mimalloc = not is_plat("xbox360", "switch", "switchhb", "psp", "ps3", "baremetal")
+local profiler = not is_mode("release")
 
 add_defines("PURPL_ENGINE")
+if profiler then
+    add_defines("PURPL_PROFILE")
+end
 
 includes(path.join("buildscripts", "shared.lua"))
 setup_shared("$(scriptdir)", directx, vulkan, opengl, swrast)
@@ -260,9 +264,10 @@ target_end()
 
 target("engine")
     set_kind("static")
-    add_headerfiles(path.join("engine", "*.h"), path.join("engine", "math", "*.h"))
-    add_files(path.join("engine", "*.c"))
+    add_headerfiles(path.join("engine", "*.h"), path.join("engine", "asset", "*.h"), path.join("engine", "math", "*.h"))
+    add_files(path.join("engine", "*.c"), path.join("engine", "asset", "*.c"), path.join("engine", "math", "*.c"))
 
+    add_includedirs(path.join("deps", "zstd", "lib"))
     add_deps(
         "common",
         "cjson",
@@ -271,7 +276,8 @@ target("engine")
         "physics",
         "platform",
         "render",
-        "util"
+        "util",
+        "zstd"
     )
 
     if not discord then
@@ -286,6 +292,33 @@ target("engine")
     on_load(fix_target)
 target_end()
 
+target("packtool")
+    set_kind("binary")
+    add_headerfiles(path.join("tools", "packtool", "*.h"), path.join("engine", "asset", "packformat.h"))
+    add_files(path.join("tools", "packtool", "*.c"))
+    add_includedirs(path.join("deps", "zstd", "lib"))
+    add_deps("common", "platform", "util", "zstd")
+
+    support_executable("support")
+
+    set_group("Tools")
+
+    on_load(fix_target)
+target_end()
+
+target("mathbench")
+    set_kind("binary")
+    add_headerfiles(path.join("engine", "math", "*.h"))
+    add_files(path.join("tools", "mathbench", "*.c"), path.join("engine", "math", "*.c"))
+    add_deps("common", "platform", "util")
+
+    support_executable("support")
+
+    set_group("Tools")
+
+    on_load(fix_target)
+target_end()
+
 target("purpl")
     set_kind("binary")
     -- header files in this case are just anything that doesn't participate in the build
@@ -340,3 +373,43 @@ target("purpl")
         end
     end)
 target_end()
+
+task("pack")
+    set_category("plugin")
+    on_run(function ()
+        import("core.base.option")
+        import("core.project.config")
+        import("core.project.project")
+
+        config.load()
+        local packtool = project.target("packtool"):targetfile()
+        if not os.isfile(packtool) then
+            raise("packtool hasn't been built, run xmake build packtool first")
+        end
+
+        local args = {}
+        for _, pair in ipairs({{"jobs", "-j"}, {"level", "-c"}, {"alignment", "-a"}, {"order", "-o"}}) do
+            if option.get(pair[1]) then
+                table.insert(args, pair[2])
+                table.insert(args, option.get(pair[1]))
+            end
+        end
+        table.insert(args, option.get("output"))
+        -- same order as the engine's directory sources, later ones override earlier ones
+        table.insert(args, path.join("assets"))
+        table.insert(args, path.join("assets", "out"))
+
+        os.execv(packtool, args)
+    end)
+    set_menu({
+        usage = "xmake pack [options]",
+        description = "Build the mapped asset pack from the asset directories with packtool",
+        options = {
+            {'j', "jobs", "kv", nil, "Number of threads to use, the number of processors by default"},
+            {'c', "level", "kv", nil, "zstd compression level, 0 to store entries uncompressed"},
+            {'a', "alignment", "kv", nil, "Alignment of entry data in bytes"},
+            {'O', "order", "kv", nil, "Load order trace from the engine's data directory to lay entries out by"},
+            {nil, "output", "kv", path.join("assets", "assets_mapped.pak"), "Pack to write"}
+        }
+    })
+task_end()